@@ -0,0 +1,472 @@
+/*
+    CIieeefp: CIbatch.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains arithmetic on arrays of doubles which keeps
+   track of the exceptions raised by each element. The elements are
+   done in blocks of 64, one word of each bitmap. The exception flags
+   are cleared before each block and read after it, which costs little
+   next to 64 operations. Only if a block raises one of the exceptions
+   being tracked is it done again, an element at a time, clearing and
+   reading the flags around each one to find which elements raised
+   what. Since the same operation on the same operands always raises
+   the same exceptions, this gives the same bitmaps as checking every
+   element, at the speed of the vector instructions when exceptions
+   are rare.
+
+   The kernels are built for SSE2, AVX and AVX-512 with target
+   attributes and chosen at run time, as in fpclass_array(). They work
+   on the SSE unit, even for the odd elements at the end, so that the
+   MXCSR controls the rounding and collects the flags. Without the
+   kernels (compilers older than gcc 5), the arithmetic is done in C
+   on whichever unit the compiler uses, and the flags are handled
+   through fpsetround(), fpsetsticky() and fpgetsticky().
+
+   fp_add_rnd() and the rest track no exceptions, and on CPUs with
+   AVX-512 use its embedded rounding, which gives each instruction its
+   own rounding direction and suppresses exceptions, so that they do
+   not touch the MXCSR at all. FP_RS is done in software: each result
+   is worked out rounded to nearest along with its exact error, using
+   the error-free transformations in CIdd.c, and moved to the number
+   on the other side of the exact result with probability in
+   proportion to the error by fpsr_round() in CIsround.c. The
+   fpbatch_ functions, which set the hardware to the direction, abort
+   on FP_RS as fpsetround() does. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CIbatch.h>
+#include <CIdd.h>
+#include <CIsround.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+
+#if defined(__GNUC__) && __GNUC__ >= 5 \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build SSE2/AVX/AVX-512
+				   kernels chosen at run time */
+#include <immintrin.h>
+#endif
+
+#define BATCH_BLOCK 64		/* Elements per bitmap word */
+#define BATCH_SR 256		/* Elements per chunk for FP_RS */
+
+typedef enum { BATCH_ADD = 0, BATCH_SUB, BATCH_MUL, BATCH_DIV } BATCH_OP;
+
+static const char *const batch_names[4] = { "add", "sub", "mul", "div" };
+
+typedef void (*BATCH_KERNEL)(const double *a, const double *b, double *r,
+			     size_t n);
+
+#ifdef CI_SIMD_KERNELS
+
+/* batch_OP_KERNEL(a, b, r, n)
+ *
+ * OP = {add, sub, mul, div}, KERNEL = {sse2, avx, avx512}
+ *
+ * Put a[i] OP b[i] in r[i] for the n elements. The AVX and AVX-512
+ * kernels leave the elements after the last whole vector to the SSE2
+ * kernel, which does an odd last element with a scalar instruction.
+ */
+
+#define BATCH_SSE2(name, op_pd, op_sd) \
+static __attribute__((target("sse2"))) \
+void batch_##name##_sse2(const double *a, const double *b, double *r, \
+			 size_t n) { \
+  size_t i; \
+ \
+  for(i = 0; i + 2 <= n; i += 2) { \
+    _mm_storeu_pd(r + i, op_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i))); \
+  } \
+  if(i < n) { \
+    _mm_store_sd(r + i, op_sd(_mm_load_sd(a + i), _mm_load_sd(b + i))); \
+  } \
+}
+
+#define BATCH_AVX(name, op_pd) \
+static __attribute__((target("avx"))) \
+void batch_##name##_avx(const double *a, const double *b, double *r, \
+			size_t n) { \
+  size_t i; \
+ \
+  for(i = 0; i + 4 <= n; i += 4) { \
+    _mm256_storeu_pd(r + i, op_pd(_mm256_loadu_pd(a + i), \
+				  _mm256_loadu_pd(b + i))); \
+  } \
+  if(i < n) batch_##name##_sse2(a + i, b + i, r + i, n - i); \
+}
+
+#define BATCH_AVX512(name, op_pd) \
+static __attribute__((target("avx512f"))) \
+void batch_##name##_avx512(const double *a, const double *b, double *r, \
+			   size_t n) { \
+  size_t i; \
+ \
+  for(i = 0; i + 8 <= n; i += 8) { \
+    _mm512_storeu_pd(r + i, op_pd(_mm512_loadu_pd(a + i), \
+				  _mm512_loadu_pd(b + i))); \
+  } \
+  if(i < n) batch_##name##_sse2(a + i, b + i, r + i, n - i); \
+}
+
+BATCH_SSE2(add, _mm_add_pd, _mm_add_sd)
+BATCH_SSE2(sub, _mm_sub_pd, _mm_sub_sd)
+BATCH_SSE2(mul, _mm_mul_pd, _mm_mul_sd)
+BATCH_SSE2(div, _mm_div_pd, _mm_div_sd)
+BATCH_AVX(add, _mm256_add_pd)
+BATCH_AVX(sub, _mm256_sub_pd)
+BATCH_AVX(mul, _mm256_mul_pd)
+BATCH_AVX(div, _mm256_div_pd)
+BATCH_AVX512(add, _mm512_add_pd)
+BATCH_AVX512(sub, _mm512_sub_pd)
+BATCH_AVX512(mul, _mm512_mul_pd)
+BATCH_AVX512(div, _mm512_div_pd)
+
+static const BATCH_KERNEL batch_sse2[4] = {
+  batch_add_sse2, batch_sub_sse2, batch_mul_sse2, batch_div_sse2
+};
+static const BATCH_KERNEL batch_avx[4] = {
+  batch_add_avx, batch_sub_avx, batch_mul_avx, batch_div_avx
+};
+static const BATCH_KERNEL batch_avx512[4] = {
+  batch_add_avx512, batch_sub_avx512, batch_mul_avx512, batch_div_avx512
+};
+
+/* batch_OP_RND_avx512(a, b, r, n)
+ *
+ * OP = {add, sub, mul, div}, RND = {rn, rm, rp, rz}
+ *
+ * Put a[i] OP b[i] in r[i] for the n elements, with the rounding
+ * direction embedded in each instruction and exceptions suppressed,
+ * so that the MXCSR is neither read nor written. The elements after
+ * the last whole vector are done with a masked load and store.
+ */
+
+#define BATCH_RND_AVX512(name, rnd, op_round_pd, mode) \
+static __attribute__((target("avx512f"))) \
+void batch_##name##_##rnd##_avx512(const double *a, const double *b, \
+				   double *r, size_t n) { \
+  size_t i; \
+  __mmask8 k; \
+ \
+  for(i = 0; i + 8 <= n; i += 8) { \
+    _mm512_storeu_pd(r + i, op_round_pd(_mm512_loadu_pd(a + i), \
+					_mm512_loadu_pd(b + i), \
+					(mode) | _MM_FROUND_NO_EXC)); \
+  } \
+  if(i < n) { \
+    k = (__mmask8)((1U << (n - i)) - 1U); \
+    _mm512_mask_storeu_pd(r + i, k, \
+			  op_round_pd(_mm512_maskz_loadu_pd(k, a + i), \
+				      _mm512_maskz_loadu_pd(k, b + i), \
+				      (mode) | _MM_FROUND_NO_EXC)); \
+  } \
+}
+
+#define BATCH_RND_AVX512_ALL(name, op_round_pd) \
+BATCH_RND_AVX512(name, rn, op_round_pd, _MM_FROUND_TO_NEAREST_INT) \
+BATCH_RND_AVX512(name, rm, op_round_pd, _MM_FROUND_TO_NEG_INF) \
+BATCH_RND_AVX512(name, rp, op_round_pd, _MM_FROUND_TO_POS_INF) \
+BATCH_RND_AVX512(name, rz, op_round_pd, _MM_FROUND_TO_ZERO)
+
+BATCH_RND_AVX512_ALL(add, _mm512_add_round_pd)
+BATCH_RND_AVX512_ALL(sub, _mm512_sub_round_pd)
+BATCH_RND_AVX512_ALL(mul, _mm512_mul_round_pd)
+BATCH_RND_AVX512_ALL(div, _mm512_div_round_pd)
+
+static const BATCH_KERNEL batch_rnd_avx512[4][4] = {
+  { batch_add_rn_avx512, batch_add_rm_avx512, batch_add_rp_avx512,
+    batch_add_rz_avx512 },
+  { batch_sub_rn_avx512, batch_sub_rm_avx512, batch_sub_rp_avx512,
+    batch_sub_rz_avx512 },
+  { batch_mul_rn_avx512, batch_mul_rm_avx512, batch_mul_rp_avx512,
+    batch_mul_rz_avx512 },
+  { batch_div_rn_avx512, batch_div_rm_avx512, batch_div_rp_avx512,
+    batch_div_rz_avx512 }
+};				/* Indexed by BATCH_OP and fp_rnd */
+
+#else
+
+/* batch_OP(a, b, r, n)
+ *
+ * OP = {add, sub, mul, div}
+ *
+ * Put a[i] OP b[i] in r[i] for the n elements, in C.
+ */
+
+#define BATCH_C(name, op) \
+static void batch_##name(const double *a, const double *b, double *r, \
+			 size_t n) { \
+  size_t i; \
+ \
+  for(i = 0; i < n; i++) r[i] = a[i] op b[i]; \
+}
+
+BATCH_C(add, +)
+BATCH_C(sub, -)
+BATCH_C(mul, *)
+BATCH_C(div, /)
+
+static const BATCH_KERNEL batch_c[4] = {
+  batch_add, batch_sub, batch_mul, batch_div
+};
+
+#endif
+
+/* batch(op, a, b, r, n, rnd, track, maps) -> exceptions raised
+ *
+ * Do the work of fpbatch_add() and the rest for operation op. If r is
+ * a or b and a block may have to be done again, the block's results
+ * are put in a buffer and only copied to r once its operands are no
+ * longer needed.
+ */
+
+static fp_except batch(BATCH_OP op, const double *a, const double *b,
+		       double *r, size_t n, fp_rnd rnd, fp_except track,
+		       uint64_t *maps) {
+  size_t words = FP_BATCH_WORDS(n);
+  size_t start, len, j;
+  BATCH_KERNEL kernel, single;
+  fp_except raised = 0U, x;
+  double block[BATCH_BLOCK], *out;
+  int e;
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr mxcsr, ctl;
+#else
+  fp_rnd old_rnd;
+  fp_except before;
+#endif
+
+  if(rnd > FP_RZ) {
+    fprintf(stderr, "fpbatch_%s called with invalid rounding direction: "
+	    "%hx\n", batch_names[op], rnd);
+    abort();
+  }
+#ifdef CI_SIMD_KERNELS
+  if(__builtin_cpu_supports("avx512f")) kernel = batch_avx512[op];
+  else if(__builtin_cpu_supports("avx")) kernel = batch_avx[op];
+  else kernel = batch_sse2[op];
+  single = batch_sse2[op];
+  mxcsr = SSE_stmxcsr();
+  ctl = set_mxcsr_flag(mxcsr & ~MX_XF, MX_RC, rnd);
+#define BATCH_CLEAR() SSE_ldmxcsr(ctl)
+#define BATCH_FLAGS() ((fp_except)(SSE_stmxcsr() & MX_XF))
+#else
+  kernel = single = batch_c[op];
+  old_rnd = fpsetround(rnd);
+  before = fpsetsticky(0);
+#define BATCH_CLEAR() fpsetsticky(0)
+#define BATCH_FLAGS() fpgetsticky()
+#endif
+
+  if(maps != NULL) memset(maps, 0, FP_BATCH_NMAPS * words * sizeof(uint64_t));
+  for(start = 0; start < n; start += BATCH_BLOCK) {
+    len = (n - start < BATCH_BLOCK) ? n - start : BATCH_BLOCK;
+    out = (r == a || r == b) && maps != NULL ? block : r + start;
+    BATCH_CLEAR();
+    kernel(a + start, b + start, out, len);
+    x = BATCH_FLAGS();
+    raised |= x;
+    if(maps != NULL && (x & track) != 0U) {
+      for(j = 0; j < len; j++) {
+	BATCH_CLEAR();
+	single(a + start + j, b + start + j, out + j, 1);
+	x = BATCH_FLAGS() & track;
+	for(e = 0; e < FP_BATCH_NMAPS; e++) {
+	  if(x & (1U << e)) {
+	    maps[(e * words) + (start / BATCH_BLOCK)] |= (uint64_t)1 << j;
+	  }
+	}
+      }
+    }
+    if(out != r + start) memcpy(r + start, out, len * sizeof(double));
+  }
+
+#ifdef CI_SIMD_KERNELS
+  SSE_ldmxcsr(mxcsr | raised);
+  if((fpgetunit() & FP_UNIT_SSE) == 0U) {
+				/* Flags in the MXCSR not read */
+    fpsetsticky(fpgetsticky() | raised);
+  }
+#else
+  fpsetround(old_rnd);
+  fpsetsticky(before | raised);
+#endif
+#undef BATCH_CLEAR
+#undef BATCH_FLAGS
+
+  return raised;
+}
+
+/* batch_stochastic(op, a, b, r, n)
+ *
+ * Do the work of fp_add_rnd() and the rest for FP_RS, a chunk of
+ * BATCH_SR elements at a time. The error of a quotient q is found
+ * from the remainder a - q b, which is exact. Exceptions are masked
+ * and the sticky bits put back afterwards.
+ */
+
+static void batch_stochastic(BATCH_OP op, const double *a, const double *b,
+			     double *r, size_t n) {
+  double hi[BATCH_SR], err[BATCH_SR], t[BATCH_SR];
+  fp_except before, mask;
+  size_t start, len, j;
+
+  mask = fpsetmask(0U);
+  before = fpgetsticky();
+  for(start = 0; start < n; start += len) {
+    len = n - start < BATCH_SR ? n - start : BATCH_SR;
+    switch(op) {
+    case BATCH_ADD:
+      fp_two_sum_array(a + start, b + start, hi, err, len);
+      break;
+    case BATCH_SUB:
+      for(j = 0; j < len; j++) t[j] = -b[start + j];
+      fp_two_sum_array(a + start, t, hi, err, len);
+      break;
+    case BATCH_MUL:
+      fp_two_prod_array(a + start, b + start, hi, err, len);
+      break;
+    case BATCH_DIV:
+      fp_div_rnd(a + start, b + start, hi, len, FP_RN);
+      fp_two_prod_array(hi, b + start, t, err, len);
+      for(j = 0; j < len; j++) {
+	err[j] = ((a[start + j] - t[j]) - err[j]) / b[start + j];
+      }
+      break;
+    }
+    fpsr_round(hi, err, r + start, len);
+  }
+  fpsetsticky(before);
+  fpsetmask(mask);
+}
+
+/* batch_rnd(op, a, b, r, n, rnd)
+ *
+ * Do the work of fp_add_rnd() and the rest for operation op. Without
+ * AVX-512 the MXCSR is loaded once to set the rounding direction and
+ * mask all exceptions, and once to put it back as it was, flags and
+ * all. FP_RS is passed on to batch_stochastic(); any other direction
+ * the hardware does not have aborts the program.
+ */
+
+static void batch_rnd(BATCH_OP op, const double *a, const double *b,
+		      double *r, size_t n, fp_rnd rnd) {
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr mxcsr;
+#else
+  fp_rnd old_rnd;
+  fp_except before, mask;
+#endif
+
+  if(rnd > FP_RS) {
+    fprintf(stderr, "fp_%s_rnd called with invalid rounding direction: "
+	    "%hx\n", batch_names[op], rnd);
+    abort();
+  }
+  if(rnd == FP_RS) {
+    batch_stochastic(op, a, b, r, n);
+    return;
+  }
+#ifdef CI_SIMD_KERNELS
+  if(__builtin_cpu_supports("avx512f")) {
+    batch_rnd_avx512[op][rnd](a, b, r, n);
+    return;
+  }
+  mxcsr = SSE_stmxcsr();
+  SSE_ldmxcsr(set_mxcsr_flag(mxcsr | MX_XM, MX_RC, rnd));
+  if(__builtin_cpu_supports("avx")) batch_avx[op](a, b, r, n);
+  else batch_sse2[op](a, b, r, n);
+  SSE_ldmxcsr(mxcsr);
+#else
+  old_rnd = fpsetround(rnd);
+  mask = fpsetmask(0U);
+  before = fpgetsticky();
+  batch_c[op](a, b, r, n);
+  fpsetsticky(before);
+  fpsetmask(mask);
+  fpsetround(old_rnd);
+#endif
+}
+
+/* fpbatch_add(a, b, r, n, rnd, track, maps) -> exceptions raised
+ * fpbatch_sub(a, b, r, n, rnd, track, maps) -> exceptions raised
+ * fpbatch_mul(a, b, r, n, rnd, track, maps) -> exceptions raised
+ * fpbatch_div(a, b, r, n, rnd, track, maps) -> exceptions raised
+ *
+ * See CIbatch.h.
+ */
+
+fp_except fpbatch_add(const double *a, const double *b, double *r,
+		      size_t n, fp_rnd rnd, fp_except track, uint64_t *maps) {
+  return batch(BATCH_ADD, a, b, r, n, rnd, track, maps);
+}
+
+fp_except fpbatch_sub(const double *a, const double *b, double *r,
+		      size_t n, fp_rnd rnd, fp_except track, uint64_t *maps) {
+  return batch(BATCH_SUB, a, b, r, n, rnd, track, maps);
+}
+
+fp_except fpbatch_mul(const double *a, const double *b, double *r,
+		      size_t n, fp_rnd rnd, fp_except track, uint64_t *maps) {
+  return batch(BATCH_MUL, a, b, r, n, rnd, track, maps);
+}
+
+fp_except fpbatch_div(const double *a, const double *b, double *r,
+		      size_t n, fp_rnd rnd, fp_except track, uint64_t *maps) {
+  return batch(BATCH_DIV, a, b, r, n, rnd, track, maps);
+}
+
+/* fp_add_rnd(a, b, r, n, rnd)
+ * fp_sub_rnd(a, b, r, n, rnd)
+ * fp_mul_rnd(a, b, r, n, rnd)
+ * fp_div_rnd(a, b, r, n, rnd)
+ *
+ * See CIbatch.h.
+ */
+
+void fp_add_rnd(const double *a, const double *b, double *r, size_t n,
+		fp_rnd rnd) {
+  batch_rnd(BATCH_ADD, a, b, r, n, rnd);
+}
+
+void fp_sub_rnd(const double *a, const double *b, double *r, size_t n,
+		fp_rnd rnd) {
+  batch_rnd(BATCH_SUB, a, b, r, n, rnd);
+}
+
+void fp_mul_rnd(const double *a, const double *b, double *r, size_t n,
+		fp_rnd rnd) {
+  batch_rnd(BATCH_MUL, a, b, r, n, rnd);
+}
+
+void fp_div_rnd(const double *a, const double *b, double *r, size_t n,
+		fp_rnd rnd) {
+  batch_rnd(BATCH_DIV, a, b, r, n, rnd);
+}
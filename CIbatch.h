@@ -0,0 +1,119 @@
+/*
+    CIieeefp: CIbatch.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIbatch.c,
+   which do arithmetic on arrays of doubles several elements at a
+   time, keeping track of which elements raised which exceptions. */
+
+#ifndef CIBATCH_H
+#define CIBATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <CIieeefp.h>
+
+/* Exception bitmaps
+ *
+ * The bitmaps for n elements are FP_BATCH_NMAPS arrays of
+ * FP_BATCH_WORDS(n) 64-bit words, one after another, the first for
+ * FP_X_INV and the rest in the order of the FP_X_ bits. Bit i % 64 of
+ * word i / 64 of an exception's bitmap is set if element i raised the
+ * exception. FP_BATCH_MAP() finds the bitmap for an exception (given
+ * as one FP_X_ bit) and FP_BATCH_TEST() tests an element's bit in it.
+ */
+
+#define FP_BATCH_NMAPS 6
+#define FP_BATCH_WORDS(n) (((n) + 63) / 64)
+#define FP_BATCH_MAP(maps, n, except) \
+  ((maps) + (__builtin_ctz(except) * FP_BATCH_WORDS(n)))
+#define FP_BATCH_TEST(map, i) (((map)[(i) / 64] >> ((i) % 64)) & 1U)
+
+/* fpbatch_add(a, b, r, n, rnd, track, maps) -> exceptions raised
+ * fpbatch_sub(a, b, r, n, rnd, track, maps) -> exceptions raised
+ * fpbatch_mul(a, b, r, n, rnd, track, maps) -> exceptions raised
+ * fpbatch_div(a, b, r, n, rnd, track, maps) -> exceptions raised
+ *
+ * Put a[i] + b[i] (or -, *, /) in r[i] for each of the n elements,
+ * rounding in direction rnd, and return all the exceptions raised,
+ * which are also added to the sticky bits. If maps is not NULL, it
+ * must have room for the FP_BATCH_NMAPS bitmaps for n elements, which
+ * are filled in for the exceptions in track (the others are left
+ * clear). Blocks of 64 elements are done using the widest vector
+ * instructions the CPU supports; only a block raising an exception in
+ * track is done again an element at a time to find which elements
+ * raised it. Inexact results are common, so tracking FP_X_IMP is much
+ * slower. The rounding direction and other settings are left as they
+ * were, and the arithmetic is done on the SSE unit whatever units the
+ * library is looking after. rnd must be one of the directions the
+ * hardware has: FP_RS, or an invalid direction, is reported on stderr
+ * and the program aborted, as with fpsetround(). r may be the same
+ * array as a or b, but must not otherwise overlap either.
+ */
+
+extern fp_except fpbatch_add(const double *a, const double *b, double *r,
+			     size_t n, fp_rnd rnd, fp_except track,
+			     uint64_t *maps);
+extern fp_except fpbatch_sub(const double *a, const double *b, double *r,
+			     size_t n, fp_rnd rnd, fp_except track,
+			     uint64_t *maps);
+extern fp_except fpbatch_mul(const double *a, const double *b, double *r,
+			     size_t n, fp_rnd rnd, fp_except track,
+			     uint64_t *maps);
+extern fp_except fpbatch_div(const double *a, const double *b, double *r,
+			     size_t n, fp_rnd rnd, fp_except track,
+			     uint64_t *maps);
+
+/* fp_add_rnd(a, b, r, n, rnd)
+ * fp_sub_rnd(a, b, r, n, rnd)
+ * fp_mul_rnd(a, b, r, n, rnd)
+ * fp_div_rnd(a, b, r, n, rnd)
+ *
+ * Put a[i] + b[i] (or -, *, /) in r[i] for each of the n elements,
+ * rounding in direction rnd, without raising exceptions or changing
+ * the rounding direction, sticky bits or masks seen by other code.
+ * With AVX-512 the direction is embedded in each instruction and the
+ * MXCSR is not touched; otherwise it is switched once for the whole
+ * array and put back. Flush-to-zero and denormals-are-zeros apply as
+ * set in the MXCSR. Like the fpbatch_ functions, the arithmetic is
+ * done on the SSE unit. rnd may also be FP_RS (see CIsround.h), which
+ * is done in software, several times slower, taking random numbers
+ * from the calling thread's stream. An invalid direction aborts the
+ * program.
+ */
+
+extern void fp_add_rnd(const double *a, const double *b, double *r,
+		       size_t n, fp_rnd rnd);
+extern void fp_sub_rnd(const double *a, const double *b, double *r,
+		       size_t n, fp_rnd rnd);
+extern void fp_mul_rnd(const double *a, const double *b, double *r,
+		       size_t n, fp_rnd rnd);
+extern void fp_div_rnd(const double *a, const double *b, double *r,
+		       size_t n, fp_rnd rnd);
+
+#endif
@@ -0,0 +1,559 @@
+/*
+    CIieeefp: CIblas.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains level 1 BLAS kernels that record the exceptions
+   raised by each block of FP_BLAS_BLOCK elements. As in CIbatch.c, the
+   exception flags are cleared before each block and read after it,
+   which costs little next to the block's arithmetic, and is far
+   cheaper than clearing and reading them around small pieces of the
+   array from outside. The blocks are done in gcc's vector types, for
+   the default target and for AVX2, chosen at run time as in
+   CIelemfn.c, with the same operations in the same order in both, so
+   that the results do not depend on the CPU. Multiplies and adds are
+   not contracted into FMAs (the file is compiled with
+   -ffp-contract=off) for the same reason, and so that an overflowing
+   product raises its exception.
+
+   With more than one thread, each thread is given a run of whole
+   blocks. A new thread starts with the MXCSR's defaults, so each is
+   given the caller's rounding direction, flush-to-zero and
+   denormals-are-zeros, with all exceptions masked while the blocks are
+   done. The reductions work out one sum (three for nrm2) per block,
+   and add the blocks' sums in order afterwards, so they come out the
+   same whatever the number of threads. Threads need the SSE unit's
+   per-thread MXCSR to collect the flags, so without the kernels
+   (compilers older than gcc 5, or builds doing their arithmetic on the
+   x87 FPU, where the blocks' sums would be added) the calling thread
+   does all the blocks, and the flags are handled through
+   fpsetsticky() and fpgetsticky(). */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <CIblas.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+
+#if defined(__GNUC__) && __GNUC__ >= 5 && defined(__SSE2_MATH__) \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build AVX2 kernels
+				   chosen at run time */
+#endif
+
+#define BLAS_LANES 4		/* Elements per vector */
+#define BLAS_STEP 8		/* Elements per loop: two vectors */
+#define BLAS_PARTS 3		/* Sums per block */
+#define BLAS_MAX_THREADS 64
+#define BLAS_ABS UINT64_C(0x7fffffffffffffff)
+
+/* Blue's thresholds and scales: squares of elements from BLAS_TSML to
+   BLAS_TBIG neither overflow nor underflow, and those of elements
+   above or below, scaled by BLAS_SBIG or BLAS_SSML, do not either */
+
+#define BLAS_TSML 0x1p-511
+#define BLAS_TBIG 0x1p486
+#define BLAS_SSML 0x1p537
+#define BLAS_SBIG 0x1p-538
+
+#define BLAS_INLINE static __inline__ __attribute__((always_inline))
+
+typedef double BLAS_V __attribute__((vector_size(BLAS_LANES
+						 * sizeof(double))));
+typedef int64_t BLAS_M __attribute__((vector_size(BLAS_LANES
+						  * sizeof(double))));
+
+typedef enum {
+  BLAS_AXPY = 0, BLAS_SCAL, BLAS_DOT, BLAS_NRM2, BLAS_ASUM
+} BLAS_OP;			/* The reductions from BLAS_DOT on */
+
+/* A kernel: the operation on n elements (a multiple of BLAS_STEP) of x
+   and y, putting the results in r or the sums in part */
+
+typedef void (*BLAS_KERNEL)(double alpha, const double *x, const double *y,
+			    double *r, size_t n, double *part);
+
+/* The work given to a thread: blocks first to last - 1, with the sums
+   of each block put in part if it is not NULL, and otherwise added in
+   order to sum, when the exceptions raised doing so go in combined */
+
+typedef struct {
+  BLAS_KERNEL kernel;
+  BLAS_OP op;
+  double alpha;
+  const double *x, *y;
+  double *r;
+  size_t n, first, last;
+  uint8_t *record;
+  double *part;
+  double sum[BLAS_PARTS];
+  fp_except raised, combined;
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr ctl;
+#endif
+} BLAS_WORK;
+
+/* The vectors are passed to and from these by pointer, as passing
+   them by value has a different ABI depending on whether AVX is
+   enabled; all are inlined, so the pointers cost nothing. */
+
+BLAS_INLINE void blas_load(BLAS_V *v, const double *p) {
+  memcpy(v, p, sizeof(*v));
+}
+
+BLAS_INLINE void blas_store(double *p, const BLAS_V *v) {
+  memcpy(p, v, sizeof(*v));
+}
+
+BLAS_INLINE void blas_abs(BLAS_V *v) {
+  *v = (BLAS_V)((BLAS_M)*v & (int64_t)BLAS_ABS);
+}
+
+BLAS_INLINE double blas_total(const BLAS_V *v) {
+  double t = 0.0;
+  int i;
+
+  for(i = 0; i < BLAS_LANES; i++) t += (*v)[i];
+  return t;
+}
+
+/* blas_OP_block(alpha, x, y, r, n, part)
+ *
+ * OP = {axpy, scal, dot, nrm2, asum}
+ *
+ * The kernels' work. Each sum is kept in two vectors, for the even
+ * and odd vectors of elements, to keep more additions in flight.
+ * blas_nrm2_block() puts the sums of squares of the large, middling
+ * and small elements, scaled, in part[0] to part[2]; the other
+ * reductions put their sum in part[0] and zeros in the rest.
+ */
+
+BLAS_INLINE void blas_axpy_block(double alpha, const double *x,
+				 const double *y, double *r, size_t n,
+				 double *part) {
+  BLAS_V x0, x1, y0, y1;
+  size_t i;
+
+  (void)part;
+  for(i = 0; i < n; i += BLAS_STEP) {
+    blas_load(&x0, x + i);
+    blas_load(&x1, x + i + BLAS_LANES);
+    blas_load(&y0, y + i);
+    blas_load(&y1, y + i + BLAS_LANES);
+    x0 = alpha * x0 + y0;
+    x1 = alpha * x1 + y1;
+    blas_store(r + i, &x0);
+    blas_store(r + i + BLAS_LANES, &x1);
+  }
+}
+
+BLAS_INLINE void blas_scal_block(double alpha, const double *x,
+				 const double *y, double *r, size_t n,
+				 double *part) {
+  BLAS_V x0, x1;
+  size_t i;
+
+  (void)y;
+  (void)part;
+  for(i = 0; i < n; i += BLAS_STEP) {
+    blas_load(&x0, x + i);
+    blas_load(&x1, x + i + BLAS_LANES);
+    x0 *= alpha;
+    x1 *= alpha;
+    blas_store(r + i, &x0);
+    blas_store(r + i + BLAS_LANES, &x1);
+  }
+}
+
+BLAS_INLINE void blas_dot_block(double alpha, const double *x,
+				const double *y, double *r, size_t n,
+				double *part) {
+  BLAS_V s0 = { 0.0, 0.0, 0.0, 0.0 }, s1 = s0, x0, x1, y0, y1;
+  size_t i;
+
+  (void)alpha;
+  (void)r;
+  for(i = 0; i < n; i += BLAS_STEP) {
+    blas_load(&x0, x + i);
+    blas_load(&x1, x + i + BLAS_LANES);
+    blas_load(&y0, y + i);
+    blas_load(&y1, y + i + BLAS_LANES);
+    s0 += x0 * y0;
+    s1 += x1 * y1;
+  }
+  s0 += s1;
+  part[0] = blas_total(&s0);
+  part[1] = part[2] = 0.0;
+}
+
+BLAS_INLINE void blas_asum_block(double alpha, const double *x,
+				 const double *y, double *r, size_t n,
+				 double *part) {
+  BLAS_V s0 = { 0.0, 0.0, 0.0, 0.0 }, s1 = s0, x0, x1;
+  size_t i;
+
+  (void)alpha;
+  (void)y;
+  (void)r;
+  for(i = 0; i < n; i += BLAS_STEP) {
+    blas_load(&x0, x + i);
+    blas_load(&x1, x + i + BLAS_LANES);
+    blas_abs(&x0);
+    blas_abs(&x1);
+    s0 += x0;
+    s1 += x1;
+  }
+  s0 += s1;
+  part[0] = blas_total(&s0);
+  part[1] = part[2] = 0.0;
+}
+
+/* blas_nrm2_square(v, big, mid, small)
+ *
+ * Add the square of each element of v, scaled, to the sum for its
+ * size. The scale is chosen before multiplying, so that no lane raises
+ * an exception for a size it is not.
+ */
+
+BLAS_INLINE void blas_nrm2_square(const BLAS_V *v, BLAS_V *big,
+				  BLAS_V *mid, BLAS_V *small) {
+  const BLAS_V one = { 1.0, 1.0, 1.0, 1.0 };
+  const BLAS_V tbig = { BLAS_TBIG, BLAS_TBIG, BLAS_TBIG, BLAS_TBIG };
+  const BLAS_V tsml = { BLAS_TSML, BLAS_TSML, BLAS_TSML, BLAS_TSML };
+  const BLAS_V sbig = { BLAS_SBIG, BLAS_SBIG, BLAS_SBIG, BLAS_SBIG };
+  const BLAS_V ssml = { BLAS_SSML, BLAS_SSML, BLAS_SSML, BLAS_SSML };
+  BLAS_M b, s, m;
+  BLAS_V t, sq;
+
+  t = *v;
+  blas_abs(&t);
+  b = t > tbig;
+  s = t < tsml;
+  m = ~(b | s);
+  t *= (BLAS_V)((b & (BLAS_M)sbig) | (s & (BLAS_M)ssml) | (m & (BLAS_M)one));
+  sq = t * t;
+  *big += (BLAS_V)(b & (BLAS_M)sq);
+  *mid += (BLAS_V)(m & (BLAS_M)sq);
+  *small += (BLAS_V)(s & (BLAS_M)sq);
+}
+
+BLAS_INLINE void blas_nrm2_block(double alpha, const double *x,
+				 const double *y, double *r, size_t n,
+				 double *part) {
+  BLAS_V big = { 0.0, 0.0, 0.0, 0.0 }, mid = big, small = big, x0, x1;
+  size_t i;
+
+  (void)alpha;
+  (void)y;
+  (void)r;
+  for(i = 0; i < n; i += BLAS_STEP) {
+    blas_load(&x0, x + i);
+    blas_load(&x1, x + i + BLAS_LANES);
+    blas_nrm2_square(&x0, &big, &mid, &small);
+    blas_nrm2_square(&x1, &big, &mid, &small);
+  }
+  part[0] = blas_total(&big);
+  part[1] = blas_total(&mid);
+  part[2] = blas_total(&small);
+}
+
+/* blas_OP_vec(...), blas_OP_avx2(...)
+ *
+ * The kernels built for the default target and for AVX2.
+ */
+
+#define BLAS_KERNEL_FN(op, suffix) \
+  static void blas_##op##_##suffix(double alpha, const double *x, \
+				   const double *y, double *r, size_t n, \
+				   double *part) { \
+    blas_##op##_block(alpha, x, y, r, n, part); \
+  }
+
+#define BLAS_KERNELS(suffix) \
+  BLAS_KERNEL_FN(axpy, suffix) \
+  BLAS_KERNEL_FN(scal, suffix) \
+  BLAS_KERNEL_FN(dot, suffix) \
+  BLAS_KERNEL_FN(nrm2, suffix) \
+  BLAS_KERNEL_FN(asum, suffix) \
+  static const BLAS_KERNEL blas_##suffix[5] = { \
+    blas_axpy_##suffix, blas_scal_##suffix, blas_dot_##suffix, \
+    blas_nrm2_##suffix, blas_asum_##suffix \
+  };
+
+BLAS_KERNELS(vec)
+
+#ifdef CI_SIMD_KERNELS
+#pragma GCC push_options
+#pragma GCC target("avx2")
+BLAS_KERNELS(avx2)
+#pragma GCC pop_options
+
+#define BLAS_CHOOSE(op) \
+  (__builtin_cpu_supports("avx2") ? blas_avx2[op] : blas_vec[op])
+#define BLAS_CLEAR(w) SSE_ldmxcsr((w)->ctl)
+#define BLAS_FLAGS() ((fp_except)(SSE_stmxcsr() & MX_XF))
+#else
+#define BLAS_CHOOSE(op) blas_vec[op]
+#define BLAS_CLEAR(w) fpsetsticky(0)
+#define BLAS_FLAGS() fpgetsticky()
+#endif
+
+/* blas_block(w, b, part) -> exceptions raised
+ *
+ * Do block b of w's work, putting its sums in part. A last part block
+ * is copied and filled out to a whole number of steps, with zeros for
+ * the reductions and with copies of the last element for axpy and
+ * scal, so that the filling raises no exceptions the elements do not.
+ */
+
+static fp_except blas_block(BLAS_WORK *w, size_t b, double *part) {
+  double xp[FP_BLAS_BLOCK], yp[FP_BLAS_BLOCK], rp[FP_BLAS_BLOCK];
+  size_t start = b * FP_BLAS_BLOCK, len, full, i;
+  int copies = w->op == BLAS_AXPY || w->op == BLAS_SCAL;
+  fp_except x;
+
+  len = w->n - start < FP_BLAS_BLOCK ? w->n - start : FP_BLAS_BLOCK;
+  full = (len + BLAS_STEP - 1) / BLAS_STEP * BLAS_STEP;
+  BLAS_CLEAR(w);
+  if(full == len) {
+    w->kernel(w->alpha, w->x + start, w->y + start,
+	      w->r == NULL ? NULL : w->r + start, len, part);
+  }
+  else {
+    for(i = 0; i < full; i++) {
+      xp[i] = i < len ? w->x[start + i]
+	: (copies ? w->x[start + len - 1] : 0.0);
+      yp[i] = w->y == NULL ? 0.0 : (i < len ? w->y[start + i]
+				    : (copies ? w->y[start + len - 1] : 0.0));
+    }
+    w->kernel(w->alpha, xp, yp, rp, full, part);
+    if(w->r != NULL) memcpy(w->r + start, rp, len * sizeof(double));
+  }
+  x = BLAS_FLAGS();
+  return x;
+}
+
+/* blas_run(arg) -> NULL
+ *
+ * Do the work arg points to, in the calling thread.
+ */
+
+static void *blas_run(void *arg) {
+  BLAS_WORK *w = (BLAS_WORK *)arg;
+  double part[BLAS_PARTS];
+  fp_except x;
+  size_t b;
+  int k;
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr mxcsr = SSE_stmxcsr();
+#endif
+
+  for(b = w->first; b < w->last; b++) {
+    x = blas_block(w, b, w->part == NULL ? part : w->part + b * BLAS_PARTS);
+    w->raised |= x;
+    if(w->record != NULL) w->record[b] = (uint8_t)(x & FP_BLAS_RECORD);
+    if(w->part == NULL && w->op >= BLAS_DOT) {
+      BLAS_CLEAR(w);
+      for(k = 0; k < BLAS_PARTS; k++) w->sum[k] += part[k];
+      w->combined |= BLAS_FLAGS();
+    }
+  }
+#ifdef CI_SIMD_KERNELS
+  SSE_ldmxcsr(mxcsr);
+#endif
+  return NULL;
+}
+
+/* blas_nrm2(sum) -> 2-norm from the sums of squares
+ *
+ * Put the sums for large, middling and small elements together as
+ * LAPACK's dnrm2 does, using the large ones' scale if there are any,
+ * and the small ones' only if there is nothing else.
+ */
+
+static double blas_nrm2(const double *sum) {
+  double big = sum[0], mid = sum[1], small = sum[2], lo, hi;
+
+  if(big > 0.0) {
+    if(mid > 0.0 || mid != mid) big += (mid * BLAS_SBIG) * BLAS_SBIG;
+    return sqrt(big) / BLAS_SBIG;
+  }
+  if(small > 0.0) {
+    if(mid > 0.0 || mid != mid) {
+      mid = sqrt(mid);
+      small = sqrt(small) / BLAS_SSML;
+      lo = small > mid ? mid : small;
+      hi = small > mid ? small : mid;
+      return hi * sqrt(1.0 + (lo / hi) * (lo / hi));
+    }
+    return sqrt(small) / BLAS_SSML;
+  }
+  return sqrt(mid);
+}
+
+/* blas(op, alpha, x, y, r, n, threads, record, sum) -> exceptions raised
+ *
+ * Do the work of the fpblas_ functions for operation op, putting the
+ * result of a reduction in sum[0].
+ */
+
+static fp_except blas(BLAS_OP op, double alpha, const double *x,
+		      const double *y, double *r, size_t n, int threads,
+		      uint8_t *record, double *sum) {
+  BLAS_WORK work[BLAS_MAX_THREADS];
+  pthread_t id[BLAS_MAX_THREADS];
+  int started[BLAS_MAX_THREADS];
+  size_t blocks = FP_BLAS_BLOCKS(n), b;
+  double *part = NULL;
+  fp_except raised = 0U;
+  int t, k;
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr mxcsr = SSE_stmxcsr();
+#else
+  fp_except before = fpgetsticky();
+
+  threads = 1;
+#endif
+
+  if(threads > BLAS_MAX_THREADS) threads = BLAS_MAX_THREADS;
+  if((size_t)threads > blocks) threads = (int)blocks;
+  if(threads < 1) threads = 1;
+  if(threads > 1 && op >= BLAS_DOT) {
+    part = (double *)malloc(blocks * BLAS_PARTS * sizeof(double));
+    if(part == NULL) threads = 1;
+  }
+  for(t = 0; t < threads; t++) {
+    work[t].kernel = BLAS_CHOOSE(op);
+    work[t].op = op;
+    work[t].alpha = alpha;
+    work[t].x = x;
+    work[t].y = y;
+    work[t].r = r;
+    work[t].n = n;
+    work[t].first = blocks * t / threads;
+    work[t].last = blocks * (t + 1) / threads;
+    work[t].record = record;
+    work[t].part = part;
+    for(k = 0; k < BLAS_PARTS; k++) work[t].sum[k] = 0.0;
+    work[t].raised = work[t].combined = 0U;
+#ifdef CI_SIMD_KERNELS
+    work[t].ctl = (mxcsr & ~MX_XF) | MX_XM;
+#endif
+  }
+
+  for(t = 1; t < threads; t++) {
+    started[t] = pthread_create(&id[t], NULL, blas_run, &work[t]) == 0;
+  }
+  blas_run(&work[0]);
+  for(t = 1; t < threads; t++) {
+    if(started[t]) pthread_join(id[t], NULL);
+    else blas_run(&work[t]);
+  }
+  for(t = 0; t < threads; t++) raised |= work[t].raised;
+
+  if(op >= BLAS_DOT) {
+    if(part == NULL) {
+      for(k = 0; k < BLAS_PARTS; k++) sum[k] = work[0].sum[k];
+      raised |= work[0].combined;
+    }
+    else {
+      BLAS_CLEAR(&work[0]);
+      for(k = 0; k < BLAS_PARTS; k++) sum[k] = 0.0;
+      for(b = 0; b < blocks; b++) {
+	for(k = 0; k < BLAS_PARTS; k++) sum[k] += part[b * BLAS_PARTS + k];
+      }
+      raised |= BLAS_FLAGS();
+      free(part);
+    }
+    if(op == BLAS_NRM2) {
+      BLAS_CLEAR(&work[0]);
+      sum[0] = blas_nrm2(sum);
+      raised |= BLAS_FLAGS();
+    }
+  }
+
+#ifdef CI_SIMD_KERNELS
+  SSE_ldmxcsr(mxcsr | raised);
+  if((fpgetunit() & FP_UNIT_SSE) == 0U) {
+				/* Flags in the MXCSR not read */
+    fpsetsticky(fpgetsticky() | raised);
+  }
+#else
+  fpsetsticky(before | raised);
+#endif
+  return raised;
+}
+
+/* fpblas_axpy(alpha, x, y, n, threads, record) -> exceptions raised
+ * fpblas_scal(alpha, x, n, threads, record) -> exceptions raised
+ */
+
+fp_except fpblas_axpy(double alpha, const double *x, double *y, size_t n,
+		      int threads, uint8_t *record) {
+  return blas(BLAS_AXPY, alpha, x, y, y, n, threads, record, NULL);
+}
+
+fp_except fpblas_scal(double alpha, double *x, size_t n, int threads,
+		      uint8_t *record) {
+  return blas(BLAS_SCAL, alpha, x, NULL, x, n, threads, record, NULL);
+}
+
+/* fpblas_dot(x, y, n, threads, record, raised) -> dot product of x and y
+ * fpblas_nrm2(x, n, threads, record, raised) -> 2-norm of x
+ * fpblas_asum(x, n, threads, record, raised) -> sum of |x[i]|
+ */
+
+double fpblas_dot(const double *x, const double *y, size_t n, int threads,
+		  uint8_t *record, fp_except *raised) {
+  double sum[BLAS_PARTS];
+  fp_except x1 = blas(BLAS_DOT, 0.0, x, y, NULL, n, threads, record, sum);
+
+  if(raised != NULL) *raised = x1;
+  return sum[0];
+}
+
+double fpblas_nrm2(const double *x, size_t n, int threads, uint8_t *record,
+		   fp_except *raised) {
+  double sum[BLAS_PARTS];
+  fp_except x1 = blas(BLAS_NRM2, 0.0, x, NULL, NULL, n, threads, record,
+		      sum);
+
+  if(raised != NULL) *raised = x1;
+  return sum[0];
+}
+
+double fpblas_asum(const double *x, size_t n, int threads, uint8_t *record,
+		   fp_except *raised) {
+  double sum[BLAS_PARTS];
+  fp_except x1 = blas(BLAS_ASUM, 0.0, x, NULL, NULL, n, threads, record,
+		      sum);
+
+  if(raised != NULL) *raised = x1;
+  return sum[0];
+}
@@ -0,0 +1,99 @@
+/*
+    CIieeefp: CIblas.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIblas.c,
+   which are level 1 BLAS kernels (axpy, scal, dot, nrm2 and asum)
+   that work in blocks, in vector registers and optionally several
+   threads, and record which exceptions each block raised. */
+
+#ifndef CIBLAS_H
+#define CIBLAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <CIieeefp.h>
+
+/* Block records
+ *
+ * The elements are done in blocks of FP_BLAS_BLOCK, element i being in
+ * block i / FP_BLAS_BLOCK. A record for n elements is an array of
+ * FP_BLAS_BLOCKS(n) bytes, byte j holding the exceptions block j
+ * raised, as FP_X_ bits, out of those in FP_BLAS_RECORD. Inexact
+ * results and denormalised operands are too common to be worth
+ * recording; they are still in the exceptions returned.
+ */
+
+#define FP_BLAS_BLOCK 256
+#define FP_BLAS_BLOCKS(n) (((n) + FP_BLAS_BLOCK - 1) / FP_BLAS_BLOCK)
+#define FP_BLAS_RECORD (FP_X_INV | FP_X_DZ | FP_X_OFL | FP_X_UFL)
+
+/* fpblas_axpy(alpha, x, y, n, threads, record) -> exceptions raised
+ * fpblas_scal(alpha, x, n, threads, record) -> exceptions raised
+ *
+ * Put alpha * x[i] + y[i] in y[i], or alpha * x[i] in x[i], for each
+ * of the n elements, and return all the exceptions raised, which are
+ * also added to the sticky bits. The product and sum are rounded
+ * separately, in the current rounding direction, so the results are
+ * the same on every CPU. If record is not NULL it is filled in for
+ * the n elements. If threads is more than 1, the blocks are shared
+ * out between that many threads (up to 64), the calling one included,
+ * when the library does its arithmetic on the SSE unit; otherwise the
+ * calling thread does them all.
+ */
+
+extern fp_except fpblas_axpy(double alpha, const double *x, double *y,
+			     size_t n, int threads, uint8_t *record);
+extern fp_except fpblas_scal(double alpha, double *x, size_t n,
+			     int threads, uint8_t *record);
+
+/* fpblas_dot(x, y, n, threads, record, raised) -> dot product of x and y
+ * fpblas_nrm2(x, n, threads, record, raised) -> 2-norm of x
+ * fpblas_asum(x, n, threads, record, raised) -> sum of |x[i]|
+ *
+ * Work out a reduction of the n elements, in the current rounding
+ * direction, filling in record as the functions above do, and if
+ * raised is not NULL put in it all the exceptions raised, which are
+ * also added to the sticky bits. Each block's sum is worked out on its
+ * own and the block sums added in order, so the result is the same
+ * however many threads are used. Exceptions raised in adding the
+ * block sums belong to no block, but are in *raised. fpblas_nrm2()
+ * keeps separate sums of squares for large, middling and small
+ * elements, scaled so that squaring them neither overflows nor
+ * underflows (Blue's algorithm, as in LAPACK), so it only overflows
+ * or underflows if the 2-norm does.
+ */
+
+extern double fpblas_dot(const double *x, const double *y, size_t n,
+			 int threads, uint8_t *record, fp_except *raised);
+extern double fpblas_nrm2(const double *x, size_t n, int threads,
+			  uint8_t *record, fp_except *raised);
+extern double fpblas_asum(const double *x, size_t n, int threads,
+			  uint8_t *record, fp_except *raised);
+
+#endif
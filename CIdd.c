@@ -0,0 +1,633 @@
+/*
+    CIieeefp: CIdd.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains error-free transformations and double-double
+   arithmetic. Rounding to nearest, a + b and a * b are each a double
+   and a rounding error that is itself a double: TwoSum (Knuth) and
+   FastTwoSum (Dekker) find the error of a sum with three or six
+   additions, and TwoProduct that of a product with an FMA, or without
+   one by splitting each operand into two 26 bit halves whose products
+   are exact (Dekker and Veltkamp). Double-double arithmetic keeps a
+   value as such an unevaluated sum, hi + lo; the algorithms for it
+   are those of Joldes, Muller and Popescu (ACM TOMS 44, 2017), whose
+   error bounds are given in CIdd.h.
+
+   All of this needs every operation rounded once to nearest double.
+   Rounded another way the errors are no longer exact, and on the x87
+   FPU with precision control set to extended the sums are rounded
+   twice, first to 64 bits and then to 53 when stored, which also
+   loses them: 2^53 + (1 + 2^-12) comes out as 2^53 + 2 with an error
+   of -(1 - 2^-12) rounding once, but 2^53 with an error of 1 + 2^-12
+   that is no longer a double rounding twice. So each function sets
+   rounding to nearest and, for the x87 FPU, precision control to
+   double, if they are not already set, and puts them back after.
+   gcc must not contract multiplies and adds into FMAs, nor move
+   arithmetic past the changes of mode, so the file is compiled with
+   -ffp-contract=off and -frounding-math.
+
+   The array functions work on DD_LANES elements at once in gcc's
+   vector types, for the default target and for AVX2 with FMA,
+   chosen at run time as in CIelemfn.c. The vector code does the same
+   operations in the same order as the scalar code, so the results are
+   the same bit for bit. */
+
+#include <string.h>
+#include <stdint.h>
+#include <CIdd.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+#ifdef __SSE2__
+#include <xmmintrin.h>
+#endif
+
+#if defined(__GNUC__) && __GNUC__ >= 5 && defined(__SSE2__) \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build AVX2 kernels
+				   chosen at run time */
+#endif
+
+#define DD_LANES 4		/* Elements per vector */
+#define DD_SPLIT 134217729.0	/* 2^27 + 1 */
+#define DD_SPLIT_MAX 0x1p995	/* Largest |x| split without scaling */
+#define DD_SPLIT_DOWN 0x1p-28
+#define DD_SPLIT_UP 0x1p28
+#define DD_ABS UINT64_C(0x7fffffffffffffff)
+#define DD_CW_DBL 0x0200	/* FP_PC_DBL in the CW_PC bits */
+
+#define DD_INLINE static __inline__ __attribute__((always_inline))
+
+/* Vectors of doubles, masks of the same size (each lane all ones or
+   all zeros) and vectors of double-doubles */
+
+typedef double DD_V __attribute__((vector_size(DD_LANES * sizeof(double))));
+typedef int64_t DD_M __attribute__((vector_size(DD_LANES * sizeof(double))));
+
+typedef struct {
+  DD_V hi, lo;
+} DD_VDD;
+
+/* Kernels doing an operation on n elements, n a multiple of DD_LANES:
+   on doubles, giving results and errors, and on double-doubles */
+
+typedef void (*DD_PAIR)(const double *a, const double *b, double *r,
+			double *err, size_t n);
+typedef void (*DD_OP)(const fp_dd *a, const fp_dd *b, fp_dd *r, size_t n);
+
+/* The rounding direction and precision control to put back, if
+   dd_enter() changed them */
+
+typedef struct {
+  int changed;
+  fp_rnd rnd;
+#ifndef __SSE2_MATH__
+  fp_pctl pctl;
+#endif
+} DD_MODE;
+
+/* dd_enter() -> mode to put back
+ *
+ * Set rounding to nearest, and on the x87 FPU double precision, if
+ * they are not already set. This is done for every call of the scalar
+ * functions, so the registers are read directly (the MXCSR inline)
+ * and their bits tested with masks, which takes a few nanoseconds,
+ * where fpgetround() and fpgetprecision() take several times as long.
+ */
+
+static DD_MODE dd_enter(void) {
+  DD_MODE m;
+#ifndef __SSE2_MATH__
+  x87FPU_control_word cw = x87FPU_fstcw();
+#endif
+
+  m.changed = 0;
+#ifdef __SSE2__
+  if((_mm_getcsr() & MX_RC) != 0U) m.changed = 1;	/* FP_RN is 0 */
+#endif
+#ifndef __SSE2_MATH__
+  if((cw & (CW_RC | CW_PC)) != DD_CW_DBL) m.changed = 1;
+#endif
+  if(m.changed) {
+    m.rnd = fpsetround(FP_RN);
+#ifndef __SSE2_MATH__
+    m.pctl = fpsetprecision(FP_PC_DBL);
+#endif
+  }
+  return m;
+}
+
+/* dd_leave(m)
+ *
+ * Put back the mode dd_enter() returned.
+ */
+
+static void dd_leave(DD_MODE m) {
+  if(m.changed) {
+    fpsetround(m.rnd);
+#ifndef __SSE2_MATH__
+    fpsetprecision(m.pctl);
+#endif
+  }
+}
+
+/* Scalar operations
+ *
+ * dd_two_sum(a, b, e), dd_fast_two_sum(a, b, e) and dd_two_prod(a, b,
+ * e) return a + b or a * b and put the error in *e, with the mode
+ * already set. dd_split(a, h, l) splits a into h + l, each with 26
+ * bits, scaling a down first if a large h might overflow.
+ * dd_finite(r, plain) puts plain in r.hi and zero in r.lo if either is
+ * not finite.
+ */
+
+DD_INLINE double dd_two_sum(double a, double b, double *e) {
+  double s, bb;
+
+  s = a + b;
+  bb = s - a;
+  *e = (a - (s - bb)) + (b - bb);
+  return s;
+}
+
+DD_INLINE double dd_fast_two_sum(double a, double b, double *e) {
+  double s;
+
+  s = a + b;
+  *e = b - (s - a);
+  return s;
+}
+
+DD_INLINE void dd_split(double a, double *h, double *l) {
+  double c, s = 1.0, u = 1.0;
+
+  if((a < 0.0 ? -a : a) > DD_SPLIT_MAX) {
+    s = DD_SPLIT_DOWN;
+    u = DD_SPLIT_UP;
+  }
+  c = DD_SPLIT * (a * s);
+  *h = (c - (c - a * s)) * u;
+  *l = a - *h;
+}
+
+DD_INLINE double dd_two_prod(double a, double b, double *e) {
+  double p;
+#ifndef __FMA__
+  double ah, al, bh, bl;
+#endif
+
+  p = a * b;
+#ifdef __FMA__
+  *e = __builtin_fma(a, b, -p);
+#else
+  dd_split(a, &ah, &al);
+  dd_split(b, &bh, &bl);
+  *e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+#endif
+  return p;
+}
+
+DD_INLINE fp_dd dd_finite(fp_dd r, double plain) {
+#ifndef __SSE2_MATH__
+  volatile double hi = r.hi, lo = r.lo;
+
+  r.hi = hi;			/* Overflow x87 registers' wider range */
+  r.lo = lo;
+#endif
+  if(!((r.hi - r.hi) + (r.lo - r.lo) == 0.0)) {
+    r.hi = plain;
+    r.lo = 0.0;
+  }
+  return r;
+}
+
+/* dd_add(a, b) -> a + b
+ * dd_mul(a, b) -> a * b
+ * dd_div(a, b) -> a / b
+ *
+ * Double-double arithmetic with the mode already set: AccurateDWPlusDW,
+ * DWTimesDW1 and DWDivDW2 (with DWTimesFP1) in Joldes, Muller and
+ * Popescu's names.
+ */
+
+DD_INLINE fp_dd dd_add(fp_dd a, fp_dd b) {
+  fp_dd r;
+  double s, se, t, te, plain;
+
+  s = plain = dd_two_sum(a.hi, b.hi, &se);
+  t = dd_two_sum(a.lo, b.lo, &te);
+  se += t;
+  s = dd_fast_two_sum(s, se, &se);
+  se += te;
+  r.hi = dd_fast_two_sum(s, se, &r.lo);
+  return dd_finite(r, plain);
+}
+
+DD_INLINE fp_dd dd_mul(fp_dd a, fp_dd b) {
+  fp_dd r;
+  double p, e;
+
+  p = dd_two_prod(a.hi, b.hi, &e);
+  e += a.hi * b.lo + a.lo * b.hi;
+  r.hi = dd_fast_two_sum(p, e, &r.lo);
+  return dd_finite(r, p);
+}
+
+DD_INLINE fp_dd dd_div(fp_dd a, fp_dd b) {
+  fp_dd r;
+  double q, p, pe, t, te, d;
+
+  q = a.hi / b.hi;
+  p = dd_two_prod(b.hi, q, &pe);
+  t = dd_fast_two_sum(p, b.lo * q, &te);
+  t = dd_fast_two_sum(t, te + pe, &te);
+  d = (a.hi - t) + (a.lo - te);
+  r.hi = dd_fast_two_sum(q, d / b.hi, &r.lo);
+  return dd_finite(r, q);
+}
+
+/* Vector operations
+ *
+ * The same as the scalar ones, lane by lane. dd_v_two_prod() uses an
+ * FMA if fma is set, which it is in the kernels built for CPUs with
+ * one, and Dekker's splitting otherwise.
+ */
+
+DD_INLINE void dd_v_load(DD_V *v, const double *p) {
+  memcpy(v, p, sizeof(*v));
+}
+
+DD_INLINE void dd_v_store(double *p, const DD_V *v) {
+  memcpy(p, v, sizeof(*v));
+}
+
+DD_INLINE void dd_v_load_dd(DD_VDD *v, const fp_dd *p) {
+  int i;
+
+  for(i = 0; i < DD_LANES; i++) {
+    v->hi[i] = p[i].hi;
+    v->lo[i] = p[i].lo;
+  }
+}
+
+DD_INLINE void dd_v_store_dd(fp_dd *p, const DD_VDD *v) {
+  int i;
+
+  for(i = 0; i < DD_LANES; i++) {
+    p[i].hi = v->hi[i];
+    p[i].lo = v->lo[i];
+  }
+}
+
+DD_INLINE void dd_v_two_sum(const DD_V *a, const DD_V *b, DD_V *s,
+			    DD_V *e) {
+  DD_V x = *a, y = *b, t, bb;
+
+  t = x + y;
+  bb = t - x;
+  *e = (x - (t - bb)) + (y - bb);
+  *s = t;
+}
+
+DD_INLINE void dd_v_fast_two_sum(const DD_V *a, const DD_V *b, DD_V *s,
+				 DD_V *e) {
+  DD_V x = *a, y = *b, t;
+
+  t = x + y;
+  *e = y - (t - x);
+  *s = t;
+}
+
+DD_INLINE void dd_v_split(const DD_V *a, DD_V *h, DD_V *l) {
+  const DD_V one = { 1.0, 1.0, 1.0, 1.0 };
+  const DD_V down = { DD_SPLIT_DOWN, DD_SPLIT_DOWN, DD_SPLIT_DOWN,
+		      DD_SPLIT_DOWN };
+  const DD_V up = { DD_SPLIT_UP, DD_SPLIT_UP, DD_SPLIT_UP, DD_SPLIT_UP };
+  const DD_V max = { DD_SPLIT_MAX, DD_SPLIT_MAX, DD_SPLIT_MAX,
+		     DD_SPLIT_MAX };
+  DD_M big;
+  DD_V x = *a, c, s, u;
+
+  big = (DD_V)((DD_M)x & (int64_t)DD_ABS) > max;
+  s = (DD_V)((big & (DD_M)down) | (~big & (DD_M)one));
+  u = (DD_V)((big & (DD_M)up) | (~big & (DD_M)one));
+  c = DD_SPLIT * (x * s);
+  *h = (c - (c - x * s)) * u;
+  *l = x - *h;
+}
+
+DD_INLINE void dd_v_two_prod(const DD_V *a, const DD_V *b, DD_V *p,
+			     DD_V *e, int fma) {
+  DD_V x = *a, y = *b, t, ah, al, bh, bl;
+  int i;
+
+  t = x * y;
+  if(fma) {
+    DD_V f = { 0.0, 0.0, 0.0, 0.0 };
+
+#pragma GCC unroll 4
+    for(i = 0; i < DD_LANES; i++) f[i] = __builtin_fma(x[i], y[i], -t[i]);
+    *e = f;
+  }
+  else {
+    dd_v_split(&x, &ah, &al);
+    dd_v_split(&y, &bh, &bl);
+    *e = ((ah * bh - t) + ah * bl + al * bh) + al * bl;
+  }
+  *p = t;
+}
+
+DD_INLINE void dd_v_finite(DD_VDD *r, const DD_V *plain) {
+  const DD_V zero = { 0.0, 0.0, 0.0, 0.0 };
+  DD_M ok;
+
+  ok = (r->hi - r->hi) + (r->lo - r->lo) == zero;
+  r->hi = (DD_V)((ok & (DD_M)r->hi) | (~ok & (DD_M)*plain));
+  r->lo = (DD_V)(ok & (DD_M)r->lo);
+}
+
+DD_INLINE void dd_v_add(const DD_VDD *a, const DD_VDD *b, DD_VDD *r) {
+  DD_V s, se, t, te, plain;
+
+  dd_v_two_sum(&a->hi, &b->hi, &s, &se);
+  plain = s;
+  dd_v_two_sum(&a->lo, &b->lo, &t, &te);
+  se += t;
+  dd_v_fast_two_sum(&s, &se, &s, &se);
+  se += te;
+  dd_v_fast_two_sum(&s, &se, &r->hi, &r->lo);
+  dd_v_finite(r, &plain);
+}
+
+DD_INLINE void dd_v_mul(const DD_VDD *a, const DD_VDD *b, DD_VDD *r,
+			int fma) {
+  DD_V p, e;
+
+  dd_v_two_prod(&a->hi, &b->hi, &p, &e, fma);
+  e += a->hi * b->lo + a->lo * b->hi;
+  dd_v_fast_two_sum(&p, &e, &r->hi, &r->lo);
+  dd_v_finite(r, &p);
+}
+
+DD_INLINE void dd_v_div(const DD_VDD *a, const DD_VDD *b, DD_VDD *r,
+			int fma) {
+  DD_V q, p, pe, t, te, d;
+
+  q = a->hi / b->hi;
+  dd_v_two_prod(&b->hi, &q, &p, &pe, fma);
+  d = b->lo * q;
+  dd_v_fast_two_sum(&p, &d, &t, &te);
+  d = te + pe;
+  dd_v_fast_two_sum(&t, &d, &t, &te);
+  d = (a->hi - t) + (a->lo - te);
+  d /= b->hi;
+  dd_v_fast_two_sum(&q, &d, &r->hi, &r->lo);
+  dd_v_finite(r, &q);
+}
+
+/* dd_OP_vec(a, b, r, ...), dd_OP_avx2(a, b, r, ...)
+ *
+ * OP = {two_sum, two_prod, add, mul, div}
+ *
+ * The kernels built for the default target and for AVX2 with FMA.
+ */
+
+#define DD_KERNELS(suffix, fma) \
+  static void dd_two_sum_##suffix(const double *a, const double *b, \
+				  double *r, double *err, size_t n) { \
+    DD_V x, y, e; \
+    size_t i; \
+    for(i = 0; i < n; i += DD_LANES) { \
+      dd_v_load(&x, a + i); \
+      dd_v_load(&y, b + i); \
+      dd_v_two_sum(&x, &y, &x, &e); \
+      dd_v_store(r + i, &x); \
+      dd_v_store(err + i, &e); \
+    } \
+  } \
+  static void dd_two_prod_##suffix(const double *a, const double *b, \
+				   double *r, double *err, size_t n) { \
+    DD_V x, y, e; \
+    size_t i; \
+    for(i = 0; i < n; i += DD_LANES) { \
+      dd_v_load(&x, a + i); \
+      dd_v_load(&y, b + i); \
+      dd_v_two_prod(&x, &y, &x, &e, fma); \
+      dd_v_store(r + i, &x); \
+      dd_v_store(err + i, &e); \
+    } \
+  } \
+  static void dd_add_##suffix(const fp_dd *a, const fp_dd *b, fp_dd *r, \
+			      size_t n) { \
+    DD_VDD x, y; \
+    size_t i; \
+    for(i = 0; i < n; i += DD_LANES) { \
+      dd_v_load_dd(&x, a + i); \
+      dd_v_load_dd(&y, b + i); \
+      dd_v_add(&x, &y, &x); \
+      dd_v_store_dd(r + i, &x); \
+    } \
+  } \
+  static void dd_mul_##suffix(const fp_dd *a, const fp_dd *b, fp_dd *r, \
+			      size_t n) { \
+    DD_VDD x, y; \
+    size_t i; \
+    for(i = 0; i < n; i += DD_LANES) { \
+      dd_v_load_dd(&x, a + i); \
+      dd_v_load_dd(&y, b + i); \
+      dd_v_mul(&x, &y, &x, fma); \
+      dd_v_store_dd(r + i, &x); \
+    } \
+  } \
+  static void dd_div_##suffix(const fp_dd *a, const fp_dd *b, fp_dd *r, \
+			      size_t n) { \
+    DD_VDD x, y; \
+    size_t i; \
+    for(i = 0; i < n; i += DD_LANES) { \
+      dd_v_load_dd(&x, a + i); \
+      dd_v_load_dd(&y, b + i); \
+      dd_v_div(&x, &y, &x, fma); \
+      dd_v_store_dd(r + i, &x); \
+    } \
+  }
+
+#ifdef __FMA__
+DD_KERNELS(vec, 1)
+#else
+DD_KERNELS(vec, 0)
+#endif
+
+#ifdef CI_SIMD_KERNELS
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+DD_KERNELS(avx2, 1)
+#pragma GCC pop_options
+
+#define DD_CHOOSE(name) \
+  ((__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) \
+   ? name##_avx2 : name##_vec)
+#else
+#define DD_CHOOSE(name) name##_vec
+#endif
+
+/* dd_pair_array(kernel, a, b, r, err, n)
+ * dd_op_array(kernel, a, b, r, n)
+ *
+ * Do the operation kernel does on the n elements, in the mode the
+ * functions need. A last part block is filled with copies of the
+ * last element, so that it raises no exceptions the elements do not.
+ */
+
+static void dd_pair_array(DD_PAIR kernel, const double *a, const double *b,
+			  double *r, double *err, size_t n) {
+  double ap[DD_LANES], bp[DD_LANES], rp[DD_LANES], ep[DD_LANES];
+  DD_MODE m;
+  size_t i, len, full = n - n % DD_LANES;
+
+  if(n == 0) return;
+  m = dd_enter();
+  kernel(a, b, r, err, full);
+  len = n - full;
+  if(len > 0) {
+    for(i = 0; i < DD_LANES; i++) {
+      ap[i] = a[full + (i < len ? i : len - 1)];
+      bp[i] = b[full + (i < len ? i : len - 1)];
+    }
+    kernel(ap, bp, rp, ep, DD_LANES);
+    memcpy(r + full, rp, len * sizeof(double));
+    memcpy(err + full, ep, len * sizeof(double));
+  }
+  dd_leave(m);
+}
+
+static void dd_op_array(DD_OP kernel, const fp_dd *a, const fp_dd *b,
+			fp_dd *r, size_t n) {
+  fp_dd ap[DD_LANES], bp[DD_LANES], rp[DD_LANES];
+  DD_MODE m;
+  size_t i, len, full = n - n % DD_LANES;
+
+  if(n == 0) return;
+  m = dd_enter();
+  kernel(a, b, r, full);
+  len = n - full;
+  if(len > 0) {
+    for(i = 0; i < DD_LANES; i++) {
+      ap[i] = a[full + (i < len ? i : len - 1)];
+      bp[i] = b[full + (i < len ? i : len - 1)];
+    }
+    kernel(ap, bp, rp, DD_LANES);
+    memcpy(r + full, rp, len * sizeof(fp_dd));
+  }
+  dd_leave(m);
+}
+
+/* fp_two_sum(a, b, err) -> a + b rounded to nearest
+ * fp_fast_two_sum(a, b, err) -> a + b rounded to nearest
+ * fp_two_prod(a, b, err) -> a * b rounded to nearest
+ */
+
+double fp_two_sum(double a, double b, double *err) {
+  DD_MODE m = dd_enter();
+  double s = dd_two_sum(a, b, err);
+
+  dd_leave(m);
+  return s;
+}
+
+double fp_fast_two_sum(double a, double b, double *err) {
+  DD_MODE m = dd_enter();
+  double s = dd_fast_two_sum(a, b, err);
+
+  dd_leave(m);
+  return s;
+}
+
+double fp_two_prod(double a, double b, double *err) {
+  DD_MODE m = dd_enter();
+  double p = dd_two_prod(a, b, err);
+
+  dd_leave(m);
+  return p;
+}
+
+/* fpdd_add(a, b) -> a + b
+ * fpdd_mul(a, b) -> a * b
+ * fpdd_div(a, b) -> a / b
+ */
+
+fp_dd fpdd_add(fp_dd a, fp_dd b) {
+  DD_MODE m = dd_enter();
+  fp_dd r = dd_add(a, b);
+
+  dd_leave(m);
+  return r;
+}
+
+fp_dd fpdd_mul(fp_dd a, fp_dd b) {
+  DD_MODE m = dd_enter();
+  fp_dd r = dd_mul(a, b);
+
+  dd_leave(m);
+  return r;
+}
+
+fp_dd fpdd_div(fp_dd a, fp_dd b) {
+  DD_MODE m = dd_enter();
+  fp_dd r = dd_div(a, b);
+
+  dd_leave(m);
+  return r;
+}
+
+/* fp_two_sum_array(a, b, r, err, n)
+ * fp_two_prod_array(a, b, r, err, n)
+ * fpdd_add_array(a, b, r, n)
+ * fpdd_mul_array(a, b, r, n)
+ * fpdd_div_array(a, b, r, n)
+ */
+
+void fp_two_sum_array(const double *a, const double *b, double *r,
+		      double *err, size_t n) {
+  dd_pair_array(DD_CHOOSE(dd_two_sum), a, b, r, err, n);
+}
+
+void fp_two_prod_array(const double *a, const double *b, double *r,
+		       double *err, size_t n) {
+  dd_pair_array(DD_CHOOSE(dd_two_prod), a, b, r, err, n);
+}
+
+void fpdd_add_array(const fp_dd *a, const fp_dd *b, fp_dd *r, size_t n) {
+  dd_op_array(DD_CHOOSE(dd_add), a, b, r, n);
+}
+
+void fpdd_mul_array(const fp_dd *a, const fp_dd *b, fp_dd *r, size_t n) {
+  dd_op_array(DD_CHOOSE(dd_mul), a, b, r, n);
+}
+
+void fpdd_div_array(const fp_dd *a, const fp_dd *b, fp_dd *r, size_t n) {
+  dd_op_array(DD_CHOOSE(dd_div), a, b, r, n);
+}
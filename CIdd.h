@@ -0,0 +1,113 @@
+/*
+    CIieeefp: CIdd.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIdd.c:
+   error-free transformations, which give the rounding error of a sum
+   or product of doubles exactly, and double-double arithmetic built on
+   them, carrying about 106 bits in an unevaluated sum of two doubles.
+   They give the same results whatever rounding direction and (on the
+   x87 FPU) precision control are set. */
+
+#ifndef CIDD_H
+#define CIDD_H
+
+#include <stddef.h>
+#include <CIieeefp.h>
+
+/* A double-double: hi + lo, with hi the sum rounded to nearest, so
+   that |lo| is no more than half an ulp of hi */
+
+typedef struct {
+  double hi, lo;
+} fp_dd;
+
+/* fp_two_sum(a, b, err) -> a + b rounded to nearest
+ * fp_fast_two_sum(a, b, err) -> a + b rounded to nearest
+ * fp_two_prod(a, b, err) -> a * b rounded to nearest
+ *
+ * Put in *err the rounding error of the result, so that the result
+ * plus *err is exactly a + b or a * b. fp_fast_two_sum() is only
+ * right when a is zero or |a| >= |b|. fp_two_prod() uses an FMA if
+ * the library is built for a CPU with one, and Dekker's splitting
+ * otherwise. The error is exact unless the result overflows, or for
+ * fp_two_prod(), unless it is within a factor 2^-26 of overflowing or
+ * less than 2^-969 in size, when the error may be too small to be a
+ * double. If the result is an infinity or NaN, *err is a NaN.
+ */
+
+extern double fp_two_sum(double a, double b, double *err);
+extern double fp_fast_two_sum(double a, double b, double *err);
+extern double fp_two_prod(double a, double b, double *err);
+
+/* fpdd_add(a, b) -> a + b
+ * fpdd_mul(a, b) -> a * b
+ * fpdd_div(a, b) -> a / b
+ *
+ * Double-double arithmetic. The relative error of the result is at
+ * most 2^-104 for fpdd_add() and 2^-102 for fpdd_mul() and
+ * fpdd_div(), given results away from overflow and underflow.
+ * fpdd_add() is the accurate sum, which keeps its bound when a and b
+ * nearly cancel. If the result is not finite, its hi is the operation
+ * done on the hi parts of a and b, and its lo is zero. Exceptions are
+ * raised by the steps of the algorithms rather than by the operation
+ * as a whole, so FP_X_IMP is usual, and an overflow raises FP_X_INV
+ * as well.
+ */
+
+extern fp_dd fpdd_add(fp_dd a, fp_dd b);
+extern fp_dd fpdd_mul(fp_dd a, fp_dd b);
+extern fp_dd fpdd_div(fp_dd a, fp_dd b);
+
+/* fp_two_sum_array(a, b, r, err, n)
+ * fp_two_prod_array(a, b, r, err, n)
+ * fpdd_add_array(a, b, r, n)
+ * fpdd_mul_array(a, b, r, n)
+ * fpdd_div_array(a, b, r, n)
+ *
+ * Do the operation on a[i] and b[i], putting the result in r[i] (and
+ * the error in err[i]), for each of the n elements. Several elements
+ * are worked out at once in vector registers, with AVX2 and FMA
+ * instructions where the CPU has them, but the results are the same
+ * as those of the functions for one element wherever the errors of
+ * products are exact. r and err may be a or b, but must not otherwise
+ * overlap them.
+ */
+
+extern void fp_two_sum_array(const double *a, const double *b, double *r,
+			     double *err, size_t n);
+extern void fp_two_prod_array(const double *a, const double *b, double *r,
+			      double *err, size_t n);
+extern void fpdd_add_array(const fp_dd *a, const fp_dd *b, fp_dd *r,
+			   size_t n);
+extern void fpdd_mul_array(const fp_dd *a, const fp_dd *b, fp_dd *r,
+			   size_t n);
+extern void fpdd_div_array(const fp_dd *a, const fp_dd *b, fp_dd *r,
+			   size_t n);
+
+#endif
@@ -0,0 +1,1356 @@
+/*
+    CIieeefp: CIelemfn.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains exp, log, sin, cos and pow rounded in a chosen
+   direction. Each function has a kernel that works out the value in
+   double-double arithmetic (an unevaluated sum of two doubles) as
+   (h + l) 2^k, with a bound on its relative error of 2^-70, at least
+   eight times what the kernels actually make. elem_round() then rounds
+   that to a double in the direction wanted: the result is the
+   correctly rounded one unless the error bound straddles a double,
+   when the double further out is taken, so that results are always
+   bounds. Exact results, such as exp(0), log(1) and powers of two, are
+   recognised and have no error.
+
+   The kernels work on ELEM_LANES elements at once using gcc's vector
+   extensions, which compile to SSE2 instructions, or AVX2 ones chosen
+   at run time as in CIbatch.c. Double-double arithmetic is latency
+   bound, so even without wider vectors this keeps several elements in
+   flight. Table lookups are done lane by lane, and elements needing
+   special handling (NaNs, infinities, results that are exact, too large
+   or too small, and sin and cos of arguments above 2^20) are worked out
+   apart from the vectors. A single element is done as a vector of
+   copies of it.
+
+   Double-double arithmetic only works when rounding to nearest, so the
+   kernels need FP_RN whatever the caller has set, and on the x87 FPU
+   precision control set to double. gcc must not contract multiplies
+   and adds into FMAs in Dekker's product, so the file is compiled with
+   -ffp-contract=off; with FMA instructions available at compile time
+   they are used instead. The tables and constants were made with 120
+   digit arithmetic. Arguments of sin and cos are reduced modulo pi/2
+   with a four-part Cody-Waite reduction below 2^20, and above with
+   Payne and Hanek's method using 1344 bits of 2/pi, so the reduction is
+   accurate for all doubles. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <CIelemfn.h>
+
+#if defined(__GNUC__) && __GNUC__ >= 5 \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build AVX2 kernels
+				   chosen at run time */
+#endif
+
+#define ELEM_LANES 4		/* Elements per vector */
+#define ELEM_ERR 0x1p-70	/* Relative error bound of the kernels */
+#define ELEM_HUGE 2000		/* Power of two standing in for values
+				   too large or small for a double */
+
+#define ELEM_INLINE static __inline__ __attribute__((always_inline))
+
+/* Vectors of doubles, masks of the same size (each lane all ones or
+   all zeros) and double-doubles, scalar and vector, with |l| no more
+   than half an ulp of h */
+
+typedef double ELEM_V __attribute__((vector_size(ELEM_LANES * sizeof(double))));
+typedef int64_t ELEM_M __attribute__((vector_size(ELEM_LANES * sizeof(double))));
+
+typedef struct {
+  double h, l;
+} ELEM_DD;
+
+typedef struct {
+  ELEM_V h, l;
+} ELEM_VDD;
+
+/* The result of a kernel: (h + l) * 2^k to within err * |h| * 2^k,
+   unless exact is set, when the result is h */
+
+typedef struct {
+  double h, l, err;
+  int k, exact;
+} ELEM_VALUE;
+
+/* A kernel for ELEM_LANES elements of x (and y for pow) */
+
+typedef void (*ELEM_BLOCK)(const double *x, const double *y, ELEM_VALUE *v);
+
+/* The rounding direction and precision control to put back */
+
+typedef struct {
+  fp_rnd rnd;
+#ifndef __SSE2_MATH__
+  fp_pctl pctl;
+#endif
+} ELEM_MODE;
+
+/* 2^(j/64) for j = 0 to 63 */
+
+static const ELEM_DD elem_exp_table[64] = {
+  { 0x1.0000000000000p+0, 0.0 },
+  { 0x1.02c9a3e778061p+0, -0x1.19083535b085dp-56 },
+  { 0x1.059b0d3158574p+0, 0x1.d73e2a475b465p-55 },
+  { 0x1.0874518759bc8p+0, 0x1.186be4bb284ffp-57 },
+  { 0x1.0b5586cf9890fp+0, 0x1.8a62e4adc610bp-54 },
+  { 0x1.0e3ec32d3d1a2p+0, 0x1.03a1727c57b53p-59 },
+  { 0x1.11301d0125b51p+0, -0x1.6c51039449b3ap-54 },
+  { 0x1.1429aaea92de0p+0, -0x1.32fbf9af1369ep-54 },
+  { 0x1.172b83c7d517bp+0, -0x1.19041b9d78a76p-55 },
+  { 0x1.1a35beb6fcb75p+0, 0x1.e5b4c7b4968e4p-55 },
+  { 0x1.1d4873168b9aap+0, 0x1.e016e00a2643cp-54 },
+  { 0x1.2063b88628cd6p+0, 0x1.dc775814a8495p-55 },
+  { 0x1.2387a6e756238p+0, 0x1.9b07eb6c70573p-54 },
+  { 0x1.26b4565e27cddp+0, 0x1.2bd339940e9d9p-55 },
+  { 0x1.29e9df51fdee1p+0, 0x1.612e8afad1255p-55 },
+  { 0x1.2d285a6e4030bp+0, 0x1.0024754db41d5p-54 },
+  { 0x1.306fe0a31b715p+0, 0x1.6f46ad23182e4p-55 },
+  { 0x1.33c08b26416ffp+0, 0x1.32721843659a6p-54 },
+  { 0x1.371a7373aa9cbp+0, -0x1.63aeabf42eae2p-54 },
+  { 0x1.3a7db34e59ff7p+0, -0x1.5e436d661f5e3p-56 },
+  { 0x1.3dea64c123422p+0, 0x1.ada0911f09ebcp-55 },
+  { 0x1.4160a21f72e2ap+0, -0x1.ef3691c309278p-58 },
+  { 0x1.44e086061892dp+0, 0x1.89b7a04ef80d0p-59 },
+  { 0x1.486a2b5c13cd0p+0, 0x1.3c1a3b69062f0p-56 },
+  { 0x1.4bfdad5362a27p+0, 0x1.d4397afec42e2p-56 },
+  { 0x1.4f9b2769d2ca7p+0, -0x1.4b309d25957e3p-54 },
+  { 0x1.5342b569d4f82p+0, -0x1.07abe1db13cadp-55 },
+  { 0x1.56f4736b527dap+0, 0x1.9bb2c011d93adp-54 },
+  { 0x1.5ab07dd485429p+0, 0x1.6324c054647adp-54 },
+  { 0x1.5e76f15ad2148p+0, 0x1.ba6f93080e65ep-54 },
+  { 0x1.6247eb03a5585p+0, -0x1.383c17e40b497p-54 },
+  { 0x1.6623882552225p+0, -0x1.bb60987591c34p-54 },
+  { 0x1.6a09e667f3bcdp+0, -0x1.bdd3413b26456p-54 },
+  { 0x1.6dfb23c651a2fp+0, -0x1.bbe3a683c88abp-57 },
+  { 0x1.71f75e8ec5f74p+0, -0x1.16e4786887a99p-55 },
+  { 0x1.75feb564267c9p+0, -0x1.0245957316dd3p-54 },
+  { 0x1.7a11473eb0187p+0, -0x1.41577ee04992fp-55 },
+  { 0x1.7e2f336cf4e62p+0, 0x1.05d02ba15797ep-56 },
+  { 0x1.82589994cce13p+0, -0x1.d4c1dd41532d8p-54 },
+  { 0x1.868d99b4492edp+0, -0x1.fc6f89bd4f6bap-54 },
+  { 0x1.8ace5422aa0dbp+0, 0x1.6e9f156864b27p-54 },
+  { 0x1.8f1ae99157736p+0, 0x1.5cc13a2e3976cp-55 },
+  { 0x1.93737b0cdc5e5p+0, -0x1.75fc781b57ebcp-57 },
+  { 0x1.97d829fde4e50p+0, -0x1.d185b7c1b85d1p-54 },
+  { 0x1.9c49182a3f090p+0, 0x1.c7c46b071f2bep-56 },
+  { 0x1.a0c667b5de565p+0, -0x1.359495d1cd533p-54 },
+  { 0x1.a5503b23e255dp+0, -0x1.d2f6edb8d41e1p-54 },
+  { 0x1.a9e6b5579fdbfp+0, 0x1.0fac90ef7fd31p-54 },
+  { 0x1.ae89f995ad3adp+0, 0x1.7a1cd345dcc81p-54 },
+  { 0x1.b33a2b84f15fbp+0, -0x1.2805e3084d708p-57 },
+  { 0x1.b7f76f2fb5e47p+0, -0x1.5584f7e54ac3bp-56 },
+  { 0x1.bcc1e904bc1d2p+0, 0x1.23dd07a2d9e84p-55 },
+  { 0x1.c199bdd85529cp+0, 0x1.11065895048ddp-55 },
+  { 0x1.c67f12e57d14bp+0, 0x1.2884dff483cadp-54 },
+  { 0x1.cb720dcef9069p+0, 0x1.503cbd1e949dbp-56 },
+  { 0x1.d072d4a07897cp+0, -0x1.cbc3743797a9cp-54 },
+  { 0x1.d5818dcfba487p+0, 0x1.2ed02d75b3707p-55 },
+  { 0x1.da9e603db3285p+0, 0x1.c2300696db532p-54 },
+  { 0x1.dfc97337b9b5fp+0, -0x1.1a5cd4f184b5cp-54 },
+  { 0x1.e502ee78b3ff6p+0, 0x1.39e8980a9cc8fp-55 },
+  { 0x1.ea4afa2a490dap+0, -0x1.e9c23179c2893p-54 },
+  { 0x1.efa1bee615a27p+0, 0x1.dc7f486a4b6b0p-54 },
+  { 0x1.f50765b6e4540p+0, 0x1.9d3e12dd8a18bp-54 },
+  { 0x1.fa7c1819e90d8p+0, 0x1.74853f3a5931ep-55 }
+};
+
+/* ln(2)/64 in three parts, the first with enough trailing zeros that
+   k times it is exact for |k| < 2^17, and 64/ln(2) */
+
+#define EXP_L1 0x1.62e42fefa0000p-7
+#define EXP_L2 0x1.cf79abc9e3b3ap-46
+#define EXP_L3 -0x1.ff0342542fc33p-100
+#define EXP_INV_L 0x1.71547652b82fep+6
+
+/* c, -ln(c) (high and low parts) for j = -38 to 53: c is 1/(1 + j/128)
+   to 10 bits, so that m * c is within 2^-7 of 1 for m within 1/256 of
+   1 + j/128 */
+
+static const double elem_log_table[92][3] = {
+  { 0x1.6c00000000000p+0, -0x1.686c81e9b14afp-2, 0x1.ddea0f7f58e3dp-57 }, /* -38 */
+  { 0x1.6800000000000p+0, -0x1.5d1bdbf5809cap-2, -0x1.4236383dc7fe1p-56 }, /* -37 */
+  { 0x1.6400000000000p+0, -0x1.51aad872df82dp-2, -0x1.3927ac19f55e3p-59 }, /* -36 */
+  { 0x1.6080000000000p+0, -0x1.478cd5959b3d9p-2, -0x1.37e191a12fb48p-58 }, /* -35 */
+  { 0x1.5c80000000000p+0, -0x1.3bdd24eb14b6ap-2, -0x1.2da3c6449a7d0p-58 }, /* -34 */
+  { 0x1.5900000000000p+0, -0x1.31871c9544185p-2, 0x1.51acc4c09b379p-60 }, /* -33 */
+  { 0x1.5580000000000p+0, -0x1.27161913f853dp-2, -0x1.e3ec2ac9676b8p-57 }, /* -32 */
+  { 0x1.5200000000000p+0, -0x1.1c898c16999fbp-2, 0x1.0e5c62aff1c44p-60 }, /* -31 */
+  { 0x1.4e80000000000p+0, -0x1.11e0e2dad9cb7p-2, -0x1.dc0cc6917022bp-63 }, /* -30 */
+  { 0x1.4b00000000000p+0, -0x1.071b85fcd590dp-2, -0x1.d1707f97bde80p-58 }, /* -29 */
+  { 0x1.4780000000000p+0, -0x1.f871b28955045p-3, -0x1.4ad6c8812d31ap-63 }, /* -28 */
+  { 0x1.4480000000000p+0, -0x1.e598ed5a87e2fp-3, 0x1.a5e78f4c50659p-58 }, /* -27 */
+  { 0x1.4180000000000p+0, -0x1.d293581b6b3e7p-3, 0x1.c04a2aa97ac8ep-58 }, /* -26 */
+  { 0x1.3e00000000000p+0, -0x1.bc286742d8cd6p-3, -0x1.4fce744870f55p-58 }, /* -25 */
+  { 0x1.3b00000000000p+0, -0x1.a8becfc882f19p-3, 0x1.e8c37918c39ebp-58 }, /* -24 */
+  { 0x1.3800000000000p+0, -0x1.9525a9cf456b4p-3, -0x1.d904c1d4e2e26p-57 }, /* -23 */
+  { 0x1.3500000000000p+0, -0x1.815c0a14357ebp-3, 0x1.4be48073a0564p-58 }, /* -22 */
+  { 0x1.3200000000000p+0, -0x1.6d60fe719d21dp-3, 0x1.caae268ecd179p-57 }, /* -21 */
+  { 0x1.2f80000000000p+0, -0x1.5c940075972b9p-3, -0x1.adccb73379cc5p-58 }, /* -20 */
+  { 0x1.2c80000000000p+0, -0x1.483bccce6e3ddp-3, -0x1.29391fb1b4b22p-57 }, /* -19 */
+  { 0x1.2a00000000000p+0, -0x1.371fc201e8f74p-3, -0x1.de6cb62af18a0p-58 }, /* -18 */
+  { 0x1.2700000000000p+0, -0x1.2266f190a5acbp-3, -0x1.f547bf1809e88p-57 }, /* -17 */
+  { 0x1.2480000000000p+0, -0x1.10f8e422539b1p-3, -0x1.8f798d39f1b7dp-58 }, /* -16 */
+  { 0x1.2200000000000p+0, -0x1.fec9131dbeabbp-4, 0x1.5746b9981b36cp-58 }, /* -15 */
+  { 0x1.1f80000000000p+0, -0x1.db5270187d927p-4, -0x1.e15ab8607d2acp-58 }, /* -14 */
+  { 0x1.1d00000000000p+0, -0x1.b78c82bb0eda1p-4, -0x1.0878cf0327e21p-61 }, /* -13 */
+  { 0x1.1a80000000000p+0, -0x1.9375e55595edep-4, 0x1.e463f9e4dd920p-59 }, /* -12 */
+  { 0x1.1800000000000p+0, -0x1.6f0d28ae56b4cp-4, 0x1.906d99184b992p-58 }, /* -11 */
+  { 0x1.1580000000000p+0, -0x1.4a50d3aa1b040p-4, -0x1.ecf768c1dd57bp-61 }, /* -10 */
+  { 0x1.1380000000000p+0, -0x1.2cb0283f5de1fp-4, 0x1.d359a8fde8adep-60 }, /* -9 */
+  { 0x1.1100000000000p+0, -0x1.075983598e471p-4, -0x1.80da5333c45b8p-59 }, /* -8 */
+  { 0x1.0f00000000000p+0, -0x1.d276b8adb0b52p-5, -0x1.1e3c53257fd47p-61 }, /* -7 */
+  { 0x1.0c80000000000p+0, -0x1.868a83083f6cfp-5, 0x1.d09a5634943dbp-61 }, /* -6 */
+  { 0x1.0a80000000000p+0, -0x1.494acc34d911cp-5, -0x1.e295bf491ccc5p-59 }, /* -5 */
+  { 0x1.0880000000000p+0, -0x1.0b94f7c196176p-5, -0x1.da43f761f4dc4p-59 }, /* -4 */
+  { 0x1.0600000000000p+0, -0x1.7b91b07d5b11bp-6, 0x1.5b602ace3a510p-60 }, /* -3 */
+  { 0x1.0400000000000p+0, -0x1.fc0a8b0fc03e4p-7, 0x1.83092c59642a1p-62 }, /* -2 */
+  { 0x1.0200000000000p+0, -0x1.fe02a6b106789p-8, 0x1.e44b7e3711ebfp-67 }, /* -1 */
+  { 0x1.0000000000000p+0, 0.0, 0.0 }, /* 0 */
+  { 0x1.fc00000000000p-1, 0x1.010157588de71p-7, 0x1.46662d417ced0p-62 }, /* 1 */
+  { 0x1.f800000000000p-1, 0x1.0205658935847p-6, 0x1.27c8e8416e71fp-60 }, /* 2 */
+  { 0x1.f400000000000p-1, 0x1.8492528c8cabfp-6, -0x1.d192d0619fa67p-60 }, /* 3 */
+  { 0x1.f000000000000p-1, 0x1.0415d89e74444p-5, 0x1.c05cf1d753622p-59 }, /* 4 */
+  { 0x1.ed00000000000p-1, 0x1.35c8bfaa1306bp-5, -0x1.50830a65543a4p-63 }, /* 5 */
+  { 0x1.e900000000000p-1, 0x1.788595a3577bap-5, 0x1.e5ef898b67923p-59 }, /* 6 */
+  { 0x1.e500000000000p-1, 0x1.bbcebfc68f420p-5, 0x1.e5cf3a0f56f72p-60 }, /* 7 */
+  { 0x1.e200000000000p-1, 0x1.eea31c006b87cp-5, -0x1.3e4fc93b7b66cp-59 }, /* 8 */
+  { 0x1.de00000000000p-1, 0x1.1973bd1465567p-4, -0x1.7558367a6acf6p-59 }, /* 9 */
+  { 0x1.db00000000000p-1, 0x1.333d7f8183f4bp-4, 0x1.a92afc8ef70b1p-58 }, /* 10 */
+  { 0x1.d700000000000p-1, 0x1.55e10050e0384p-4, -0x1.45f9d61c68c1bp-58 }, /* 11 */
+  { 0x1.d400000000000p-1, 0x1.700d30aeac0e1p-4, -0x1.72566212cdd05p-61 }, /* 12 */
+  { 0x1.d100000000000p-1, 0x1.8a6477a91dc29p-4, -0x1.fa83214904842p-59 }, /* 13 */
+  { 0x1.ce00000000000p-1, 0x1.a4e7640b1bc38p-4, -0x1.5b5ca203e4259p-58 }, /* 14 */
+  { 0x1.ca00000000000p-1, 0x1.c885801bc4b23p-4, 0x1.a38cb559a6706p-58 }, /* 15 */
+  { 0x1.c700000000000p-1, 0x1.e3707ee30487bp-4, 0x1.09ccecd579d99p-58 }, /* 16 */
+  { 0x1.c400000000000p-1, 0x1.fe89139dbd566p-4, -0x1.ac9f4215f9393p-58 }, /* 17 */
+  { 0x1.c100000000000p-1, 0x1.0ce7ecdccc28dp-3, -0x1.692a0055dc959p-57 }, /* 18 */
+  { 0x1.be00000000000p-1, 0x1.1aa2b7e23f72ap-3, -0x1.c6ef1d9b2ef7ep-59 }, /* 19 */
+  { 0x1.bb00000000000p-1, 0x1.28753bc11aba5p-3, -0x1.6394d9fa33311p-57 }, /* 20 */
+  { 0x1.b800000000000p-1, 0x1.365fcb0159016p-3, 0x1.7d411a5b944adp-58 }, /* 21 */
+  { 0x1.b500000000000p-1, 0x1.4462b9dc9b3dcp-3, -0x1.629c46c186385p-58 }, /* 22 */
+  { 0x1.b200000000000p-1, 0x1.527e5e4a1b58dp-3, -0x1.71a9682395bfdp-61 }, /* 23 */
+  { 0x1.af00000000000p-1, 0x1.60b3100b09476p-3, -0x1.5b2623e05016bp-58 }, /* 24 */
+  { 0x1.ac00000000000p-1, 0x1.6f0128b756abcp-3, -0x1.8de59c21e166cp-57 }, /* 25 */
+  { 0x1.aa00000000000p-1, 0x1.7898d85444c73p-3, 0x1.ef8f6ebcfb201p-58 }, /* 26 */
+  { 0x1.a700000000000p-1, 0x1.871213750e994p-3, 0x1.d685f35eea2a0p-57 }, /* 27 */
+  { 0x1.a400000000000p-1, 0x1.95a5adcf7017fp-3, 0x1.142c507fb7a3dp-58 }, /* 28 */
+  { 0x1.a100000000000p-1, 0x1.a454082e6ab05p-3, 0x1.df207dc5c34c6p-58 }, /* 29 */
+  { 0x1.9f00000000000p-1, 0x1.ae2ca6f672bd4p-3, 0x1.ab5ca9eaa088ap-57 }, /* 30 */
+  { 0x1.9c00000000000p-1, 0x1.bd087383bd8adp-3, 0x1.dd355f6a516d7p-60 }, /* 31 */
+  { 0x1.9a00000000000p-1, 0x1.c6ffbc6f00f71p-3, -0x1.8e58b2c57a4a5p-57 }, /* 32 */
+  { 0x1.9700000000000p-1, 0x1.d60a17f903515p-3, -0x1.c0df841a71b7ap-57 }, /* 33 */
+  { 0x1.9500000000000p-1, 0x1.e020cc6235ab5p-3, 0x1.fea48dd7b81d1p-58 }, /* 34 */
+  { 0x1.9200000000000p-1, 0x1.ef5ade4dcffe6p-3, -0x1.08ab2ddc708a0p-58 }, /* 35 */
+  { 0x1.9000000000000p-1, 0x1.f991c6cb3b379p-3, 0x1.f665066f980a2p-57 }, /* 36 */
+  { 0x1.8d00000000000p-1, 0x1.047e60cde83b8p-2, -0x1.0779634061cbcp-56 }, /* 37 */
+  { 0x1.8b00000000000p-1, 0x1.09aa572e6c6d4p-2, 0x1.43c2e68684d53p-57 }, /* 38 */
+  { 0x1.8800000000000p-1, 0x1.1178e8227e47cp-2, -0x1.0e63a5f01c691p-57 }, /* 39 */
+  { 0x1.8600000000000p-1, 0x1.16b5ccbacfb73p-2, 0x1.66fbd28b40935p-56 }, /* 40 */
+  { 0x1.8400000000000p-1, 0x1.1bf99635a6b95p-2, -0x1.12aeb84249223p-57 }, /* 41 */
+  { 0x1.8200000000000p-1, 0x1.214456d0eb8d4p-2, 0x1.f7ae91aeba60ap-57 }, /* 42 */
+  { 0x1.7f00000000000p-1, 0x1.2941afb186b7cp-2, -0x1.856e61c515740p-57 }, /* 43 */
+  { 0x1.7d00000000000p-1, 0x1.2e9e2bce12286p-2, 0x1.8251a3b83d97ap-62 }, /* 44 */
+  { 0x1.7b00000000000p-1, 0x1.3401e12aecba1p-2, -0x1.cd55b8a4746c0p-58 }, /* 45 */
+  { 0x1.7900000000000p-1, 0x1.396ce359bbf54p-2, -0x1.ce2b31b31e8b0p-58 }, /* 46 */
+  { 0x1.7600000000000p-1, 0x1.419b423d5e8c7p-2, 0x1.0dbb243827392p-57 }, /* 47 */
+  { 0x1.7400000000000p-1, 0x1.4718dc271c41bp-2, 0x1.8fb4c14c56eefp-60 }, /* 48 */
+  { 0x1.7200000000000p-1, 0x1.4c9e09e172c3cp-2, -0x1.123615b147a5dp-58 }, /* 49 */
+  { 0x1.7000000000000p-1, 0x1.522ae0738a3d8p-2, -0x1.8f7e9b38a6979p-57 }, /* 50 */
+  { 0x1.6e00000000000p-1, 0x1.57bf753c8d1fbp-2, -0x1.0908d15f88b63p-57 }, /* 51 */
+  { 0x1.6c00000000000p-1, 0x1.5d5bddf595f30p-2, -0x1.6541148cbb8a2p-56 }, /* 52 */
+  { 0x1.6a00000000000p-1, 0x1.630030b3aac49p-2, 0x1.dc18ce51fff99p-57 }  /* 53 */
+};
+
+#define LOG_LN2_H 0x1.62e42fefa39efp-1
+#define LOG_LN2_L 0x1.abc9e3b39803fp-56
+#define LOG_SQRT2 0x1.6a09e667f3bcdp+0
+
+/* pi/2 in four parts, the first three with 33 bits so that k times
+   them is exact for |k| < 2^20, pi/2 as a double-double, and 2/pi */
+
+#define TRIG_P1 0x1.921fb54400000p+0
+#define TRIG_P2 0x1.0b4611a600000p-34
+#define TRIG_P3 0x1.3198a2e000000p-69
+#define TRIG_P4 0x1.b839a252049c1p-104
+#define TRIG_PIO2_H 0x1.921fb54442d18p+0
+#define TRIG_PIO2_L 0x1.1a62633145c07p-54
+#define TRIG_INV_PIO2 0x1.45f306dc9c883p-1
+#define TRIG_CW_MAX 0x1p20	/* Largest argument for Cody-Waite */
+
+/* The first 1344 bits of 2/pi, after the binary point */
+
+static const uint64_t elem_two_over_pi[21] = {
+  0xa2f9836e4e441529ULL, 0xfc2757d1f534ddc0ULL, 0xdb6295993c439041ULL,
+  0xfe5163abdebbc561ULL, 0xb7246e3a424dd2e0ULL, 0x06492eea09d1921cULL,
+  0xfe1deb1cb129a73eULL, 0xe88235f52ebb4484ULL, 0xe99c7026b45f7e41ULL,
+  0x3991d639835339f4ULL, 0x9c845f8bbdf9283bULL, 0x1ff897ffde05980fULL,
+  0xef2f118b5a0a6d1fULL, 0x6d367ecf27cb09b7ULL, 0x4f463f669e5fea2dULL,
+  0x7527bac7ebe5f17bULL, 0x3d0739f78a5292eaULL, 0x6bfb5fb11f8d5d08ULL,
+  0x56033046fc7b6babULL, 0xf0cfbc209af4361dULL, 0xa9e391615ee61b08ULL
+};
+
+/* Taylor series coefficients: the leading ones as double-doubles and
+   the rest, too small to need them, as doubles, highest first */
+
+static const double elem_exp_d[8] = {
+  0x1.27e4fb7789f5cp-22, 0x1.71de3a556c734p-19, 0x1.a01a01a01a01ap-16,
+  0x1.a01a01a01a01ap-13, 0x1.6c16c16c16c17p-10, 0x1.1111111111111p-7,
+  0x1.5555555555555p-5, 0x1.5555555555555p-3
+};				/* 1/10! down to 1/3! */
+static const ELEM_DD elem_log_third = {
+  0x1.5555555555555p-2, 0x1.5555555555555p-56
+};
+static const double elem_log_d[12] = {
+  1.0 / 15, -1.0 / 14, 1.0 / 13, -1.0 / 12, 1.0 / 11, -1.0 / 10,
+  1.0 / 9, -1.0 / 8, 1.0 / 7, -1.0 / 6, 1.0 / 5, -1.0 / 4
+};
+static const ELEM_DD elem_sin_dd[4] = {
+  { -0x1.5555555555555p-3, -0x1.5555555555555p-57 },
+  { 0x1.1111111111111p-7, 0x1.1111111111111p-63 },
+  { -0x1.a01a01a01a01ap-13, -0x1.a01a01a01a01ap-73 },
+  { 0x1.71de3a556c734p-19, -0x1.c154f8ddc6c00p-73 }
+};				/* -1/3! to 1/9! */
+static const double elem_sin_d[8] = {
+  0x1.3f3ccdd165fa9p-84, -0x1.761b41316381ap-75, 0x1.71b8ef6dcf572p-66,
+  -0x1.2f49b46814157p-57, 0x1.952c77030ad4ap-49, -0x1.ae7f3e733b81fp-41,
+  0x1.6124613a86d09p-33, -0x1.ae64567f544e4p-26
+};				/* 1/25! down to -1/11! */
+static const ELEM_DD elem_cos_dd[4] = {
+  { -0x1.0000000000000p-1, 0.0 },
+  { 0x1.5555555555555p-5, 0x1.5555555555555p-59 },
+  { -0x1.6c16c16c16c17p-10, 0x1.f49f49f49f49fp-65 },
+  { 0x1.a01a01a01a01ap-16, 0x1.a01a01a01a01ap-76 }
+};				/* -1/2! to 1/8! */
+static const double elem_cos_d[8] = {
+  0x1.f2cf01972f578p-80, -0x1.0ce396db7f853p-70, 0x1.e542ba4020225p-62,
+  -0x1.6827863b97d97p-53, 0x1.ae7f3e733b81fp-45, -0x1.93974a8c07c9dp-37,
+  0x1.1eed8eff8d898p-29, -0x1.27e4fb7789f5cp-22
+};				/* 1/24! down to -1/10! */
+
+/* elem_pow2(e) -> 2^e
+ *
+ * e is from -1022 to 1023.
+ */
+
+static double elem_pow2(int e) {
+  uint64_t bits = (uint64_t)(e + 1023) << 52;
+  double x;
+
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+/* elem_scale(x, e) -> x * 2^e
+ *
+ * Exact if the result is representable: the first multiplication
+ * leaves a normal number whenever e is large enough to need two.
+ */
+
+static double elem_scale(double x, int e) {
+  if(e > 1000) {
+    x *= elem_pow2(1000);
+    e -= 1000;
+  }
+  else if(e < -1000) {
+    x *= elem_pow2(-1000);
+    e += 1000;
+  }
+  return x * elem_pow2(e);
+}
+
+/* elem_exponent(x) -> exponent of x
+ *
+ * x is normal and not zero, so that x * 2^-exponent is in [1, 2).
+ */
+
+static int elem_exponent(double x) {
+  uint64_t bits;
+
+  memcpy(&bits, &x, sizeof(bits));
+  return (int)((bits >> 52) & 0x7ff) - 1023;
+}
+
+/* elem_exact(x) -> kernel result that is exactly x
+ */
+
+static ELEM_VALUE elem_exact(double x) {
+  ELEM_VALUE v;
+
+  v.h = x;
+  v.l = v.err = 0.0;
+  v.k = 0;
+  v.exact = 1;
+  return v;
+}
+
+/* elem_value(h, l, k, err) -> kernel result (h + l) * 2^k
+ */
+
+static ELEM_VALUE elem_value(double h, double l, int k, double err) {
+  ELEM_VALUE v;
+
+  v.h = h;
+  v.l = l;
+  v.k = k;
+  v.err = err;
+  v.exact = 0;
+  return v;
+}
+
+/* Error-free transformations and double-double arithmetic
+ *
+ * elem_two_sum(a, b) and elem_fast_two_sum(a, b) (|a| >= |b|) return
+ * a + b rounded and its rounding error; elem_two_prod(a, b) the same
+ * for a * b, with an FMA if the library is built for a CPU with one,
+ * and Dekker's splitting otherwise. The double-double operations have
+ * a relative error of a few 2^-106. The elem_v_ versions do the same
+ * on vectors, taking them by pointer, as passing a vector by value
+ * has a different ABI with AVX enabled and without.
+ */
+
+static ELEM_DD elem_fast_two_sum(double a, double b) {
+  ELEM_DD r;
+
+  r.h = a + b;
+  r.l = b - (r.h - a);
+  return r;
+}
+
+static ELEM_DD elem_two_sum(double a, double b) {
+  ELEM_DD r;
+  double bb;
+
+  r.h = a + b;
+  bb = r.h - a;
+  r.l = (a - (r.h - bb)) + (b - bb);
+  return r;
+}
+
+static ELEM_DD elem_two_prod(double a, double b) {
+  ELEM_DD r;
+#ifdef __FMA__
+  r.h = a * b;
+  r.l = __builtin_fma(a, b, -r.h);
+#else
+  double c, ah, al, bh, bl;
+
+  r.h = a * b;
+  c = 134217729.0 * a;		/* 2^27 + 1 */
+  ah = c - (c - a);
+  al = a - ah;
+  c = 134217729.0 * b;
+  bh = c - (c - b);
+  bl = b - bh;
+  r.l = ((ah * bh - r.h) + ah * bl + al * bh) + al * bl;
+#endif
+  return r;
+}
+
+static ELEM_DD elem_dd_add_d(ELEM_DD a, double b) {
+  ELEM_DD s;
+
+  s = elem_two_sum(a.h, b);
+  s.l += a.l;
+  return elem_fast_two_sum(s.h, s.l);
+}
+
+static ELEM_DD elem_dd_mul(ELEM_DD a, ELEM_DD b) {
+  ELEM_DD p;
+
+  p = elem_two_prod(a.h, b.h);
+  p.l += a.h * b.l + a.l * b.h;
+  return elem_fast_two_sum(p.h, p.l);
+}
+
+#define ELEM_V_SELECT(m, a, b) \
+  ((ELEM_V)(((ELEM_M)(a) & (m)) | ((ELEM_M)(b) & ~(m))))
+
+ELEM_INLINE ELEM_VDD elem_v_fast_two_sum(const ELEM_V *a, const ELEM_V *b) {
+  ELEM_VDD r;
+
+  r.h = *a + *b;
+  r.l = *b - (r.h - *a);
+  return r;
+}
+
+ELEM_INLINE ELEM_VDD elem_v_two_sum(const ELEM_V *a, const ELEM_V *b) {
+  ELEM_VDD r;
+  ELEM_V bb;
+
+  r.h = *a + *b;
+  bb = r.h - *a;
+  r.l = (*a - (r.h - bb)) + (*b - bb);
+  return r;
+}
+
+ELEM_INLINE ELEM_VDD elem_v_two_prod(const ELEM_V *a, const ELEM_V *b) {
+  ELEM_VDD r;
+#ifdef __FMA__
+  int i;
+
+  r.h = *a * *b;
+  for(i = 0; i < ELEM_LANES; i++) {
+    r.l[i] = __builtin_fma((*a)[i], (*b)[i], -r.h[i]);
+  }
+#else
+  ELEM_V c, ah, al, bh, bl;
+
+  r.h = *a * *b;
+  c = 134217729.0 * *a;
+  ah = c - (c - *a);
+  al = *a - ah;
+  c = 134217729.0 * *b;
+  bh = c - (c - *b);
+  bl = *b - bh;
+  r.l = ((ah * bh - r.h) + ah * bl + al * bh) + al * bl;
+#endif
+  return r;
+}
+
+ELEM_INLINE ELEM_VDD elem_v_dd_add(const ELEM_VDD *a, const ELEM_VDD *b) {
+  ELEM_VDD s, t;
+
+  s = elem_v_two_sum(&a->h, &b->h);
+  t = elem_v_two_sum(&a->l, &b->l);
+  s.l += t.h;
+  s = elem_v_fast_two_sum(&s.h, &s.l);
+  s.l += t.l;
+  return elem_v_fast_two_sum(&s.h, &s.l);
+}
+
+ELEM_INLINE ELEM_VDD elem_v_dd_add_d(const ELEM_VDD *a, const ELEM_V *b) {
+  ELEM_VDD s;
+
+  s = elem_v_two_sum(&a->h, b);
+  s.l += a->l;
+  return elem_v_fast_two_sum(&s.h, &s.l);
+}
+
+ELEM_INLINE ELEM_VDD elem_v_dd_mul(const ELEM_VDD *a, const ELEM_VDD *b) {
+  ELEM_VDD p;
+
+  p = elem_v_two_prod(&a->h, &b->h);
+  p.l += a->h * b->l + a->l * b->h;
+  return elem_v_fast_two_sum(&p.h, &p.l);
+}
+
+ELEM_INLINE ELEM_VDD elem_v_dd_mul_d(const ELEM_VDD *a, const ELEM_V *b) {
+  ELEM_VDD p;
+
+  p = elem_v_two_prod(&a->h, b);
+  p.l += a->l * *b;
+  return elem_v_fast_two_sum(&p.h, &p.l);
+}
+
+/* ELEM_V_ROUND(x) -> x rounded to the nearest integer
+ *
+ * |x| < 2^51.
+ */
+
+#define ELEM_V_ROUND(x) (((x) + 0x1.8p52) - 0x1.8p52)
+
+/* elem_round(v, rnd) -> v rounded in the direction rnd
+ *
+ * The value is scaled so that the ulp of the result (2^-1074 if it is
+ * subnormal) is 1, making it n + f for an integer n and |f| < 1. The
+ * result is n plus the floor (or ceiling) of f less (or plus) the
+ * error: unless the error straddles an integer this is the floor (or
+ * ceiling) of the true value, and otherwise one further out. Just
+ * below a power of two the ulp halves, so values that might be below
+ * one are rounded on the finer grid.
+ */
+
+static double elem_floor(double d) {
+  double i = (double)(int)d;
+
+  return i > d ? i - 1.0 : i;
+}
+
+static double elem_round(ELEM_VALUE v, fp_rnd rnd) {
+  ELEM_DD s;
+  double th, tl, te, n, f, d, inc, r;
+  int neg, dir, e, q, sh;
+
+  if(v.exact || v.h == 0.0) return v.h;
+  s = elem_fast_two_sum(v.h, v.l);
+  neg = s.h < 0.0;
+  if(neg) {
+    s.h = -s.h;
+    s.l = -s.l;
+  }
+  if(rnd == FP_RN) dir = 0;
+  else if(rnd == FP_RZ) dir = -1;
+  else dir = ((rnd == FP_RP) != neg) ? 1 : -1;
+
+  e = elem_exponent(s.h);
+  s.h = elem_scale(s.h, -e);
+  s.l = elem_scale(s.l, -e);
+  e += v.k;			/* Value in [2^e, 2^(e + 1)) */
+  q = e - 52 < -1074 ? -1074 : e - 52;
+  sh = e - q;
+  if(sh < -2) {			/* Below half the smallest subnormal */
+    r = dir > 0 ? elem_scale(1.0, -1074) : 0.0;
+    return neg ? -r : r;
+  }
+  th = elem_scale(s.h, sh);
+  tl = elem_scale(s.l, sh);
+  n = (double)(int64_t)th;
+  f = (th - n) + tl;
+  te = v.err * elem_scale(2.0, sh) + (th == n ? 0.0 : 0x1p-50);
+				/* The last for the rounding of f */
+  d = dir < 0 ? f - te : (dir > 0 ? f + te : f);
+  if(d < 0.0 && n == 0x1p52 && q > -1074) {
+    n *= 2.0;
+    d *= 2.0;
+    q--;
+  }
+  if(dir < 0) inc = elem_floor(d);
+  else if(dir > 0) inc = -elem_floor(-d);
+  else inc = elem_floor(d + 0.5);
+  n += inc;
+  if(q > 971 || (q == 971 && n >= 0x1p53)) {
+    r = dir < 0 ? DBL_MAX : DBL_MAX * 2.0;
+  }
+  else {
+    r = elem_scale(n, q);
+  }
+  return neg ? -r : r;
+}
+
+/* elem_enter() -> mode to put back
+ *
+ * Set rounding to nearest, and on the x87 FPU double precision, for
+ * the kernels, changing nothing that is already set.
+ */
+
+static ELEM_MODE elem_enter(void) {
+  ELEM_MODE m;
+
+  m.rnd = fpgetround();
+  if(m.rnd != FP_RN) fpsetround(FP_RN);
+#ifndef __SSE2_MATH__
+  m.pctl = fpgetprecision();
+  if(m.pctl != FP_PC_DBL) fpsetprecision(FP_PC_DBL);
+#endif
+  return m;
+}
+
+/* elem_leave(m)
+ *
+ * Put back the mode elem_enter() returned.
+ */
+
+static void elem_leave(ELEM_MODE m) {
+  if(m.rnd != FP_RN) fpsetround(m.rnd);
+#ifndef __SSE2_MATH__
+  if(m.pctl != FP_PC_DBL) fpsetprecision(m.pctl);
+#endif
+}
+
+/* exp_special(x, v) -> whether x needs special handling
+ *
+ * If so, put exp(x) in *v. exp(x) of tiny x is between 1 and 1 + 2x,
+ * which is what 1 + x with no error says; beyond the range of doubles
+ * the result is a power of two that rounds the same way.
+ */
+
+static int exp_special(double x, ELEM_VALUE *v) {
+  if(x != x) *v = elem_exact(x + x);
+  else if(x > 710.0) {
+    *v = x == 1.0 / 0.0 ? elem_exact(x)
+      : elem_value(1.0, 0.0, ELEM_HUGE, 0.0);
+  }
+  else if(x < -746.0) {
+    *v = x == -1.0 / 0.0 ? elem_exact(0.0)
+      : elem_value(1.0, 0.0, -ELEM_HUGE, 0.0);
+  }
+  else if(x > -0x1p-60 && x < 0x1p-60) *v = elem_value(1.0, x, 0, 0.0);
+  else return 0;
+  return 1;
+}
+
+/* exp_core(x, v)
+ *
+ * Put exp(x) in v[i] for each lane of x, none special. x = k ln(2)/64
+ * + r with |r| <= ln(2)/128, and exp(x) = 2^(k/64) (1 + s), the first
+ * from the table and s = exp(r) - 1 = r + r^2/2 + r^3 p(r). The first
+ * two terms are added exactly, and the third, less than 2^-25, in
+ * doubles. The error is under 2^-75.
+ */
+
+ELEM_INLINE void exp_core(const ELEM_VDD *x, ELEM_VALUE *v) {
+  ELEM_VDD r, p, s, t;
+  ELEM_V kd, q, b, c;
+  int i, k, j;
+
+  kd = ELEM_V_ROUND(x->h * EXP_INV_L);
+  c = kd - kd + EXP_L2;
+  p = elem_v_two_prod(&kd, &c);
+  c = x->h - kd * EXP_L1;
+  b = -p.h;
+  r = elem_v_two_sum(&c, &b);
+  b = -p.l;
+  r = elem_v_dd_add_d(&r, &b);
+  r = elem_v_dd_add_d(&r, &x->l);
+  b = -kd * EXP_L3;
+  r = elem_v_dd_add_d(&r, &b);
+  p = elem_v_two_prod(&r.h, &r.h);
+  q = kd - kd + elem_exp_d[0];
+  for(i = 1; i < 8; i++) q = q * r.h + elem_exp_d[i];
+  q *= p.h * r.h;
+  b = ((0.5 * p.l + r.l * (r.h + 0.5 * p.h)) + r.l) + q;
+  c = 0.5 * p.h;
+  s = elem_v_two_sum(&r.h, &c);
+  s = elem_v_dd_add_d(&s, &b);
+  for(i = 0; i < ELEM_LANES; i++) {
+    k = (int)kd[i];
+    j = k & 63;
+    t.h[i] = elem_exp_table[j].h;
+    t.l[i] = elem_exp_table[j].l;
+    v[i].k = (k - j) / 64;
+  }
+  p = elem_v_dd_mul(&t, &s);
+  s = elem_v_dd_add(&t, &p);
+  for(i = 0; i < ELEM_LANES; i++) {
+    v[i].h = s.h[i];
+    v[i].l = s.l[i];
+    v[i].err = ELEM_ERR;
+    v[i].exact = 0;
+  }
+}
+
+/* log_core(x, e) -> ln(x 2^e)
+ *
+ * x is normal and positive in every lane. x = 2^e m with m in
+ * [sqrt(1/2), sqrt(2)), and ln(x) = e ln(2) - ln(c) + ln(1 + u), with c
+ * from the table for the nearest 1 + j/128 to m, and u = m c - 1
+ * exactly, |u| < 2^-7. ln(1 + u) = u - u^2/2 + u^3/3 - u^4 p(u), the
+ * first three terms in double-doubles and the last, below 2^-21 of u,
+ * in doubles. j is 0 for m near 1, where c is 1, so that there is no
+ * cancellation between the terms when x is near 1. The relative error
+ * is under 2^-73.
+ */
+
+ELEM_INLINE ELEM_VDD log_core(const ELEM_V *x, const ELEM_V *ep) {
+  ELEM_VDD u, p, s, t, ln2, third;
+  ELEM_M bits = (ELEM_M)*x, big;
+  ELEM_V m, j, c, q, d, e = *ep;
+  int i, ji;
+
+  for(i = 0; i < ELEM_LANES; i++) {
+    e[i] += (double)((int)((bits[i] >> 52) & 0x7ff) - 1023);
+  }
+  m = (ELEM_V)((bits & 0xfffffffffffffLL) | 0x3ff0000000000000LL);
+  big = m > LOG_SQRT2;
+  m = ELEM_V_SELECT(big, m * 0.5, m);
+  e = ELEM_V_SELECT(big, e + 1.0, e);
+  j = ELEM_V_ROUND((m - 1.0) * 128.0);
+  for(i = 0; i < ELEM_LANES; i++) {
+    ji = (int)j[i] + 38;
+    c[i] = elem_log_table[ji][0];
+    t.h[i] = elem_log_table[ji][1];
+    t.l[i] = elem_log_table[ji][2];
+  }
+  p = elem_v_two_prod(&m, &c);
+  d = p.h - 1.0;
+  u = elem_v_two_sum(&d, &p.l);
+  p = elem_v_two_prod(&u.h, &u.h);
+  s = elem_v_dd_mul_d(&p, &u.h);
+  s.l += 3.0 * p.h * u.l;	/* u^3 */
+  third.h = m - m + elem_log_third.h;
+  third.l = m - m + elem_log_third.l;
+  s = elem_v_dd_mul(&s, &third);
+  q = m - m + elem_log_d[0];
+  for(i = 1; i < 12; i++) q = q * u.h + elem_log_d[i];
+  q *= p.h * p.h;
+  u.l = ((u.l - 0.5 * p.l) - u.l * u.h) + q;
+  d = -0.5 * p.h;
+  p = elem_v_two_sum(&u.h, &d);
+  u = elem_v_dd_add_d(&p, &u.l);
+  u = elem_v_dd_add(&u, &s);
+  u = elem_v_dd_add(&u, &t);
+  ln2.h = m - m + LOG_LN2_H;
+  ln2.l = m - m + LOG_LN2_L;
+  p = elem_v_dd_mul_d(&ln2, &e);
+  return elem_v_dd_add(&u, &p);
+}
+
+/* log_special(x, v, scaled) -> whether x needs special handling
+ *
+ * If so, put ln(x) in *v. Otherwise put x, scaled to be normal if it
+ * is subnormal, in *scaled, and the power of two to take from it in
+ * *e.
+ */
+
+static int log_special(double x, ELEM_VALUE *v, double *scaled, double *e) {
+  if(x != x) *v = elem_exact(x + x);
+  else if(x < 0.0) *v = elem_exact((x - x) / (x - x));
+  else if(x == 0.0) *v = elem_exact(-1.0 / (x * x));
+  else if(x == 1.0 / 0.0) *v = elem_exact(x);
+  else {
+    *scaled = x < DBL_MIN ? x * 0x1p54 : x;
+    *e = x < DBL_MIN ? -54.0 : 0.0;
+    return 0;
+  }
+  *scaled = 1.0;
+  *e = 0.0;
+  return 1;
+}
+
+/* trig_reduce(x, r, err) -> quadrant
+ *
+ * Put x - q pi/2 in r and a bound on its absolute error in err, where
+ * q is the nearest integer to x / (pi/2), and return q mod 4, using
+ * Payne and Hanek's method. |x| >= 2^20 and finite.
+ */
+
+static uint64_t trig_bits(int i) {
+				/* Bits i to i + 63 of 2/pi, numbering
+				   from 1 just after the binary point */
+  int w, b;
+
+  if(i <= -63) return 0;
+  if(i < 1) return elem_two_over_pi[0] >> (1 - i);
+  w = (i - 1) / 64;
+  b = (i - 1) % 64;
+  if(b == 0) return elem_two_over_pi[w];
+  return (elem_two_over_pi[w] << b) | (elem_two_over_pi[w + 1] >> (64 - b));
+}
+
+static uint64_t trig_take(const uint32_t *p, int top) {
+				/* 53 bits of the 254 bit fraction p,
+				   ending at bit top */
+  uint64_t r = 0;
+  int i;
+
+  for(i = top; i > top - 53; i--) {
+    r <<= 1;
+    if(i >= 0) r |= (p[i / 32] >> (i % 32)) & 1;
+  }
+  return r;
+}
+
+static int trig_reduce(double x, ELEM_DD *r, double *err) {
+  static const ELEM_DD pio2 = { TRIG_PIO2_H, TRIG_PIO2_L };
+  double ax = x < 0.0 ? -x : x;
+  uint32_t w[8], p[10];
+  uint64_t m, bits, c;
+  int e, i, j, q, neg = 0, top;
+
+  /* ax = m 2^e with m a 53 bit integer; the bits of 2/pi before number
+     e - 1 only add multiples of 4 to ax * 2/pi. The 256 from there
+     times m give ax * 2/pi mod 4 in 254 bit fixed point. */
+
+  memcpy(&bits, &ax, sizeof(bits));
+  e = (int)(bits >> 52) - 1075;
+  m = (bits & 0xfffffffffffffULL) | 0x10000000000000ULL;
+  for(i = 0; i < 4; i++) {
+    uint64_t b = trig_bits(e - 1 + 64 * i);
+
+    w[7 - 2 * i] = (uint32_t)(b >> 32);
+    w[6 - 2 * i] = (uint32_t)b;
+  }
+  memset(p, 0, sizeof(p));
+  for(i = 0; i < 8; i++) {
+    c = 0;
+    for(j = 0; j < 2; j++) {
+      uint64_t t = (uint64_t)w[i] * (uint32_t)(j == 0 ? m : m >> 32)
+	+ p[i + j] + c;
+
+      p[i + j] = (uint32_t)t;
+      c = t >> 32;
+    }
+    for(j = i + 2; c != 0 && j < 10; j++) {
+      uint64_t t = (uint64_t)p[j] + c;
+
+      p[j] = (uint32_t)t;
+      c = t >> 32;
+    }
+  }
+  q = (int)(p[7] >> 30);
+  p[7] &= 0x3fffffff;
+  if(p[7] & 0x20000000) {	/* Fraction >= 1/2: take 1 from it */
+    neg = 1;
+    q++;
+    c = 1;
+    for(i = 0; i < 8; i++) {
+      uint64_t t = (uint64_t)(uint32_t)~p[i] + c;
+
+      p[i] = (uint32_t)t;
+      c = t >> 32;
+    }
+    p[7] &= 0x3fffffff;
+  }
+  for(top = 253; top >= 0 && !((p[top / 32] >> (top % 32)) & 1); top--);
+  r->h = elem_scale((double)trig_take(p, top), top - 52 - 254);
+  r->l = elem_scale((double)trig_take(p, top - 53), top - 105 - 254);
+  *r = elem_dd_mul(*r, pio2);
+  *r = elem_dd_add_d(*r, elem_scale((double)trig_take(p, top - 106),
+				    top - 158 - 254) * TRIG_PIO2_H);
+  *err = 0x1p-100 * (r->h < 0.0 ? -r->h : r->h) + 0x1p-190;
+  if(neg != (x < 0.0)) {
+    r->h = -r->h;
+    r->l = -r->l;
+  }
+  if(x < 0.0) q = -q;
+  return q & 3;
+}
+
+/* trig_special(x, cosine, v) -> whether x needs special handling
+ *
+ * If so, put sin(x) (or cos(x) if cosine) in *v. Below 2^-30 sin(x)
+ * is just below x and cos(x) just below 1 by less than half an ulp,
+ * which is what the tiny low parts given say.
+ */
+
+static int trig_special(double x, int cosine, ELEM_VALUE *v) {
+  if(x != x) *v = elem_exact(x + x);
+  else if(x - x != 0.0) *v = elem_exact((x - x) / (x - x));
+  else if(x == 0.0) *v = elem_exact(cosine ? 1.0 : x);
+  else if(x > -0x1p-30 && x < 0x1p-30) {
+    *v = cosine ? elem_value(1.0, -0x1p-60, 0, 0.0)
+      : elem_value(x * 0x1p200, -x * 0x1p140, -200, 0.0);
+  }
+  else return 0;
+  return 1;
+}
+
+/* trig_core(x, r, q, err, v)
+ *
+ * Put sin(r) or cos(r) (by quadrant q) in v[i] for each lane. r is x
+ * reduced modulo pi/2 with a four-part Cody-Waite reduction, except
+ * for lanes where q is not negative, where r, q and err have been
+ * worked out already. sin(r) = r (1 + r^2 (-1/3! + r^2 (1/5! - ...)))
+ * and cos(r) = 1 + r^2 (-1/2! + r^2 (1/4! - ...)), the coefficients
+ * chosen lane by lane, the first four as double-doubles. The
+ * polynomials are good to about 2^-95; the error in r adds at most
+ * twice its relative size to the error of sin(r), since sin(r)/r >=
+ * 0.9 for |r| <= pi/4, and twice its absolute size to cos(r) >= 0.7.
+ */
+
+ELEM_INLINE void trig_core(const ELEM_V *x, const ELEM_VDD *rp, int cosine,
+			   int *q, double *err, ELEM_VALUE *v) {
+  ELEM_VDD r = *rp, cw, p, s, dd[4];
+  ELEM_V kd, t, d, zero = *x - *x;
+  ELEM_M cos_lane;
+  int i;
+
+  kd = ELEM_V_ROUND(*x * TRIG_INV_PIO2);
+  d = -kd * TRIG_P1;
+  cw = elem_v_two_sum(x, &d);
+  d = -kd * TRIG_P2;
+  cw = elem_v_dd_add_d(&cw, &d);
+  d = -kd * TRIG_P3;
+  cw = elem_v_dd_add_d(&cw, &d);
+  d = zero + TRIG_P4;
+  p = elem_v_two_prod(&kd, &d);
+  d = -p.h;
+  cw = elem_v_dd_add_d(&cw, &d);
+  d = -p.l;
+  cw = elem_v_dd_add_d(&cw, &d);
+  for(i = 0; i < ELEM_LANES; i++) {
+    if(q[i] < 0) {
+      r.h[i] = cw.h[i];
+      r.l[i] = cw.l[i];
+      err[i] = 0x1p-100 * (r.h[i] < 0.0 ? -r.h[i] : r.h[i]) + 0x1p-130;
+      q[i] = (int)kd[i] & 3;
+    }
+    q[i] = (q[i] + cosine) & 3;
+    cos_lane[i] = (q[i] & 1) ? -1 : 0;
+  }
+  for(i = 0; i < 4; i++) {
+    dd[i].h = ELEM_V_SELECT(cos_lane, zero + elem_cos_dd[i].h,
+			    zero + elem_sin_dd[i].h);
+    dd[i].l = ELEM_V_SELECT(cos_lane, zero + elem_cos_dd[i].l,
+			    zero + elem_sin_dd[i].l);
+  }
+  p = elem_v_dd_mul(&r, &r);
+  s.h = ELEM_V_SELECT(cos_lane, zero + elem_cos_d[0], zero + elem_sin_d[0]);
+  for(i = 1; i < 8; i++) {
+    s.h = s.h * p.h + ELEM_V_SELECT(cos_lane, zero + elem_cos_d[i],
+				    zero + elem_sin_d[i]);
+  }
+  s.l = zero;
+  for(i = 3; i >= 0; i--) {
+    s = elem_v_dd_mul(&s, &p);
+    s = elem_v_dd_add(&s, &dd[i]);
+  }
+  s = elem_v_dd_mul(&s, &p);
+  d = zero + 1.0;
+  s = elem_v_dd_add_d(&s, &d);
+  p = elem_v_dd_mul(&s, &r);
+  s.h = ELEM_V_SELECT(cos_lane, s.h, p.h);
+  s.l = ELEM_V_SELECT(cos_lane, s.l, p.l);
+  for(i = 0; i < ELEM_LANES; i++) {
+    t[i] = (q[i] & 2) ? -1.0 : 1.0;
+    v[i].err = ELEM_ERR + 2.0 * err[i]
+      / ((q[i] & 1) ? 1.0 : (r.h[i] < 0.0 ? -r.h[i] : r.h[i]));
+    v[i].k = 0;
+    v[i].exact = 0;
+  }
+  s.h *= t;
+  s.l *= t;
+  for(i = 0; i < ELEM_LANES; i++) {
+    v[i].h = s.h[i];
+    v[i].l = s.l[i];
+  }
+}
+
+/* pow_special(x, y, v, ax, neg) -> whether x, y need special handling
+ *
+ * If so, put x to the power y in *v. Special cases are as C99 (Annex
+ * F) has them; integer powers of powers of two, and squares, are exact.
+ * Otherwise put |x| in *ax and whether the result is negative (x is
+ * negative and y an odd integer) in *neg.
+ */
+
+static int pow_special(double x, double y, ELEM_VALUE *v, double *ax,
+		       int *neg) {
+  ELEM_DD z;
+  double ay = y < 0.0 ? -y : y, inf = 1.0 / 0.0;
+  int yint, yodd;
+  uint64_t bits;
+
+  *ax = x < 0.0 ? -x : x;
+  *neg = 0;
+  if(y == 0.0 || x == 1.0) *v = elem_exact(1.0);
+  else if(x != x || y != y) *v = elem_exact(x + y);
+  else {
+    yint = ay >= 0x1p53 || (double)(int64_t)ay == ay;
+    yodd = yint && ay < 0x1p53 && ((int64_t)ay & 1);
+    memcpy(&bits, ax, sizeof(bits));
+    if(x == 0.0) {
+      if(y < 0.0) *v = elem_exact(yodd ? 1.0 / x : inf);
+      else *v = elem_exact(yodd ? x : 0.0);
+    }
+    else if(ay == inf) {
+      if(*ax == 1.0) *v = elem_exact(1.0);
+      else *v = elem_exact((*ax < 1.0) == (y < 0.0) ? inf : 0.0);
+    }
+    else if(*ax == inf) {
+      if(x > 0.0) *v = elem_exact(y < 0.0 ? 0.0 : inf);
+      else if(y < 0.0) *v = elem_exact(yodd ? -0.0 : 0.0);
+      else *v = elem_exact(yodd ? -inf : inf);
+    }
+    else if(x < 0.0 && !yint) *v = elem_exact((x - x) / (x - x));
+    else if(y == 1.0) *v = elem_exact(x);
+    else if(yint && ay < 0x1p20 && (bits & 0xfffffffffffffULL) == 0
+	    && *ax >= DBL_MIN) {	/* A power of two */
+      *v = elem_value((x < 0.0 && yodd) ? -1.0 : 1.0, 0.0,
+		      elem_exponent(*ax) * (int)y, 0.0);
+    }
+    else if(y == 2.0 && *ax > 0x1p-400 && *ax < 0x1p400) {
+      z = elem_two_prod(x, x);
+      *v = elem_value(z.h, z.l, 0, 0.0);
+    }
+    else {
+      *neg = x < 0.0 && yodd;
+      return 0;
+    }
+  }
+  *ax = 1.0;
+  return 1;
+}
+
+/* FN_block(x, y, v)
+ *
+ * FN = {exp, log, sin, cos, pow}
+ *
+ * Put FN of the ELEM_LANES elements of x (and y) in v, working out
+ * special cases apart and putting harmless values in their lanes of
+ * the vectors.
+ *
+ * pow is exp(y ln|x|), negated as pow_special() says. The relative
+ * error in ln|x| (taken as 2^-70, though under 2^-73) is a relative
+ * error in z = y ln|x|, and so an absolute error in the argument of
+ * exp, and a relative error in the result.
+ */
+
+ELEM_INLINE void exp_block(const double *x, const double *y, ELEM_VALUE *v) {
+  ELEM_VALUE special[ELEM_LANES];
+  int is_special[ELEM_LANES];
+  ELEM_VDD a;
+  int i;
+
+  (void)y;
+  for(i = 0; i < ELEM_LANES; i++) {
+    is_special[i] = exp_special(x[i], &special[i]);
+    a.h[i] = is_special[i] ? 1.0 : x[i];
+    a.l[i] = 0.0;
+  }
+  exp_core(&a, v);
+  for(i = 0; i < ELEM_LANES; i++) if(is_special[i]) v[i] = special[i];
+}
+
+ELEM_INLINE void log_block(const double *x, const double *y, ELEM_VALUE *v) {
+  ELEM_VALUE special[ELEM_LANES];
+  int is_special[ELEM_LANES];
+  ELEM_VDD r;
+  ELEM_V a, e;
+  int i;
+
+  (void)y;
+  for(i = 0; i < ELEM_LANES; i++) {
+    is_special[i] = log_special(x[i], &special[i], &a[i], &e[i]);
+  }
+  r = log_core(&a, &e);
+  for(i = 0; i < ELEM_LANES; i++) {
+    v[i] = is_special[i] ? special[i]
+      : elem_value(r.h[i], r.l[i], 0, ELEM_ERR);
+  }
+}
+
+ELEM_INLINE void trig_block(const double *x, int cosine, ELEM_VALUE *v) {
+  ELEM_VALUE special[ELEM_LANES];
+  int is_special[ELEM_LANES], q[ELEM_LANES];
+  double err[ELEM_LANES];
+  ELEM_DD rd;
+  ELEM_VDD r;
+  ELEM_V a;
+  int i;
+
+  for(i = 0; i < ELEM_LANES; i++) {
+    is_special[i] = trig_special(x[i], cosine, &special[i]);
+    a[i] = (is_special[i] || x[i] >= TRIG_CW_MAX || x[i] <= -TRIG_CW_MAX)
+      ? 1.0 : x[i];
+    q[i] = -1;
+    r.h[i] = r.l[i] = 0.0;
+    if(!is_special[i] && a[i] != x[i]) {
+      q[i] = trig_reduce(x[i], &rd, &err[i]);
+      r.h[i] = rd.h;
+      r.l[i] = rd.l;
+    }
+  }
+  trig_core(&a, &r, cosine, q, err, v);
+  for(i = 0; i < ELEM_LANES; i++) if(is_special[i]) v[i] = special[i];
+}
+
+ELEM_INLINE void sin_block(const double *x, const double *y, ELEM_VALUE *v) {
+  (void)y;
+  trig_block(x, 0, v);
+}
+
+ELEM_INLINE void cos_block(const double *x, const double *y, ELEM_VALUE *v) {
+  (void)y;
+  trig_block(x, 1, v);
+}
+
+ELEM_INLINE void pow_block(const double *x, const double *y, ELEM_VALUE *v) {
+  ELEM_VALUE special[ELEM_LANES];
+  int is_special[ELEM_LANES], neg[ELEM_LANES];
+  ELEM_VDD z;
+  ELEM_V a, e, b;
+  double za;
+  int i;
+
+  for(i = 0; i < ELEM_LANES; i++) {
+    is_special[i] = pow_special(x[i], y[i], &special[i], &a[i], &neg[i]);
+    if(!is_special[i]) log_special(a[i], &special[i], &a[i], &e[i]);
+    else e[i] = 0.0;
+    b[i] = is_special[i] ? 1.0 : y[i];
+  }
+  z = log_core(&a, &e);
+  z = elem_v_dd_mul_d(&z, &b);
+  for(i = 0; i < ELEM_LANES; i++) {
+    if(!is_special[i]) {
+      is_special[i] = exp_special(z.h[i], &special[i]);
+      if(is_special[i]) special[i].err = (z.h[i] < 0.0 ? -z.h[i] : z.h[i])
+			  * ELEM_ERR;
+    }
+    if(is_special[i]) z.h[i] = z.l[i] = 0.5;
+  }
+  exp_core(&z, v);
+  for(i = 0; i < ELEM_LANES; i++) {
+    if(is_special[i]) v[i] = special[i];
+    else {
+      za = z.h[i] < 0.0 ? -z.h[i] : z.h[i];
+      v[i].err += za * ELEM_ERR * 1.01;
+    }
+    if(neg[i]) {
+      v[i].h = -v[i].h;
+      v[i].l = -v[i].l;
+    }
+  }
+}
+
+/* FN_vec(x, y, v), FN_avx2(x, y, v)
+ *
+ * The blocks built for the default target and for AVX2.
+ */
+
+#ifdef CI_SIMD_KERNELS
+#define ELEM_AVX2(fn) \
+__attribute__((target("avx2"))) \
+static void fn##_avx2(const double *x, const double *y, ELEM_VALUE *v) { \
+  fn##_block(x, y, v); \
+}
+#else
+#define ELEM_AVX2(fn)
+#endif
+
+#define ELEM_KERNELS(fn) \
+static void fn##_vec(const double *x, const double *y, ELEM_VALUE *v) { \
+  fn##_block(x, y, v); \
+} \
+ELEM_AVX2(fn)
+
+ELEM_KERNELS(exp)
+ELEM_KERNELS(log)
+ELEM_KERNELS(sin)
+ELEM_KERNELS(cos)
+ELEM_KERNELS(pow)
+
+#ifdef CI_SIMD_KERNELS
+#define ELEM_CHOOSE(fn) \
+  (__builtin_cpu_supports("avx2") ? fn##_avx2 : fn##_vec)
+#else
+#define ELEM_CHOOSE(fn) fn##_vec
+#endif
+
+/* elem_array(block, x, y, r, iv, n, rnd, clamp)
+ *
+ * Put the function block works out of x[i] (and y[i]) rounded in the
+ * direction rnd in r[i], or if r is NULL, rounded down and up in
+ * iv[i], for the n elements. A last part block is filled with copies
+ * of the last element. clamp keeps results in [-1, 1], since the
+ * bounds of sin and cos might be stepped past them.
+ */
+
+static void elem_array(ELEM_BLOCK block, const double *x, const double *y,
+		       double *r, fp_interval *iv, size_t n, fp_rnd rnd,
+		       int clamp) {
+  ELEM_VALUE v[ELEM_LANES];
+  double xp[ELEM_LANES], yp[ELEM_LANES], lo, hi;
+  ELEM_MODE m = elem_enter();
+  size_t i, j, len;
+
+  for(i = 0; i < n; i += ELEM_LANES) {
+    len = n - i < ELEM_LANES ? n - i : ELEM_LANES;
+    if(len < ELEM_LANES) {
+      for(j = 0; j < ELEM_LANES; j++) {
+	xp[j] = x[i + (j < len ? j : len - 1)];
+	yp[j] = y == NULL ? 0.0 : y[i + (j < len ? j : len - 1)];
+      }
+      block(xp, yp, v);
+    }
+    else {
+      block(x + i, y == NULL ? x + i : y + i, v);
+    }
+    for(j = 0; j < len; j++) {
+      if(r != NULL) {
+	r[i + j] = elem_round(v[j], rnd);
+	if(clamp) r[i + j] = r[i + j] > 1.0 ? 1.0
+		    : (r[i + j] < -1.0 ? -1.0 : r[i + j]);
+      }
+      else {
+	lo = elem_round(v[j], FP_RM);
+	hi = elem_round(v[j], FP_RP);
+	iv[i + j].lo = clamp && lo < -1.0 ? -1.0 : lo;
+	iv[i + j].hi = clamp && hi > 1.0 ? 1.0 : hi;
+      }
+    }
+  }
+  elem_leave(m);
+}
+
+/* elem_check(name, rnd)
+ *
+ * Abort, as fpsetround() does, if rnd is not one of the hardware's
+ * directions: elem_round() has no stochastic rounding, and would take
+ * FP_RS, or anything else, as rounding up or down by the sign.
+ */
+
+static void elem_check(const char *name, fp_rnd rnd) {
+  if(rnd <= FP_RZ) return;
+  fprintf(stderr, "%s called with invalid rounding direction: %hx\n",
+	  name, rnd);
+  abort();
+}
+
+/* fpe_FN(x, rnd) -> FN(x) rounded in the direction rnd
+ * fpe_FN_array(x, r, n, rnd)
+ * fpe_FN_enclose(x, r, n)
+ *
+ * FN = {exp, log, sin, cos}
+ */
+
+#define ELEM_FUNCTIONS(fn, clamp) \
+double fpe_##fn(double x, fp_rnd rnd) { \
+  double r; \
+  \
+  elem_check("fpe_" #fn, rnd); \
+  elem_array(ELEM_CHOOSE(fn), &x, NULL, &r, NULL, 1, rnd, clamp); \
+  return r; \
+} \
+\
+void fpe_##fn##_array(const double *x, double *r, size_t n, fp_rnd rnd) { \
+  elem_check("fpe_" #fn "_array", rnd); \
+  elem_array(ELEM_CHOOSE(fn), x, NULL, r, NULL, n, rnd, clamp); \
+} \
+\
+void fpe_##fn##_enclose(const double *x, fp_interval *r, size_t n) { \
+  elem_array(ELEM_CHOOSE(fn), x, NULL, NULL, r, n, FP_RN, clamp); \
+}
+
+ELEM_FUNCTIONS(exp, 0)
+ELEM_FUNCTIONS(log, 0)
+ELEM_FUNCTIONS(sin, 1)
+ELEM_FUNCTIONS(cos, 1)
+
+/* fpe_pow(x, y, rnd) -> x to the power y rounded in the direction rnd
+ */
+
+double fpe_pow(double x, double y, fp_rnd rnd) {
+  double r;
+
+  elem_check("fpe_pow", rnd);
+  elem_array(ELEM_CHOOSE(pow), &x, &y, &r, NULL, 1, rnd, 0);
+  return r;
+}
+
+/* fpe_pow_array(x, y, r, n, rnd)
+ */
+
+void fpe_pow_array(const double *x, const double *y, double *r, size_t n,
+		   fp_rnd rnd) {
+  elem_check("fpe_pow_array", rnd);
+  elem_array(ELEM_CHOOSE(pow), x, y, r, NULL, n, rnd, 0);
+}
+
+/* fpe_pow_enclose(x, y, r, n)
+ */
+
+void fpe_pow_enclose(const double *x, const double *y, fp_interval *r,
+		     size_t n) {
+  elem_array(ELEM_CHOOSE(pow), x, y, NULL, r, n, FP_RN, 0);
+}
@@ -0,0 +1,98 @@
+/*
+    CIieeefp: CIelemfn.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIelemfn.c,
+   which work out exp, log, sin, cos and pow of doubles rounded in a
+   chosen direction, so that bounds obtained with directed rounding can
+   be carried through these functions as well as the four arithmetic
+   operations. */
+
+#ifndef CIELEMFN_H
+#define CIELEMFN_H
+
+#include <stddef.h>
+#include <CIieeefp.h>
+#include <CIinterval.h>
+
+/* Scalar functions
+ *
+ * Return the function of x (x to the power y for fpe_pow()) rounded in
+ * the direction rnd: FP_RM gives a double no larger than the true
+ * value and FP_RP one no smaller, whatever the rounding direction
+ * currently set. The result is the correctly rounded one, except when
+ * the true value is within about 2^-70 of a double (relative), where
+ * it may be one further out: the bound is always kept. With FP_RN the
+ * result is the nearest double except, as rarely, when the true value
+ * is within 2^-70 of half way between two. For fpe_pow() the 2^-70
+ * grows with |y ln(x)|, to about 2^-60 for results near the limits of
+ * doubles. Special cases (NaN, infinities, zeros, negative numbers
+ * for log and pow) follow C99. rnd must be one of the directions the
+ * hardware has: FP_RS, or an invalid direction, is reported on stderr
+ * and the program aborted, as with fpsetround().
+ *
+ * The arithmetic inside must be rounded to nearest, so each call
+ * changes the rounding direction and puts it back if it is not
+ * FP_RN; the array functions do this once for the whole array.
+ */
+
+extern double fpe_exp(double x, fp_rnd rnd);
+extern double fpe_log(double x, fp_rnd rnd);
+extern double fpe_sin(double x, fp_rnd rnd);
+extern double fpe_cos(double x, fp_rnd rnd);
+extern double fpe_pow(double x, double y, fp_rnd rnd);
+
+/* Array functions
+ *
+ * Put the function of x[i] (and y[i]) rounded in the direction rnd in
+ * r[i] for each of the n elements, as the scalar functions would.
+ */
+
+extern void fpe_exp_array(const double *x, double *r, size_t n, fp_rnd rnd);
+extern void fpe_log_array(const double *x, double *r, size_t n, fp_rnd rnd);
+extern void fpe_sin_array(const double *x, double *r, size_t n, fp_rnd rnd);
+extern void fpe_cos_array(const double *x, double *r, size_t n, fp_rnd rnd);
+extern void fpe_pow_array(const double *x, const double *y, double *r,
+			  size_t n, fp_rnd rnd);
+
+/* Enclosures
+ *
+ * Put the function of x[i] (and y[i]) rounded down and up in r[i].lo
+ * and r[i].hi for each of the n elements. Both come from one
+ * evaluation, so this costs little more than rounding in one
+ * direction.
+ */
+
+extern void fpe_exp_enclose(const double *x, fp_interval *r, size_t n);
+extern void fpe_log_enclose(const double *x, fp_interval *r, size_t n);
+extern void fpe_sin_enclose(const double *x, fp_interval *r, size_t n);
+extern void fpe_cos_enclose(const double *x, fp_interval *r, size_t n);
+extern void fpe_pow_enclose(const double *x, const double *y,
+			    fp_interval *r, size_t n);
+
+#endif
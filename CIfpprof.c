@@ -0,0 +1,403 @@
+/*
+    CIieeefp: CIfpprof.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains a profiler for floating point exceptions. Rather
+   than polling the sticky bits after every operation, the chosen
+   exceptions are unmasked in the MXCSR, so that an instruction
+   raising one of them faults and SIGFPE is delivered. The handler
+   looks up the address of the faulting instruction in a fixed size
+   table of sites, recording the stack the first time a site is seen,
+   then masks all the exceptions in the interrupted context, clears
+   the flags (saving them) and sets the trap flag. On return the
+   instruction is run again, masked, giving the same result it would
+   have done without the profiler, and the trap flag raises SIGTRAP
+   once it is done. The SIGTRAP handler counts the exceptions the
+   instruction raised against its site, puts back the saved flags and
+   unmasks the exceptions again.
+
+   Only the SSE unit is profiled: an x87 instruction raising an
+   unmasked exception leaves its destination unchanged, and the fault
+   is only delivered at the next x87 instruction, so it cannot be
+   stepped past in this way. For the same reason the masks are set
+   directly rather than with fpsetmask(), which would unmask the x87
+   FPU too when the library is looking after both units. Code to be
+   profiled must therefore do its floating point arithmetic on the SSE
+   unit, as compilers do by default on x86-64.
+
+   A trapping region (CIfptry.c) also handles SIGFPE. Whichever handler
+   was installed last passes on the signals that are not its own, and
+   the profiler leaves to the regions the exceptions they unmasked,
+   asking fp_try_trapping(), so a region traps its exceptions as usual
+   while profiling and the others are profiled. */
+
+#if defined(__linux__) && defined(__x86_64__)
+#define _GNU_SOURCE
+#define CI_PROF_SUPPORTED	/* Registers of the interrupted context
+				   are available to signal handlers */
+#include <signal.h>
+#include <ucontext.h>
+#include <execinfo.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <CIfpprof.h>
+#include <CIfptry.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+
+#define PROF_EXCEPTS (FP_X_INV | FP_X_DNML | FP_X_DZ | FP_X_OFL \
+		      | FP_X_UFL | FP_X_IMP)
+#define PROF_NEXCEPT 6		/* Number of exception flags */
+#define PROF_TF 0x100		/* Trap flag in EFLAGS */
+
+#if defined(__GNUC__)
+#define CI_PROF_THREAD __thread __attribute__((tls_model("initial-exec")))
+				/* Thread-local storage class safe to
+				   use in a signal handler */
+#else
+#define CI_PROF_THREAD
+#endif
+
+/* A site at which exceptions have been trapped: the address of the
+   instruction, the number of times it has faulted, the number of
+   times each exception was raised when it was stepped past, and the
+   stack when it first faulted. depth is set once the stack has been
+   recorded. */
+
+typedef struct {
+  void *volatile pc;
+  unsigned long faults;
+  unsigned long raised[PROF_NEXCEPT];
+  void *stack[FP_PROF_DEPTH];
+  volatile int depth;
+} PROF_SITE;
+
+static PROF_SITE prof_sites[FP_PROF_SITES];
+static unsigned long prof_faults = 0;
+				/* Exceptions trapped in all */
+static unsigned long prof_lost = 0;
+				/* Exceptions trapped at sites for
+				   which the table had no room */
+static fp_except prof_excepts = 0;
+				/* Exceptions ever profiled */
+static int prof_installed = 0;
+
+static const char *prof_names[PROF_NEXCEPT] = {
+  "INV", "DNML", "DZ", "OFL", "UFL", "IMP"
+};
+
+#ifdef CI_PROF_SUPPORTED
+
+static struct sigaction prof_old_fpe, prof_old_trap;
+				/* Handlers to pass on signals not
+				   caused by the profiler */
+
+static CI_PROF_THREAD int prof_stepping = 0;
+static CI_PROF_THREAD PROF_SITE *prof_step_site;
+static CI_PROF_THREAD SSE_mxcsr prof_step_mxcsr;
+				/* While an instruction is being
+				   stepped past in this thread, its
+				   site (NULL if not recorded) and the
+				   masks and flags of the MXCSR when it
+				   faulted */
+
+/* prof_site(pc) -> site
+ *
+ * Return the site for the instruction at pc, claiming an empty entry
+ * of the table and recording the stack if it has not been seen
+ * before, or NULL if the table is full. Entries are claimed with a
+ * compare and swap, so that several threads may fault at once.
+ */
+
+static PROF_SITE *prof_site(void *pc) {
+  size_t h = (size_t)(((uintptr_t)pc * UINT64_C(0x9e3779b97f4a7c15)) >> 32);
+  size_t i;
+
+  for(i = 0; i < FP_PROF_SITES; i++) {
+    PROF_SITE *site = &prof_sites[(h + i) % FP_PROF_SITES];
+
+    if(site->pc == pc) return site;
+    if(site->pc == NULL
+       && __sync_bool_compare_and_swap(&site->pc, NULL, pc)) {
+      void *frames[FP_PROF_DEPTH + 4];
+      int n, skip;
+
+      n = backtrace(frames, FP_PROF_DEPTH + 4);
+				/* The first frames are the handler's
+				   and the signal trampoline's */
+      for(skip = 0; skip < n && frames[skip] != pc; skip++);
+      if(skip == n) skip = 0;
+      if(n - skip > FP_PROF_DEPTH) n = skip + FP_PROF_DEPTH;
+      memcpy(site->stack, frames + skip, (n - skip) * sizeof(void *));
+      __sync_synchronize();
+      site->depth = n - skip;
+      return site;
+    }
+    if(site->pc == pc) return site;
+  }
+  return NULL;
+}
+
+/* prof_chain(sig, info, context, old)
+ *
+ * Pass on a signal the profiler did not cause to the handler that was
+ * installed before it. If that was the default, it is put back: a
+ * fault then happens again when the handler returns, and a trap is
+ * raised again.
+ */
+
+static void prof_chain(int sig, siginfo_t *info, void *context,
+		       struct sigaction *old) {
+  if(old->sa_flags & SA_SIGINFO) {
+    old->sa_sigaction(sig, info, context);
+  }
+  else if(old->sa_handler == SIG_DFL) {
+    sigaction(sig, old, NULL);
+    if(sig == SIGTRAP) raise(sig);
+  }
+  else if(old->sa_handler != SIG_IGN) {
+    old->sa_handler(sig);
+  }
+}
+
+/* prof_fpe(sig, info, context)
+ *
+ * Handle SIGFPE. If it was raised by an unmasked exception on the SSE
+ * unit that no trapping region of the thread unmasked, record the site
+ * and arrange to step past the instruction.
+ */
+
+static void prof_fpe(int sig, siginfo_t *info, void *context) {
+  ucontext_t *uc = (ucontext_t *)context;
+  SSE_mxcsr mxcsr;
+
+  if(uc->uc_mcontext.fpregs == NULL || prof_stepping
+     || info->si_code < FPE_FLTDIV || info->si_code > FPE_FLTSUB) {
+    prof_chain(sig, info, context, &prof_old_fpe);
+    return;
+  }
+  mxcsr = uc->uc_mcontext.fpregs->mxcsr;
+  if((mxcsr & MX_XF & ~(mxcsr >> 7)) == 0U
+				/* Not the SSE unit */
+     || fp_try_trapping((fp_except)(mxcsr & MX_XF & ~(mxcsr >> 7)))) {
+    prof_chain(sig, info, context, &prof_old_fpe);
+    return;
+  }
+
+  __sync_fetch_and_add(&prof_faults, 1UL);
+  prof_step_site = prof_site((void *)uc->uc_mcontext.gregs[REG_RIP]);
+  if(prof_step_site == NULL) __sync_fetch_and_add(&prof_lost, 1UL);
+  else __sync_fetch_and_add(&prof_step_site->faults, 1UL);
+  prof_step_mxcsr = mxcsr;
+  prof_stepping = 1;
+
+  uc->uc_mcontext.fpregs->mxcsr = (mxcsr | MX_XM) & ~MX_XF;
+  uc->uc_mcontext.gregs[REG_EFL] |= PROF_TF;
+}
+
+/* prof_trap(sig, info, context)
+ *
+ * Handle SIGTRAP. If an instruction has just been stepped past, count
+ * the exceptions it raised, and put back the flags and masks as they
+ * were when it faulted, with its own flags added.
+ */
+
+static void prof_trap(int sig, siginfo_t *info, void *context) {
+  ucontext_t *uc = (ucontext_t *)context;
+  SSE_mxcsr raised;
+  int i;
+
+  if(!prof_stepping || uc->uc_mcontext.fpregs == NULL) {
+    prof_chain(sig, info, context, &prof_old_trap);
+    return;
+  }
+
+  raised = uc->uc_mcontext.fpregs->mxcsr & MX_XF;
+  if(prof_step_site != NULL) {
+    for(i = 0; i < PROF_NEXCEPT; i++) {
+      if(raised & (1U << i)) {
+	__sync_fetch_and_add(&prof_step_site->raised[i], 1UL);
+      }
+    }
+  }
+  uc->uc_mcontext.fpregs->mxcsr = prof_step_mxcsr | raised;
+  uc->uc_mcontext.gregs[REG_EFL] &= ~PROF_TF;
+  prof_stepping = 0;
+}
+
+/* prof_exit()
+ *
+ * Print the profile at exit if anything was trapped.
+ */
+
+static void prof_exit(void) {
+  if(prof_faults > 0) print_fp_prof();
+}
+
+#endif
+
+/* fpprofstart(excepts) -> 0, or -1 if not supported
+ *
+ * Begin trapping the exceptions excepts on the SSE unit in the calling
+ * thread, installing the signal handlers and registering the report
+ * at exit the first time it is called. backtrace() is called once
+ * here, as the first call may load the unwinder, which is not safe in
+ * a signal handler.
+ */
+
+int fpprofstart(fp_except excepts) {
+#ifdef CI_PROF_SUPPORTED
+  SSE_mxcsr mxcsr;
+
+  if((excepts & ~PROF_EXCEPTS) != 0U) {
+    fprintf(stderr, "fpprofstart called with invalid exceptions: %x\n",
+	    excepts);
+    abort();
+  }
+
+  if(__sync_bool_compare_and_swap(&prof_installed, 0, 1)) {
+    struct sigaction sa;
+    void *frame;
+
+    backtrace(&frame, 1);
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sa.sa_sigaction = prof_fpe;
+    sigaction(SIGFPE, &sa, &prof_old_fpe);
+    sa.sa_sigaction = prof_trap;
+    sigaction(SIGTRAP, &sa, &prof_old_trap);
+    atexit(prof_exit);
+  }
+  __sync_fetch_and_or(&prof_excepts, excepts);
+
+  mxcsr = SSE_stmxcsr();
+  SSE_ldmxcsr(mxcsr & ~((SSE_mxcsr)excepts << 7));
+  if(fpgetcwcache()) fpsynccw();
+
+  return 0;
+#else
+  (void)excepts;
+  fprintf(stderr, "fpprofstart: exception profiling is not supported on "
+	  "this platform\n");
+  return -1;
+#endif
+}
+
+/* fpprofstop()
+ *
+ * Mask again all the exceptions that have been profiled, in the
+ * calling thread.
+ */
+
+void fpprofstop(void) {
+#ifdef CI_PROF_SUPPORTED
+  SSE_ldmxcsr(SSE_stmxcsr() | ((SSE_mxcsr)prof_excepts << 7));
+  if(fpgetcwcache()) fpsynccw();
+#endif
+}
+
+/* fpprofcount() -> exceptions trapped
+ *
+ * Return the number of times an exception has been trapped.
+ */
+
+unsigned long fpprofcount(void) {
+  return prof_faults;
+}
+
+/* fpprofreset()
+ *
+ * Forget all the sites and counts. This must not be called while
+ * another thread may trap an exception.
+ */
+
+void fpprofreset(void) {
+  memset(prof_sites, 0, sizeof(prof_sites));
+  prof_faults = 0;
+  prof_lost = 0;
+}
+
+/* print_fp_prof()
+ *
+ * Print each site at which exceptions have been trapped, the most
+ * often first, with the number of faults there and of each exception
+ * raised, and the stack recorded there. The stack is printed with
+ * backtrace_symbols(), which can only name functions in the
+ * executable if it was linked with -rdynamic; otherwise addr2line
+ * will find them from the addresses.
+ */
+
+static int prof_compare(const void *a, const void *b) {
+  const PROF_SITE *sa = *(const PROF_SITE *const *)a;
+  const PROF_SITE *sb = *(const PROF_SITE *const *)b;
+
+  if(sa->faults != sb->faults) return sa->faults < sb->faults ? 1 : -1;
+  return (uintptr_t)sa->pc < (uintptr_t)sb->pc ? -1 : 1;
+}
+
+void print_fp_prof(void) {
+  PROF_SITE *sorted[FP_PROF_SITES];
+  size_t i, n = 0;
+  int j;
+
+  for(i = 0; i < FP_PROF_SITES; i++) {
+    if(prof_sites[i].pc != NULL) sorted[n++] = &prof_sites[i];
+  }
+  qsort(sorted, n, sizeof(PROF_SITE *), prof_compare);
+
+  printf("%-18s %12s", "Site", "Faults");
+  for(j = 0; j < PROF_NEXCEPT; j++) printf(" %10s", prof_names[j]);
+  printf("\n");
+  for(i = 0; i < n; i++) {
+    printf("%-18p %12lu", sorted[i]->pc, sorted[i]->faults);
+    for(j = 0; j < PROF_NEXCEPT; j++) {
+      printf(" %10lu", sorted[i]->raised[j]);
+    }
+    printf("\n");
+#ifdef CI_PROF_SUPPORTED
+    if(sorted[i]->depth > 0) {
+      char **names = backtrace_symbols(sorted[i]->stack, sorted[i]->depth);
+
+      for(j = 0; j < sorted[i]->depth; j++) {
+	printf("\t%s\n", names != NULL ? names[j] : "?");
+      }
+      free(names);
+    }
+#endif
+  }
+  if(prof_lost > 0) {
+    printf("%lu exceptions trapped at sites not recorded (more than %d "
+	   "sites)\n", prof_lost, FP_PROF_SITES);
+  }
+  fflush(stdout);
+}
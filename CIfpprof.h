@@ -0,0 +1,66 @@
+/*
+    CIieeefp: CIfpprof.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIfpprof.c,
+   which find where floating point exceptions are raised in a long
+   running program by trapping them, rather than by polling the sticky
+   bits. */
+
+#ifndef CIFPPROF_H
+#define CIFPPROF_H
+
+#include <CIieeefp.h>
+
+#define FP_PROF_SITES 1024	/* Faulting instructions recorded */
+#define FP_PROF_DEPTH 16	/* Stack frames recorded per site */
+
+/* fpprofstart() unmasks the exceptions given on the SSE unit for the
+   calling thread (threads created afterwards inherit the masks), the
+   first time installing handlers for SIGFPE and SIGTRAP. When one of
+   the exceptions is raised, the handler records the address of the
+   instruction and the stack into a preallocated table of sites, then
+   steps past the instruction with the exceptions masked, so that it
+   gives its usual result, and unmasks them again. Nothing is done
+   when no exception is raised, so the cost is only that of the
+   faults. It returns 0, or -1 if profiling is not supported here.
+
+   fpprofstop() masks the exceptions again in the calling thread.
+   fpprofcount() returns the number of exceptions trapped so far, and
+   fpprofreset() forgets them. print_fp_prof() prints the number of
+   each exception raised at each site and the stack recorded there,
+   and is called at exit if any were trapped. Exceptions a trapping
+   region (CIfptry.h) unmasked are left to it. */
+
+extern int fpprofstart(fp_except excepts);
+extern void fpprofstop(void);
+extern unsigned long fpprofcount(void);
+extern void fpprofreset(void);
+extern void print_fp_prof(void);
+
+#endif
@@ -0,0 +1,250 @@
+/*
+    CIieeefp: CIfptry.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains fp_try_enter(), fp_try_caught() and
+   fp_try_end(). A region saves the floating point environment with
+   fpgetenv(), clears the sticky bits and unmasks its exceptions with
+   fpsetmask(), so that the code in it runs at full speed, with no
+   flags to check. A SIGFPE raised by an unmasked exception finds the
+   innermost region of the thread that asked for that exception, which
+   need not be the innermost region since each inherits the unmasked
+   exceptions of those around it, and siglongjmp()s back to it. The
+   signal handler runs with a clean floating point state, which
+   siglongjmp() leaves behind, so fp_try_caught() puts back the
+   environment saved at the start of the region, including the
+   library's saved_sticky_bits, and adds the exceptions raised in the
+   region to the sticky bits.
+
+   An x87 instruction raising an unmasked exception does not fault
+   until the next x87 instruction that waits. fp_try_end() reads the
+   sticky bits with fpgetsticky(), which waits, before masking the
+   exceptions again, so an exception raised by the last x87
+   instruction in the region is still trapped in the region. */
+
+#if defined(__linux__) && defined(__x86_64__)
+#define _GNU_SOURCE
+#define CI_TRY_CONTEXT		/* Exception flags of the interrupted
+				   context are available to signal
+				   handlers */
+#include <ucontext.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <CIfptry.h>
+
+#if defined(__GNUC__)
+#define CI_TRY_THREAD __thread __attribute__((tls_model("initial-exec")))
+				/* Thread-local storage class safe to
+				   use in a signal handler */
+#else
+#define CI_TRY_THREAD
+#endif
+
+static CI_TRY_THREAD fp_try *try_current = NULL;
+				/* Innermost region of this thread */
+static volatile int try_installed = 0;
+				/* 1 while the SIGFPE handler is being
+				   installed, 2 once it has been */
+static struct sigaction try_old_fpe;
+				/* Handler to pass on signals raised
+				   outside any region */
+
+/* try_code(code) -> exception
+ *
+ * Return the exception indicated by the si_code of a SIGFPE, or 0 if
+ * it is not a floating point exception.
+ */
+
+static fp_except try_code(int code) {
+  switch(code) {
+  case FPE_FLTINV:
+  case FPE_FLTSUB:
+    return FP_X_INV;
+  case FPE_FLTDIV:
+    return FP_X_DZ;
+  case FPE_FLTOVF:
+    return FP_X_OFL;
+  case FPE_FLTUND:
+    return FP_X_UFL;
+  case FPE_FLTRES:
+    return FP_X_IMP;
+  default:
+    return 0U;
+  }
+}
+
+/* try_fpe(sig, info, context)
+ *
+ * Handle SIGFPE. If the signal is for a floating point exception and
+ * the calling thread is in a region unmasking it, return to the start
+ * of the innermost such region, abandoning any inside it, with the
+ * exceptions raised: the flags in the interrupted context where they
+ * are available, otherwise the one given by si_code, and the sticky
+ * bits the regions abandoned kept aside when they began. Otherwise
+ * pass the signal on to the handler installed before, putting back
+ * the default if that was it, so that the fault happens again with
+ * the default action.
+ */
+
+static void try_fpe(int sig, siginfo_t *info, void *context) {
+  fp_try *region = try_current;
+  fp_except trapped = try_code(info->si_code), raised = trapped;
+
+  while(region != NULL && (region->mask & trapped) == 0U) {
+    raised |= region->before;
+    region = region->prev;
+  }
+  if(region == NULL || trapped == 0U) {
+    if(try_old_fpe.sa_flags & SA_SIGINFO) {
+      try_old_fpe.sa_sigaction(sig, info, context);
+    }
+    else if(try_old_fpe.sa_handler == SIG_DFL) {
+      sigaction(sig, &try_old_fpe, NULL);
+    }
+    else if(try_old_fpe.sa_handler != SIG_IGN) {
+      try_old_fpe.sa_handler(sig);
+    }
+    return;
+  }
+
+#ifdef CI_TRY_CONTEXT
+  {
+    ucontext_t *uc = (ucontext_t *)context;
+
+    if(uc->uc_mcontext.fpregs != NULL) {
+      raised |= (fp_except)((uc->uc_mcontext.fpregs->mxcsr
+			     | uc->uc_mcontext.fpregs->swd) & 0x3fU);
+    }
+  }
+#else
+  (void)context;
+#endif
+
+  region->raised = raised;
+  siglongjmp(region->jmp, 1);
+}
+
+/* try_install()
+ *
+ * Install the SIGFPE handler if no thread has yet, or wait for the
+ * thread installing it to finish, so that no region begins before it
+ * is in place.
+ */
+
+static void try_install(void) {
+  if(__sync_bool_compare_and_swap(&try_installed, 0, 1)) {
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = try_fpe;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO;
+    if(sigaction(SIGFPE, &sa, &try_old_fpe) != 0) {
+      perror("fp_try_enter: installing the SIGFPE handler");
+      abort();
+    }
+    __sync_synchronize();
+    try_installed = 2;
+  }
+  while(try_installed != 2);
+}
+
+/* fp_try_enter(region, mask)
+ *
+ * Begin a region, before the caller's sigsetjmp() on it. The SIGFPE
+ * handler is installed the first time.
+ */
+
+void fp_try_enter(fp_try *region, fp_except mask) {
+  if(try_installed != 2) try_install();
+
+  fpgetenv(&region->env);
+  region->mask = mask;
+  region->old_mask = fpgetmask();
+  region->raised = 0U;
+  region->before = fpsetsticky(0);
+  region->prev = try_current;
+  try_current = region;
+  fpsetmask(region->old_mask | mask);
+}
+
+/* fp_try_caught(region) -> exceptions raised
+ *
+ * Having come back to the start of region from the SIGFPE handler,
+ * leave the region, and any inside it, and put back the environment from before it, with
+ * the exceptions raised in it added to the sticky bits.
+ */
+
+fp_except fp_try_caught(fp_try *region) {
+  try_current = region->prev;
+  fpsetenv(&region->env);
+  fpsetsticky(fpgetsticky() | region->raised);
+
+  return region->raised;
+}
+
+/* fp_try_end(region) -> exceptions raised
+ *
+ * End a region that was not trapped, masking its exceptions again and
+ * adding the sticky bits raised before it to those raised in it. The
+ * exceptions raised in it (those still masked, since none of the
+ * others were) are returned.
+ */
+
+fp_except fp_try_end(fp_try *region) {
+  fp_except raised = fpgetsticky();
+
+  if(try_current != region) {
+    fprintf(stderr, "fp_try_end called for a region that is not the "
+	    "innermost\n");
+    abort();
+  }
+  try_current = region->prev;
+  fpsetmask(region->old_mask);
+  fpsetsticky(region->before | raised);
+
+  return raised;
+}
+
+/* fp_try_trapping(excepts) -> 1 or 0
+ *
+ * See CIfptry.h.
+ */
+
+int fp_try_trapping(fp_except excepts) {
+  fp_try *region;
+
+  for(region = try_current; region != NULL; region = region->prev) {
+    if(region->mask & excepts) return 1;
+  }
+  return 0;
+}
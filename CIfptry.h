@@ -0,0 +1,105 @@
+/*
+    CIieeefp: CIfptry.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIfptry.c,
+   which run regions of code with exceptions unmasked, returning to
+   the start of the region if one of them is raised, instead of
+   checking the sticky bits afterwards. */
+
+#ifndef CIFPTRY_H
+#define CIFPTRY_H
+
+#include <setjmp.h>
+#include <CIieeefp.h>
+
+/* A trapping region. The caller provides the storage, which must last
+   until fp_try_end() or fp_try_caught(). */
+
+typedef struct fp_try {
+  sigjmp_buf jmp;		/* Where to return to on a trap */
+  fp_env env;			/* Environment when the region began */
+  fp_except mask;		/* Exceptions unmasked in the region */
+  fp_except old_mask;		/* Exception mask before it */
+  fp_except before;		/* Sticky bits raised before it */
+  volatile fp_except raised;	/* Exceptions raised when it trapped */
+  struct fp_try *prev;		/* Enclosing region in this thread */
+} fp_try;
+
+/* fp_try_enter(region, mask)
+ * sigsetjmp(region->jmp, 1)
+ * fp_try_caught(region) -> exceptions raised
+ *
+ * Begin a region in which the exceptions in mask are unmasked with
+ * fp_try_enter(), then call sigsetjmp() on the region's jmp, which
+ * returns 0. If one of the exceptions is raised before fp_try_end(),
+ * the region is abandoned: control comes back to the sigsetjmp() as
+ * if it had returned again, this time non-zero, and fp_try_caught()
+ * must then be called. It returns the exceptions raised in the region
+ * up to and including the one trapped, and puts the floating point
+ * environment -- rounding, precision, masks and sticky bits -- back
+ * as it was before the region began, with those exceptions added to
+ * the sticky bits. The call to sigsetjmp() must be in the function
+ * calling fp_try_enter(), and written as C allows, the whole
+ * controlling expression of an if or compared with a constant:
+ *
+ *   fp_try_enter(&region, FP_X_OFL);
+ *   if(sigsetjmp(region.jmp, 1) == 0) {
+ *     ...
+ *     fp_try_end(&region);
+ *   }
+ *   else x = fp_try_caught(&region);
+ *
+ * As with any sigsetjmp(), local variables changed in the region must
+ * be volatile if they are to be used afterwards. Regions may be
+ * nested: an exception is trapped by the innermost region with it in
+ * mask, abandoning any regions inside that one.
+ */
+
+extern void fp_try_enter(fp_try *region, fp_except mask);
+extern fp_except fp_try_caught(fp_try *region);
+
+/* fp_try_end(region) -> exceptions raised
+ *
+ * End the innermost region, which was not trapped, masking its
+ * exceptions again, and return the exceptions raised in it.
+ */
+
+extern fp_except fp_try_end(fp_try *region);
+
+/* fp_try_trapping(excepts) -> 1 or 0
+ *
+ * Return 1 if the calling thread is in a region that unmasked one of
+ * excepts, which will then trap it, and 0 otherwise. It may be called
+ * from a signal handler, so that other SIGFPE handlers can leave the
+ * signal to the regions whichever was installed last.
+ */
+
+extern int fp_try_trapping(fp_except excepts);
+
+#endif
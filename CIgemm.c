@@ -0,0 +1,381 @@
+/*
+    CIieeefp: CIgemm.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains a matrix multiply that records the exceptions
+   raised in each tile of the result. It is blocked in the usual way
+   for the caches: a tile's GEMM_KC columns of A and rows of B at a
+   time are copied into contiguous panels, which stay in the L2 cache,
+   and a micro-kernel works out GEMM_MR by GEMM_NR blocks of the tile
+   from them, keeping the block in vector registers (gcc's vector
+   types, for the default target and for AVX2, chosen at run time as
+   in CIelemfn.c). As in CIbatch.c and CIblas.c, the exception flags
+   are cleared before each call of the micro-kernel and read after,
+   once for thousands of operations, and added to the entry for the
+   tile; when the tile is done, its NaNs, infinities and denormalised
+   numbers are counted.
+
+   Micro-blocks overhanging the edge of the matrices are filled out by
+   repeating the last row of A and column of B (and element of C), so
+   that the extra elements are copies of real ones and raise no
+   exceptions the real ones do not. Threads are given tiles in turn,
+   and set up as in CIblas.c. */
+
+#include <string.h>
+#include <pthread.h>
+#include <CIgemm.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+
+#if defined(__GNUC__) && __GNUC__ >= 5 && defined(__SSE2_MATH__) \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build AVX2 kernels
+				   chosen at run time */
+#endif
+
+#define GEMM_LANES 4		/* Elements per vector */
+#define GEMM_MR 4		/* Rows of a micro-block */
+#define GEMM_NR 8		/* Columns of a micro-block: two vectors */
+#define GEMM_KC 128		/* Columns of A (rows of B) per panel */
+#define GEMM_MAX_THREADS 64
+
+#define GEMM_INLINE static __inline__ __attribute__((always_inline))
+
+typedef double GEMM_V __attribute__((vector_size(GEMM_LANES
+						 * sizeof(double))));
+
+/* A micro-kernel: a GEMM_MR by GEMM_NR block of C (at c, rows ldc
+   apart) from kc columns of packed A and rows of packed B, as
+   alpha A B + beta C, or alpha A B if beta is not to be used */
+
+typedef void (*GEMM_KERNEL)(size_t kc, const double *ap, const double *bp,
+			    double alpha, double beta, int use_beta,
+			    double *c, size_t ldc);
+
+/* A multiply, and the tiles a thread is to do: first, first + step, ... */
+
+typedef struct {
+  GEMM_KERNEL kernel;
+  size_t m, n, k;
+  double alpha, beta;
+  const double *a, *b;
+  size_t lda, ldb, ldc;
+  double *c;
+  fp_tile *map;
+  size_t first, step;
+  fp_except raised;
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr ctl;
+#endif
+} GEMM_WORK;
+
+GEMM_INLINE void gemm_load(GEMM_V *v, const double *p) {
+  memcpy(v, p, sizeof(*v));
+}
+
+GEMM_INLINE void gemm_store(double *p, const GEMM_V *v) {
+  memcpy(p, v, sizeof(*v));
+}
+
+/* gemm_micro(kc, ap, bp, alpha, beta, use_beta, c, ldc)
+ *
+ * The micro-kernel's work. Packed A has GEMM_MR elements for each of
+ * the kc columns, and packed B GEMM_NR for each row; the block of C is
+ * kept in two vectors for each row.
+ */
+
+GEMM_INLINE void gemm_micro(size_t kc, const double *ap, const double *bp,
+			    double alpha, double beta, int use_beta,
+			    double *c, size_t ldc) {
+  GEMM_V s[GEMM_MR][2], b0, b1, c0, c1;
+  size_t p;
+  int r;
+
+#pragma GCC unroll 4
+  for(r = 0; r < GEMM_MR; r++) s[r][0] = s[r][1] = (GEMM_V){ 0.0 };
+  for(p = 0; p < kc; p++) {
+    gemm_load(&b0, bp + p * GEMM_NR);
+    gemm_load(&b1, bp + p * GEMM_NR + GEMM_LANES);
+#pragma GCC unroll 4
+    for(r = 0; r < GEMM_MR; r++) {
+      s[r][0] += ap[p * GEMM_MR + r] * b0;
+      s[r][1] += ap[p * GEMM_MR + r] * b1;
+    }
+  }
+#pragma GCC unroll 4
+  for(r = 0; r < GEMM_MR; r++) {
+    s[r][0] *= alpha;
+    s[r][1] *= alpha;
+    if(use_beta) {
+      gemm_load(&c0, c + r * ldc);
+      gemm_load(&c1, c + r * ldc + GEMM_LANES);
+      s[r][0] += beta * c0;
+      s[r][1] += beta * c1;
+    }
+    gemm_store(c + r * ldc, &s[r][0]);
+    gemm_store(c + r * ldc + GEMM_LANES, &s[r][1]);
+  }
+}
+
+/* gemm_micro_vec(...), gemm_micro_avx2(...)
+ *
+ * The micro-kernels built for the default target and for AVX2.
+ */
+
+#define GEMM_KERNEL_FN(suffix) \
+  static void gemm_micro_##suffix(size_t kc, const double *ap, \
+				  const double *bp, double alpha, \
+				  double beta, int use_beta, double *c, \
+				  size_t ldc) { \
+    gemm_micro(kc, ap, bp, alpha, beta, use_beta, c, ldc); \
+  }
+
+GEMM_KERNEL_FN(vec)
+
+#ifdef CI_SIMD_KERNELS
+#pragma GCC push_options
+#pragma GCC target("avx2")
+GEMM_KERNEL_FN(avx2)
+#pragma GCC pop_options
+
+#define GEMM_CHOOSE() \
+  (__builtin_cpu_supports("avx2") ? gemm_micro_avx2 : gemm_micro_vec)
+#define GEMM_CLEAR(w) SSE_ldmxcsr((w)->ctl)
+#define GEMM_FLAGS() ((fp_except)(SSE_stmxcsr() & MX_XF))
+#else
+#define GEMM_CHOOSE() gemm_micro_vec
+#define GEMM_CLEAR(w) fpsetsticky(0)
+#define GEMM_FLAGS() fpgetsticky()
+#endif
+
+/* gemm_pack(w, i0, j0, tm, tn, p0, kc, ap, bp)
+ *
+ * Copy columns p0 to p0 + kc - 1 of rows i0 to i0 + tm - 1 of A, and
+ * the same rows of columns j0 to j0 + tn - 1 of B, into panels of
+ * micro-blocks, repeating the last row or column to fill out the
+ * last micro-block.
+ */
+
+static void gemm_pack(const GEMM_WORK *w, size_t i0, size_t j0, size_t tm,
+		      size_t tn, size_t p0, size_t kc, double *ap,
+		      double *bp) {
+  size_t i, j, p, row, col;
+
+  for(i = 0; i < tm; i += GEMM_MR) {
+    for(p = 0; p < kc; p++) {
+      for(row = 0; row < GEMM_MR; row++) {
+	*ap++ = w->a[(i0 + (i + row < tm ? i + row : tm - 1)) * w->lda
+		     + p0 + p];
+      }
+    }
+  }
+  for(j = 0; j < tn; j += GEMM_NR) {
+    for(p = 0; p < kc; p++) {
+      for(col = 0; col < GEMM_NR; col++) {
+	*bp++ = w->b[(p0 + p) * w->ldb + j0
+		     + (j + col < tn ? j + col : tn - 1)];
+      }
+    }
+  }
+}
+
+/* gemm_tile(w, t, ap, bp)
+ *
+ * Work out tile t of C and fill in its entry in the map, using ap and
+ * bp for the panels. Micro-blocks that overhang the edge of C are
+ * worked out in a copy, filled out with repeated elements.
+ */
+
+static void gemm_tile(GEMM_WORK *w, size_t t, double *ap, double *bp) {
+  double part[GEMM_MR * GEMM_NR], *c;
+  size_t tiles_n = FP_GEMM_TILES(w->n);
+  size_t i0 = t / tiles_n * FP_GEMM_TILE, j0 = t % tiles_n * FP_GEMM_TILE;
+  size_t tm = w->m - i0 < FP_GEMM_TILE ? w->m - i0 : FP_GEMM_TILE;
+  size_t tn = w->n - j0 < FP_GEMM_TILE ? w->n - j0 : FP_GEMM_TILE;
+  size_t i, j, p0, kc, mr, nr, row, col;
+  double beta = w->beta;
+  fp_tile entry;
+
+  memset(&entry, 0, sizeof(entry));
+  if(w->k == 0 || w->alpha == 0.0) {
+    GEMM_CLEAR(w);
+    for(i = 0; i < tm; i++) {
+      c = w->c + (i0 + i) * w->ldc + j0;
+      for(j = 0; j < tn; j++) c[j] = beta == 0.0 ? 0.0 : beta * c[j];
+    }
+    entry.raised = GEMM_FLAGS();
+  }
+  for(p0 = 0; p0 < w->k && w->alpha != 0.0; p0 += kc) {
+    kc = w->k - p0 < GEMM_KC ? w->k - p0 : GEMM_KC;
+    gemm_pack(w, i0, j0, tm, tn, p0, kc, ap, bp);
+    for(i = 0; i < tm; i += GEMM_MR) {
+      mr = tm - i < GEMM_MR ? tm - i : GEMM_MR;
+      for(j = 0; j < tn; j += GEMM_NR) {
+	nr = tn - j < GEMM_NR ? tn - j : GEMM_NR;
+	c = w->c + (i0 + i) * w->ldc + j0 + j;
+	if((mr < GEMM_MR || nr < GEMM_NR) && beta != 0.0) {
+	  for(row = 0; row < GEMM_MR; row++) {
+	    for(col = 0; col < GEMM_NR; col++) {
+	      part[row * GEMM_NR + col]
+		= c[(row < mr ? row : mr - 1) * w->ldc
+		    + (col < nr ? col : nr - 1)];
+	    }
+	  }
+	}
+	GEMM_CLEAR(w);
+	w->kernel(kc, ap + i * kc, bp + j * kc, w->alpha, beta,
+		  beta != 0.0,
+		  mr < GEMM_MR || nr < GEMM_NR ? part : c,
+		  mr < GEMM_MR || nr < GEMM_NR ? GEMM_NR : w->ldc);
+	entry.raised |= GEMM_FLAGS();
+	if(mr < GEMM_MR || nr < GEMM_NR) {
+	  for(row = 0; row < mr; row++) {
+	    memcpy(c + row * w->ldc, part + row * GEMM_NR,
+		   nr * sizeof(double));
+	  }
+	}
+      }
+    }
+    beta = 1.0;
+  }
+
+  for(i = 0; i < tm; i++) {
+    c = w->c + (i0 + i) * w->ldc + j0;
+    for(j = 0; j < tn; j++) {
+      switch(fpclass_fast(c[j])) {
+      case FP_SNAN:
+      case FP_QNAN:
+	entry.nan++;
+	break;
+      case FP_NINF:
+      case FP_PINF:
+	entry.inf++;
+	break;
+      case FP_NDENORM:
+      case FP_PDENORM:
+	entry.denorm++;
+	break;
+      default:
+	break;
+      }
+    }
+  }
+  w->raised |= entry.raised;
+  if(w->map != NULL) w->map[t] = entry;
+}
+
+/* gemm_run(arg) -> NULL
+ *
+ * Do the tiles arg points to, in the calling thread.
+ */
+
+static void *gemm_run(void *arg) {
+  GEMM_WORK *w = (GEMM_WORK *)arg;
+  double ap[FP_GEMM_TILE * GEMM_KC], bp[GEMM_KC * FP_GEMM_TILE];
+  size_t tiles = FP_GEMM_TILES(w->m) * FP_GEMM_TILES(w->n), t;
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr mxcsr = SSE_stmxcsr();
+#endif
+
+  for(t = w->first; t < tiles; t += w->step) gemm_tile(w, t, ap, bp);
+#ifdef CI_SIMD_KERNELS
+  SSE_ldmxcsr(mxcsr);
+#endif
+  return NULL;
+}
+
+/* fpgemm(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, threads, map)
+ * -> exceptions raised
+ *
+ * See CIgemm.h.
+ */
+
+fp_except fpgemm(size_t m, size_t n, size_t k, double alpha,
+		 const double *a, size_t lda, const double *b, size_t ldb,
+		 double beta, double *c, size_t ldc, int threads,
+		 fp_tile *map) {
+  GEMM_WORK work[GEMM_MAX_THREADS];
+  pthread_t id[GEMM_MAX_THREADS];
+  int started[GEMM_MAX_THREADS];
+  size_t tiles = FP_GEMM_TILES(m) * FP_GEMM_TILES(n);
+  fp_except raised = 0U;
+  int t;
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr mxcsr = SSE_stmxcsr();
+#else
+  fp_except before = fpgetsticky();
+
+  threads = 1;
+#endif
+
+  if(threads > GEMM_MAX_THREADS) threads = GEMM_MAX_THREADS;
+  if((size_t)threads > tiles) threads = (int)tiles;
+  if(threads < 1) threads = 1;
+  for(t = 0; t < threads; t++) {
+    work[t].kernel = GEMM_CHOOSE();
+    work[t].m = m;
+    work[t].n = n;
+    work[t].k = k;
+    work[t].alpha = alpha;
+    work[t].beta = beta;
+    work[t].a = a;
+    work[t].b = b;
+    work[t].lda = lda;
+    work[t].ldb = ldb;
+    work[t].ldc = ldc;
+    work[t].c = c;
+    work[t].map = map;
+    work[t].first = (size_t)t;
+    work[t].step = (size_t)threads;
+    work[t].raised = 0U;
+#ifdef CI_SIMD_KERNELS
+    work[t].ctl = (mxcsr & ~MX_XF) | MX_XM;
+#endif
+  }
+
+  for(t = 1; t < threads; t++) {
+    started[t] = pthread_create(&id[t], NULL, gemm_run, &work[t]) == 0;
+  }
+  gemm_run(&work[0]);
+  for(t = 1; t < threads; t++) {
+    if(started[t]) pthread_join(id[t], NULL);
+    else gemm_run(&work[t]);
+  }
+  for(t = 0; t < threads; t++) raised |= work[t].raised;
+
+#ifdef CI_SIMD_KERNELS
+  SSE_ldmxcsr(mxcsr | raised);
+  if((fpgetunit() & FP_UNIT_SSE) == 0U) {
+				/* Flags in the MXCSR not read */
+    fpsetsticky(fpgetsticky() | raised);
+  }
+#else
+  fpsetsticky(before | raised);
+#endif
+  return raised;
+}
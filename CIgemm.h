@@ -0,0 +1,86 @@
+/*
+    CIieeefp: CIgemm.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIgemm.c, a
+   cache-blocked, multithreaded matrix multiply that maps the
+   exceptions raised, and the NaNs, infinities and denormalised
+   numbers made, onto tiles of the result. */
+
+#ifndef CIGEMM_H
+#define CIGEMM_H
+
+#include <stddef.h>
+#include <CIieeefp.h>
+
+/* Tile maps
+ *
+ * The result of an m by n product is divided into tiles of
+ * FP_GEMM_TILE rows and columns, those on the bottom and right edges
+ * being smaller. Element (i, j) is in tile (i / FP_GEMM_TILE,
+ * j / FP_GEMM_TILE), and a map has an fp_tile for each tile, row of
+ * tiles by row of tiles: FP_GEMM_TILES(m) * FP_GEMM_TILES(n) of them,
+ * tile (ti, tj) being entry ti * FP_GEMM_TILES(n) + tj.
+ */
+
+#define FP_GEMM_TILE 64
+#define FP_GEMM_TILES(n) (((n) + FP_GEMM_TILE - 1) / FP_GEMM_TILE)
+
+typedef struct {
+  fp_except raised;		/* Exceptions raised working out the tile */
+  unsigned nan;			/* Elements of the tile that are NaNs, */
+  unsigned inf;			/* infinities */
+  unsigned denorm;		/* and denormalised */
+} fp_tile;
+
+/* fpgemm(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, threads, map)
+ *   -> exceptions raised
+ *
+ * Put alpha A B + beta C in C, where A is m by k, B is k by n and C is
+ * m by n, all stored by rows, with row i of A starting at a + i * lda
+ * and so on. As in the BLAS, C is not read if beta is zero, and if
+ * alpha or k is zero C is just multiplied by beta. Return all the
+ * exceptions raised, which are also added to the sticky bits, and if
+ * map is not NULL fill it in for the tiles of C, so that the tiles
+ * where a NaN or infinity was made, and the exception that made it,
+ * can be found without working anything out again. The arithmetic is
+ * done in the current rounding direction, with multiplies and adds
+ * not fused, and each element's products are added in the same order
+ * however the work is shared, so the results and map are the same on
+ * any CPU and for any number of threads. If threads is more than 1,
+ * the tiles are shared out between that many threads (up to 64), the
+ * calling one included, when the library does its arithmetic on the
+ * SSE unit; otherwise the calling thread does them all.
+ */
+
+extern fp_except fpgemm(size_t m, size_t n, size_t k, double alpha,
+			const double *a, size_t lda, const double *b,
+			size_t ldb, double beta, double *c, size_t ldc,
+			int threads, fp_tile *map);
+
+#endif
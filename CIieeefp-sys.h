@@ -34,10 +34,34 @@
 typedef unsigned fp_rnd;
 typedef unsigned fp_except;
 typedef unsigned fp_pctl;
+typedef unsigned fp_unit;
 typedef enum { FP_SNAN = 0, FP_QNAN, FP_NINF, FP_PINF, FP_NDENORM,
 	       FP_PDENORM, FP_NZERO, FP_PZERO, FP_NNORM, FP_PNORM,
 	       FP_INTEL_UNSUPPORTED } fpclass_t;
 
+/* The floating point environment (see fpgetenv() and fpsetenv()) */
+
+typedef struct {
+  unsigned short x87[14];	/* x87 FPU environment as stored by
+				   fnstenv */
+  unsigned int mxcsr;		/* SSE control and status register */
+  fp_except saved_sticky;	/* Exception flags saved by CIieeefp */
+  fp_unit units;		/* Units looked after by CIieeefp */
+} fp_env;
+
+/* Monitored code sites (see fpsitebegin() and fpsiteend()) */
+
+typedef struct fp_site {
+  const char *name;
+  unsigned long calls;		/* Times the site has been run */
+  unsigned long dnml;		/* Times it raised FP_X_DNML */
+  unsigned long ufl;		/* Times it raised FP_X_UFL */
+  int listed;
+  struct fp_site *next;
+} fp_site;
+
+#define FP_SITE_INIT(name) { (name), 0UL, 0UL, 0UL, 0, 0 }
+
 /* Exceptions */
 
 #define FP_X_INV  0x01U
@@ -53,6 +77,7 @@ typedef enum { FP_SNAN = 0, FP_QNAN, FP_NINF, FP_PINF, FP_NDENORM,
 #define FP_RM 1U
 #define FP_RP 2U
 #define FP_RZ 3U
+#define FP_RS 4U		/* Stochastic: software only, see CIsround.h */
 
 /* Precision control */
 
@@ -61,4 +86,10 @@ typedef enum { FP_SNAN = 0, FP_QNAN, FP_NINF, FP_PINF, FP_NDENORM,
 #define FP_PC_DBL 2U
 #define FP_PC_EXT 3U
 
+/* Floating point units */
+
+#define FP_UNIT_X87  0x1U
+#define FP_UNIT_SSE  0x2U
+#define FP_UNIT_BOTH 0x3U
+
 #endif
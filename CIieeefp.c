@@ -32,10 +32,20 @@
    that would typically appear in ieeefp.h */
 
 #include <stdio.h>
-#include <CIieeefp-sys.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <CIieeefp.h>
 #include "x87FPUutil.h"
 #include "x87FPUcmds.h"
 
+#if defined(__GNUC__) && __GNUC__ >= 5 \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build SSE2/AVX2/AVX-512
+				   kernels chosen at run time */
+#include <immintrin.h>
+#endif
+
 #define D2L (sizeof(double) / sizeof(long))
 #define CC_UNS 0x0000U		/* no condition code flags set */
 #define CC_NAN 0x0100U		/* C0 set */
@@ -45,23 +55,293 @@
 #define CC_MTY 0x4100U		/* C3 | C0 set */
 #define CC_DNM 0x4400U		/* C3 | C2 set */
 
-static fp_except saved_sticky_bits = 0;
-				/* This is a global variable used to
-                                   store the exception flags. This may
-                                   affect the multi-threading safety
-                                   of these functions. */
+#if defined(__GNUC__)
+#define CI_THREAD __thread __attribute__((tls_model("initial-exec")))
+				/* Thread-local storage class, read
+				   with one instruction even in a
+				   shared library */
+#else
+#define CI_THREAD
+#endif
+
+static CI_THREAD fp_except saved_sticky_bits = 0;
+				/* This is a thread-local variable
+                                   used to store the exception
+                                   flags. Each thread has its own FPU
+                                   state, so each thread needs its own
+                                   copy of the flags saved from it,
+                                   and no thread ever writes to data
+                                   another thread reads. */
+
+#if defined(__x86_64__) || defined(__SSE__)
+#define FP_UNIT_DEFAULT FP_UNIT_BOTH
+#else
+#define FP_UNIT_DEFAULT FP_UNIT_X87
+#endif
+
+static CI_THREAD fp_unit fp_units = FP_UNIT_DEFAULT;
+				/* The floating point units whose
+				   settings and flags the library
+				   looks after in this thread */
+
+static CI_THREAD int cw_cached = 0;
+static CI_THREAD x87FPU_control_word cw_shadow;
+static CI_THREAD SSE_mxcsr mxcsr_shadow;
+				/* When cw_cached is set, cw_shadow
+				   is taken to be the control word on
+				   the chip, and mxcsr_shadow the
+				   controls in the MXCSR (without the
+				   flags). The control word and MXCSR
+				   are only loaded when they would
+				   change. */
 
 static const unsigned MASK_FP_BITS = (FP_X_INV | FP_X_DNML | FP_X_DZ
 				      | FP_X_OFL | FP_X_UFL | FP_X_IMP);
 
+#define CW_RC_SHIFT 10		/* Positions of the rounding control */
+#define MX_RC_SHIFT 13		/* and masks, for the functions called */
+#define MX_XM_SHIFT 7		/* too often to use get_/set_*_flag() */
+
+#ifdef CI_SIMD_KERNELS
+
+/* fpclass_array_KERNEL(src, n, out) -> number of elements classified
+ *
+ * KERNEL = {sse2, avx2, avx512}
+ *
+ * Vector kernels for fpclass_array(). These do what fpclass_fast()
+ * (CIieeefp.h) does, several numbers at a time. Each classifies as many whole
+ * vectors of src as it can, storing the classes as ints, and returns
+ * the number of elements done; the caller does the rest.
+ *
+ * SSE2 and AVX2 have no unsigned 64-bit compares, so the high and low
+ * 32-bit halves of four (eight) doubles are gathered into separate
+ * registers with shufps. The high half carries the sign, exponent and
+ * top 20 bits of the significand, which is enough to classify
+ * everything except that a zero high significand needs the low half
+ * to tell zero from denormal and infinity from NaN. The classes are
+ * then assembled from the fact that each class comes as a negative
+ * and positive pair in fpclass_t, with the positive one second (the
+ * NaNs come as signalling then quiet).
+ */
+
+static __inline__ __attribute__((target("sse2")))
+__m128i fpclass_sse2_select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static __inline__ __attribute__((target("sse2")))
+__m128i fpclass_sse2_lanes(__m128i hi, __m128i lo) {
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i exp_hi = _mm_set1_epi32((int)(FP_DBL_EXP >> 32));
+  const __m128i min_hi = _mm_set1_epi32((int)(FP_DBL_MIN >> 32));
+  __m128i abs_hi = _mm_and_si128(hi, _mm_set1_epi32(0x7fffffff));
+  __m128i pos = _mm_xor_si128(_mm_srli_epi32(hi, 31), one);
+  __m128i lo_zero = _mm_cmpeq_epi32(lo, _mm_setzero_si128());
+  __m128i quiet = _mm_and_si128(_mm_srli_epi32(abs_hi, 19), one);
+  __m128i exp_max = _mm_cmpgt_epi32(abs_hi, _mm_sub_epi32(exp_hi, one));
+  __m128i nan = _mm_or_si128(_mm_cmpgt_epi32(abs_hi, exp_hi),
+			     _mm_andnot_si128(lo_zero, exp_max));
+  __m128i exp_zero = _mm_cmpgt_epi32(min_hi, abs_hi);
+  __m128i zero = _mm_and_si128(_mm_cmpeq_epi32(abs_hi, _mm_setzero_si128()),
+			       lo_zero);
+  __m128i cls = _mm_set1_epi32(FP_NNORM);
+
+  cls = fpclass_sse2_select(exp_zero,
+			    fpclass_sse2_select(zero,
+						_mm_set1_epi32(FP_NZERO),
+						_mm_set1_epi32(FP_NDENORM)),
+			    cls);
+  cls = fpclass_sse2_select(exp_max,
+			    fpclass_sse2_select(nan,
+						_mm_set1_epi32(FP_SNAN),
+						_mm_set1_epi32(FP_NINF)),
+			    cls);
+  return _mm_add_epi32(cls, fpclass_sse2_select(nan, quiet, pos));
+}
+
+static __attribute__((target("sse2")))
+size_t fpclass_array_sse2(const double *src, size_t n, int *out) {
+  size_t i;
+
+  for(i = 0; i + 4 <= n; i += 4) {
+    __m128 a = _mm_castpd_ps(_mm_loadu_pd(src + i));
+    __m128 b = _mm_castpd_ps(_mm_loadu_pd(src + i + 2));
+    __m128i hi = _mm_castps_si128(_mm_shuffle_ps(a, b,
+						 _MM_SHUFFLE(3, 1, 3, 1)));
+    __m128i lo = _mm_castps_si128(_mm_shuffle_ps(a, b,
+						 _MM_SHUFFLE(2, 0, 2, 0)));
+
+    _mm_storeu_si128((__m128i *)(out + i), fpclass_sse2_lanes(hi, lo));
+  }
+
+  return i;
+}
+
+static __inline__ __attribute__((target("avx2")))
+__m256i fpclass_avx2_select(__m256i mask, __m256i a, __m256i b) {
+  return _mm256_blendv_epi8(b, a, mask);
+}
+
+static __inline__ __attribute__((target("avx2")))
+__m256i fpclass_avx2_lanes(__m256i hi, __m256i lo) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i exp_hi = _mm256_set1_epi32((int)(FP_DBL_EXP >> 32));
+  const __m256i min_hi = _mm256_set1_epi32((int)(FP_DBL_MIN >> 32));
+  __m256i abs_hi = _mm256_and_si256(hi, _mm256_set1_epi32(0x7fffffff));
+  __m256i pos = _mm256_xor_si256(_mm256_srli_epi32(hi, 31), one);
+  __m256i lo_zero = _mm256_cmpeq_epi32(lo, _mm256_setzero_si256());
+  __m256i quiet = _mm256_and_si256(_mm256_srli_epi32(abs_hi, 19), one);
+  __m256i exp_max = _mm256_cmpgt_epi32(abs_hi, _mm256_sub_epi32(exp_hi, one));
+  __m256i nan = _mm256_or_si256(_mm256_cmpgt_epi32(abs_hi, exp_hi),
+				_mm256_andnot_si256(lo_zero, exp_max));
+  __m256i exp_zero = _mm256_cmpgt_epi32(min_hi, abs_hi);
+  __m256i zero = _mm256_and_si256(_mm256_cmpeq_epi32(abs_hi,
+						     _mm256_setzero_si256()),
+				  lo_zero);
+  __m256i cls = _mm256_set1_epi32(FP_NNORM);
+
+  cls = fpclass_avx2_select(exp_zero,
+			    fpclass_avx2_select(zero,
+						_mm256_set1_epi32(FP_NZERO),
+						_mm256_set1_epi32(FP_NDENORM)),
+			    cls);
+  cls = fpclass_avx2_select(exp_max,
+			    fpclass_avx2_select(nan,
+						_mm256_set1_epi32(FP_SNAN),
+						_mm256_set1_epi32(FP_NINF)),
+			    cls);
+  return _mm256_add_epi32(cls, fpclass_avx2_select(nan, quiet, pos));
+}
+
+static __attribute__((target("avx2")))
+size_t fpclass_array_avx2(const double *src, size_t n, int *out) {
+  size_t i;
+
+  for(i = 0; i + 8 <= n; i += 8) {
+    __m256 a = _mm256_castpd_ps(_mm256_loadu_pd(src + i));
+    __m256 b = _mm256_castpd_ps(_mm256_loadu_pd(src + i + 4));
+    __m256i hi = _mm256_castps_si256(_mm256_shuffle_ps(a, b,
+						       _MM_SHUFFLE(3, 1, 3, 1)));
+    __m256i lo = _mm256_castps_si256(_mm256_shuffle_ps(a, b,
+						       _MM_SHUFFLE(2, 0, 2, 0)));
+
+    /* shufps works within each 128-bit lane, leaving the classes in
+       the order 0 1 4 5 2 3 6 7, which the permute puts right. */
+    _mm256_storeu_si256((__m256i *)(out + i),
+			_mm256_permute4x64_epi64(fpclass_avx2_lanes(hi, lo),
+						 _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+
+  return i;
+}
+
+static __attribute__((target("avx512f")))
+size_t fpclass_array_avx512(const double *src, size_t n, int *out) {
+  const __m512i one = _mm512_set1_epi64(1);
+  const __m512i exp_bits = _mm512_set1_epi64((long long)FP_DBL_EXP);
+  const __m512i min_bits = _mm512_set1_epi64((long long)FP_DBL_MIN);
+  size_t i;
+
+  for(i = 0; i + 8 <= n; i += 8) {
+    __m512i bits = _mm512_loadu_si512((const void *)(src + i));
+    __m512i abs_bits = _mm512_and_epi64(bits,
+					_mm512_set1_epi64(0x7fffffffffffffffLL));
+    __m512i pos = _mm512_xor_epi64(_mm512_srli_epi64(bits, 63), one);
+    __m512i quiet = _mm512_and_epi64(_mm512_srli_epi64(abs_bits, 51), one);
+    __mmask8 exp_max = _mm512_cmpge_epu64_mask(abs_bits, exp_bits);
+    __mmask8 nan = _mm512_cmpgt_epu64_mask(abs_bits, exp_bits);
+    __mmask8 exp_zero = _mm512_cmplt_epu64_mask(abs_bits, min_bits);
+    __mmask8 zero = _mm512_cmpeq_epu64_mask(abs_bits, _mm512_setzero_si512());
+    __m512i cls = _mm512_set1_epi64(FP_NNORM);
+
+    cls = _mm512_mask_mov_epi64(cls, exp_zero, _mm512_set1_epi64(FP_NDENORM));
+    cls = _mm512_mask_mov_epi64(cls, zero, _mm512_set1_epi64(FP_NZERO));
+    cls = _mm512_mask_mov_epi64(cls, exp_max, _mm512_set1_epi64(FP_NINF));
+    cls = _mm512_mask_mov_epi64(cls, nan, _mm512_set1_epi64(FP_SNAN));
+    cls = _mm512_add_epi64(cls, _mm512_mask_mov_epi64(pos, nan, quiet));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm512_cvtepi64_epi32(cls));
+  }
+
+  return i;
+}
+
+#endif
+
+/* control_word_get() -> control word
+ *
+ * Return the control word: the shadow copy if the control word is
+ * being cached, otherwise the result of fstcw.
+ */
+
+static x87FPU_control_word control_word_get(void) {
+  return cw_cached ? cw_shadow : x87FPU_fstcw();
+}
+
+/* control_word_set(old_cw, new_cw)
+ *
+ * Load new_cw into the control word, old_cw being the current setting
+ * as returned by control_word_get(). Loading the control word
+ * requires the exception flags to be cleared first, so the sticky
+ * bits are saved before doing so. If the control word is being cached
+ * and new_cw is the same as old_cw, nothing is done at all, saving
+ * the fstsw, fclex and fldcw, the last of which serialises the FPU.
+ */
+
+static void control_word_set(x87FPU_control_word old_cw,
+			     x87FPU_control_word new_cw) {
+  if(cw_cached) {
+    if(new_cw == old_cw) return;
+    cw_shadow = new_cw;
+  }
+  saved_sticky_bits |= (fp_except)get_status_word_flag(x87FPU_fstsw(), SW_XF);
+				/* Save the sticky bits, because the
+                                   call to x87FPU_fldcw will unset
+                                   them all */
+  x87FPU_fldcw(new_cw);
+}
+
+/* mxcsr_get() -> MXCSR
+ *
+ * Return the MXCSR: the shadow copy of the controls if the control
+ * word is being cached (in which case the flags will be clear),
+ * otherwise the result of stmxcsr.
+ */
+
+static SSE_mxcsr mxcsr_get(void) {
+  return cw_cached ? mxcsr_shadow : SSE_stmxcsr();
+}
+
+/* mxcsr_set(old_mxcsr, new_mxcsr)
+ *
+ * Load the controls in new_mxcsr into the MXCSR, old_mxcsr being the
+ * current setting as returned by mxcsr_get(). ldmxcsr loads the flags
+ * as well, so new_mxcsr must carry the flags currently on the chip,
+ * which it will if it was made from the result of mxcsr_get() when
+ * the control word is not being cached. If it is being cached, the
+ * flags are read from the chip -- unless the controls are not
+ * changing, in which case nothing is done.
+ */
+
+static void mxcsr_set(SSE_mxcsr old_mxcsr, SSE_mxcsr new_mxcsr) {
+  if(cw_cached) {
+    if(((old_mxcsr ^ new_mxcsr) & ~MX_XF) == 0U) return;
+    mxcsr_shadow = new_mxcsr & ~MX_XF;
+    new_mxcsr = mxcsr_shadow | (SSE_stmxcsr() & MX_XF);
+  }
+  SSE_ldmxcsr(new_mxcsr);
+}
+
 /* fpgetround() -> rounding direction
  *
  * Return the current rounding direction as set in the control word of
- * the FPU.
+ * the FPU, or in the MXCSR if the library is only looking after the
+ * SSE unit.
  */
 
 fp_rnd fpgetround(void) {
-  fp_rnd round_bits = get_control_word_flag(x87FPU_fstcw(), CW_RC);
+  fp_rnd round_bits = (fp_units & FP_UNIT_X87)
+    ? (fp_rnd)((control_word_get() & CW_RC) >> CW_RC_SHIFT)
+    : (fp_rnd)((mxcsr_get() & MX_RC) >> MX_RC_SHIFT);
   
   switch(round_bits) {
   case FP_RN:
@@ -78,32 +358,32 @@ fp_rnd fpgetround(void) {
 
 /* fpsetround(rnd_dir) -> previous rounding direction
  *
- * Set the rounding direction in the control word of the FPU to
- * rnd_dir, and return the previous setting. This function changes the
- * setting of the control word on the FPU chip. This requires the
- * exception flags in the status word to be cleared first. Thus before
- * changing the control word the exception flags need to be saved.
+ * Set the rounding direction in the control word of the FPU and/or
+ * the MXCSR to rnd_dir, and return the previous setting. This
+ * function changes the setting of the control word on the FPU
+ * chip. This requires the exception flags in the status word to be
+ * cleared first. Thus before changing the control word the exception
+ * flags need to be saved. The MXCSR uses the same encoding of the
+ * rounding direction as the control word, and can be loaded without
+ * clearing its flags.
+ *
+ * Code switching the rounding direction millions of times turns the
+ * cache on, and then mostly sets the direction already in effect, so
+ * that case is tested first against the shadows, with the thread's
+ * state read once, and returns without anything else being done.
  */
 
 fp_rnd fpsetround(fp_rnd rnd_dir) {
-  fp_except current_sticky = (fp_except)get_status_word_flag(x87FPU_fstsw(),
-							     SW_XF);
-  x87FPU_control_word control_word = x87FPU_fstcw(); 
-  fp_rnd old_rnd_dir = (fp_rnd)get_control_word_flag(control_word, CW_RC);
-
-  saved_sticky_bits |= current_sticky;
-				/* Save the sticky bits, because the
-                                   call to x87FPU_fldcw will unset
-                                   them all */
+  fp_unit units = fp_units;
+  x87FPU_control_word control_word;
+  SSE_mxcsr mxcsr;
+  fp_rnd old_rnd_dir = FP_RN;
 
   switch(rnd_dir) {
   case FP_RN:
   case FP_RM:
   case FP_RP:
   case FP_RZ:
-    control_word = set_control_word_flag(control_word, CW_RC,
-					 (unsigned)rnd_dir);
-    x87FPU_fldcw(control_word);
     break;
   default:
     fprintf(stderr, "fpsetround called with invalid rounding direction: "
@@ -111,6 +391,27 @@ fp_rnd fpsetround(fp_rnd rnd_dir) {
     abort();
   }
 
+  if(cw_cached
+     && ((units & FP_UNIT_SSE) == 0U
+	 || (mxcsr_shadow & MX_RC) == (rnd_dir << MX_RC_SHIFT))
+     && ((units & FP_UNIT_X87) == 0U
+	 || (cw_shadow & CW_RC) == (rnd_dir << CW_RC_SHIFT))) {
+    return rnd_dir;
+  }
+
+  if(units & FP_UNIT_SSE) {
+    mxcsr = mxcsr_get();
+    old_rnd_dir = (fp_rnd)((mxcsr & MX_RC) >> MX_RC_SHIFT);
+    mxcsr_set(mxcsr, (mxcsr & ~MX_RC) | (rnd_dir << MX_RC_SHIFT));
+  }
+  if(units & FP_UNIT_X87) {
+    control_word = control_word_get();
+    old_rnd_dir = (fp_rnd)((control_word & CW_RC) >> CW_RC_SHIFT);
+    control_word_set(control_word,
+		     (x87FPU_control_word)((control_word & ~CW_RC)
+					   | (rnd_dir << CW_RC_SHIFT)));
+  }
+
   switch(old_rnd_dir) {
   case FP_RN:
   case FP_RM:
@@ -127,14 +428,18 @@ fp_rnd fpsetround(fp_rnd rnd_dir) {
 /* fpgetsticky() -> exception flags
  *
  * Return the current state of the floating point exception flags on
- * the FPU status word.
+ * the FPU status word and/or in the MXCSR, which uses the same bits
+ * for the same exceptions.
  */
 
 fp_except fpgetsticky(void) {
-  fp_except current_sticky = (fp_except)get_status_word_flag(x87FPU_fstsw(),
-							     SW_XF);
-
-  saved_sticky_bits |= current_sticky;
+  if(fp_units & FP_UNIT_X87) {
+    saved_sticky_bits |= (fp_except)get_status_word_flag(x87FPU_fstsw(),
+							 SW_XF);
+  }
+  if(fp_units & FP_UNIT_SSE) {
+    saved_sticky_bits |= (fp_except)get_mxcsr_flag(SSE_stmxcsr(), MX_XF);
+  }
 
   return saved_sticky_bits;
 }
@@ -144,18 +449,16 @@ fp_except fpgetsticky(void) {
  * Set the exception flags to the specified value. Return the previous
  * setting. In terms of the settings on the chip, this function just
  * clears all the exception flags. The setting passed as argument is
- * stored in saved_sticky_bits, the global variable to this file,
- * which is used to save flag settings from other accesses to the FPU
+ * stored in saved_sticky_bits, the thread-local variable to this
+ * file, which is used to save flag settings from other accesses to the FPU
  * -- in particular, those involving fldcw, which requires an fclex
- * beforehand.
+ * beforehand. The flags in the MXCSR are cleared too, if the library
+ * is looking after the SSE unit.
  */
 
 fp_except fpsetsticky(fp_except sticky) {
-  fp_except current_sticky = (fp_except)get_status_word_flag(x87FPU_fstsw(),
-							     SW_XF);
+  fp_except current_sticky = fpgetsticky();
   x87FPU_status_word sw = SW_XF;
-
-  current_sticky |= saved_sticky_bits;
  
   /* Ensure that sticky contains a valid setting of the exception
      flags. Do this by left shifting sticky until it aligns with the
@@ -177,7 +480,12 @@ fp_except fpsetsticky(fp_except sticky) {
   }
 
   saved_sticky_bits = sticky;
-  x87FPU_fclex();		/* Clear the exception flags on chip */
+  if(fp_units & FP_UNIT_X87) {
+    x87FPU_fclex();		/* Clear the exception flags on chip */
+  }
+  if(fp_units & FP_UNIT_SSE) {
+    SSE_ldmxcsr(SSE_stmxcsr() & ~MX_XF);
+  }
 
   return current_sticky;
 }
@@ -185,11 +493,15 @@ fp_except fpsetsticky(fp_except sticky) {
 /* fpgetmask() -> exception masks
  *
  * Return the current setting of the exception mask bits in the
- * control word of the FPU.
+ * control word of the FPU, or in the MXCSR if the library is only
+ * looking after the SSE unit. The MXCSR has the masks in the same
+ * order as the control word.
  */
 
 fp_except fpgetmask(void) {
-  return (fp_except)(get_control_word_flag(x87FPU_fstcw(), CW_XM)
+  return (fp_except)(((fp_units & FP_UNIT_X87)
+		      ? (control_word_get() & CW_XM)
+		      : ((mxcsr_get() & MX_XM) >> MX_XM_SHIFT))
 		     ^ MASK_FP_BITS);
 }
 
@@ -200,32 +512,63 @@ fp_except fpgetmask(void) {
  * the fldcw instruction to make the setting, which requires fclex to
  * be executed, clearing the exception flags in the status word. We
  * therefore need to save the current exception flag settings on the
- * chip before changing the control word.
+ * chip before changing the control word, which control_word_set()
+ * does. The masks in the MXCSR are set in the same way if the library
+ * is looking after the SSE unit. As in fpsetround(), masks already in
+ * effect are tested for first when the control word is cached.
  */
 
 fp_except fpsetmask(fp_except mask) {
-  x87FPU_control_word cw = x87FPU_fstcw();
-  fp_except old_mask = get_control_word_flag(cw, CW_XM);
-  fp_except current_sticky = (fp_except)get_status_word_flag(x87FPU_fstsw(),
-							     SW_XF);
-  
-  saved_sticky_bits |= current_sticky;
-				/* Save the sticky bits because the
-                                   call to x87FPU_fldcw will clear
-                                   them on the chip. */
-  cw = set_control_word_flag(cw, CW_XM, (unsigned)mask ^ MASK_FP_BITS);
-  x87FPU_fldcw(cw);
+  fp_unit units = fp_units;
+  unsigned masks = ((unsigned)mask ^ MASK_FP_BITS) & CW_XM;
+  x87FPU_control_word cw;
+  SSE_mxcsr mxcsr;
+  fp_except old_mask = 0;
+
+  if(cw_cached
+     && ((units & FP_UNIT_SSE) == 0U
+	 || (mxcsr_shadow & MX_XM) == (masks << MX_XM_SHIFT))
+     && ((units & FP_UNIT_X87) == 0U || (cw_shadow & CW_XM) == masks)) {
+    return masks ^ MASK_FP_BITS;
+  }
+
+  if(units & FP_UNIT_SSE) {
+    mxcsr = mxcsr_get();
+    old_mask = (mxcsr & MX_XM) >> MX_XM_SHIFT;
+    mxcsr_set(mxcsr, (mxcsr & ~MX_XM) | (masks << MX_XM_SHIFT));
+  }
+  if(units & FP_UNIT_X87) {
+    cw = control_word_get();
+    old_mask = cw & CW_XM;
+    control_word_set(cw, (x87FPU_control_word)((cw & ~CW_XM) | masks));
+  }
 
   return old_mask ^ MASK_FP_BITS;
 }
 
 /* fpclass(dsrc) -> class of floating point number
  *
- * This function uses the fxam instruction to get back the class of
- * floating point number passed in as argument.
+ * Return the class of the floating point number passed in as
+ * argument. As of version 3.1 this is worked out from the IEEE 754
+ * bit pattern of the number by fpclass_fast() in CIieeefp.h, which
+ * unlike fxam distinguishes denormalised numbers from normalised
+ * ones. The old fxam implementation is kept as fpclass_x87().
  */
 
 fpclass_t fpclass(double dsrc) {
+  return fpclass_fast(dsrc);
+}
+
+/* fpclass_x87(dsrc) -> class of floating point number
+ *
+ * This function uses the fxam instruction to get back the class of
+ * floating point number passed in as argument. fxam examines the
+ * number after it has been loaded onto the x87 stack in double
+ * extended format, in which a denormalised double is a normalised
+ * number, so denormalised doubles are reported as FP_PNORM/FP_NNORM.
+ */
+
+fpclass_t fpclass_x87(double dsrc) {
   x87FPU_status_word sw;
   union {
     double d;
@@ -310,26 +653,43 @@ fpclass_t fpclass(double dsrc) {
 /* finite(num) -> boolean
  *
  * Returns 1 (true) if the argument is a finite number, and 0 otherwise.
+ * See finite_fast() in CIieeefp.h.
  */
 
 int finite(double num) {
-  switch(fpclass(num)) {
-  case FP_PDENORM:
-  case FP_NDENORM:
-  case FP_PNORM:
-  case FP_NNORM:
-  case FP_PZERO:
-  case FP_NZERO:
-    return 1;
-  case FP_PINF:
-  case FP_NINF:
-  case FP_SNAN:
-  case FP_QNAN:
-    return 0;
-  default:
-    fprintf(stderr, "PANIC: fpclass returned invalid class\n");
-    abort();
+  return finite_fast(num);
+}
+
+/* fpclass_array(src, n, out)
+ *
+ * Classify the n doubles in src, storing the class of src[i] in
+ * out[i]. This gives the same answers as fpclass(), working from the
+ * IEEE 754 bit pattern of each number, but several numbers at a time
+ * using whichever of the SSE2, AVX2 or AVX-512 instruction sets the
+ * CPU supports. Since nothing is loaded onto the FPU, signalling NaNs
+ * are reported as FP_SNAN, and no exception flags are raised.
+ */
+
+void fpclass_array(const double *src, size_t n, fpclass_t *out) {
+  size_t i = 0;
+
+#ifdef CI_SIMD_KERNELS
+  if(sizeof(fpclass_t) == sizeof(int)) {
+				/* The kernels store the classes as
+				   32-bit integers */
+    if(__builtin_cpu_supports("avx512f")) {
+      i = fpclass_array_avx512(src, n, (int *)out);
+    }
+    else if(__builtin_cpu_supports("avx2")) {
+      i = fpclass_array_avx2(src, n, (int *)out);
+    }
+    else if(__builtin_cpu_supports("sse2")) {
+      i = fpclass_array_sse2(src, n, (int *)out);
+    }
   }
+#endif
+
+  for(; i < n; i++) out[i] = fpclass_fast(src[i]);
 }
 
 
@@ -355,8 +715,8 @@ int finite(double num) {
  */
 
 fp_pctl fpgetprecision(void) {
-  fp_pctl current_precision = (fp_pctl)get_control_word_flag(x87FPU_fstcw(),
-							     CW_PC);
+  fp_pctl current_precision
+    = (fp_pctl)get_control_word_flag(control_word_get(), CW_PC);
 
   switch(current_precision) {
   case FP_PC_SGL:
@@ -382,22 +742,16 @@ fp_pctl fpgetprecision(void) {
  */
 
 fp_pctl fpsetprecision(fp_pctl pctl) {
-  fp_except current_sticky = (fp_except)get_status_word_flag(x87FPU_fstsw(),
-							     SW_XF);
-  x87FPU_control_word control_word = x87FPU_fstcw();
+  x87FPU_control_word control_word = control_word_get();
   fp_pctl old_pctl = (fp_pctl)get_control_word_flag(control_word, CW_PC);
 
-  saved_sticky_bits |= current_sticky;
-				/* Save the sticky bits, because the
-                                   call to x87FPUfldcw will unset them
-                                   all */
-
   switch(pctl) {
   case FP_PC_SGL:
   case FP_PC_DBL:
   case FP_PC_EXT:
-    control_word = set_control_word_flag(control_word, CW_PC, (unsigned)pctl);
-    x87FPU_fldcw(control_word);
+    control_word_set(control_word,
+		     set_control_word_flag(control_word, CW_PC,
+					   (unsigned)pctl));
     break;
   case FP_PC_RES:
     fprintf(stderr, "fpsetprecision called with reserved precision control"
@@ -421,6 +775,271 @@ fp_pctl fpsetprecision(fp_pctl pctl) {
   }
 }
 
+/* fpgetenv(env)
+ *
+ * Store the whole floating point environment of the calling thread in
+ * env: the x87 FPU environment (including the control word and the
+ * status word with its exception flags), the MXCSR (controls and
+ * flags), and the library's own state -- the sticky bits it has saved
+ * and the units it is looking after. This takes an fnstenv and a
+ * stmxcsr, rather than the separate fstcw, fstsw and stmxcsr of each
+ * of fpgetround(), fpgetmask(), fpgetprecision() and fpgetsticky().
+ */
+
+void fpgetenv(fp_env *env) {
+  x87FPU_env x87env;
+
+  x87FPU_fnstenv(&x87env);
+  memcpy(env->x87, &x87env, sizeof(x87FPU_env));
+  env->mxcsr = (fp_units & FP_UNIT_SSE) ? SSE_stmxcsr() : 0U;
+  env->saved_sticky = saved_sticky_bits;
+  env->units = fp_units;
+}
+
+/* fpsetenv(env)
+ *
+ * Load the floating point environment stored in env by fpgetenv(),
+ * using one fldenv and one ldmxcsr. Unlike any of the fpset...()
+ * functions, this puts the exception flags back on the chip exactly as
+ * they were, which means that if any flag set in env is for an
+ * unmasked exception, that exception will be raised by the next
+ * floating point instruction -- as it would have been had the
+ * environment never been changed.
+ *
+ * The x87 environment includes the tag word, which says which of the
+ * x87 data registers are in use. It is loaded as stored, which is safe
+ * because fpgetenv() is a function call, and the calling conventions
+ * leave the x87 stack empty over function calls; an fp_env should not
+ * be built any other way. If the control word is being cached, the
+ * shadow copies are taken from env, or for the MXCSR from the chip if
+ * env was saved when the library was not looking after the SSE unit.
+ */
+
+void fpsetenv(const fp_env *env) {
+  x87FPU_env x87env;
+
+  memcpy(&x87env, env->x87, sizeof(x87FPU_env));
+  x87FPU_fldenv(&x87env);
+  if(env->units & FP_UNIT_SSE) SSE_ldmxcsr(env->mxcsr);
+  saved_sticky_bits = env->saved_sticky;
+  fp_units = env->units;
+  cw_shadow = x87env.control_word;
+  mxcsr_shadow = ((env->units & FP_UNIT_SSE) ? env->mxcsr : SSE_stmxcsr())
+    & ~MX_XF;
+}
+
+/* fpgetftz() -> boolean
+ * fpgetdaz() -> boolean
+ *
+ * Return 1 if flush-to-zero (FTZ) or denormals-are-zeros (DAZ)
+ * respectively is turned on in the MXCSR, 0 otherwise.
+ */
+
+int fpgetftz(void) {
+  return (int)get_mxcsr_flag(mxcsr_get(), MX_FZ);
+}
+
+int fpgetdaz(void) {
+  return (int)get_mxcsr_flag(mxcsr_get(), MX_DAZ);
+}
+
+/* fpsetftz(on) -> previous FTZ setting
+ * fpsetdaz(on) -> previous DAZ setting
+ *
+ * Turn flush-to-zero or denormals-are-zeros on (non-zero) or off
+ * (zero) in the MXCSR, returning the previous setting. These are
+ * settings of the SSE unit only, whatever fpsetunit() says, as the
+ * x87 FPU has nothing like them.
+ *
+ * Arithmetic producing or using denormalised numbers is handled by
+ * microcode on most Intel CPUs, and can be a hundred times slower
+ * than with normalised numbers. With FTZ on, a result that would be
+ * denormalised is replaced with a zero of the same sign (raising
+ * FP_X_UFL and FP_X_IMP); with DAZ on, denormalised operands are
+ * treated as zeros of the same sign (without raising FP_X_DNML). Both
+ * break IEEE 754 gradual underflow, and so should only be turned on
+ * around code known not to need it. The fp_site functions below can
+ * be used to find out whether such code produces denormalised numbers
+ * in the first place.
+ *
+ * They read the MXCSR from the chip rather than the shadow copy kept
+ * when the control word is cached, as they set it even when the
+ * library is not looking after the SSE unit.
+ */
+
+int fpsetftz(int on) {
+  SSE_mxcsr mxcsr = SSE_stmxcsr();
+
+  mxcsr_set(mxcsr, set_mxcsr_flag(mxcsr, MX_FZ, on ? 1U : 0U));
+
+  return (int)get_mxcsr_flag(mxcsr, MX_FZ);
+}
+
+int fpsetdaz(int on) {
+  SSE_mxcsr mxcsr = SSE_stmxcsr();
+
+  mxcsr_set(mxcsr, set_mxcsr_flag(mxcsr, MX_DAZ, on ? 1U : 0U));
+
+  return (int)get_mxcsr_flag(mxcsr, MX_DAZ);
+}
+
+/* fpsitebegin() -> exception flags raised before the site
+ *
+ * Begin a region of code to be monitored as an fp_site. The exception
+ * flags are cleared, and the flags previously raised are returned, to
+ * be passed to fpsiteend() at the end of the region.
+ */
+
+fp_except fpsitebegin(void) {
+  return fpsetsticky(0);
+}
+
+/* fpsiteend(site, before)
+ *
+ * End a region of code begun with fpsitebegin(), which returned
+ * before. The site's count of calls is incremented, as are its counts
+ * of denormalised operands and underflows if FP_X_DNML or FP_X_UFL
+ * were raised in the region. The exception flags are then set to
+ * those raised before the region together with those raised in it, so
+ * the region is invisible to code checking the flags around it.
+ *
+ * The counts are updated atomically, so one site can be used from
+ * several threads. The first time a site ends it is added to a list
+ * of all sites, which print_fp_sites() prints.
+ */
+
+static fp_site *fp_sites = NULL;
+
+void fpsiteend(fp_site *site, fp_except before) {
+  fp_except raised = fpgetsticky();
+
+  __sync_fetch_and_add(&site->calls, 1UL);
+  if(raised & FP_X_DNML) __sync_fetch_and_add(&site->dnml, 1UL);
+  if(raised & FP_X_UFL) __sync_fetch_and_add(&site->ufl, 1UL);
+
+  if(!site->listed && __sync_bool_compare_and_swap(&site->listed, 0, 1)) {
+    do {
+      site->next = fp_sites;
+    } while(!__sync_bool_compare_and_swap(&fp_sites, site->next, site));
+  }
+
+  fpsetsticky(before | raised);
+}
+
+/* print_fp_sites()
+ *
+ * Print the counts for every fp_site that has been used, in the order
+ * of their first use.
+ */
+
+static void print_fp_sites_from(fp_site *site) {
+  if(site == NULL) return;
+  print_fp_sites_from(site->next);
+  printf("%-32s %12lu %12lu %12lu\n", site->name, site->calls, site->dnml,
+	 site->ufl);
+}
+
+void print_fp_sites(void) {
+  printf("%-32s %12s %12s %12s\n", "Site", "Calls", "Denormal", "Underflow");
+  print_fp_sites_from(fp_sites);
+}
+
+/* fpgetunit() -> floating point units
+ *
+ * Return the floating point units looked after by the library in this
+ * thread: FP_UNIT_X87, FP_UNIT_SSE or FP_UNIT_BOTH.
+ */
+
+fp_unit fpgetunit(void) {
+  return fp_units;
+}
+
+/* fpsetunit(units) -> previous setting
+ *
+ * Set the floating point units the library looks after in this
+ * thread, returning the previous setting. On x86-64 compilers do
+ * double arithmetic on the SSE unit, which has its own rounding
+ * control, exception masks and flags in the MXCSR, and the x87 FPU is
+ * only used for long double; on 32-bit x86 it is the other way round
+ * unless told otherwise (e.g. gcc -mfpmath=sse). With FP_UNIT_BOTH,
+ * the default where SSE is available, fpsetround() and fpsetmask()
+ * set both units, fpgetsticky() returns the exceptions raised on
+ * either, and the two are kept consistent. Whenever the units
+ * change, the rounding direction and masks in effect are carried over
+ * to the new units, so a unit being added is brought into line with
+ * the one already in use. FP_UNIT_X87 or FP_UNIT_SSE alone save the
+ * cost of setting the other unit in code known not to use it.
+ * fpsetprecision() always applies to the x87 FPU, the SSE unit having
+ * no precision control.
+ */
+
+fp_unit fpsetunit(fp_unit units) {
+  fp_unit old_units = fp_units;
+  fp_rnd rnd_dir;
+  fp_except mask;
+
+  if(units == 0U || (units & ~FP_UNIT_BOTH) != 0U) {
+    fprintf(stderr, "fpsetunit called with invalid units: %hx\n", units);
+    abort();
+  }
+
+  rnd_dir = fpgetround();
+  mask = fpgetmask();
+  fp_units = units;
+  if(cw_cached) fpsynccw();
+  if(units != old_units) {
+    fpsetround(rnd_dir);
+    fpsetmask(mask);
+  }
+
+  return old_units;
+}
+
+/* fpgetcwcache() -> boolean
+ *
+ * Return 1 if this thread is caching the control word, 0 otherwise.
+ */
+
+int fpgetcwcache(void) {
+  return cw_cached;
+}
+
+/* fpsetcwcache(on) -> previous setting
+ *
+ * Turn caching of the control word on (non-zero) or off (zero) for
+ * the calling thread, returning the previous setting. When it is on,
+ * the library keeps a shadow copy of the control word, from which
+ * fpgetround(), fpgetmask() and fpgetprecision() are answered without
+ * fstcw, and fpsetround(), fpsetmask() and fpsetprecision() do
+ * nothing to the chip if the setting asked for is already in
+ * place. The same is done for the controls in the MXCSR. This is
+ * only safe if nothing but this library changes the control word; if
+ * other code might have done so (e.g. fesetround() or a library that
+ * saves and restores the FPU state), call fpsynccw() afterwards.
+ */
+
+int fpsetcwcache(int on) {
+  int old_cached = cw_cached;
+
+  if(on) fpsynccw();
+  cw_cached = (on != 0);
+
+  return old_cached;
+}
+
+/* fpsynccw()
+ *
+ * Resynchronise the shadow copies of the control word and MXCSR with
+ * the chip. Both are synchronised whatever units the library is
+ * looking after, as fpsetftz() and fpsetdaz() set the MXCSR even when
+ * it is not one of them, and a stale shadow would be loaded into it.
+ */
+
+void fpsynccw(void) {
+  cw_shadow = x87FPU_fstcw();
+  mxcsr_shadow = SSE_stmxcsr() & ~MX_XF;
+}
+
 /* print_fpu_status()
  *
  * This function is provided for diagnostic purposes. It prints out
@@ -440,3 +1059,13 @@ void print_fpu_status(void) {
 void print_fpu_control(void) {
   print_control_word(x87FPU_fstcw());
 }
+
+/* print_fpu_mxcsr()
+ *
+ * This function is provided for diagnostic purposes. It prints out
+ * the current setting of all the bits in the SSE MXCSR.
+ */
+
+void print_fpu_mxcsr(void) {
+  print_mxcsr(SSE_stmxcsr());
+}
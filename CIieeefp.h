@@ -29,6 +29,7 @@
 #ifndef CIIEEEFP_H
 #define CIIEEEFP_H
 
+#include <stddef.h>
 #include <CIieeefp-sys.h>
 
 /* POSIX functions */
@@ -42,11 +43,95 @@ extern fp_except fpsetmask(fp_except mask);
 extern fpclass_t fpclass(double dsrc);
 extern int finite(double num);
 
+/* Inline classification
+ *
+ * fpclass_fast() and finite_fast() do the same job as fpclass() and
+ * finite(), but work straight from the IEEE 754 bit pattern of the
+ * number without going anywhere near the FPU, and can be inlined into
+ * inner loops. If CIIEEEFP_INLINE is defined before including this
+ * file, fpclass() and finite() are replaced with them.
+ */
+
+#define FP_DBL_SIGN  0x8000000000000000ULL /* sign bit */
+#define FP_DBL_EXP   0x7ff0000000000000ULL /* exponent bits, +Inf */
+#define FP_DBL_QUIET 0x0008000000000000ULL /* MSB of the significand */
+#define FP_DBL_MIN   0x0010000000000000ULL /* bits of DBL_MIN */
+
+/* fpclass_fast(dsrc) -> class of floating point number
+ *
+ * The class is built up without branches using the layout of
+ * fpclass_t, where each class comes as a negative and positive pair
+ * (signalling and quiet for NaNs): all the comparisons are on the
+ * number with its sign bit cleared.
+ */
+
+static __inline__ fpclass_t fpclass_fast(double dsrc) {
+  union {
+    double d;
+    unsigned long long u;
+  } bits;
+  unsigned long long abs_bits;
+  int pos, quiet, nan, inf, zero, denorm;
+
+  bits.d = dsrc;
+  abs_bits = bits.u & ~FP_DBL_SIGN;
+  pos = (bits.u & FP_DBL_SIGN) == 0;
+  quiet = (abs_bits & FP_DBL_QUIET) != 0;
+  nan = abs_bits > FP_DBL_EXP;
+  inf = abs_bits == FP_DBL_EXP;
+  zero = abs_bits == 0;
+  denorm = (abs_bits < FP_DBL_MIN) & !zero;
+
+  return (fpclass_t)(FP_NNORM
+		     + (FP_NDENORM - FP_NNORM) * denorm
+		     + (FP_NZERO - FP_NNORM) * zero
+		     + (FP_NINF - FP_NNORM) * inf
+		     + (FP_SNAN - FP_NNORM) * nan
+		     + (pos ^ (nan & (pos ^ quiet))));
+}
+
+/* finite_fast(num) -> boolean
+ *
+ * A number is finite unless its exponent bits are all set.
+ */
+
+static __inline__ int finite_fast(double num) {
+  union {
+    double d;
+    unsigned long long u;
+  } bits;
+
+  bits.d = num;
+  return (bits.u & FP_DBL_EXP) != FP_DBL_EXP;
+}
+
+#ifdef CIIEEEFP_INLINE
+#define fpclass(dsrc) fpclass_fast(dsrc)
+#define finite(num) finite_fast(num)
+#endif
+
 /* Intel specific functions and utilities */
 
 extern fp_pctl fpgetprecision(void);
 extern fp_pctl fpsetprecision(fp_pctl pctl);
+extern fpclass_t fpclass_x87(double dsrc);
+extern void fpclass_array(const double *src, size_t n, fpclass_t *out);
+extern void fpgetenv(fp_env *env);
+extern void fpsetenv(const fp_env *env);
+extern int fpgetftz(void);
+extern int fpsetftz(int on);
+extern int fpgetdaz(void);
+extern int fpsetdaz(int on);
+extern fp_except fpsitebegin(void);
+extern void fpsiteend(fp_site *site, fp_except before);
+extern void print_fp_sites(void);
+extern fp_unit fpgetunit(void);
+extern fp_unit fpsetunit(fp_unit units);
+extern int fpgetcwcache(void);
+extern int fpsetcwcache(int on);
+extern void fpsynccw(void);
 extern void print_fpu_status(void);
 extern void print_fpu_control(void);
+extern void print_fpu_mxcsr(void);
 
 #endif
@@ -0,0 +1,359 @@
+/*
+    CIieeefp: CIinterval.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains interval arithmetic on doubles. A bound is
+   rounded outwards by working it out with the rounding direction set
+   towards it: the lower bound with FP_RM and the upper bound with
+   FP_RP. Changing the rounding direction costs far more than the
+   arithmetic, so the scalar operations use FP_RM for both bounds,
+   negating the operands of the upper bound (rounding -x down is the
+   same as rounding x up), and the array operations do all the lower
+   bounds and then all the upper bounds.
+
+   The library must be compiled with -frounding-math so that gcc does
+   not fold -((-a) - b) back into a + b, nor assume round to nearest
+   in any other way, and with -fno-math-errno so that sqrt() is done
+   with the instruction (which rounds as directed) and no call to
+   libm. */
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <CIinterval.h>
+
+/* interval_nan() -> NaN interval
+ *
+ * The result of an operation with no answer
+ */
+
+static fp_interval interval_nan(void) {
+  fp_interval r;
+
+  r.lo = r.hi = NAN;
+  return r;
+}
+
+/* interval_isnan(x) -> whether x has a NaN bound
+ */
+
+static int interval_isnan(fp_interval x) {
+  return x.lo != x.lo || x.hi != x.hi;
+}
+
+/* interval_min(a, b) -> smaller of a and b
+ *
+ * Either a or b may be NaN, when the other is returned, so that the
+ * NaN an undefined product or quotient of bounds gives is left out.
+ */
+
+static double interval_min(double a, double b) {
+  return (b < a || a != a) ? b : a;
+}
+
+/* interval_max(a, b) -> larger of a and b, as interval_min()
+ */
+
+static double interval_max(double a, double b) {
+  return (b > a || a != a) ? b : a;
+}
+
+/* interval_mul(a, b) -> a * b, taking 0 * Inf as 0
+ *
+ * A zero bound times an infinite one is the limit of finite numbers
+ * multiplied by zero, so contributes zero to the bounds of a product.
+ */
+
+static double interval_mul(double a, double b) {
+  return (a == 0.0 || b == 0.0) ? 0.0 : a * b;
+}
+
+/* interval_div(a, b) -> a / b, taking 0 / b and x / Inf as 0
+ *
+ * b is zero only when dividing by an interval containing zero, whose
+ * result is set aside for [-Inf, +Inf]: 0 is returned rather than
+ * raising FP_X_DZ for a bound that is not used. Inf / Inf gives NaN,
+ * which interval_min() and interval_max() leave out: another quotient
+ * of the bounds is always infinite or zero in its place.
+ */
+
+static double interval_div(double a, double b) {
+  if(a == 0.0 || b == 0.0) return 0.0;
+  if(isinf(b)) return isinf(a) ? NAN : 0.0;
+  return a / b;
+}
+
+/* interval_next_up(a) -> smallest double larger than a
+ *
+ * a is not negative or NaN. +Inf is returned unchanged.
+ */
+
+static double interval_next_up(double a) {
+  uint64_t bits;
+
+  if(isinf(a)) return a;
+  memcpy(&bits, &a, sizeof(bits));
+  bits++;
+  memcpy(&a, &bits, sizeof(bits));
+  return a;
+}
+
+/* interval_enter() -> rounding direction before
+ *
+ * Set the rounding direction to FP_RM for a scalar operation, unless
+ * it already is.
+ */
+
+static fp_rnd interval_enter(void) {
+  fp_rnd old = fpgetround();
+
+  if(old != FP_RM) fpsetround(FP_RM);
+  return old;
+}
+
+/* interval_leave(old)
+ *
+ * Put back the rounding direction interval_enter() returned.
+ */
+
+static void interval_leave(fp_rnd old) {
+  if(old != FP_RM) fpsetround(old);
+}
+
+/* fpi_add(x, y) -> x + y
+ */
+
+fp_interval fpi_add(fp_interval x, fp_interval y) {
+  fp_interval r;
+  fp_rnd old = interval_enter();
+
+  r.lo = x.lo + y.lo;
+  r.hi = -((-x.hi) - y.hi);
+  interval_leave(old);
+  return r;
+}
+
+/* fpi_sub(x, y) -> x - y
+ */
+
+fp_interval fpi_sub(fp_interval x, fp_interval y) {
+  fp_interval r;
+  fp_rnd old = interval_enter();
+
+  r.lo = x.lo - y.hi;
+  r.hi = -(y.lo - x.hi);
+  interval_leave(old);
+  return r;
+}
+
+/* fpi_mul(x, y) -> x * y
+ *
+ * The bounds are the smallest and largest products of the bounds of
+ * x and y. The largest rounded up is minus the smallest of the
+ * negated products rounded down.
+ */
+
+fp_interval fpi_mul(fp_interval x, fp_interval y) {
+  fp_interval r;
+  fp_rnd old;
+
+  if(interval_isnan(x) || interval_isnan(y)) return interval_nan();
+  old = interval_enter();
+  r.lo = interval_min(interval_min(interval_mul(x.lo, y.lo),
+				   interval_mul(x.lo, y.hi)),
+		      interval_min(interval_mul(x.hi, y.lo),
+				   interval_mul(x.hi, y.hi)));
+  r.hi = -interval_min(interval_min(interval_mul(-x.lo, y.lo),
+				    interval_mul(-x.lo, y.hi)),
+		       interval_min(interval_mul(-x.hi, y.lo),
+				    interval_mul(-x.hi, y.hi)));
+  interval_leave(old);
+  return r;
+}
+
+/* fpi_div(x, y) -> x / y
+ *
+ * As fpi_mul(), with quotients, unless y contains zero.
+ */
+
+fp_interval fpi_div(fp_interval x, fp_interval y) {
+  fp_interval r;
+  fp_rnd old;
+
+  if(interval_isnan(x) || interval_isnan(y)) return interval_nan();
+  if(y.lo <= 0.0 && y.hi >= 0.0) {
+    r.lo = -INFINITY;
+    r.hi = INFINITY;
+    return r;
+  }
+  old = interval_enter();
+  r.lo = interval_min(interval_min(interval_div(x.lo, y.lo),
+				   interval_div(x.lo, y.hi)),
+		      interval_min(interval_div(x.hi, y.lo),
+				   interval_div(x.hi, y.hi)));
+  r.hi = -interval_min(interval_min(interval_div(-x.lo, y.lo),
+				    interval_div(-x.lo, y.hi)),
+		       interval_min(interval_div(-x.hi, y.lo),
+				    interval_div(-x.hi, y.hi)));
+  interval_leave(old);
+  return r;
+}
+
+/* fpi_sqrt(x) -> square root of x
+ *
+ * The square root can't be negated, so the upper bound is the lower
+ * bound of the square root of x.hi, or the next double up if that
+ * squared (rounded down) falls short of x.hi. A square root rounded
+ * down squares to at most x.hi, and rounding down can only give x.hi
+ * if it is exact.
+ */
+
+fp_interval fpi_sqrt(fp_interval x) {
+  fp_interval r;
+  fp_rnd old;
+
+  if(interval_isnan(x) || x.hi < 0.0) return interval_nan();
+  old = interval_enter();
+  r.lo = x.lo > 0.0 ? sqrt(x.lo) : 0.0;
+  r.hi = sqrt(x.hi);
+  if(r.hi * r.hi != x.hi) r.hi = interval_next_up(r.hi);
+  interval_leave(old);
+  return r;
+}
+
+/* fpi_add_array(x, y, r, n)
+ */
+
+void fpi_add_array(const fp_interval *x, const fp_interval *y,
+		   fp_interval *r, size_t n) {
+  size_t i;
+  fp_rnd old = fpsetround(FP_RM);
+
+  for(i = 0; i < n; i++) r[i].lo = x[i].lo + y[i].lo;
+  fpsetround(FP_RP);
+  for(i = 0; i < n; i++) r[i].hi = x[i].hi + y[i].hi;
+  fpsetround(old);
+}
+
+/* fpi_sub_array(x, y, r, n)
+ */
+
+void fpi_sub_array(const fp_interval *x, const fp_interval *y,
+		   fp_interval *r, size_t n) {
+  size_t i;
+  fp_rnd old = fpsetround(FP_RM);
+
+  for(i = 0; i < n; i++) r[i].lo = x[i].lo - y[i].hi;
+  fpsetround(FP_RP);
+  for(i = 0; i < n; i++) r[i].hi = x[i].hi - y[i].lo;
+  fpsetround(old);
+}
+
+/* fpi_mul_array(x, y, r, n)
+ *
+ * Elements with a NaN bound are made NaN after both passes.
+ */
+
+void fpi_mul_array(const fp_interval *x, const fp_interval *y,
+		   fp_interval *r, size_t n) {
+  size_t i;
+  fp_rnd old = fpsetround(FP_RM);
+
+  for(i = 0; i < n; i++) {
+    r[i].lo = interval_min(interval_min(interval_mul(x[i].lo, y[i].lo),
+					interval_mul(x[i].lo, y[i].hi)),
+			   interval_min(interval_mul(x[i].hi, y[i].lo),
+					interval_mul(x[i].hi, y[i].hi)));
+  }
+  fpsetround(FP_RP);
+  for(i = 0; i < n; i++) {
+    r[i].hi = interval_max(interval_max(interval_mul(x[i].lo, y[i].lo),
+					interval_mul(x[i].lo, y[i].hi)),
+			   interval_max(interval_mul(x[i].hi, y[i].lo),
+					interval_mul(x[i].hi, y[i].hi)));
+  }
+  fpsetround(old);
+  for(i = 0; i < n; i++) {
+    if(interval_isnan(x[i]) || interval_isnan(y[i])) r[i] = interval_nan();
+  }
+}
+
+/* fpi_div_array(x, y, r, n)
+ *
+ * Elements with a NaN bound are made NaN, and those dividing by an
+ * interval containing zero [-Inf, +Inf], after both passes.
+ */
+
+void fpi_div_array(const fp_interval *x, const fp_interval *y,
+		   fp_interval *r, size_t n) {
+  size_t i;
+  fp_rnd old = fpsetround(FP_RM);
+
+  for(i = 0; i < n; i++) {
+    r[i].lo = interval_min(interval_min(interval_div(x[i].lo, y[i].lo),
+					interval_div(x[i].lo, y[i].hi)),
+			   interval_min(interval_div(x[i].hi, y[i].lo),
+					interval_div(x[i].hi, y[i].hi)));
+  }
+  fpsetround(FP_RP);
+  for(i = 0; i < n; i++) {
+    r[i].hi = interval_max(interval_max(interval_div(x[i].lo, y[i].lo),
+					interval_div(x[i].lo, y[i].hi)),
+			   interval_max(interval_div(x[i].hi, y[i].lo),
+					interval_div(x[i].hi, y[i].hi)));
+  }
+  fpsetround(old);
+  for(i = 0; i < n; i++) {
+    if(interval_isnan(x[i]) || interval_isnan(y[i])) {
+      r[i] = interval_nan();
+    }
+    else if(y[i].lo <= 0.0 && y[i].hi >= 0.0) {
+      r[i].lo = -INFINITY;
+      r[i].hi = INFINITY;
+    }
+  }
+}
+
+/* fpi_sqrt_array(x, r, n)
+ *
+ * Elements with a NaN bound or no non-negative numbers are made NaN
+ * after both passes.
+ */
+
+void fpi_sqrt_array(const fp_interval *x, fp_interval *r, size_t n) {
+  size_t i;
+  fp_rnd old = fpsetround(FP_RM);
+
+  for(i = 0; i < n; i++) r[i].lo = x[i].lo > 0.0 ? sqrt(x[i].lo) : 0.0;
+  fpsetround(FP_RP);
+  for(i = 0; i < n; i++) r[i].hi = x[i].hi >= 0.0 ? sqrt(x[i].hi) : 0.0;
+  fpsetround(old);
+  for(i = 0; i < n; i++) {
+    if(interval_isnan(x[i]) || x[i].hi < 0.0) r[i] = interval_nan();
+  }
+}
@@ -0,0 +1,89 @@
+/*
+    CIieeefp: CIinterval.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIinterval.c,
+   which do interval arithmetic on doubles using the directed rounding
+   set with fpsetround(). */
+
+#ifndef CIINTERVAL_H
+#define CIINTERVAL_H
+
+#include <stddef.h>
+#include <CIieeefp.h>
+
+/* An interval of doubles: all the numbers from lo to hi */
+
+typedef struct {
+  double lo, hi;
+} fp_interval;
+
+/* Scalar operations
+ *
+ * Each returns the smallest interval of doubles that contains the
+ * result of the operation on every pair of numbers in x and y (or
+ * every number in x for fpi_sqrt()). Division by an interval
+ * containing zero gives [-Inf, +Inf], and the square root of an
+ * interval with negative numbers is taken of its non-negative part
+ * (a NaN interval if there is none). Both bounds are worked out
+ * rounding towards minus infinity, the upper bound of a + b as
+ * -((-a) - b), for example, so a run of operations only needs the
+ * rounding direction changed at all if it is not already FP_RM: set
+ * it with fpsetround(FP_RM) first, and each operation checks it with
+ * fpgetround() and leaves it alone. Otherwise each operation sets
+ * FP_RM and puts the rounding direction back.
+ */
+
+extern fp_interval fpi_add(fp_interval x, fp_interval y);
+extern fp_interval fpi_sub(fp_interval x, fp_interval y);
+extern fp_interval fpi_mul(fp_interval x, fp_interval y);
+extern fp_interval fpi_div(fp_interval x, fp_interval y);
+extern fp_interval fpi_sqrt(fp_interval x);
+
+/* Array operations
+ *
+ * Put the result of the operation on x[i] and y[i] (x[i] for
+ * fpi_sqrt_array()) in r[i] for each of the n elements, giving the
+ * same answers as the scalar operations. All the lower bounds are
+ * worked out with the rounding direction set to FP_RM, then all the
+ * upper bounds with it set to FP_RP, so the rounding direction is only
+ * changed twice (and put back) for the whole array. r must not overlap
+ * x or y.
+ */
+
+extern void fpi_add_array(const fp_interval *x, const fp_interval *y,
+			  fp_interval *r, size_t n);
+extern void fpi_sub_array(const fp_interval *x, const fp_interval *y,
+			  fp_interval *r, size_t n);
+extern void fpi_mul_array(const fp_interval *x, const fp_interval *y,
+			  fp_interval *r, size_t n);
+extern void fpi_div_array(const fp_interval *x, const fp_interval *y,
+			  fp_interval *r, size_t n);
+extern void fpi_sqrt_array(const fp_interval *x, fp_interval *r, size_t n);
+
+#endif
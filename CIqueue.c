@@ -0,0 +1,225 @@
+/*
+    CIieeefp: CIqueue.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains a queue of arithmetic operations, each with the
+   rounding direction and precision it needs. Loading the control word
+   stops the FPU until everything in progress has finished, so doing
+   operations that need different environments one after another costs
+   far more than the arithmetic. fpq_run() instead sorts the queue into
+   a list for each of the 16 combinations of rounding direction and
+   precision control, linking each entry to the next with the same
+   environment, and does each list with one change of environment.
+
+   The exceptions each operation raises are found from the exception
+   flags of the unit the compiler does double arithmetic on, read
+   straight from the chip after it. They are only cleared when an
+   operation has set them, so that reading them is all the cost when
+   exceptions are rare, and operations whose exceptions are not wanted
+   do not look at them at all. The library's sticky bits are brought up
+   to date once at the end of the queue. The file is compiled with
+   -frounding-math so that gcc keeps the arithmetic where it is
+   written, and the results are stored through a volatile variable so
+   that each is worked out before the sticky bits are read. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <CIqueue.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+
+#define QUEUE_ENVS 16		/* Rounding directions times precisions */
+#define QUEUE_END SIZE_MAX	/* Marks the end of a list */
+
+#ifdef __SSE2_MATH__
+#define QUEUE_FLAGS() ((fp_except)(SSE_stmxcsr() & MX_XF))
+#define QUEUE_CLEAR() SSE_ldmxcsr(SSE_stmxcsr() & ~MX_XF)
+#else
+#define QUEUE_FLAGS() ((fp_except)(x87FPU_fstsw() & SW_XF))
+#define QUEUE_CLEAR() x87FPU_fclex()
+#endif
+
+/* fpq_init(queue, entries, size)
+ *
+ * See CIqueue.h.
+ */
+
+void fpq_init(fp_queue *queue, fp_queue_entry *entries, size_t size) {
+  queue->entries = entries;
+  queue->size = size;
+  queue->n = 0;
+}
+
+/* fpq_push(queue, op, a, b, rnd, pctl, result, flags) -> 0 or -1
+ *
+ * See CIqueue.h.
+ */
+
+int fpq_push(fp_queue *queue, fp_queue_op op, double a, double b,
+	     fp_rnd rnd, fp_pctl pctl, double *result, fp_except *flags) {
+  fp_queue_entry *e;
+
+  switch(op) {
+  case FP_QUEUE_ADD:
+  case FP_QUEUE_SUB:
+  case FP_QUEUE_MUL:
+  case FP_QUEUE_DIV:
+  case FP_QUEUE_SQRT:
+    break;
+  default:
+    fprintf(stderr, "fpq_push called with invalid operation: %d\n",
+	    (int)op);
+    abort();
+  }
+  switch(rnd) {
+  case FP_RN:
+  case FP_RM:
+  case FP_RP:
+  case FP_RZ:
+    break;
+  default:
+    fprintf(stderr, "fpq_push called with invalid rounding direction: "
+	    "%hx\n", rnd);
+    abort();
+  }
+  switch(pctl) {
+  case FP_PC_SGL:
+  case FP_PC_DBL:
+  case FP_PC_EXT:
+    break;
+  default:
+    fprintf(stderr, "fpq_push called with invalid precision control: "
+	    "%hx\n", pctl);
+    abort();
+  }
+  if(queue->n >= queue->size) return -1;
+  e = &queue->entries[queue->n++];
+  e->op = op;
+  e->rnd = rnd;
+  e->pctl = pctl;
+  e->a = a;
+  e->b = b;
+  e->result = result;
+  e->flags = flags;
+  return 0;
+}
+
+/* queue_do(e)
+ *
+ * Do the operation in entry e and put its result where it should go.
+ */
+
+static void queue_do(const fp_queue_entry *e) {
+  volatile double r;
+
+  switch(e->op) {
+  case FP_QUEUE_ADD:
+    r = e->a + e->b;
+    break;
+  case FP_QUEUE_SUB:
+    r = e->a - e->b;
+    break;
+  case FP_QUEUE_MUL:
+    r = e->a * e->b;
+    break;
+  case FP_QUEUE_DIV:
+    r = e->a / e->b;
+    break;
+  case FP_QUEUE_SQRT:
+  default:			/* Not reached: fpq_push() checks op */
+    r = sqrt(e->a);
+    break;
+  }
+  *e->result = r;
+}
+
+/* fpq_run(queue) -> number of runs
+ *
+ * See CIqueue.h.
+ */
+
+size_t fpq_run(fp_queue *queue) {
+  size_t head[QUEUE_ENVS], tail[QUEUE_ENVS];
+  size_t i, runs = 0;
+  fp_queue_entry *e = NULL;
+  fp_rnd old_rnd, rnd;
+  fp_pctl old_pctl, pctl;
+  fp_except before, raised = 0U, x;
+  int env, dirty = 0;
+
+  for(env = 0; env < QUEUE_ENVS; env++) head[env] = tail[env] = QUEUE_END;
+  for(i = 0; i < queue->n; i++) {
+    env = (int)((queue->entries[i].rnd << 2) | queue->entries[i].pctl);
+    queue->entries[i].next = QUEUE_END;
+    if(head[env] == QUEUE_END) head[env] = i;
+    else queue->entries[tail[env]].next = i;
+    tail[env] = i;
+  }
+
+  rnd = old_rnd = fpgetround();
+  pctl = old_pctl = fpgetprecision();
+  before = fpsetsticky(0U);
+  for(env = 0; env < QUEUE_ENVS; env++) {
+    if(head[env] == QUEUE_END) continue;
+    if((fp_rnd)(env >> 2) != rnd) {
+      rnd = (fp_rnd)(env >> 2);
+      fpsetround(rnd);
+    }
+    if((fp_pctl)(env & 3) != pctl) {
+      pctl = (fp_pctl)(env & 3);
+      fpsetprecision(pctl);
+    }
+    for(i = head[env]; i != QUEUE_END; i = e->next) {
+      e = &queue->entries[i];
+      if(e->flags != NULL && dirty) {
+	raised |= QUEUE_FLAGS();	/* Left by operations before */
+	QUEUE_CLEAR();
+      }
+      queue_do(e);
+      if(e->flags == NULL) {
+	dirty = 1;
+	continue;
+      }
+      x = QUEUE_FLAGS();
+      if(x != 0U) QUEUE_CLEAR();
+      *e->flags = x;
+      raised |= x;
+      dirty = 0;
+    }
+    raised |= QUEUE_FLAGS();	/* Before fpsetround() might clear them */
+    runs++;
+  }
+  if(pctl != old_pctl) fpsetprecision(old_pctl);
+  if(rnd != old_rnd) fpsetround(old_rnd);
+  fpsetsticky(before | raised);
+
+  queue->n = 0;
+  return runs;
+}
@@ -0,0 +1,106 @@
+/*
+    CIieeefp: CIqueue.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIqueue.c,
+   which queue arithmetic operations each needing its own rounding
+   direction and precision, and do them grouped by environment, so
+   that the control word is loaded once per group instead of once per
+   operation. */
+
+#ifndef CIQUEUE_H
+#define CIQUEUE_H
+
+#include <stddef.h>
+#include <CIieeefp.h>
+
+/* Operations */
+
+typedef enum { FP_QUEUE_ADD = 0, FP_QUEUE_SUB, FP_QUEUE_MUL, FP_QUEUE_DIV,
+	       FP_QUEUE_SQRT } fp_queue_op;
+
+/* An operation waiting in a queue */
+
+typedef struct {
+  fp_queue_op op;		/* What to do */
+  fp_rnd rnd;			/* Rounding direction to do it in */
+  fp_pctl pctl;			/* Precision control to do it with */
+  double a, b;			/* Operands (b not used by FP_QUEUE_SQRT) */
+  double *result;		/* Where to put the result */
+  fp_except *flags;		/* Where to put the exceptions, or NULL */
+  size_t next;			/* Next operation in the same environment */
+} fp_queue_entry;
+
+/* A queue. The caller provides the storage for the entries, which must
+   last as long as the queue is used. */
+
+typedef struct {
+  fp_queue_entry *entries;	/* Room for the operations */
+  size_t size;			/* How many there is room for */
+  size_t n;			/* How many are waiting */
+} fp_queue;
+
+/* fpq_init(queue, entries, size)
+ *
+ * Make queue an empty queue keeping up to size operations in entries.
+ */
+
+extern void fpq_init(fp_queue *queue, fp_queue_entry *entries, size_t size);
+
+/* fpq_push(queue, op, a, b, rnd, pctl, result, flags) -> 0 or -1
+ *
+ * Add the operation a op b (or the square root of a) to the queue, to
+ * be done rounding in direction rnd with precision control pctl, and
+ * return 0. When the queue is run, the result is put in *result and,
+ * if flags is not NULL, the exceptions the operation raised in *flags.
+ * Return -1, queueing nothing, if the queue is full. An invalid
+ * operation, rounding direction or precision control (including FP_RS,
+ * which the hardware does not have, and FP_PC_RES) is reported on
+ * stderr and the program aborted, as with fpsetround() and
+ * fpsetprecision().
+ */
+
+extern int fpq_push(fp_queue *queue, fp_queue_op op, double a, double b,
+		    fp_rnd rnd, fp_pctl pctl, double *result,
+		    fp_except *flags);
+
+/* fpq_run(queue) -> number of runs
+ *
+ * Do the operations in the queue and empty it. The operations are
+ * grouped into runs needing the same rounding direction and precision
+ * control, in the order they were queued within each run, and the
+ * rounding direction and precision are set once per run. The number
+ * of runs is returned. The exceptions raised are added to the sticky
+ * bits, and the rounding direction and precision are put back as they
+ * were. The precision control only makes a difference to arithmetic
+ * on the x87 FPU: on x86-64 the compiler does it on the SSE unit.
+ */
+
+extern size_t fpq_run(fp_queue *queue);
+
+#endif
@@ -0,0 +1,855 @@
+/*
+    CIieeefp: CIreduce.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains exact reductions of arrays of doubles. A double
+   is m 2^e for a 53 bit integer m and e from -1074 to 971, and the
+   product of two is a 106 bit integer times 2^e with e from -2148 to
+   1942, so every sum of them is an integer multiple of 2^-2148. An
+   fp_acc holds that integer as signed 32 bit digits in 64 bit
+   integers, and adding m 2^e to it takes three integer additions to
+   the digits covering bits e + 2148 onwards (nine for a product made
+   from its four 32 bit partial products). Each addition puts less than
+   2^35 into a digit, so carries need only be propagated every 2^24
+   elements, and integer addition being associative, the digits, and
+   so the rounded result, are the same whatever order the elements
+   are added in, and whatever accumulators they are added through.
+   Infinities and NaNs are noted as they are seen, and the exceptions
+   are worked out from the exact result when it is rounded, so they
+   do not depend on the order either. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <CIreduce.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+
+#define REDUCE_EMIN -2148	/* Exponent of the lowest digit's bit 0 */
+#define REDUCE_CARRY (1U << 24)	/* Elements between carries */
+#define REDUCE_M32 UINT64_C(0xffffffff)
+
+#define REDUCE_NAN 0x1U		/* Special values seen */
+#define REDUCE_PINF 0x2U
+#define REDUCE_NINF 0x4U
+
+/* reduce_add(digit, v, pos, sign)
+ *
+ * Add sign * v * 2^pos to the digits, sign being 1 or -1.
+ */
+
+static __inline__ void reduce_add(int64_t *digit, uint64_t v, int pos,
+				  int64_t sign) {
+  int i = pos >> 5, sh = pos & 31;
+  uint64_t v0 = (v & REDUCE_M32) << sh, v1 = (v >> 32) << sh;
+
+  digit[i] += sign * (int64_t)(v0 & REDUCE_M32);
+  digit[i + 1] += sign * (int64_t)((v0 >> 32) + (v1 & REDUCE_M32));
+  digit[i + 2] += sign * (int64_t)(v1 >> 32);
+}
+
+/* reduce_carry(digit)
+ *
+ * Propagate the carries, leaving every digit but the top one in
+ * [0, 2^32).
+ */
+
+static void reduce_carry(int64_t *digit) {
+  int64_t c;
+  int i;
+
+  for(i = 0; i < FP_ACC_DIGITS - 1; i++) {
+    c = digit[i] >> 32;		/* Arithmetic shift: rounds down */
+    digit[i] -= c * ((int64_t)1 << 32);
+    digit[i + 1] += c;
+  }
+}
+
+/* reduce_count(acc, n)
+ *
+ * Note that n more elements have been added, doing the carries if
+ * enough have been added since they were last done. n is at most
+ * REDUCE_CARRY.
+ */
+
+static void reduce_count(fp_acc *acc, size_t n) {
+  if(acc->pending + n >= REDUCE_CARRY) {
+    reduce_carry(acc->digit);
+    acc->pending = 0;
+  }
+  acc->pending += (uint32_t)n;
+}
+
+/* reduce_split(x, acc, m, e) -> 0, or what special value x is
+ *
+ * Put the integer significand and exponent of x in *m and *e and
+ * return 0, noting in acc if x is denormalised. If x is an infinity or
+ * a NaN return REDUCE_PINF, REDUCE_NINF or REDUCE_NAN instead, noting
+ * an invalid operation for a signalling NaN.
+ */
+
+static __inline__ unsigned reduce_split(double x, fp_acc *acc, uint64_t *m,
+					int *e) {
+  uint64_t bits;
+  int field;
+
+  memcpy(&bits, &x, sizeof(bits));
+  field = (int)((bits >> 52) & 0x7ff);
+  *m = bits & UINT64_C(0xfffffffffffff);
+  if(field == 0x7ff) {
+    if(*m == 0) return (bits >> 63) ? REDUCE_NINF : REDUCE_PINF;
+    if(!(*m & UINT64_C(0x8000000000000))) acc->flags |= FP_X_INV;
+    return REDUCE_NAN;
+  }
+  if(field == 0) {
+    if(*m != 0) acc->flags |= FP_X_DNML;
+    *e = -1074;
+  }
+  else {
+    *m |= UINT64_C(0x10000000000000);
+    *e = field - 1075;
+  }
+  return 0U;
+}
+
+/* reduce_product(acc, mx, my, pos, sign)
+ *
+ * Add sign * mx * my * 2^pos to acc, from the four partial products
+ * of the 32 bit halves of mx and my (each below 2^53).
+ */
+
+static __inline__ void reduce_product(fp_acc *acc, uint64_t mx, uint64_t my,
+				      int pos, int64_t sign) {
+  uint64_t x0 = mx & REDUCE_M32, x1 = mx >> 32;
+  uint64_t y0 = my & REDUCE_M32, y1 = my >> 32;
+
+  reduce_add(acc->digit, x0 * y0, pos, sign);
+  reduce_add(acc->digit, x0 * y1 + x1 * y0, pos + 32, sign);
+  reduce_add(acc->digit, x1 * y1, pos + 64, sign);
+}
+
+/* fpacc_init(acc)
+ *
+ * See CIreduce.h.
+ */
+
+void fpacc_init(fp_acc *acc) {
+  memset(acc, 0, sizeof(*acc));
+}
+
+/* reduce_sum_exact(acc, x, y, n)
+ * reduce_dot_exact(acc, x, y, n)
+ *
+ * Add x[i] (or x[i] * y[i]) to acc for each of the n elements, one at
+ * a time in integers. The caller does the counting. y is not used by
+ * reduce_sum_exact(), which takes it to look like reduce_dot_exact().
+ */
+
+static void reduce_sum_exact(fp_acc *acc, const double *x, const double *y,
+			     size_t n) {
+  size_t j;
+  uint64_t m;
+  unsigned sx;
+  int e;
+
+  (void)y;
+  for(j = 0; j < n; j++) {
+    sx = reduce_split(x[j], acc, &m, &e);
+    if(sx == 0U) {
+      reduce_add(acc->digit, m, e - REDUCE_EMIN, x[j] < 0.0 ? -1 : 1);
+    }
+    else acc->special |= sx;
+  }
+}
+
+static void reduce_dot_exact(fp_acc *acc, const double *x, const double *y,
+			     size_t n) {
+  size_t j;
+  uint64_t mx, my;
+  unsigned sx, sy;
+  int ex, ey, neg;
+
+  for(j = 0; j < n; j++) {
+    sx = reduce_split(x[j], acc, &mx, &ex);
+    sy = reduce_split(y[j], acc, &my, &ey);
+    neg = (x[j] < 0.0) != (y[j] < 0.0);
+    if((sx | sy) == 0U) {
+      reduce_product(acc, mx, my, ex + ey - REDUCE_EMIN, neg ? -1 : 1);
+    }
+    else if((sx | sy) & REDUCE_NAN) acc->special |= REDUCE_NAN;
+    else if(x[j] == 0.0 || y[j] == 0.0) {
+      acc->special |= REDUCE_NAN;
+      acc->flags |= FP_X_INV;
+    }
+    else acc->special |= neg ? REDUCE_NINF : REDUCE_PINF;
+  }
+}
+
+#ifdef __SSE2_MATH__
+
+/* The fast path
+ *
+ * A block of up to REDUCE_BLOCK terms is first scanned for the sum S
+ * of their absolute values, 2^E <= S < 2^(E + 1). Each term is then
+ * split into parts on REDUCE_LEVELS fixed grids: with C = 1.5 * 2^(E +
+ * 3), q = (x + C) - C is x rounded to a multiple of u = 2^(E - 49),
+ * exactly, and x - q is exact too. The q add up to at most about S,
+ * under 2^53 u, so adding them in doubles is exact, in any order. The
+ * remainders, at most u / 2, are split in the same way on grids each
+ * 2^REDUCE_STEP finer, whose sums are exact for the same reason, and
+ * the sums are added to the digits. Terms with bits left after that,
+ * about 2^172 smaller than S, are added one at a time in integers.
+ * Products are made into two terms with an exact product: Dekker's,
+ * or an FMA where the CPU has one. A block adds at most 2 n + 8 terms
+ * to the digits this way, less than n products would in integers, so
+ * the carries need not be done any sooner.
+ *
+ * This needs rounding to nearest, and no flush-to-zero or
+ * denormals-are-zeros, so the MXCSR is set for it and put back after,
+ * flags and all, so that the exceptions raised on the way are not
+ * seen. The scan is done with the flags clear, and blocks whose scan
+ * raises one, which happens for denormalised terms, signalling NaNs
+ * and (with the products scaled by 2^-54) products small enough that
+ * their rounding error might not be a double, or whose S is not
+ * finite or is too large or small for the grids to be doubles, are
+ * added in integers instead. Either way the sum is exact, so which
+ * way a block goes makes no difference to the result. The terms are
+ * taken REDUCE_LANES at a time in gcc's vector types, for the default
+ * target and for AVX2 and FMA, chosen at run time, as in CIelemfn.c,
+ * with no comparisons in the loops, as SSE2 has none for vectors of
+ * 64-bit integers.
+ */
+
+#if defined(__GNUC__) && __GNUC__ >= 5 \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build AVX2 kernels
+				   chosen at run time */
+#endif
+
+#define REDUCE_BLOCK 1024	/* Terms per block: 2^10 */
+#define REDUCE_LANES 4
+#define REDUCE_LEVELS 4	/* Grids */
+#define REDUCE_STEP 41		/* Bits between grids */
+#define REDUCE_EMAX 1018	/* Range of E for the grids */
+#define REDUCE_EMIN_FAST -902
+#define REDUCE_SCALE 0x1p-54	/* Scale of the products in the scan */
+#define REDUCE_SCALE_EXP 54
+#define REDUCE_ABS UINT64_C(0x7fffffffffffffff)
+#define REDUCE_SCAN_FLAGS (MX_IE | MX_DE | MX_UE)
+
+#define REDUCE_INLINE static __inline__ __attribute__((always_inline))
+
+typedef double REDUCE_V __attribute__((vector_size(REDUCE_LANES
+						   * sizeof(double))));
+typedef int64_t REDUCE_M __attribute__((vector_size(REDUCE_LANES
+						    * sizeof(double))));
+
+typedef double (*REDUCE_SCAN)(const double *x, const double *y, size_t n);
+typedef int (*REDUCE_SPLIT)(fp_acc *acc, const double *x, const double *y,
+			    size_t n, const double *c);
+
+REDUCE_INLINE void reduce_load(REDUCE_V *v, const double *p) {
+  memcpy(v, p, sizeof(*v));
+}
+
+REDUCE_INLINE void reduce_abs(REDUCE_V *v) {
+  *v = (REDUCE_V)((REDUCE_M)*v & (int64_t)REDUCE_ABS);
+}
+
+REDUCE_INLINE double reduce_total(const REDUCE_V *v) {
+  double t = 0.0;
+  int i;
+
+  for(i = 0; i < REDUCE_LANES; i++) t += (*v)[i];
+  return t;
+}
+
+/* reduce_two_prod(a, b, h, l, fma)
+ *
+ * Put a * b rounded in h and its rounding error in l.
+ */
+
+REDUCE_INLINE void reduce_two_prod(const REDUCE_V *x, const REDUCE_V *y,
+				   REDUCE_V *h, REDUCE_V *l, int fma) {
+  REDUCE_V a = *x, b = *y, c, ah, al, bh, bl;
+  int i;
+
+  *h = a * b;
+  if(fma) {
+    for(i = 0; i < REDUCE_LANES; i++) (*l)[i] = __builtin_fma(a[i], b[i],
+							      -(*h)[i]);
+  }
+  else {
+    c = 134217729.0 * a;	/* 2^27 + 1 */
+    ah = c - (c - a);
+    al = a - ah;
+    c = 134217729.0 * b;
+    bh = c - (c - b);
+    bl = b - bh;
+    *l = ((ah * bh - *h) + ah * bl + al * bh) + al * bl;
+  }
+}
+
+/* reduce_extract(v, c, s, from)
+ *
+ * Split v on the grids c[from] to c[REDUCE_LEVELS - 1], adding the
+ * parts to s[from] to s[REDUCE_LEVELS - 1] and leaving in v the bits
+ * left over.
+ */
+
+REDUCE_INLINE void reduce_extract(REDUCE_V *v, const REDUCE_V *c,
+				  REDUCE_V *s, int from) {
+  REDUCE_V q, w = *v;
+  int i;
+
+#pragma GCC unroll 4
+  for(i = from; i < REDUCE_LEVELS; i++) {
+    q = (w + c[i]) - c[i];
+    s[i] += q;
+    w -= q;
+  }
+  *v = w;
+}
+
+/* reduce_part(acc, d)
+ *
+ * Add d, part of a term, to acc, exactly. Parts can be denormalised
+ * when the terms are not, so the flags are put back after.
+ */
+
+static void reduce_part(fp_acc *acc, double d) {
+  fp_except flags = acc->flags;
+
+  reduce_sum_exact(acc, &d, NULL, 1);
+  acc->flags = flags;
+}
+
+/* reduce_left(acc, v)
+ *
+ * Add to acc the lanes of v, the bits left over after splitting a
+ * term on the grids.
+ */
+
+static void reduce_left(fp_acc *acc, const REDUCE_V *v) {
+  int j;
+
+  for(j = 0; j < REDUCE_LANES; j++) {
+    if((*v)[j] != 0.0) reduce_part(acc, (*v)[j]);
+  }
+}
+
+/* reduce_grids(s, scale, c) -> whether the block can take the fast path
+ *
+ * Put in c the grids for a block whose terms have absolute values
+ * adding up to s 2^scale.
+ */
+
+static int reduce_grids(double s, int scale, double *c) {
+  uint64_t bits;
+  int i, e;
+
+  if(!(s < 1.0 / 0.0)) return 0;
+  memcpy(&bits, &s, sizeof(bits));
+  e = (int)(bits >> 52) - 1023 + scale;
+  if(e > REDUCE_EMAX || e < REDUCE_EMIN_FAST) return 0;
+  for(i = 0; i < REDUCE_LEVELS; i++) {
+    bits = ((uint64_t)(e + 3 - REDUCE_STEP * i + 1023) << 52)
+      | UINT64_C(0x8000000000000);
+    memcpy(&c[i], &bits, sizeof(bits));
+  }
+  return 1;
+}
+
+/* reduce_finish(acc, s) -> 0 if the terms had NaNs
+ *
+ * Add the sums on the grids, the totals of the lanes of the first
+ * REDUCE_LEVELS * 2 vectors in s, to acc. Terms giving NaN are passed
+ * by the scan only if they are products whose low parts overflowed,
+ * and these make the sums NaN.
+ */
+
+static int reduce_finish(fp_acc *acc, const REDUCE_V *s) {
+  double t[REDUCE_LEVELS * 2];
+  int i;
+
+  for(i = 0; i < REDUCE_LEVELS * 2; i++) {
+    t[i] = reduce_total(&s[i]);
+    if(t[i] != t[i]) return 0;
+  }
+  for(i = 0; i < REDUCE_LEVELS * 2; i++) {
+    if(t[i] != 0.0) reduce_part(acc, t[i]);
+  }
+  return 1;
+}
+
+/* reduce_sum_scan(x, y, n) -> sum of |x[i]|
+ * reduce_dot_scan(x, y, n) -> sum of |x[i] y[i]| 2^-54
+ *
+ * Scan the n elements (a multiple of REDUCE_LANES) for the grids.
+ */
+
+REDUCE_INLINE double reduce_sum_scan(const double *x, const double *y,
+				     size_t n) {
+  REDUCE_V s = { 0.0 }, a;
+  size_t j;
+
+  (void)y;
+  for(j = 0; j < n; j += REDUCE_LANES) {
+    reduce_load(&a, x + j);
+    reduce_abs(&a);
+    s += a;
+  }
+  return reduce_total(&s);
+}
+
+REDUCE_INLINE double reduce_dot_scan(const double *x, const double *y,
+				     size_t n) {
+  REDUCE_V s = { 0.0 }, a, b;
+  size_t j;
+
+  for(j = 0; j < n; j += REDUCE_LANES) {
+    reduce_load(&a, x + j);
+    reduce_load(&b, y + j);
+    a = a * REDUCE_SCALE * b;
+    reduce_abs(&a);
+    s += a;
+  }
+  return reduce_total(&s);
+}
+
+/* reduce_sum_split(acc, x, y, n, c) -> 0 if the block needs integers
+ * reduce_dot_split(acc, x, y, n, c, fma) -> 0 if the block needs integers
+ *
+ * Add the n elements of x (y is not used) or the n products x[i] *
+ * y[i] to acc, split on the grids in c. Pairs of elements, or the two
+ * parts of each product, go to separate sums, so that the additions
+ * to each do not wait for the one before. The low part of a product
+ * is less than half the first grid, so it starts on the second. The
+ * bits left over are looked for once for the block, and only if there
+ * are any are the terms split again to find them.
+ */
+
+REDUCE_INLINE int reduce_sum_split(fp_acc *acc, const double *x,
+				   const double *y, size_t n,
+				   const double *c) {
+  REDUCE_V a, b, cv[REDUCE_LEVELS], sv[REDUCE_LEVELS * 3], left = { 0.0 };
+  size_t j;
+  int i;
+
+  (void)y;
+  for(i = 0; i < REDUCE_LEVELS * 3; i++) sv[i] = left;
+  for(i = 0; i < REDUCE_LEVELS; i++) cv[i] = left + c[i];
+  for(j = 0; j + REDUCE_LANES < n; j += 2 * REDUCE_LANES) {
+    reduce_load(&a, x + j);
+    reduce_load(&b, x + j + REDUCE_LANES);
+    reduce_extract(&a, cv, sv, 0);
+    reduce_extract(&b, cv, sv + REDUCE_LEVELS, 0);
+    left = (REDUCE_V)((REDUCE_M)left | (REDUCE_M)a | (REDUCE_M)b);
+  }
+  if(j < n) {
+    reduce_load(&a, x + j);
+    reduce_extract(&a, cv, sv, 0);
+    left = (REDUCE_V)((REDUCE_M)left | (REDUCE_M)a);
+  }
+  reduce_abs(&left);
+  if(reduce_total(&left) != 0.0) {
+    for(j = 0; j < n; j += REDUCE_LANES) {
+      reduce_load(&a, x + j);
+      reduce_extract(&a, cv, sv + REDUCE_LEVELS * 2, 0);
+      reduce_left(acc, &a);
+    }
+  }
+  return reduce_finish(acc, sv);
+}
+
+REDUCE_INLINE int reduce_dot_split(fp_acc *acc, const double *x,
+				   const double *y, size_t n,
+				   const double *c, int fma) {
+  REDUCE_V a, b, h, l, cv[REDUCE_LEVELS], sv[REDUCE_LEVELS * 3];
+  REDUCE_V left = { 0.0 };
+  size_t j;
+  int i;
+
+  for(i = 0; i < REDUCE_LEVELS * 3; i++) sv[i] = left;
+  for(i = 0; i < REDUCE_LEVELS; i++) cv[i] = left + c[i];
+  for(j = 0; j < n; j += REDUCE_LANES) {
+    reduce_load(&a, x + j);
+    reduce_load(&b, y + j);
+    reduce_two_prod(&a, &b, &h, &l, fma);
+    reduce_extract(&h, cv, sv, 0);
+    reduce_extract(&l, cv, sv + REDUCE_LEVELS, 1);
+    left = (REDUCE_V)((REDUCE_M)left | (REDUCE_M)h | (REDUCE_M)l);
+  }
+  h = sv[0] + sv[REDUCE_LEVELS + 1];
+  if(reduce_total(&h) != reduce_total(&h)) return 0;
+  reduce_abs(&left);
+  if(reduce_total(&left) != 0.0) {
+    for(j = 0; j < n; j += REDUCE_LANES) {
+      reduce_load(&a, x + j);
+      reduce_load(&b, y + j);
+      reduce_two_prod(&a, &b, &h, &l, fma);
+      reduce_extract(&h, cv, sv + REDUCE_LEVELS * 2, 0);
+      reduce_left(acc, &h);
+      reduce_extract(&l, cv, sv + REDUCE_LEVELS * 2, 1);
+      reduce_left(acc, &l);
+    }
+  }
+  return reduce_finish(acc, sv);
+}
+
+/* reduce_KIND_STEP_vec(...), reduce_KIND_STEP_avx2(...)
+ *
+ * KIND = {sum, dot}, STEP = {scan, split}
+ *
+ * The steps built for the default target and for AVX2 with FMA.
+ */
+
+#define REDUCE_KERNELS(suffix, fma) \
+  static double reduce_sum_scan_##suffix(const double *x, const double *y, \
+					 size_t n) { \
+    return reduce_sum_scan(x, y, n); \
+  } \
+  static double reduce_dot_scan_##suffix(const double *x, const double *y, \
+					 size_t n) { \
+    return reduce_dot_scan(x, y, n); \
+  } \
+  static int reduce_sum_split_##suffix(fp_acc *acc, const double *x, \
+				       const double *y, size_t n, \
+				       const double *c) { \
+    return reduce_sum_split(acc, x, y, n, c); \
+  } \
+  static int reduce_dot_split_##suffix(fp_acc *acc, const double *x, \
+				       const double *y, size_t n, \
+				       const double *c) { \
+    return reduce_dot_split(acc, x, y, n, c, fma); \
+  }
+
+REDUCE_KERNELS(vec, 0)
+
+#ifdef CI_SIMD_KERNELS
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+REDUCE_KERNELS(avx2, 1)
+#pragma GCC pop_options
+
+#define REDUCE_CHOOSE(name) \
+  ((__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) \
+   ? name##_avx2 : name##_vec)
+#else
+#define REDUCE_CHOOSE(name) name##_vec
+#endif
+
+/* reduce_fast(acc, x, y, n, scan, split, scale, exact)
+ *
+ * Add the n elements of x, or the products of x and y, to acc, in
+ * blocks on the fast path where they can take it, and otherwise
+ * with exact.
+ */
+
+static void reduce_fast(fp_acc *acc, const double *x, const double *y,
+			size_t n, REDUCE_SCAN scan, REDUCE_SPLIT split,
+			int scale, void (*exact)(fp_acc *, const double *,
+						 const double *, size_t)) {
+  SSE_mxcsr mxcsr = SSE_stmxcsr(), ctl;
+  double c[REDUCE_LEVELS];
+  size_t i, len;
+
+  ctl = ((mxcsr & ~(MX_RC | MX_FZ | MX_DAZ)) | MX_XM) & ~MX_XF;
+  for(i = 0; i < n; i += len) {
+    len = n - i < REDUCE_BLOCK ? n - i : REDUCE_BLOCK;
+    len -= len % REDUCE_LANES;
+    if(len == 0) len = n - i;
+    reduce_count(acc, len);
+    if(len % REDUCE_LANES == 0) {
+      SSE_ldmxcsr(ctl);
+      if(reduce_grids(scan(x + i, y + i, len), scale, c)
+	 && (SSE_stmxcsr() & REDUCE_SCAN_FLAGS) == 0
+	 && split(acc, x + i, y + i, len, c)) continue;
+    }
+    exact(acc, x + i, y + i, len);
+  }
+  SSE_ldmxcsr(mxcsr);
+}
+
+#endif
+
+/* fpacc_sum(acc, x, n)
+ * fpacc_dot(acc, x, y, n)
+ * fpacc_sumsq(acc, x, n)
+ *
+ * See CIreduce.h. The elements are taken in blocks, doing the carries
+ * when enough have been added. Blocks that can are done on the fast
+ * path, and the rest, and any elements after the last whole vector, in
+ * integers.
+ */
+
+void fpacc_sum(fp_acc *acc, const double *x, size_t n) {
+#ifdef __SSE2_MATH__
+  reduce_fast(acc, x, x, n, REDUCE_CHOOSE(reduce_sum_scan),
+	      REDUCE_CHOOSE(reduce_sum_split), 0, reduce_sum_exact);
+#else
+  size_t i, len;
+
+  for(i = 0; i < n; i += len) {
+    len = n - i < REDUCE_CARRY ? n - i : REDUCE_CARRY;
+    reduce_count(acc, len);
+    reduce_sum_exact(acc, x + i, NULL, len);
+  }
+#endif
+}
+
+void fpacc_dot(fp_acc *acc, const double *x, const double *y, size_t n) {
+#ifdef __SSE2_MATH__
+  reduce_fast(acc, x, y, n, REDUCE_CHOOSE(reduce_dot_scan),
+	      REDUCE_CHOOSE(reduce_dot_split), REDUCE_SCALE_EXP,
+	      reduce_dot_exact);
+#else
+  size_t i, len;
+
+  for(i = 0; i < n; i += len) {
+    len = n - i < REDUCE_CARRY ? n - i : REDUCE_CARRY;
+    reduce_count(acc, len);
+    reduce_dot_exact(acc, x + i, y + i, len);
+  }
+#endif
+}
+
+void fpacc_sumsq(fp_acc *acc, const double *x, size_t n) {
+  fpacc_dot(acc, x, x, n);
+}
+
+/* fpacc_merge(acc, other)
+ *
+ * See CIreduce.h. Doing the carries in both first leaves room for the
+ * digits to be added.
+ */
+
+void fpacc_merge(fp_acc *acc, const fp_acc *other) {
+  int64_t digit[FP_ACC_DIGITS];
+  int i;
+
+  memcpy(digit, other->digit, sizeof(digit));
+  reduce_carry(digit);
+  reduce_carry(acc->digit);
+  for(i = 0; i < FP_ACC_DIGITS; i++) acc->digit[i] += digit[i];
+  acc->pending = 0;
+  acc->special |= other->special;
+  acc->flags |= other->flags;
+}
+
+/* reduce_round(acc, rnd, scale, raised) -> value of acc rounded
+ *
+ * Do the work of fpacc_round(), without touching the sticky bits. If
+ * scale is not NULL, the value is first multiplied by 2^-*scale, *scale
+ * being set to the even number putting it in [1, 4). With the carries
+ * done, the sign is that of the top digit; a negative value is negated
+ * digit by digit and the carries done again. The 64 bits from the
+ * highest one, with a sticky bit for any below them, are then rounded
+ * to the 53 bits of a double, or fewer for a subnormal, and scaled into
+ * place.
+ */
+
+static int reduce_bits(uint64_t v) {	/* Number of bits in v, not 0 */
+  return 64 - __builtin_clzll(v);
+}
+
+static double reduce_round(const fp_acc *acc, fp_rnd rnd, int *scale,
+			   fp_except *raised) {
+  int64_t digit[FP_ACC_DIGITS];
+  uint64_t top, rest, sticky = 0, m, half, low;
+  fp_except x = acc->flags;
+  double r;
+  int i, k, neg, up, pos, e, keep, drop;
+
+  memcpy(digit, acc->digit, sizeof(digit));
+  reduce_carry(digit);
+  neg = digit[FP_ACC_DIGITS - 1] < 0;
+  if(neg) {
+    for(i = 0; i < FP_ACC_DIGITS; i++) digit[i] = -digit[i];
+    reduce_carry(digit);
+  }
+  for(k = FP_ACC_DIGITS - 1; k >= 0 && digit[k] == 0; k--);
+
+  if(acc->special & REDUCE_NAN
+     || (acc->special & REDUCE_PINF && acc->special & REDUCE_NINF)) {
+    if(!(acc->special & REDUCE_NAN)) x |= FP_X_INV;
+    r = nan("");
+  }
+  else if(acc->special) r = acc->special & REDUCE_PINF ? HUGE_VAL : -HUGE_VAL;
+  else if(k < 0) {
+    r = rnd == FP_RM ? -0.0 : 0.0;
+    if(scale != NULL) *scale = 0;
+  }
+  else {
+
+    /* top holds bits pos down to pos - 63 of the integer, bit 0 of
+       digit 0 being bit 0 */
+
+    top = (uint64_t)digit[k] << 32;
+    if(k > 0) top |= (uint64_t)digit[k - 1];
+    rest = k > 1 ? (uint64_t)digit[k - 2] : 0;
+    for(i = 0; i < k - 2; i++) sticky |= (uint64_t)digit[i];
+    pos = 32 * (k - 1) + reduce_bits(top) - 1;
+    drop = 64 - reduce_bits(top);
+    if(drop > 0) {
+      top = (top << drop) | (rest >> (32 - drop));
+      rest = (rest << drop) & REDUCE_M32;
+    }
+    sticky |= rest;
+    e = pos + REDUCE_EMIN;		/* Value in [2^e, 2^(e + 1)) */
+    if(scale != NULL) {
+      *scale = e - (e & 1);
+      e -= *scale;
+    }
+
+    /* Round to keep bits, 53 or fewer for a subnormal */
+
+    keep = e >= -1022 ? 53 : e + 1075;
+    drop = 64 - keep;
+    if(drop > 64) {
+      m = 0;
+      half = 0;
+      low = top | sticky;
+    }
+    else if(drop == 64) {
+      m = 0;
+      half = top >> 63;
+      low = (top << 1) | sticky;
+    }
+    else {
+      m = top >> drop;
+      half = (top >> (drop - 1)) & 1U;
+      low = (top & ((UINT64_C(1) << (drop - 1)) - 1)) | sticky;
+    }
+    switch(rnd) {
+    case FP_RN:
+      up = half && (low || (m & 1U));
+      break;
+    case FP_RP:
+      up = !neg && (half || low);
+      break;
+    case FP_RM:
+      up = neg && (half || low);
+      break;
+    default:
+      up = 0;
+      break;
+    }
+    if(half || low) x |= FP_X_IMP;
+    m += (uint64_t)up;
+    if(e > 1023 || (e == 1023 && m >> 53)) {
+      x |= FP_X_OFL | FP_X_IMP;
+      r = (rnd == FP_RZ || rnd == (neg ? FP_RP : FP_RM)) ? DBL_MAX
+	: HUGE_VAL;
+    }
+    else {
+      r = ldexp((double)m, e - keep + 1);
+      if((half || low) && r < DBL_MIN) x |= FP_X_UFL;
+    }
+    if(neg) r = -r;
+  }
+
+  *raised = x;
+  return r;
+}
+
+/* fpacc_round(acc, rnd, raised) -> value of acc rounded
+ *
+ * See CIreduce.h.
+ */
+
+double fpacc_round(const fp_acc *acc, fp_rnd rnd, fp_except *raised) {
+  fp_except x;
+  double r;
+
+  switch(rnd) {
+  case FP_RN:
+  case FP_RM:
+  case FP_RP:
+  case FP_RZ:
+    break;
+  default:
+    fprintf(stderr, "fpacc_round called with invalid rounding direction: "
+	    "%hx\n", rnd);
+    abort();
+  }
+  r = reduce_round(acc, rnd, NULL, &x);
+  fpsetsticky(fpgetsticky() | x);
+  if(raised != NULL) *raised = x;
+  return r;
+}
+
+/* fp_sum(x, n, raised) -> sum of x
+ * fp_dot(x, y, n, raised) -> dot product of x and y
+ * fp_nrm2(x, n, raised) -> 2-norm of x
+ *
+ * See CIreduce.h.
+ */
+
+double fp_sum(const double *x, size_t n, fp_except *raised) {
+  fp_acc acc;
+
+  fpacc_init(&acc);
+  fpacc_sum(&acc, x, n);
+  return fpacc_round(&acc, FP_RN, raised);
+}
+
+double fp_dot(const double *x, const double *y, size_t n,
+	      fp_except *raised) {
+  fp_acc acc;
+
+  fpacc_init(&acc);
+  fpacc_dot(&acc, x, y, n);
+  return fpacc_round(&acc, FP_RN, raised);
+}
+
+double fp_nrm2(const double *x, size_t n, fp_except *raised) {
+  fp_acc acc;
+  fp_except flags;
+  double v, r, q;
+  int scale = 0;
+
+  /* The sum of squares is rounded scaled into [1, 4), so that its
+     square root can be scaled back by half as much */
+
+  fpacc_init(&acc);
+  fpacc_sumsq(&acc, x, n);
+  v = reduce_round(&acc, FP_RN, &scale, &flags);
+  r = sqrt(v);
+  if(r * r != v) flags |= FP_X_IMP;
+  q = ldexp(r, scale / 2);
+  if(q > DBL_MAX && r <= DBL_MAX) flags |= FP_X_OFL | FP_X_IMP;
+  else if(q < DBL_MIN && ldexp(q, -scale / 2) != r) {
+    flags |= FP_X_UFL | FP_X_IMP;
+  }
+  fpsetsticky(fpgetsticky() | flags);
+  if(raised != NULL) *raised = flags;
+  return q;
+}
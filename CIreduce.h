@@ -0,0 +1,120 @@
+/*
+    CIieeefp: CIreduce.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIreduce.c,
+   which work out sums, dot products and 2-norms of arrays of doubles
+   exactly, rounding only at the end, so that the result is the same
+   however the array is split between threads and in whatever order
+   the parts are added. */
+
+#ifndef CIREDUCE_H
+#define CIREDUCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <CIieeefp.h>
+
+/* An accumulator: the exact sum of what has been added to it, as
+   FP_ACC_DIGITS 32-bit digits held in 64-bit integers so that carries
+   can wait, covering every product of two doubles. The fields are for
+   CIreduce.c. */
+
+#define FP_ACC_DIGITS 136
+
+typedef struct {
+  int64_t digit[FP_ACC_DIGITS];	/* Digit i has weight 2^(32 i - 2148) */
+  uint32_t pending;		/* Elements added since carries were done */
+  unsigned special;		/* Infinities and NaNs seen */
+  fp_except flags;		/* Exceptions seen in the operands */
+} fp_acc;
+
+/* fpacc_init(acc)
+ *
+ * Make acc zero.
+ */
+
+extern void fpacc_init(fp_acc *acc);
+
+/* fpacc_sum(acc, x, n)
+ * fpacc_dot(acc, x, y, n)
+ * fpacc_sumsq(acc, x, n)
+ *
+ * Add x[i] (or x[i] * y[i], or x[i] * x[i]) for each of the n
+ * elements to acc, exactly: products are never rounded, so they can
+ * neither overflow nor underflow. The floating point environment is
+ * left as it was, sticky bits included.
+ */
+
+extern void fpacc_sum(fp_acc *acc, const double *x, size_t n);
+extern void fpacc_dot(fp_acc *acc, const double *x, const double *y,
+		      size_t n);
+extern void fpacc_sumsq(fp_acc *acc, const double *x, size_t n);
+
+/* fpacc_merge(acc, other)
+ *
+ * Add what has been added to other to acc, exactly.
+ */
+
+extern void fpacc_merge(fp_acc *acc, const fp_acc *other);
+
+/* fpacc_round(acc, rnd, raised) -> value of acc rounded
+ *
+ * Return what has been added to acc rounded once in direction rnd,
+ * and if raised is not NULL put in it the exceptions that adding
+ * exactly and rounding once raise, which are also added to the sticky
+ * bits: FP_X_DNML if any operand was denormalised, FP_X_INV for a
+ * signalling NaN or for infinities of both signs or times zero,
+ * FP_X_IMP, FP_X_OFL and FP_X_UFL from the rounding. A NaN operand
+ * gives a quiet NaN. An exact zero is +0, or -0 rounding down. FP_RS,
+ * or an invalid direction, is reported on stderr and the program
+ * aborted, as with fpsetround().
+ */
+
+extern double fpacc_round(const fp_acc *acc, fp_rnd rnd, fp_except *raised);
+
+/* fp_sum(x, n, raised) -> sum of x
+ * fp_dot(x, y, n, raised) -> dot product of x and y
+ * fp_nrm2(x, n, raised) -> 2-norm of x
+ *
+ * Do the whole of a reduction in one accumulator, rounding to
+ * nearest, and put the exceptions in *raised if it is not NULL, as
+ * fpacc_round() does. fp_nrm2() takes the square root of the sum of
+ * squares rounded (scaled by an even power of two, so it neither
+ * overflows nor underflows in between), so it is within an ulp of the
+ * true 2-norm. To use several threads, give each its own accumulator
+ * for part of the array and merge them: the result is the same
+ * however the array is split.
+ */
+
+extern double fp_sum(const double *x, size_t n, fp_except *raised);
+extern double fp_dot(const double *x, const double *y, size_t n,
+		     fp_except *raised);
+extern double fp_nrm2(const double *x, size_t n, fp_except *raised);
+
+#endif
@@ -0,0 +1,817 @@
+/*
+    CIieeefp: CIsoftfp.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains a software implementation of IEEE 754 binary
+   floating point arithmetic, used as a reference against which to
+   check the hardware and the rest of the library. It is written for
+   clarity rather than speed: every operation unpacks its operands into
+   a sign, an unbiased exponent and a 128-bit significand with its
+   leading bit at SIG_MSB, works out the exact result to at least two
+   bits more than the precision it is to be rounded to, with any bits
+   beyond that ORed into the least significant bit (the sticky bit),
+   and then rounds it with round_sig(). The arithmetic itself is
+   therefore the same for every format, which is described by a
+   SOFTFP_FORMAT.
+
+   Two units are emulated. The SSE unit operates on single or double
+   precision numbers directly. The x87 FPU is emulated as the sequence
+   fld a, fld b, f<op>, fstp: the loads convert the operands to double
+   extended (raising invalid for a signalling NaN and the denormal
+   operand exception for a denormal), the operation rounds to the
+   precision set by the precision control with the double extended
+   exponent range, and the store rounds again to the destination
+   format. Both units detect tininess after rounding. */
+
+#include <CIsoftfp.h>
+
+#define SIG_MSB 126		/* Leading bit of an unpacked significand,
+				   leaving room for a carry */
+
+typedef struct {
+  uint64_t hi, lo;
+} U128;
+
+typedef struct {
+  int frac_bits;		/* Bits in the fraction, not counting
+				   the leading bit */
+  int exp_bits;			/* Bits in the exponent */
+  int bias;			/* Exponent bias */
+} SOFTFP_FORMAT;
+
+static const SOFTFP_FORMAT binary32 = { 23, 8, 127 };
+static const SOFTFP_FORMAT binary64 = { 52, 11, 1023 };
+
+/* Double extended exponent range with the precision control setting,
+   indexed by fp_pctl (the reserved setting gives double extended) */
+
+static const SOFTFP_FORMAT x87_formats[4] = {
+  { 23, 15, 16383 }, { 63, 15, 16383 }, { 52, 15, 16383 },
+  { 63, 15, 16383 }
+};
+
+typedef enum { SF_ZERO, SF_FINITE, SF_INF, SF_QNAN, SF_SNAN } SF_KIND;
+
+typedef struct {
+  SF_KIND kind;
+  int sign;
+  int exp;			/* Unbiased exponent of the leading bit */
+  U128 sig;			/* Significand, leading bit at SIG_MSB;
+				   for a NaN, the fraction bits */
+  int denormal;			/* Whether the number was denormalised */
+} UNPACKED;
+
+/* Format helpers, for formats that fit in 64 bits */
+
+#define FRAC_MASK(f) ((UINT64_C(1) << (f)->frac_bits) - 1)
+#define EXP_MASK(f) ((UINT64_C(1) << (f)->exp_bits) - 1)
+#define SIGN_BIT(f) (UINT64_C(1) << ((f)->frac_bits + (f)->exp_bits))
+#define QUIET_BIT(f) (UINT64_C(1) << ((f)->frac_bits - 1))
+#define INF_BITS(f) (EXP_MASK(f) << (f)->frac_bits)
+#define DEFAULT_NAN(f) (SIGN_BIT(f) | INF_BITS(f) | QUIET_BIT(f))
+
+/* 128-bit arithmetic
+ *
+ * Shift counts may be anything from 0 to 127. shr_jam() ORs any bits
+ * shifted out into the least significant bit, and accepts any count.
+ */
+
+static U128 u128(uint64_t hi, uint64_t lo) {
+  U128 r;
+
+  r.hi = hi;
+  r.lo = lo;
+  return r;
+}
+
+static U128 shl(U128 a, int n) {
+  if(n == 0) return a;
+  if(n >= 64) return u128(a.lo << (n - 64), 0);
+  return u128((a.hi << n) | (a.lo >> (64 - n)), a.lo << n);
+}
+
+static U128 shr_jam(U128 a, int n) {
+  U128 r;
+  int lost;
+
+  if(n <= 0) return a;
+  if(n >= 128) return u128(0, (a.hi | a.lo) != 0);
+  if(n >= 64) {
+    lost = (a.lo != 0) || (n > 64 && (a.hi << (128 - n)) != 0);
+    r = u128(0, a.hi >> (n - 64));
+  }
+  else {
+    lost = (a.lo << (64 - n)) != 0;
+    r = u128(a.hi >> n, (a.lo >> n) | (a.hi << (64 - n)));
+  }
+  r.lo |= lost;
+  return r;
+}
+
+static U128 add128(U128 a, U128 b) {
+  U128 r = u128(a.hi + b.hi, a.lo + b.lo);
+
+  r.hi += r.lo < a.lo;
+  return r;
+}
+
+static U128 sub128(U128 a, U128 b) {
+  return u128(a.hi - b.hi - (a.lo < b.lo), a.lo - b.lo);
+}
+
+static int cmp128(U128 a, U128 b) {
+  if(a.hi != b.hi) return (a.hi < b.hi) ? -1 : 1;
+  if(a.lo != b.lo) return (a.lo < b.lo) ? -1 : 1;
+  return 0;
+}
+
+static int zero128(U128 a) {
+  return a.hi == 0 && a.lo == 0;
+}
+
+static int bit128(U128 a, int n) {
+  return (int)(((n >= 64) ? (a.hi >> (n - 64)) : (a.lo >> n)) & 1);
+}
+
+/* low128(a, n) -> the n least significant bits of a
+ */
+
+static U128 low128(U128 a, int n) {
+  if(n >= 64) {
+    return u128(n >= 128 ? a.hi : (a.hi & ((UINT64_C(1) << (n - 64)) - 1)),
+		a.lo);
+  }
+  return u128(0, a.lo & ((UINT64_C(1) << n) - 1));
+}
+
+/* msb128(a) -> position of the most significant bit set in a (a != 0)
+ */
+
+static int msb128(U128 a) {
+  uint64_t w = a.hi ? a.hi : a.lo;
+  int n = a.hi ? 64 : 0;
+
+  while(w >>= 1) n++;
+  return n;
+}
+
+/* mul64(a, b) -> 128-bit product
+ *
+ * Multiply using 32-bit halves so as not to need a 128-bit integer
+ * type.
+ */
+
+static U128 mul64(uint64_t a, uint64_t b) {
+  uint64_t a0 = a & 0xffffffffU, a1 = a >> 32;
+  uint64_t b0 = b & 0xffffffffU, b1 = b >> 32;
+  uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  uint64_t mid = (p00 >> 32) + (p01 & 0xffffffffU) + (p10 & 0xffffffffU);
+
+  return u128(p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32),
+	      (mid << 32) | (p00 & 0xffffffffU));
+}
+
+/* normalise(u)
+ *
+ * Shift the significand of a non-zero finite number so its leading bit
+ * is at SIG_MSB, adjusting the exponent to match.
+ */
+
+static void normalise(UNPACKED *u) {
+  int shift = SIG_MSB - msb128(u->sig);
+
+  u->sig = shl(u->sig, shift);
+  u->exp -= shift;
+}
+
+/* unpack(fmt, bits, u)
+ *
+ * Unpack a number of the given format into u, normalising denormals.
+ */
+
+static void unpack(const SOFTFP_FORMAT *fmt, uint64_t bits, UNPACKED *u) {
+  uint64_t exp = (bits >> fmt->frac_bits) & EXP_MASK(fmt);
+  uint64_t frac = bits & FRAC_MASK(fmt);
+
+  u->sign = (bits & SIGN_BIT(fmt)) != 0;
+  u->denormal = 0;
+  u->exp = 0;
+  u->sig = u128(0, frac);
+  if(exp == EXP_MASK(fmt)) {
+    u->kind = (frac == 0) ? SF_INF
+      : ((frac & QUIET_BIT(fmt)) ? SF_QNAN : SF_SNAN);
+  }
+  else if(exp == 0) {
+    u->kind = (frac == 0) ? SF_ZERO : SF_FINITE;
+    if(frac != 0) {
+      u->denormal = 1;
+      u->exp = 1 - fmt->bias + SIG_MSB - fmt->frac_bits;
+      normalise(u);
+    }
+  }
+  else {
+    u->kind = SF_FINITE;
+    u->exp = (int)exp - fmt->bias;
+    u->sig = shl(u128(0, frac | (UINT64_C(1) << fmt->frac_bits)),
+		 SIG_MSB - fmt->frac_bits);
+  }
+}
+
+/* round_sig(sig, shift, sign, rnd, exp, inexact) -> rounded significand
+ *
+ * Round sig to a multiple of 2^shift in direction rnd, incrementing
+ * *exp if the rounding carries out of the leading bit, and setting
+ * *inexact if any bits were lost.
+ */
+
+static U128 round_sig(U128 sig, int shift, int sign, fp_rnd rnd, int *exp,
+		      int *inexact) {
+  U128 rem = low128(sig, shift);
+  int up, cmp;
+
+  sig = sub128(sig, rem);
+  switch(rnd) {
+  case FP_RN:
+    cmp = cmp128(rem, shl(u128(0, 1), shift - 1));
+    up = cmp > 0 || (cmp == 0 && bit128(sig, shift));
+    break;
+  case FP_RM:
+    up = !zero128(rem) && sign;
+    break;
+  case FP_RP:
+    up = !zero128(rem) && !sign;
+    break;
+  default:
+    up = 0;
+  }
+  if(up) {
+    sig = add128(sig, shl(u128(0, 1), shift));
+    if(bit128(sig, SIG_MSB + 1)) {
+      sig = shr_jam(sig, 1);
+      (*exp)++;
+    }
+  }
+  (*inexact) = !zero128(rem);
+  return sig;
+}
+
+/* round_unpacked(fmt, u, rnd, flags)
+ *
+ * Round the finite number in u, which must be normalised, to the
+ * precision and exponent range of the format, raising inexact,
+ * underflow and overflow as appropriate. Tininess is detected after
+ * rounding: the result is tiny if, rounded to the full precision with
+ * an unbounded exponent, it would still be below the smallest normal
+ * number. As all exceptions are masked, underflow is only raised if a
+ * tiny result is also inexact. On overflow, u becomes infinity or the
+ * largest finite number, depending on the rounding direction. A result
+ * that rounds to zero is left with a zero significand.
+ */
+
+static void round_unpacked(const SOFTFP_FORMAT *fmt, UNPACKED *u,
+			   fp_rnd rnd, fp_except *flags) {
+  int shift = SIG_MSB - fmt->frac_bits;
+  int emin = 1 - fmt->bias;
+  int tiny = 0, inexact;
+
+  if(u->exp < emin) {
+    int rexp = u->exp;
+
+    round_sig(u->sig, shift, u->sign, rnd, &rexp, &inexact);
+    tiny = rexp < emin;
+    u->sig = shr_jam(u->sig, emin - u->exp);
+    u->exp = emin;
+  }
+  u->sig = round_sig(u->sig, shift, u->sign, rnd, &u->exp, &inexact);
+  if(inexact) {
+    (*flags) |= FP_X_IMP;
+    if(tiny) (*flags) |= FP_X_UFL;
+  }
+
+  if(u->exp > fmt->bias) {
+    (*flags) |= FP_X_OFL | FP_X_IMP;
+    if(rnd == FP_RZ || (rnd == FP_RM && !u->sign)
+       || (rnd == FP_RP && u->sign)) {
+      u->exp = fmt->bias;	/* Largest finite number */
+      u->sig = shl(shl(u128(0, 1), fmt->frac_bits + 1), shift);
+      u->sig = sub128(u->sig, shl(u128(0, 1), shift));
+    }
+    else {
+      u->kind = SF_INF;
+    }
+  }
+  else if(zero128(u->sig)) {
+    u->kind = SF_ZERO;
+  }
+}
+
+/* pack(fmt, u) -> bits
+ *
+ * Pack an unpacked number, which if finite must already be rounded to
+ * the format, or if a NaN has a fraction that fits.
+ */
+
+static uint64_t pack(const SOFTFP_FORMAT *fmt, const UNPACKED *u) {
+  uint64_t bits = u->sign ? SIGN_BIT(fmt) : 0;
+
+  switch(u->kind) {
+  case SF_ZERO:
+    return bits;
+  case SF_INF:
+    return bits | INF_BITS(fmt);
+  case SF_QNAN:
+  case SF_SNAN:
+    return bits | INF_BITS(fmt) | u->sig.lo;
+  default:
+    if(bit128(u->sig, SIG_MSB)) {
+      bits |= (uint64_t)(u->exp + fmt->bias) << fmt->frac_bits;
+    }
+    return bits | (shr_jam(u->sig, SIG_MSB - fmt->frac_bits).lo
+		   & FRAC_MASK(fmt));
+  }
+}
+
+/* round_pack(fmt, u, rnd, flags) -> bits
+ */
+
+static uint64_t round_pack(const SOFTFP_FORMAT *fmt, UNPACKED *u,
+			   fp_rnd rnd, fp_except *flags) {
+  if(u->kind == SF_FINITE) round_unpacked(fmt, u, rnd, flags);
+  return pack(fmt, u);
+}
+
+/* set_nan(fmt, u, bits)
+ * set_default_nan(fmt, u)
+ *
+ * Make u a quiet NaN with the fraction of bits, or the default NaN.
+ */
+
+static void set_nan(const SOFTFP_FORMAT *fmt, UNPACKED *u, uint64_t bits) {
+  u->kind = SF_QNAN;
+  u->sign = (bits & SIGN_BIT(fmt)) != 0;
+  u->sig = u128(0, (bits & FRAC_MASK(fmt)) | QUIET_BIT(fmt));
+}
+
+static void set_default_nan(const SOFTFP_FORMAT *fmt, UNPACKED *u) {
+  set_nan(fmt, u, DEFAULT_NAN(fmt));
+}
+
+/* The operations
+ *
+ * Each takes finite, zero or infinite operands (NaNs and the
+ * exceptions particular to each unit having been dealt with), leaves
+ * the exact result, or a default NaN, in *r, and raises invalid or
+ * division by zero. The result's significand is the exact result
+ * to at least SIG_MSB bits with a sticky bit, ready for rounding.
+ */
+
+typedef void (*OPERATION)(const SOFTFP_FORMAT *fmt, UNPACKED *ua,
+			  UNPACKED *ub, fp_rnd rnd, UNPACKED *r,
+			  fp_except *flags);
+
+/* op_add(fmt, ua, ub, rnd, r, flags)
+ *
+ * Add ub to ua. Subtraction negates ub first.
+ */
+
+static void op_add(const SOFTFP_FORMAT *fmt, UNPACKED *ua, UNPACKED *ub,
+		   fp_rnd rnd, UNPACKED *r, fp_except *flags) {
+  UNPACKED *t;
+  U128 sig;
+
+  r->denormal = 0;
+  if(ua->kind == SF_INF || ub->kind == SF_INF) {
+    if(ua->kind == SF_INF && ub->kind == SF_INF && ua->sign != ub->sign) {
+      (*flags) |= FP_X_INV;
+      set_default_nan(fmt, r);
+      return;
+    }
+    r->kind = SF_INF;
+    r->sign = (ua->kind == SF_INF) ? ua->sign : ub->sign;
+    return;
+  }
+  if(ua->kind == SF_ZERO && ub->kind == SF_ZERO) {
+    r->kind = SF_ZERO;
+    r->sign = (ua->sign == ub->sign) ? ua->sign : rnd == FP_RM;
+    return;
+  }
+  if(ub->kind == SF_ZERO) {
+    (*r) = (*ua);
+    return;
+  }
+  if(ua->kind == SF_ZERO) {
+    (*r) = (*ub);
+    return;
+  }
+
+  if(ua->exp < ub->exp) {
+    t = ua;
+    ua = ub;
+    ub = t;
+  }
+  r->kind = SF_FINITE;
+  r->exp = ua->exp;
+  sig = shr_jam(ub->sig, ua->exp - ub->exp);
+  if(ua->sign == ub->sign) {
+    r->sign = ua->sign;
+    r->sig = add128(ua->sig, sig);
+    if(bit128(r->sig, SIG_MSB + 1)) {
+      r->sig = shr_jam(r->sig, 1);
+      r->exp++;
+    }
+    return;
+  }
+  if(cmp128(ua->sig, sig) >= 0) {
+    r->sign = ua->sign;
+    r->sig = sub128(ua->sig, sig);
+  }
+  else {
+    r->sign = ub->sign;
+    r->sig = sub128(sig, ua->sig);
+  }
+  if(zero128(r->sig)) {
+    r->kind = SF_ZERO;
+    r->sign = rnd == FP_RM;
+    return;
+  }
+  normalise(r);
+}
+
+static void op_sub(const SOFTFP_FORMAT *fmt, UNPACKED *ua, UNPACKED *ub,
+		   fp_rnd rnd, UNPACKED *r, fp_except *flags) {
+  ub->sign = !ub->sign;
+  op_add(fmt, ua, ub, rnd, r, flags);
+}
+
+/* op_mul(fmt, ua, ub, rnd, r, flags)
+ *
+ * Multiply ua by ub. The operands have at most 64 significant bits,
+ * all in the high words of their significands, so their product is
+ * exact in 128 bits.
+ */
+
+static void op_mul(const SOFTFP_FORMAT *fmt, UNPACKED *ua, UNPACKED *ub,
+		   fp_rnd rnd, UNPACKED *r, fp_except *flags) {
+  (void)rnd;
+  r->denormal = 0;
+  r->sign = ua->sign ^ ub->sign;
+  if((ua->kind == SF_INF && ub->kind == SF_ZERO)
+     || (ua->kind == SF_ZERO && ub->kind == SF_INF)) {
+    (*flags) |= FP_X_INV;
+    set_default_nan(fmt, r);
+    return;
+  }
+  if(ua->kind == SF_INF || ub->kind == SF_INF) {
+    r->kind = SF_INF;
+    return;
+  }
+  if(ua->kind == SF_ZERO || ub->kind == SF_ZERO) {
+    r->kind = SF_ZERO;
+    return;
+  }
+  r->kind = SF_FINITE;
+  r->sig = mul64(ua->sig.hi, ub->sig.hi);
+  r->exp = ua->exp + ub->exp + 2 * (64 - SIG_MSB) + SIG_MSB;
+				/* Each high word is the significand
+				   over 2^64 */
+  normalise(r);
+}
+
+/* op_div(fmt, ua, ub, rnd, r, flags)
+ *
+ * Divide ua by ub, by long division one quotient bit at a time, with
+ * the remainder giving the sticky bit. As for op_mul(), only the high
+ * words of the significands are used. DIV_BITS quotient bits are
+ * enough for the widest format, a round bit and more to spare.
+ */
+
+#define DIV_BITS 72
+
+static void op_div(const SOFTFP_FORMAT *fmt, UNPACKED *ua, UNPACKED *ub,
+		   fp_rnd rnd, UNPACKED *r, fp_except *flags) {
+  uint64_t rem, div;
+  int i;
+
+  (void)rnd;
+  r->denormal = 0;
+  r->sign = ua->sign ^ ub->sign;
+  if((ua->kind == SF_INF && ub->kind == SF_INF)
+     || (ua->kind == SF_ZERO && ub->kind == SF_ZERO)) {
+    (*flags) |= FP_X_INV;
+    set_default_nan(fmt, r);
+    return;
+  }
+  if(ub->kind == SF_ZERO && ua->kind != SF_INF) {
+    (*flags) |= FP_X_DZ;
+    r->kind = SF_INF;
+    return;
+  }
+  if(ua->kind == SF_INF) {
+    r->kind = SF_INF;
+    return;
+  }
+  if(ub->kind == SF_INF || ua->kind == SF_ZERO) {
+    r->kind = SF_ZERO;
+    return;
+  }
+
+  r->kind = SF_FINITE;
+  r->exp = ua->exp - ub->exp;
+  r->sig = u128(0, 0);
+  rem = ua->sig.hi;
+  div = ub->sig.hi;
+  if(rem < div) {
+    rem <<= 1;
+    r->exp--;
+  }
+  for(i = SIG_MSB; i > SIG_MSB - DIV_BITS; i--) {
+    if(rem >= div) {
+      rem -= div;
+      if(i >= 64) r->sig.hi |= UINT64_C(1) << (i - 64);
+      else r->sig.lo |= UINT64_C(1) << i;
+    }
+    rem <<= 1;
+  }
+  r->sig.lo |= rem != 0;
+}
+
+/* op_sqrt(fmt, ua, ub, rnd, r, flags)
+ *
+ * Take the square root of ua (ub is ignored) one bit at a time, by
+ * the schoolbook method: each step brings down the next two bits of
+ * the radicand, and the remainder left at the end gives the sticky
+ * bit. The radicand is the high word of the significand, doubled if
+ * the exponent is odd, so the root has SQRT_BITS bits and the
+ * remainder stays below 2^(SQRT_BITS + 3).
+ */
+
+#define SQRT_BITS 68
+
+static void op_sqrt(const SOFTFP_FORMAT *fmt, UNPACKED *ua, UNPACKED *ub,
+		    fp_rnd rnd, UNPACKED *r, fp_except *flags) {
+  uint64_t rad;
+  U128 rem, root, trial;
+  int i, odd;
+
+  (void)ub;
+  (void)rnd;
+  r->denormal = 0;
+  r->sign = ua->sign;
+  r->kind = ua->kind;
+  if(ua->kind == SF_ZERO) return;
+  if(ua->sign) {
+    (*flags) |= FP_X_INV;
+    set_default_nan(fmt, r);
+    return;
+  }
+  if(ua->kind == SF_INF) return;
+
+  odd = ua->exp & 1;
+  rad = ua->sig.hi << odd;
+  rem = u128(0, 0);
+  root = u128(0, 0);
+  for(i = 0; i < SQRT_BITS; i++) {
+    int pos = 62 - (2 * i);
+
+    rem = shl(rem, 2);
+    if(pos >= 0) rem.lo |= (rad >> pos) & 3;
+    trial = add128(shl(root, 2), u128(0, 1));
+    root = shl(root, 1);
+    if(cmp128(rem, trial) >= 0) {
+      rem = sub128(rem, trial);
+      root.lo |= 1;
+    }
+  }
+  r->exp = (ua->exp - odd) / 2;
+  r->sig = shl(root, SIG_MSB - (SQRT_BITS - 1));
+  r->sig.lo |= !zero128(rem);
+}
+
+static const OPERATION operations[5] = {
+  op_add, op_sub, op_mul, op_div, op_sqrt
+};
+
+/* sse(fmt, op, a, b, rnd, flags) -> bits
+ *
+ * Do an operation as the SSE unit would. If either operand is a NaN
+ * the result is the first NaN operand made quiet, and invalid is
+ * raised if either is signalling. Otherwise the denormal operand
+ * exception is raised only if the operation uses the operand's value:
+ * the invalid operations left (the square root of a negative number)
+ * and division by zero are found from the operands' signs and kinds
+ * alone, so the square root of a negative denormalised number raises
+ * only FP_X_INV and one divided by zero only FP_X_DZ, as on the chip
+ * (which test_softfp checks).
+ */
+
+static uint64_t sse(const SOFTFP_FORMAT *fmt, softfp_op op, uint64_t a,
+		    uint64_t b, fp_rnd rnd, fp_except *flags) {
+  UNPACKED ua, ub, r;
+  fp_except x = 0;
+
+  unpack(fmt, a, &ua);
+  if(op == SOFTFP_SQRT) unpack(fmt, 0, &ub);
+  else unpack(fmt, b, &ub);
+  if(ua.kind >= SF_QNAN || ub.kind >= SF_QNAN) {
+    if(ua.kind == SF_SNAN || ub.kind == SF_SNAN) (*flags) |= FP_X_INV;
+    return ((ua.kind >= SF_QNAN) ? a : b) | QUIET_BIT(fmt);
+  }
+  operations[op](fmt, &ua, &ub, rnd, &r, &x);
+  if(!(x & (FP_X_INV | FP_X_DZ)) && (ua.denormal || ub.denormal)) {
+				/* The operand's value was used */
+    x |= FP_X_DNML;
+  }
+  (*flags) |= x;
+  return round_pack(fmt, &r, rnd, flags);
+}
+
+/* x87(fmt, op, a, b, rnd, pctl, flags) -> bits
+ *
+ * Do an operation as the x87 FPU would, loading the operands, doing
+ * the operation and storing the result in the given format. A
+ * signalling NaN is made quiet on loading, raising invalid; if either
+ * operand is then a NaN the result is the one with the larger
+ * fraction. The operation rounds to the precision control setting with
+ * the double extended exponent range, and the store rounds the result
+ * to the format.
+ */
+
+static uint64_t x87(const SOFTFP_FORMAT *fmt, softfp_op op, uint64_t a,
+		    uint64_t b, fp_rnd rnd, fp_pctl pctl, fp_except *flags) {
+  UNPACKED ua, ub, r;
+
+  unpack(fmt, a, &ua);
+  if(op == SOFTFP_SQRT) unpack(fmt, 0, &ub);
+  else unpack(fmt, b, &ub);
+  if(ua.kind == SF_SNAN || ub.kind == SF_SNAN) (*flags) |= FP_X_INV;
+  if(ua.denormal || ub.denormal) (*flags) |= FP_X_DNML;
+  a |= (ua.kind >= SF_QNAN) ? QUIET_BIT(fmt) : 0;
+  b |= (ub.kind >= SF_QNAN) ? QUIET_BIT(fmt) : 0;
+  if(ua.kind >= SF_QNAN || ub.kind >= SF_QNAN) {
+    if(ub.kind < SF_QNAN
+       || (ua.kind >= SF_QNAN
+	   && (a & FRAC_MASK(fmt)) >= (b & FRAC_MASK(fmt)))) {
+      return a;
+    }
+    return b;
+  }
+  operations[op](fmt, &ua, &ub, rnd, &r, flags);
+  if(r.kind == SF_FINITE) round_unpacked(&x87_formats[pctl & 3], &r, rnd,
+					 flags);
+  return round_pack(fmt, &r, rnd, flags);
+}
+
+/* Public interface */
+
+uint32_t softfp_add32(uint32_t a, uint32_t b, fp_rnd rnd, fp_except *flags) {
+  return (uint32_t)sse(&binary32, SOFTFP_ADD, a, b, rnd, flags);
+}
+
+uint32_t softfp_sub32(uint32_t a, uint32_t b, fp_rnd rnd, fp_except *flags) {
+  return (uint32_t)sse(&binary32, SOFTFP_SUB, a, b, rnd, flags);
+}
+
+uint32_t softfp_mul32(uint32_t a, uint32_t b, fp_rnd rnd, fp_except *flags) {
+  return (uint32_t)sse(&binary32, SOFTFP_MUL, a, b, rnd, flags);
+}
+
+uint32_t softfp_div32(uint32_t a, uint32_t b, fp_rnd rnd, fp_except *flags) {
+  return (uint32_t)sse(&binary32, SOFTFP_DIV, a, b, rnd, flags);
+}
+
+uint32_t softfp_sqrt32(uint32_t a, fp_rnd rnd, fp_except *flags) {
+  return (uint32_t)sse(&binary32, SOFTFP_SQRT, a, 0, rnd, flags);
+}
+
+uint64_t softfp_add64(uint64_t a, uint64_t b, fp_rnd rnd, fp_except *flags) {
+  return sse(&binary64, SOFTFP_ADD, a, b, rnd, flags);
+}
+
+uint64_t softfp_sub64(uint64_t a, uint64_t b, fp_rnd rnd, fp_except *flags) {
+  return sse(&binary64, SOFTFP_SUB, a, b, rnd, flags);
+}
+
+uint64_t softfp_mul64(uint64_t a, uint64_t b, fp_rnd rnd, fp_except *flags) {
+  return sse(&binary64, SOFTFP_MUL, a, b, rnd, flags);
+}
+
+uint64_t softfp_div64(uint64_t a, uint64_t b, fp_rnd rnd, fp_except *flags) {
+  return sse(&binary64, SOFTFP_DIV, a, b, rnd, flags);
+}
+
+uint64_t softfp_sqrt64(uint64_t a, fp_rnd rnd, fp_except *flags) {
+  return sse(&binary64, SOFTFP_SQRT, a, 0, rnd, flags);
+}
+
+/* softfp_x87_32(op, a, b, rnd, pctl, flags) -> bits
+ * softfp_x87_64(op, a, b, rnd, pctl, flags) -> bits
+ *
+ * Do an operation as the x87 FPU would with the given rounding
+ * direction and precision control, on single or double precision
+ * operands, storing a result of the same precision.
+ */
+
+uint32_t softfp_x87_32(softfp_op op, uint32_t a, uint32_t b, fp_rnd rnd,
+		       fp_pctl pctl, fp_except *flags) {
+  return (uint32_t)x87(&binary32, op, a, b, rnd, pctl, flags);
+}
+
+uint64_t softfp_x87_64(softfp_op op, uint64_t a, uint64_t b, fp_rnd rnd,
+		       fp_pctl pctl, fp_except *flags) {
+  return x87(&binary64, op, a, b, rnd, pctl, flags);
+}
+
+/* softfp_batch32(op, unit, rnd, pctl, a, b, n, result, flags)
+ * softfp_batch64(op, unit, rnd, pctl, a, b, n, result, flags)
+ *
+ * Do the operation on n pairs of operands a[i] and b[i] (b is not used
+ * for SOFTFP_SQRT, and may be NULL) as the given unit would, putting
+ * the results in result[i] and the exceptions each raises in
+ * flags[i]. pctl is only used for FP_UNIT_X87.
+ */
+
+void softfp_batch32(softfp_op op, fp_unit unit, fp_rnd rnd, fp_pctl pctl,
+		    const uint32_t *a, const uint32_t *b, size_t n,
+		    uint32_t *result, fp_except *flags) {
+  size_t i;
+
+  for(i = 0; i < n; i++) {
+    uint32_t bi = (op == SOFTFP_SQRT) ? 0 : b[i];
+
+    flags[i] = 0;
+    result[i] = (unit == FP_UNIT_X87)
+      ? (uint32_t)x87(&binary32, op, a[i], bi, rnd, pctl, &flags[i])
+      : (uint32_t)sse(&binary32, op, a[i], bi, rnd, &flags[i]);
+  }
+}
+
+void softfp_batch64(softfp_op op, fp_unit unit, fp_rnd rnd, fp_pctl pctl,
+		    const uint64_t *a, const uint64_t *b, size_t n,
+		    uint64_t *result, fp_except *flags) {
+  size_t i;
+
+  for(i = 0; i < n; i++) {
+    uint64_t bi = (op == SOFTFP_SQRT) ? 0 : b[i];
+
+    flags[i] = 0;
+    result[i] = (unit == FP_UNIT_X87)
+      ? x87(&binary64, op, a[i], bi, rnd, pctl, &flags[i])
+      : sse(&binary64, op, a[i], bi, rnd, &flags[i]);
+  }
+}
+
+/* softfp_class32(a) -> class of floating point number
+ * softfp_class64(a) -> class of floating point number
+ */
+
+static fpclass_t classify(const SOFTFP_FORMAT *fmt, uint64_t bits) {
+  UNPACKED u;
+
+  unpack(fmt, bits, &u);
+  switch(u.kind) {
+  case SF_SNAN:
+    return FP_SNAN;
+  case SF_QNAN:
+    return FP_QNAN;
+  case SF_INF:
+    return u.sign ? FP_NINF : FP_PINF;
+  case SF_ZERO:
+    return u.sign ? FP_NZERO : FP_PZERO;
+  default:
+    if(u.denormal) return u.sign ? FP_NDENORM : FP_PDENORM;
+    return u.sign ? FP_NNORM : FP_PNORM;
+  }
+}
+
+fpclass_t softfp_class32(uint32_t a) {
+  return classify(&binary32, a);
+}
+
+fpclass_t softfp_class64(uint64_t a) {
+  return classify(&binary64, a);
+}
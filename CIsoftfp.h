@@ -0,0 +1,106 @@
+/*
+    CIieeefp: CIsoftfp.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CIsoftfp.c, a
+   software implementation of IEEE 754 arithmetic that serves as a
+   reference for what the hardware should do. The functions have no
+   state, and can be called from any number of threads. */
+
+#ifndef CISOFTFP_H
+#define CISOFTFP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <CIieeefp.h>
+
+/* Operations, for softfp_x87_32(), softfp_x87_64() and the batch
+   functions */
+
+typedef enum { SOFTFP_ADD = 0, SOFTFP_SUB, SOFTFP_MUL, SOFTFP_DIV,
+	       SOFTFP_SQRT } softfp_op;
+
+/* Numbers are passed as their bit patterns: uint32_t for single
+   precision and uint64_t for double. Each function rounds in the
+   direction rnd, and ORs the exceptions it raises into *flags, as the
+   hardware would with all exceptions masked and flush-to-zero and
+   denormals-are-zeros off: tininess is detected after rounding and
+   FP_X_DNML is raised for a denormalised operand.
+
+   softfp_add32() to softfp_sqrt64() do as the SSE unit does: a NaN
+   result is the first NaN operand (quietened) or the default NaN.
+
+   softfp_x87_32() and softfp_x87_64() do as the x87 FPU does when it
+   loads the operands, does the operation with the precision control
+   set to pctl, and stores the result with the same precision as the
+   operands, so that the result may be rounded twice. */
+
+extern uint32_t softfp_add32(uint32_t a, uint32_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint32_t softfp_sub32(uint32_t a, uint32_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint32_t softfp_mul32(uint32_t a, uint32_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint32_t softfp_div32(uint32_t a, uint32_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint32_t softfp_sqrt32(uint32_t a, fp_rnd rnd, fp_except *flags);
+extern uint64_t softfp_add64(uint64_t a, uint64_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint64_t softfp_sub64(uint64_t a, uint64_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint64_t softfp_mul64(uint64_t a, uint64_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint64_t softfp_div64(uint64_t a, uint64_t b, fp_rnd rnd,
+			     fp_except *flags);
+extern uint64_t softfp_sqrt64(uint64_t a, fp_rnd rnd, fp_except *flags);
+extern uint32_t softfp_x87_32(softfp_op op, uint32_t a, uint32_t b,
+			      fp_rnd rnd, fp_pctl pctl, fp_except *flags);
+extern uint64_t softfp_x87_64(softfp_op op, uint64_t a, uint64_t b,
+			      fp_rnd rnd, fp_pctl pctl, fp_except *flags);
+
+/* Batches
+ *
+ * Do one operation on n operands (pairs of operands a[i] and b[i]
+ * except for SOFTFP_SQRT, where b may be NULL) as unit (FP_UNIT_SSE or
+ * FP_UNIT_X87 with precision control pctl) would, putting the result
+ * in result[i] and the exceptions raised in flags[i].
+ */
+
+extern void softfp_batch32(softfp_op op, fp_unit unit, fp_rnd rnd,
+			   fp_pctl pctl, const uint32_t *a, const uint32_t *b,
+			   size_t n, uint32_t *result, fp_except *flags);
+extern void softfp_batch64(softfp_op op, fp_unit unit, fp_rnd rnd,
+			   fp_pctl pctl, const uint64_t *a, const uint64_t *b,
+			   size_t n, uint64_t *result, fp_except *flags);
+
+/* Classification of bit patterns */
+
+extern fpclass_t softfp_class32(uint32_t a);
+extern fpclass_t softfp_class64(uint64_t a);
+
+#endif
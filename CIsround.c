@@ -0,0 +1,568 @@
+/*
+    CIieeefp: CIsround.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains the random streams used for stochastic rounding,
+   stochastic rounding of doubles given their errors, and conversions
+   from double to narrower formats. Each thread's stream is four
+   xoshiro256** generators (Blackman and Vigna), seeded through
+   splitmix64 as their authors recommend, run side by side in the
+   lanes of gcc's vector types, so that four random numbers cost about
+   what one does. The numbers are used four at a time, one for each
+   lane, in the order of the lanes.
+
+   The conversions work on the bit patterns: the significand of the
+   double is shifted down to the precision of the result, and the bits
+   shifted out decide whether to round up. Adding one to the pattern
+   of the result then carries into the exponent as it should, from the
+   largest denormalised number to the smallest normalised one and from
+   the largest finite number to infinity. For FP_RS, the top bits of a
+   random number are compared with the bits shifted out. There are no
+   branches, the special cases being worked out in every lane and
+   chosen with masks, so the loops use vector instructions throughout;
+   they are built for the default target and for AVX2, chosen at run
+   time as in CIblas.c, and inlined with the direction a constant so
+   that each direction has its own loop. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CIsround.h>
+#include "x87FPUutil.h"
+#include "x87FPUcmds.h"
+
+#if defined(__GNUC__) && __GNUC__ >= 5 && defined(__SSE2_MATH__) \
+  && (defined(__i386__) || defined(__x86_64__))
+#define CI_SIMD_KERNELS		/* Compiler can build AVX2 kernels
+				   chosen at run time */
+#endif
+
+#if defined(__GNUC__)
+#define SR_THREAD __thread	/* Thread-local storage class */
+#else
+#define SR_THREAD
+#endif
+
+#define SR_INLINE static __inline__ __attribute__((always_inline))
+
+#define SR_LANES 4		/* Generators per stream */
+#define SR_SIGN 0x8000000000000000ULL
+#define SR_MANT 0x000fffffffffffffULL
+#define SR_HIDDEN 0x0010000000000000ULL
+#define SR_ONE 0x3ff0000000000000ULL
+#define SR_INF 0x7ff0000000000000ULL
+
+typedef uint64_t SR_U __attribute__((vector_size(SR_LANES
+						 * sizeof(uint64_t))));
+typedef int64_t SR_M __attribute__((vector_size(SR_LANES
+						* sizeof(int64_t))));
+typedef double SR_V __attribute__((vector_size(SR_LANES
+					       * sizeof(double))));
+
+/* The same bits as 32-bit and 16-bit lanes, and the shuffles picking
+   out the bottom lane of each 64-bit one, which hold the results of
+   conversions */
+
+typedef uint32_t SR_W __attribute__((vector_size(SR_LANES
+						 * sizeof(uint64_t))));
+typedef uint16_t SR_H __attribute__((vector_size(SR_LANES
+						 * sizeof(uint64_t))));
+
+static const SR_W sr_words = { 0, 2, 4, 6, 0, 2, 4, 6 };
+static const SR_H sr_halves = {
+  0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12
+};
+
+/* The kernels: the conversions, fpsr_round() and fpsr_fill(), given
+   the state of the stream */
+
+typedef void (*SR_CONVERT)(const double *a, float *rf, uint16_t *r16,
+			   size_t n, fp_rnd rnd, SR_U *state);
+typedef void (*SR_ROUND)(const double *hi, const double *err, double *r,
+			 size_t n, SR_U *state);
+typedef void (*SR_FILL)(uint64_t *r, size_t n, SR_U *state);
+
+static SR_THREAD SR_U sr_state[4];
+static SR_THREAD int sr_seeded = 0;
+
+/* The helpers below take and give back vectors by pointer: passed by
+   value they are laid out differently with AVX enabled and without,
+   and being inlined it costs nothing */
+
+/* SR_ROTL(x, k) -> each lane of x rotated left k bits */
+
+#define SR_ROTL(x, k) (((x) << (k)) | ((x) >> (64 - (k))))
+
+/* sr_next(s, r)
+ *
+ * Put the next numbers from the generators with state s in r. The
+ * multiplications by 5 and 9 are written as shifts and adds, which
+ * vector units have for 64-bit lanes.
+ */
+
+SR_INLINE void sr_next(SR_U *s, SR_U *r) {
+  SR_U x = (s[1] << 2) + s[1], t = s[1] << 17;
+
+  x = SR_ROTL(x, 7);
+  *r = x + (x << 3);
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = SR_ROTL(s[3], 45);
+}
+
+SR_INLINE void sr_loadu(SR_U *v, const void *p) {
+  memcpy(v, p, sizeof(*v));
+}
+
+/* sr_up(bits, kept, rem, shift, sign, top, rnd)
+ *
+ * Add 1 to bits to round up the magnitude kept, or nothing not to,
+ * given the shift bits shifted out of it rem, the sign and, for FP_RS,
+ * random bits top of the same width as rem. Comparisons are made by
+ * adding and shifting out the carry, or taking the sign of a
+ * difference, since SSE2 has no comparisons of 64-bit integers: rem is
+ * over a half, or a half with kept odd, if adding a half less one and
+ * the bottom bit of kept carries out of it, and is not zero if adding
+ * all ones does.
+ */
+
+SR_INLINE void sr_up(SR_U *bits, const SR_U *kept, const SR_U *rem,
+		     const SR_U *shift, const SR_U *sign, const SR_U *top,
+		     fp_rnd rnd) {
+  const SR_U one = { 1U, 1U, 1U, 1U };
+
+  switch(rnd) {
+  case FP_RN:
+    *bits += (*rem + ((one << (*shift - one)) - one) + (*kept & one))
+      >> *shift;
+    break;
+  case FP_RM:
+    *bits += ((*rem + ((one << *shift) - one)) >> *shift) & *sign;
+    break;
+  case FP_RP:
+    *bits += ((*rem + ((one << *shift) - one)) >> *shift) & (*sign ^ one);
+    break;
+  case FP_RS:
+    *bits += (*top - *rem) >> 63;
+    break;
+  default:
+    break;
+  }
+}
+
+/* sr_convert(u, ebits, mbits, rnd, random)
+ *
+ * Convert the doubles with bit patterns u, in place, to those of a
+ * format with ebits bits of exponent and mbits of significand (not
+ * counting the hidden bit), rounding in direction rnd, with random used
+ * for FP_RS. When all the results are normalised numbers, as they
+ * nearly always are, the significands are shifted by the same number of
+ * bits; otherwise the shifts for denormalised results are worked out
+ * lane by lane, and infinities, NaNs and overflow chosen with masks. A
+ * shift of more than 63 bits, for results far below the smallest
+ * denormalised number, is cut down to 63, keeping a 1 at the bottom if
+ * any bits shifted out are set so that the number is still not a
+ * multiple of a half if it was not.
+ */
+
+SR_INLINE void sr_convert(SR_U *u, int ebits, int mbits, fp_rnd rnd,
+			  const SR_U *random) {
+  const int64_t emax = (1 << ebits) - 1;
+  const int fixed = 52 - mbits;	/* Shift for normalised results */
+  const SR_U one = { 1U, 1U, 1U, 1U };
+  SR_U sign = *u >> 63, m = *u & SR_MANT, ex = (*u >> 52) & 0x7ffU;
+  SR_U inf = (SR_U){ 0U } + ((uint64_t)emax << mbits);
+  SR_U kept, rem, bits, nan, big, extra, shift, out, top;
+  SR_M special, tiny, te;
+
+  te = (SR_M)ex - 1023 + (emax >> 1);
+  out = (SR_U)((te - 1) | (emax - 2 - (te - 1)));
+  if(((out[0] | out[1] | out[2] | out[3]) >> 63) == 0U) {
+    shift = (SR_U){ 0U } + (uint64_t)fixed;
+    m |= SR_HIDDEN;
+    kept = m >> fixed;
+    rem = m & ((1ULL << fixed) - 1);
+    bits = ((SR_U)(te - 1) << mbits) + kept;
+    top = *random >> (64 - fixed);
+    sr_up(&bits, &kept, &rem, &shift, &sign, &top, rnd);
+    *u = (sign << (ebits + mbits)) | bits;
+    return;
+  }
+
+  special = (SR_M)(ex == 0x7ffU);
+  tiny = (SR_M)(ex == 0U);
+  nan = inf | ((SR_U)(m != 0U)
+	       & ((1ULL << (mbits - 1)) | (m >> (52 - mbits))));
+  ex |= (SR_U)tiny & one;	/* Denormalised: no hidden bit */
+  m |= (SR_U)~tiny & SR_HIDDEN;
+  te = (SR_M)ex - 1023 + (emax >> 1);
+  shift = (SR_U)(fixed + ((te < 1) & (1 - te)));
+  extra = (SR_U)((SR_M)(shift > 63U) & (SR_M)(shift - 63U));
+  extra = (SR_U)((SR_M)(extra > 63U) & 63) | ((SR_U)(extra <= 63U) & extra);
+  m = (m >> extra) | ((SR_U)((m & ((one << extra) - one)) != 0U) & one);
+  shift = (SR_U)((SR_M)(shift > 63U) & 63) | ((SR_U)(shift <= 63U) & shift);
+  kept = m >> shift;
+  rem = m & ((one << shift) - one);
+  bits = ((SR_U)((SR_M)(te >= 1) & ((te - 1) << mbits))) + kept;
+  top = *random >> (64U - shift);
+  sr_up(&bits, &kept, &rem, &shift, &sign, &top, rnd);
+  switch(rnd) {			/* Overflow */
+  case FP_RM:
+    big = inf - (one ^ sign);
+    break;
+  case FP_RP:
+    big = inf - sign;
+    break;
+  case FP_RZ:
+    big = inf - one;
+    break;
+  default:
+    big = inf;
+    break;
+  }
+  bits = ((SR_U)(te >= emax) & big) | ((SR_U)(te < emax) & bits);
+  bits = ((SR_U)special & nan) | ((SR_U)~special & bits);
+  *u = (sign << (ebits + mbits)) | bits;
+}
+
+/* sr_convert_loop(a, rf, r16, n, ebits, mbits, rnd, state)
+ *
+ * Convert the n elements of a, putting the results in rf if it is not
+ * NULL and r16 otherwise. The last part vector is filled out with
+ * zeros. The state is only used, and the stream moved on, for FP_RS.
+ */
+
+SR_INLINE void sr_convert_loop(const double *a, float *rf, uint16_t *r16,
+			       size_t n, int ebits, int mbits, fp_rnd rnd,
+			       SR_U *state) {
+  SR_U s[4], x, random = { 0U };
+  double part[SR_LANES];
+  SR_W w;
+  SR_H h;
+  uint32_t y;
+  size_t i, j;
+
+  if(rnd == FP_RS) memcpy(s, state, sizeof(s));
+  for(i = 0; i < n; i += SR_LANES) {
+    if(n - i < SR_LANES) {
+      memset(part, 0, sizeof(part));
+      memcpy(part, a + i, (n - i) * sizeof(double));
+      sr_loadu(&x, part);
+    }
+    else sr_loadu(&x, a + i);
+    if(rnd == FP_RS) sr_next(s, &random);
+    sr_convert(&x, ebits, mbits, rnd, &random);
+    if(n - i >= SR_LANES && rf != NULL) {
+      w = __builtin_shuffle((SR_W)x, sr_words);
+      memcpy(rf + i, &w, SR_LANES * sizeof(float));
+    }
+    else if(n - i >= SR_LANES) {
+      h = __builtin_shuffle((SR_H)x, sr_halves);
+      memcpy(r16 + i, &h, SR_LANES * sizeof(uint16_t));
+    }
+    else {
+      for(j = 0; i + j < n; j++) {
+	y = (uint32_t)x[j];
+	if(rf != NULL) memcpy(&rf[i + j], &y, sizeof(y));
+	else r16[i + j] = (uint16_t)y;
+      }
+    }
+  }
+  if(rnd == FP_RS) memcpy(state, s, sizeof(s));
+}
+
+/* sr_convert_format(a, rf, r16, n, ebits, mbits, rnd, state)
+ *
+ * Convert with the loop for direction rnd.
+ */
+
+SR_INLINE void sr_convert_format(const double *a, float *rf, uint16_t *r16,
+				 size_t n, int ebits, int mbits, fp_rnd rnd,
+				 SR_U *state) {
+  switch(rnd) {
+  case FP_RN:
+    sr_convert_loop(a, rf, r16, n, ebits, mbits, FP_RN, state);
+    break;
+  case FP_RM:
+    sr_convert_loop(a, rf, r16, n, ebits, mbits, FP_RM, state);
+    break;
+  case FP_RP:
+    sr_convert_loop(a, rf, r16, n, ebits, mbits, FP_RP, state);
+    break;
+  case FP_RS:
+    sr_convert_loop(a, rf, r16, n, ebits, mbits, FP_RS, state);
+    break;
+  default:
+    sr_convert_loop(a, rf, r16, n, ebits, mbits, FP_RZ, state);
+    break;
+  }
+}
+
+/* sr_round(r, hi, err, random)
+ *
+ * Put hi + err rounded stochastically in r: the number next to hi on
+ * the side of err with probability |err| divided by the gap between
+ * them, and hi otherwise, hi and err being given as bit patterns. A
+ * zero hi is given the sign of err, so that the next number is always
+ * the one on the same side as err (further from zero) if their signs
+ * agree, and the one nearer zero otherwise. The top 52 bits of random
+ * are made into a number in [0, 1) by putting them under the exponent
+ * of 1, and magnitudes are compared as integers, which orders them as
+ * numbers: as above, SSE2 has no 64-bit integer comparisons, and gcc
+ * makes comparisons of these doubles into a scalar one per lane. An
+ * infinite or NaN hi, or a NaN err, keeps hi.
+ */
+
+SR_INLINE void sr_round(SR_V *r, const SR_U *hi, const SR_U *err,
+		       const SR_U *random) {
+  const SR_U one = { 1U, 1U, 1U, 1U };
+  SR_U u = *hi, e = *err, mag = u & ~SR_SIGN;
+  SR_U emag = e & ~SR_SIGN, zero, ok, take;
+  SR_V next, fraction;
+
+  zero = (SR_U){ 0U } - ((mag - one) >> 63);
+  u = (u & ~(zero & SR_SIGN)) | (e & zero & SR_SIGN);
+  next = (SR_V)(u + one - (((u ^ e) >> 63) << 1));
+  fraction = (SR_V)((*random >> 12) | SR_ONE) - 1.0;
+  fraction *= next - (SR_V)u;
+  ok = ((mag - SR_INF) >> 63) & ((emag - SR_INF - one) >> 63);
+  take = (((SR_U)fraction & ~SR_SIGN) - emag) >> 63;
+  take = (SR_U){ 0U } - (take & ok);
+  *r = (SR_V)((take & (SR_U)next) | (~take & *hi));
+}
+
+/* sr_round_loop(hi, err, r, n, state)
+ *
+ * Put hi[i] + err[i] rounded stochastically in r[i] for each of the n
+ * elements. The last part vector is filled out with zeros.
+ */
+
+SR_INLINE void sr_round_loop(const double *hi, const double *err, double *r,
+			     size_t n, SR_U *state) {
+  double part_hi[SR_LANES], part_err[SR_LANES];
+  SR_U s[4], h, e, random;
+  SR_V x;
+  size_t i;
+
+  memcpy(s, state, sizeof(s));
+  for(i = 0; i + SR_LANES <= n; i += SR_LANES) {
+    sr_loadu(&h, hi + i);
+    sr_loadu(&e, err + i);
+    sr_next(s, &random);
+    sr_round(&x, &h, &e, &random);
+    memcpy(r + i, &x, sizeof(x));
+  }
+  if(i < n) {
+    memset(part_hi, 0, sizeof(part_hi));
+    memset(part_err, 0, sizeof(part_err));
+    memcpy(part_hi, hi + i, (n - i) * sizeof(double));
+    memcpy(part_err, err + i, (n - i) * sizeof(double));
+    sr_loadu(&h, part_hi);
+    sr_loadu(&e, part_err);
+    sr_next(s, &random);
+    sr_round(&x, &h, &e, &random);
+    memcpy(r + i, &x, (n - i) * sizeof(double));
+  }
+  memcpy(state, s, sizeof(s));
+}
+
+/* sr_fill_loop(r, n, state)
+ *
+ * Put the next n numbers from the stream in r.
+ */
+
+SR_INLINE void sr_fill_loop(uint64_t *r, size_t n, SR_U *state) {
+  SR_U s[4], x;
+  size_t i;
+
+  memcpy(s, state, sizeof(s));
+  for(i = 0; i + SR_LANES <= n; i += SR_LANES) {
+    sr_next(s, &x);
+    memcpy(r + i, &x, sizeof(x));
+  }
+  if(i < n) {
+    sr_next(s, &x);
+    memcpy(r + i, &x, (n - i) * sizeof(uint64_t));
+  }
+  memcpy(state, s, sizeof(s));
+}
+
+/* sr_convert_SUFFIX(...), sr_round_SUFFIX(...), sr_fill_SUFFIX(...)
+ *
+ * The kernels built for the default target and for AVX2.
+ */
+
+#define SR_KERNELS(suffix) \
+  static void sr_float_##suffix(const double *a, float *rf, uint16_t *r16, \
+				size_t n, fp_rnd rnd, SR_U *state) { \
+    sr_convert_format(a, rf, r16, n, 8, 23, rnd, state); \
+  } \
+  static void sr_half_##suffix(const double *a, float *rf, uint16_t *r16, \
+			       size_t n, fp_rnd rnd, SR_U *state) { \
+    sr_convert_format(a, rf, r16, n, 5, 10, rnd, state); \
+  } \
+  static void sr_bf16_##suffix(const double *a, float *rf, uint16_t *r16, \
+			       size_t n, fp_rnd rnd, SR_U *state) { \
+    sr_convert_format(a, rf, r16, n, 8, 7, rnd, state); \
+  } \
+  static void sr_round_##suffix(const double *hi, const double *err, \
+				double *r, size_t n, SR_U *state) { \
+    sr_round_loop(hi, err, r, n, state); \
+  } \
+  static void sr_fill_##suffix(uint64_t *r, size_t n, SR_U *state) { \
+    sr_fill_loop(r, n, state); \
+  } \
+  static const SR_CONVERT sr_convert_##suffix[3] = { \
+    sr_float_##suffix, sr_half_##suffix, sr_bf16_##suffix \
+  };
+
+SR_KERNELS(vec)
+
+#ifdef CI_SIMD_KERNELS
+#pragma GCC push_options
+#pragma GCC target("avx2")
+SR_KERNELS(avx2)
+#pragma GCC pop_options
+
+#define SR_KERNEL(name) \
+  (__builtin_cpu_supports("avx2") ? name##_avx2 : name##_vec)
+#else
+#define SR_KERNEL(name) name##_vec
+#endif
+
+#define SR_FLOAT 0		/* Formats, indexing sr_convert_SUFFIX */
+#define SR_HALF 1
+#define SR_BF16 2
+
+static const char *const sr_names[3] = { "float", "half", "bf16" };
+
+/* sr_state_get() -> the calling thread's state, seeded if need be */
+
+static SR_U *sr_state_get(void) {
+  if(!sr_seeded) fpsr_seed(0);
+  return sr_state;
+}
+
+/* fpsr_seed(seed)
+ *
+ * See CIsround.h. The 16 words of state are the first 16 numbers from
+ * splitmix64 started at seed, lane by lane.
+ */
+
+void fpsr_seed(uint64_t seed) {
+  uint64_t z;
+  int i, j;
+
+  for(i = 0; i < 4; i++) {
+    for(j = 0; j < SR_LANES; j++) {
+      z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      sr_state[i][j] = z ^ (z >> 31);
+    }
+  }
+  sr_seeded = 1;
+}
+
+/* fpsr_fill(r, n)
+ *
+ * See CIsround.h.
+ */
+
+void fpsr_fill(uint64_t *r, size_t n) {
+  SR_U *state = sr_state_get();
+
+  SR_KERNEL(sr_fill)(r, n, state);
+}
+
+/* fpsr_round(hi, err, r, n)
+ *
+ * See CIsround.h. The exceptions the arithmetic might raise, for
+ * infinities and results near the bottom of the denormalised numbers,
+ * are masked and the flags put back afterwards.
+ */
+
+void fpsr_round(const double *hi, const double *err, double *r, size_t n) {
+  SR_U *state = sr_state_get();
+#ifdef CI_SIMD_KERNELS
+  SSE_mxcsr mxcsr = SSE_stmxcsr();
+
+  SSE_ldmxcsr(mxcsr | MX_XM);
+  SR_KERNEL(sr_round)(hi, err, r, n, state);
+  SSE_ldmxcsr(mxcsr);
+#else
+  fp_except before, mask;
+
+  mask = fpsetmask(0U);
+  before = fpgetsticky();
+  SR_KERNEL(sr_round)(hi, err, r, n, state);
+  fpsetsticky(before);
+  fpsetmask(mask);
+#endif
+}
+
+/* sr_convert_array(format, a, rf, r16, n, rnd)
+ *
+ * Do the work of the fp_to_ functions. An invalid direction aborts the
+ * program, as in fpsetround().
+ */
+
+static void sr_convert_array(int format, const double *a, float *rf,
+			     uint16_t *r16, size_t n, fp_rnd rnd) {
+  SR_U *state;
+
+  if(rnd > FP_RS) {
+    fprintf(stderr, "fp_to_%s_rnd called with invalid rounding direction: "
+	    "%hx\n", sr_names[format], rnd);
+    abort();
+  }
+  state = rnd == FP_RS ? sr_state_get() : NULL;
+  SR_KERNEL(sr_convert)[format](a, rf, r16, n, rnd, state);
+}
+
+/* fp_to_float_rnd(a, r, n, rnd)
+ * fp_to_half_rnd(a, r, n, rnd)
+ * fp_to_bf16_rnd(a, r, n, rnd)
+ *
+ * See CIsround.h.
+ */
+
+void fp_to_float_rnd(const double *a, float *r, size_t n, fp_rnd rnd) {
+  sr_convert_array(SR_FLOAT, a, r, NULL, n, rnd);
+}
+
+void fp_to_half_rnd(const double *a, uint16_t *r, size_t n, fp_rnd rnd) {
+  sr_convert_array(SR_HALF, a, NULL, r, n, rnd);
+}
+
+void fp_to_bf16_rnd(const double *a, uint16_t *r, size_t n, fp_rnd rnd) {
+  sr_convert_array(SR_BF16, a, NULL, r, n, rnd);
+}
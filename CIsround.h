@@ -0,0 +1,110 @@
+/*
+    CIieeefp: CIsround.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+/* This file contains declarations for the functions in CIsround.c,
+   which give each thread a stream of random numbers for stochastic
+   rounding, and convert arrays of doubles to float, half precision and
+   bfloat16 rounding in any direction, FP_RS included. */
+
+#ifndef CISROUND_H
+#define CISROUND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <CIieeefp.h>
+
+/* Stochastic rounding
+ *
+ * FP_RS rounds a result that cannot be represented exactly to one of
+ * the two numbers either side of it, choosing each with probability
+ * in proportion to how close it is, so that on average the rounding
+ * error is zero and long sums do not drift the way they do rounding
+ * to nearest. The hardware cannot do it, so fpsetround() does not
+ * take FP_RS; fp_add_rnd() and the rest in CIbatch.h and the
+ * conversions here do.
+ *
+ * The random numbers come from a stream for each thread, made up of
+ * four xoshiro256** generators taken in turn, which starts as if
+ * fpsr_seed(0) had been called. Numbers are used four at a time, so a
+ * call using n of them moves the stream on by n rounded up to a
+ * multiple of 4. The same seed gives the same rounding for the same
+ * calls in the same order, so threads working on different data
+ * should each be given their own seed.
+ */
+
+/* fpsr_seed(seed)
+ *
+ * Start the calling thread's stream from seed.
+ */
+
+extern void fpsr_seed(uint64_t seed);
+
+/* fpsr_fill(r, n)
+ *
+ * Put the next n 64-bit numbers from the calling thread's stream in
+ * r.
+ */
+
+extern void fpsr_fill(uint64_t *r, size_t n);
+
+/* fpsr_round(hi, err, r, n)
+ *
+ * Put hi[i] + err[i] rounded stochastically to a double in r[i] for
+ * each of the n elements, where hi[i] is the sum rounded to nearest
+ * and err[i] the rest of it, as given by the error-free
+ * transformations in CIdd.h: the number next to hi[i] on the side of
+ * err[i] is chosen with probability |err[i]| divided by the gap
+ * between them. Infinities and NaNs in hi are left alone. No
+ * exceptions are raised.
+ */
+
+extern void fpsr_round(const double *hi, const double *err, double *r,
+		       size_t n);
+
+/* fp_to_float_rnd(a, r, n, rnd)
+ * fp_to_half_rnd(a, r, n, rnd)
+ * fp_to_bf16_rnd(a, r, n, rnd)
+ *
+ * Convert each of the n elements of a to float, IEEE half precision
+ * or bfloat16 (the last two as their bit patterns), rounding in
+ * direction rnd, which may be FP_RS. A number too big for the format
+ * becomes infinity, or the largest finite number if rnd rounds it
+ * towards zero, and NaNs stay NaNs, made quiet. The conversion is done
+ * with integer arithmetic, so raises no exceptions and takes no notice
+ * of the rounding direction, flush-to-zero or denormals-are-zeros. An
+ * invalid direction aborts the program.
+ */
+
+extern void fp_to_float_rnd(const double *a, float *r, size_t n,
+			    fp_rnd rnd);
+extern void fp_to_half_rnd(const double *a, uint16_t *r, size_t n,
+			   fp_rnd rnd);
+extern void fp_to_bf16_rnd(const double *a, uint16_t *r, size_t n,
+			   fp_rnd rnd);
+
+#endif
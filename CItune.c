@@ -0,0 +1,245 @@
+/*
+    CIieeefp: CItune.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains a harness for deciding which precision a kernel
+   needs. The kernel is run in each variant it provides, the x87 ones
+   with the precision control set by fpsetprecision(), and timed on
+   the monotonic clock, keeping the shortest of several runs so that
+   the first run's page faults and cache misses, and interruptions by
+   other processes, do not count. The results of each variant are then
+   compared with those of the highest precision variant, element by
+   element, in units in the last place of a double and as a relative
+   error. The differences in units in the last place are found from
+   the representations of the two doubles, mapped to integers that
+   are in the same order as the doubles, so that they are exact
+   however far apart the two are. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <CItune.h>
+
+static const char *tune_names[FP_TUNE_VARIANTS] = {
+  "x87 extended", "x87 double", "SSE double", "x87 single", "SSE float"
+};
+
+static const fp_pctl tune_pctl[FP_TUNE_VARIANTS] = {
+  FP_PC_EXT, FP_PC_DBL, FP_PC_RES, FP_PC_SGL, FP_PC_RES
+};				/* Precision control for each variant,
+				   FP_PC_RES if it is to be left alone */
+
+/* tune_now() -> seconds
+ *
+ * Return a monotonic time in seconds.
+ */
+
+static double tune_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+/* tune_order(x) -> integer in the same order as x
+ *
+ * Map the representation of x to an integer such that the integers
+ * for two doubles are in the same order as them and differ by the
+ * number of doubles between them, both zeros mapping to 0.
+ */
+
+static int64_t tune_order(double x) {
+  int64_t i;
+
+  memcpy(&i, &x, sizeof(i));
+  return i < 0 ? INT64_MIN - i : i;
+}
+
+/* tune_run(kernel, arg, variant, out, n, reps, result) -> 0, or -1
+ *
+ * Run kernel in variant reps times, putting its results in out and
+ * its shortest time in result, or return -1 if it does not provide
+ * the variant.
+ */
+
+static int tune_run(fp_tune_kernel kernel, void *arg,
+		    fp_tune_variant variant, double *out, size_t n,
+		    unsigned reps, fp_tune_result *result) {
+  fp_pctl pctl = tune_pctl[variant];
+  fp_pctl old = FP_PC_RES;
+  unsigned i;
+  int ret = 0;
+
+  memset(result, 0, sizeof(*result));
+  if(pctl != FP_PC_RES) old = fpsetprecision(pctl);
+  for(i = 0; i < reps || i == 0; i++) {
+    double start = tune_now();
+    double seconds;
+
+    if(kernel(variant, arg, out, n) != 0) {
+      ret = -1;
+      break;
+    }
+    seconds = tune_now() - start;
+    if(i == 0 || seconds < result->seconds) result->seconds = seconds;
+  }
+  if(pctl != FP_PC_RES) fpsetprecision(old);
+  result->run = (ret == 0);
+  return ret;
+}
+
+/* tune_compare(ref, out, n, result)
+ *
+ * Fill in the errors in result of the n results out against the
+ * reference's, ref.
+ */
+
+static void tune_compare(const double *ref, const double *out, size_t n,
+			 fp_tune_result *result) {
+  double sum = 0.0;
+  size_t i, finite = 0;
+
+  for(i = 0; i < n; i++) {
+    int64_t a, b;
+    double ulps, rel;
+
+    if(!isfinite(ref[i]) || !isfinite(out[i])) {
+      if(!(isnan(ref[i]) && isnan(out[i])) && ref[i] != out[i]) {
+	result->bad++;
+      }
+      continue;
+    }
+    a = tune_order(ref[i]);
+    b = tune_order(out[i]);
+    ulps = (double)(a > b ? (uint64_t)a - (uint64_t)b
+		    : (uint64_t)b - (uint64_t)a);
+    if(ref[i] != 0.0) rel = fabs(out[i] - ref[i]) / fabs(ref[i]);
+    else rel = out[i] == 0.0 ? 0.0 : HUGE_VAL;
+    if(ulps > result->max_ulps) result->max_ulps = ulps;
+    if(rel > result->max_rel) result->max_rel = rel;
+    sum += rel;
+    finite++;
+  }
+  result->mean_rel = finite > 0 ? sum / (double)finite : 0.0;
+}
+
+/* fptune(kernel, arg, n, reps, results) -> reference variant, or -1
+ *
+ * See CItune.h. The comparisons are done at extended precision, so
+ * that they are not affected by the precision the kernel was run in
+ * when the arithmetic is done on the x87 FPU.
+ */
+
+int fptune(fp_tune_kernel kernel, void *arg, size_t n, unsigned reps,
+	   fp_tune_result *results) {
+  fp_env env;
+  double *ref, *out;
+  int v, reference = -1;
+
+  memset(results, 0, FP_TUNE_VARIANTS * sizeof(fp_tune_result));
+  ref = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+  out = (double *)malloc((n > 0 ? n : 1) * sizeof(double));
+  if(ref == NULL || out == NULL) {
+    free(ref);
+    free(out);
+    return -1;
+  }
+
+  fpgetenv(&env);
+  for(v = 0; v < FP_TUNE_VARIANTS; v++) {
+    if(tune_run(kernel, arg, (fp_tune_variant)v, reference < 0 ? ref : out,
+		n, reps, &results[v]) != 0) {
+      continue;
+    }
+    if(reference < 0) {
+      reference = v;
+      continue;
+    }
+    fpsetprecision(FP_PC_EXT);
+    tune_compare(ref, out, n, &results[v]);
+    fpsetenv(&env);
+  }
+  fpsetenv(&env);
+
+  free(ref);
+  free(out);
+  return reference;
+}
+
+/* fptune_recommend(results, tolerance) -> variant, or -1
+ *
+ * See CItune.h.
+ */
+
+int fptune_recommend(const fp_tune_result *results, double tolerance) {
+  int v, best = -1;
+
+  for(v = 0; v < FP_TUNE_VARIANTS; v++) {
+    if(!results[v].run || results[v].bad > 0
+       || !(results[v].max_rel <= tolerance)) {
+      continue;
+    }
+    if(best < 0 || results[v].seconds < results[best].seconds) best = v;
+  }
+  return best;
+}
+
+/* print_fp_tune(results, tolerance)
+ *
+ * See CItune.h. The speed of each variant is given as the reference's
+ * time divided by its own.
+ */
+
+void print_fp_tune(const fp_tune_result *results, double tolerance) {
+  int v, reference = -1;
+  int best = fptune_recommend(results, tolerance);
+
+  printf("%-13s %11s %8s %11s %11s %11s %8s\n", "Variant", "Seconds",
+	 "Speed", "Max ULPs", "Max rel", "Mean rel", "Bad");
+  for(v = 0; v < FP_TUNE_VARIANTS; v++) {
+    if(!results[v].run) continue;
+    if(reference < 0) reference = v;
+    printf("%-13s %11.4e %7.2fx %11.4g %11.4e %11.4e %8lu%s\n",
+	   tune_names[v], results[v].seconds,
+	   results[v].seconds > 0.0
+	   ? results[reference].seconds / results[v].seconds : 1.0,
+	   results[v].max_ulps, results[v].max_rel, results[v].mean_rel,
+	   (unsigned long)results[v].bad, v == best ? " *" : "");
+  }
+  if(best < 0) {
+    printf("No variants were run\n");
+  }
+  else {
+    printf("Recommended for relative errors up to %g: %s\n", tolerance,
+	   tune_names[best]);
+  }
+  fflush(stdout);
+}
@@ -0,0 +1,115 @@
+/*
+    CIieeefp: CItune.h
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This file contains declarations for the functions in CItune.c, which
+   run a kernel at each precision it can be done in, timing it and
+   comparing its results with those at the highest, to help decide
+   which precision it needs. */
+
+#ifndef CITUNE_H
+#define CITUNE_H
+
+#include <stddef.h>
+#include <CIieeefp.h>
+
+/* Variants
+ *
+ * The precisions a kernel may be run in, highest first. The x87
+ * variants are run with the precision control of the x87 FPU set by
+ * fpsetprecision() to FP_PC_EXT, FP_PC_DBL and FP_PC_SGL, and should
+ * do their arithmetic on the x87 FPU: in long double on x86-64, where
+ * double and float arithmetic is done on the SSE unit, or in double
+ * when the program is compiled with -mfpmath=387. The SSE variants are
+ * run with the precision control as it was, and should do their
+ * arithmetic in double and float on the SSE unit.
+ */
+
+typedef enum { FP_TUNE_X87_EXT = 0, FP_TUNE_X87_DBL, FP_TUNE_SSE_DBL,
+	       FP_TUNE_X87_SGL, FP_TUNE_SSE_FLT,
+	       FP_TUNE_VARIANTS } fp_tune_variant;
+
+/* kernel(variant, arg, out, n) -> 0, or -1 if the variant is not
+ * provided
+ *
+ * A kernel is run with the argument given to fptune(), and should work
+ * out its n results in the precision of variant and put them in out
+ * as doubles, giving the same results each time it is run. It may
+ * return -1 without doing anything if it has no code for the variant,
+ * for example if it has no float version.
+ */
+
+typedef int (*fp_tune_kernel)(fp_tune_variant variant, void *arg,
+			      double *out, size_t n);
+
+typedef struct {
+  int run;			/* Whether the kernel provided the
+				   variant */
+  double seconds;		/* Shortest wall time it took */
+  double max_ulps;		/* Largest difference from the
+				   reference in units in the last place
+				   of a double */
+  double max_rel;		/* Largest relative error */
+  double mean_rel;		/* Mean relative error */
+  size_t bad;			/* Results that are NaN or infinite
+				   where the reference's are not, or
+				   differ from it where it is */
+} fp_tune_result;
+
+/* fptune(kernel, arg, n, reps, results) -> variant used as the
+ * reference, or -1
+ *
+ * Run kernel reps times (at least once) in each variant, filling in
+ * results[variant] for each with the shortest time it took and how far
+ * its results were from those of the reference, the highest precision
+ * variant the kernel provided. The relative error of a result is its
+ * difference from the reference's divided by the magnitude of the
+ * reference's, and is infinite if the reference's is zero and it is
+ * not; only results that are finite in both count towards the errors.
+ * The floating point environment is put back as it was, so the
+ * exceptions raised by the kernel are not kept. Return -1 if the
+ * kernel provided no variant or there was no memory for the results.
+ *
+ * fptune_recommend(results, tolerance) -> variant, or -1
+ *
+ * Return the fastest variant run whose results had no bad values and
+ * relative errors of no more than tolerance, or -1 if none was run.
+ *
+ * print_fp_tune(results, tolerance)
+ *
+ * Print a table of the variants run, with their times, speed relative
+ * to the reference and errors, marking the one fptune_recommend()
+ * picks for the tolerance given.
+ */
+
+extern int fptune(fp_tune_kernel kernel, void *arg, size_t n, unsigned reps,
+		  fp_tune_result *results);
+extern int fptune_recommend(const fp_tune_result *results, double tolerance);
+extern void print_fp_tune(const fp_tune_result *results, double tolerance);
+
+#endif
@@ -0,0 +1,366 @@
+/*
+    CIieeefp: bench-CIieeefp.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This program measures the cost of each function in CIieeefp.h (other
+ * than those that print), together with their nearest equivalents in
+ * the C99 fenv.h and math.h, and prints the results as JSON: one object
+ * per benchmark giving the number of calls made, the time they took,
+ * the time stamp counter cycles per call and the calls per second.
+ *
+ * Usage: bench-CIieeefp [seconds-per-benchmark [benchmark-name...]]
+ *
+ * With names, only the benchmarks with those names are run.
+ */
+
+#include <CIieeefp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fenv.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#define DEFAULT_SECONDS 0.2
+#define ARRAY_SIZE 4096
+
+typedef struct {
+  const char *name;
+  void (*run)(long n);
+} BENCHMARK;
+
+/* Values of each class of floating point number, indexed by fpclass_t.
+   They are volatile so the compiler has to load them afresh for every
+   call, rather than classifying them once. */
+
+static volatile double values[10];
+
+static volatile long sink;	/* Results go here so they aren't
+				   optimised away */
+
+static double array[ARRAY_SIZE];
+static fpclass_t classes[ARRAY_SIZE];
+
+/* make_values()
+ *
+ * Fill values[] and array[] with numbers of each class. The NaNs are
+ * made from their bit patterns, as arithmetic would quieten a
+ * signalling NaN.
+ */
+
+static void make_values(void) {
+  unsigned long long snan = 0x7ff4000000000000ULL;
+  unsigned long long qnan = 0x7ff8000000000000ULL;
+  double d;
+  int i;
+
+  memcpy(&d, &snan, sizeof(double));
+  values[FP_SNAN] = d;
+  memcpy(&d, &qnan, sizeof(double));
+  values[FP_QNAN] = d;
+  values[FP_NINF] = -HUGE_VAL;
+  values[FP_PINF] = HUGE_VAL;
+  values[FP_NDENORM] = -4.9e-324;
+  values[FP_PDENORM] = 4.9e-324;
+  values[FP_NZERO] = -0.0;
+  values[FP_PZERO] = 0.0;
+  values[FP_NNORM] = -1.5;
+  values[FP_PNORM] = 1.5;
+
+  for(i = 0; i < ARRAY_SIZE; i++) array[i] = values[i % 10];
+}
+
+/* Benchmark bodies. Each runs n calls of the function concerned. */
+
+#define BENCH(name, body) \
+  static void bench_##name(long n) { \
+    long i; \
+    for(i = 0; i < n; i++) { body; } \
+  }
+
+#define BENCH_CLASS(cls) \
+  BENCH(fpclass_##cls, sink += fpclass(values[cls])) \
+  BENCH(fpclass_fast_##cls, sink += fpclass_fast(values[cls])) \
+  BENCH(fpclass_x87_##cls, sink += fpclass_x87(values[cls])) \
+  BENCH(fpclassify_##cls, sink += __builtin_fpclassify(0, 1, 2, 3, 4, \
+							values[cls]))
+
+BENCH(fpgetround, sink += fpgetround())
+BENCH(fpsetround_unchanged, sink += fpsetround(FP_RN))
+BENCH(fpsetround_changed, sink += fpsetround((i & 1) ? FP_RM : FP_RN))
+BENCH(fegetround, sink += fegetround())
+BENCH(fesetround_unchanged, sink += fesetround(FE_TONEAREST))
+BENCH(fesetround_changed,
+      sink += fesetround((i & 1) ? FE_DOWNWARD : FE_TONEAREST))
+BENCH(fpgetsticky, sink += fpgetsticky())
+BENCH(fpsetsticky, sink += fpsetsticky(0))
+BENCH(fetestexcept, sink += fetestexcept(FE_ALL_EXCEPT))
+BENCH(feclearexcept, sink += feclearexcept(FE_ALL_EXCEPT))
+BENCH(fpgetmask, sink += fpgetmask())
+BENCH(fpsetmask_unchanged, sink += fpsetmask(0))
+BENCH(fpsetmask_changed, sink += fpsetmask((i & 1) ? FP_X_DZ : 0))
+BENCH(fpgetprecision, sink += fpgetprecision())
+BENCH(fpsetprecision_unchanged, sink += fpsetprecision(FP_PC_EXT))
+BENCH(fpsetprecision_changed,
+      sink += fpsetprecision((i & 1) ? FP_PC_DBL : FP_PC_EXT))
+BENCH(fpgetunit, sink += fpgetunit())
+BENCH(fpsetunit, sink += fpsetunit(FP_UNIT_BOTH))
+BENCH(fpgetcwcache, sink += fpgetcwcache())
+BENCH(fpsynccw, fpsynccw())
+BENCH(fpgetftz, sink += fpgetftz())
+BENCH(fpsetftz, sink += fpsetftz(0))
+BENCH(fpgetdaz, sink += fpgetdaz())
+BENCH(fpsetdaz, sink += fpsetdaz(0))
+BENCH(fpsite, {
+    static fp_site site = FP_SITE_INIT("bench");
+    fpsiteend(&site, fpsitebegin());
+  })
+BENCH(finite, sink += finite(values[i & 7 ? FP_PNORM : FP_PINF]))
+BENCH(finite_fast, sink += finite_fast(values[i & 7 ? FP_PNORM : FP_PINF]))
+BENCH(isfinite, sink += __builtin_isfinite(values[i & 7 ? FP_PNORM : FP_PINF]))
+BENCH_CLASS(FP_SNAN)
+BENCH_CLASS(FP_QNAN)
+BENCH_CLASS(FP_NINF)
+BENCH_CLASS(FP_PINF)
+BENCH_CLASS(FP_NDENORM)
+BENCH_CLASS(FP_PDENORM)
+BENCH_CLASS(FP_NZERO)
+BENCH_CLASS(FP_PZERO)
+BENCH_CLASS(FP_NNORM)
+BENCH_CLASS(FP_PNORM)
+
+/* Benchmarks whose calls are not all alike. */
+
+static void bench_fpsetround_changed_cached(long n) {
+  fpsetcwcache(1);
+  bench_fpsetround_changed(n);
+  fpsetcwcache(0);
+}
+
+static void bench_fpsetround_unchanged_cached(long n) {
+  fpsetcwcache(1);
+  bench_fpsetround_unchanged(n);
+  fpsetcwcache(0);
+}
+
+static void bench_fpsetcwcache(long n) {
+  long i;
+
+  for(i = 0; i < n; i++) sink += fpsetcwcache((int)(i & 1));
+  fpsetcwcache(0);
+}
+
+static void bench_fpgetenv(long n) {
+  fp_env env;
+  long i;
+
+  for(i = 0; i < n; i++) {
+    fpgetenv(&env);
+    sink += env.units;
+  }
+}
+
+static void bench_fpsetenv(long n) {
+  fp_env env;
+  long i;
+
+  fpgetenv(&env);
+  for(i = 0; i < n; i++) fpsetenv(&env);
+}
+
+static void bench_fegetenv(long n) {
+  fenv_t env;
+  long i;
+
+  for(i = 0; i < n; i++) sink += fegetenv(&env);
+}
+
+static void bench_fesetenv(long n) {
+  fenv_t env;
+  long i;
+
+  fegetenv(&env);
+  for(i = 0; i < n; i++) sink += fesetenv(&env);
+}
+
+/* fpclass_array is measured per element, so n counts elements. */
+
+static void bench_fpclass_array(long n) {
+  long i;
+
+  for(i = 0; i < n; i += ARRAY_SIZE) {
+    fpclass_array(array, (n - i < ARRAY_SIZE) ? (size_t)(n - i) : ARRAY_SIZE,
+		  classes);
+  }
+  sink += classes[0];
+}
+
+static void bench_fpclass_loop(long n) {
+  long i;
+
+  for(i = 0; i < n; i++) classes[i % ARRAY_SIZE] = fpclass(array[i % ARRAY_SIZE]);
+  sink += classes[0];
+}
+
+#define ENTRY(name) { #name, bench_##name }
+#define CLASS_ENTRIES(cls, lc) \
+  { "fpclass_" lc, bench_fpclass_##cls }, \
+  { "fpclass_fast_" lc, bench_fpclass_fast_##cls }, \
+  { "fpclass_x87_" lc, bench_fpclass_x87_##cls }, \
+  { "builtin_fpclassify_" lc, bench_fpclassify_##cls }
+
+static const BENCHMARK benchmarks[] = {
+  ENTRY(fpgetround),
+  ENTRY(fpsetround_unchanged),
+  ENTRY(fpsetround_changed),
+  ENTRY(fpsetround_unchanged_cached),
+  ENTRY(fpsetround_changed_cached),
+  ENTRY(fegetround),
+  ENTRY(fesetround_unchanged),
+  ENTRY(fesetround_changed),
+  ENTRY(fpgetsticky),
+  ENTRY(fpsetsticky),
+  ENTRY(fetestexcept),
+  ENTRY(feclearexcept),
+  ENTRY(fpgetmask),
+  ENTRY(fpsetmask_unchanged),
+  ENTRY(fpsetmask_changed),
+  ENTRY(fpgetprecision),
+  ENTRY(fpsetprecision_unchanged),
+  ENTRY(fpsetprecision_changed),
+  ENTRY(fpgetunit),
+  ENTRY(fpsetunit),
+  ENTRY(fpgetcwcache),
+  ENTRY(fpsetcwcache),
+  ENTRY(fpsynccw),
+  ENTRY(fpgetenv),
+  ENTRY(fpsetenv),
+  ENTRY(fegetenv),
+  ENTRY(fesetenv),
+  ENTRY(fpgetftz),
+  ENTRY(fpsetftz),
+  ENTRY(fpgetdaz),
+  ENTRY(fpsetdaz),
+  ENTRY(fpsite),
+  ENTRY(finite),
+  ENTRY(finite_fast),
+  { "builtin_isfinite", bench_isfinite },
+  CLASS_ENTRIES(FP_SNAN, "snan"),
+  CLASS_ENTRIES(FP_QNAN, "qnan"),
+  CLASS_ENTRIES(FP_NINF, "ninf"),
+  CLASS_ENTRIES(FP_PINF, "pinf"),
+  CLASS_ENTRIES(FP_NDENORM, "ndenorm"),
+  CLASS_ENTRIES(FP_PDENORM, "pdenorm"),
+  CLASS_ENTRIES(FP_NZERO, "nzero"),
+  CLASS_ENTRIES(FP_PZERO, "pzero"),
+  CLASS_ENTRIES(FP_NNORM, "nnorm"),
+  CLASS_ENTRIES(FP_PNORM, "pnorm"),
+  ENTRY(fpclass_array),
+  ENTRY(fpclass_loop),
+  { NULL, NULL }
+};
+
+/* now() -> seconds
+ *
+ * Return a monotonic time in seconds.
+ */
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+/* measure(bench, seconds, first)
+ *
+ * Run a benchmark with increasing numbers of calls until it takes at
+ * least the given number of seconds, then print the result of that
+ * run as a JSON object.
+ */
+
+static void measure(const BENCHMARK *bench, double seconds, int first) {
+  long n = 1024;
+  double start, elapsed;
+  unsigned long long cycles;
+
+  bench->run(n);		/* Warm up */
+  for(;;) {
+    start = now();
+    cycles = __rdtsc();
+    bench->run(n);
+    cycles = __rdtsc() - cycles;
+    elapsed = now() - start;
+    if(elapsed >= seconds || n > (1L << 40)) break;
+    n *= (elapsed < seconds / 16.0) ? 16 : 2;
+  }
+
+  fpsetround(FP_RN);
+  fpsetmask(0);
+  fpsetsticky(0);
+
+  printf("%s    {\"name\": \"%s\", \"calls\": %ld, \"seconds\": %.6f, "
+	 "\"cycles_per_call\": %.2f, \"calls_per_second\": %.0f}",
+	 first ? "" : ",\n", bench->name, n, elapsed,
+	 (double)cycles / (double)n, (double)n / elapsed);
+}
+
+/* main(argc, argv)
+ *
+ * See the comment at the top of the file for usage.
+ */
+
+int main(int argc, char **argv) {
+  double seconds = DEFAULT_SECONDS;
+  int first = 1;
+  const BENCHMARK *bench;
+
+  if(argc > 1) seconds = atof(argv[1]);
+  make_values();
+
+  printf("{\n  \"seconds_per_benchmark\": %g,\n  \"benchmarks\": [\n",
+	 seconds);
+  for(bench = benchmarks; bench->name != NULL; bench++) {
+    if(argc > 2) {
+      int i, wanted = 0;
+
+      for(i = 2; i < argc; i++) {
+	if(strcmp(argv[i], bench->name) == 0) wanted = 1;
+      }
+      if(!wanted) continue;
+    }
+    measure(bench, seconds, first);
+    first = 0;
+    fflush(stdout);
+  }
+  printf("\n  ]\n}\n");
+
+  return 0;
+}
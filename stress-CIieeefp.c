@@ -0,0 +1,179 @@
+/*
+    CIieeefp: stress-CIieeefp.c
+    Copyright (C) 2026  Macaulay Institute
+
+    This file is part of CIieeefp, a partial implementation of the rounding
+    control and exception checking IEEE routines for Cygwin on an Intel
+    platform.
+
+    CIieeefp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    CIieeefp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details. (LICENCE file in
+    this directory.)
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Contact information:
+      Gary Polhill,
+      Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
+      g.polhill@macaulay.ac.uk
+*/
+
+/* This program stresses the library from several threads at once. Each
+ * thread repeatedly sets its own pattern of sticky bits, changes the
+ * rounding direction, exception mask and precision, and checks that it
+ * gets back its own sticky bits -- which it would not if the saved
+ * FPU state were shared between threads. The number of threads is
+ * doubled up to the maximum given (by default the number of CPUs
+ * online), and the throughput at each thread count is reported
+ * together with the speedup over one thread. With no shared writable
+ * state in the library the speedup should be close to the number of
+ * threads, up to the number of cores.
+ */
+
+#include <CIieeefp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_ITERATIONS 1000000L
+
+typedef struct {
+  int id;
+  long iterations;
+  long failures;
+} WORKER;
+
+static const fp_except patterns[6] = {
+  FP_X_INV, FP_X_DZ | FP_X_IMP, FP_X_OFL, FP_X_UFL | FP_X_IMP,
+  FP_X_DNML, FP_X_INV | FP_X_OFL
+};
+
+static const fp_rnd directions[4] = { FP_RN, FP_RM, FP_RP, FP_RZ };
+
+/* now() -> seconds
+ *
+ * Return a monotonic time in seconds.
+ */
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+/* worker(arg)
+ *
+ * One thread's worth of work. Each iteration sets a sticky pattern
+ * particular to this thread and iteration, then makes the calls that
+ * save the sticky bits before loading the control word, then checks
+ * the sticky bits are still what this thread set.
+ */
+
+static void *worker(void *arg) {
+  WORKER *w = (WORKER *)arg;
+  fp_except mask = fpgetmask();
+  long i;
+
+  for(i = 0; i < w->iterations; i++) {
+    fp_except mine = patterns[(w->id + i) % 6];
+
+    fpsetsticky(mine);
+    fpsetround(directions[(w->id + i) % 4]);
+    fpsetmask(mask);
+    fpsetprecision(FP_PC_DBL);
+    if(fpgetsticky() != mine) w->failures++;
+  }
+  fpsetround(FP_RN);
+  fpsetsticky(0);
+
+  return NULL;
+}
+
+/* run(nthreads, iterations, failures) -> seconds taken
+ *
+ * Run nthreads workers each doing the given number of iterations,
+ * adding any failures found to *failures.
+ */
+
+static double run(int nthreads, long iterations, long *failures) {
+  pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+  WORKER *workers = malloc(nthreads * sizeof(WORKER));
+  double start;
+  int i;
+
+  if(threads == NULL || workers == NULL) {
+    perror("Memory allocation");
+    abort();
+  }
+
+  start = now();
+  for(i = 0; i < nthreads; i++) {
+    workers[i].id = i;
+    workers[i].iterations = iterations;
+    workers[i].failures = 0;
+    if(pthread_create(&threads[i], NULL, worker, &workers[i]) != 0) {
+      perror("pthread_create");
+      abort();
+    }
+  }
+  for(i = 0; i < nthreads; i++) {
+    pthread_join(threads[i], NULL);
+    (*failures) += workers[i].failures;
+  }
+  start = now() - start;
+
+  free(threads);
+  free(workers);
+
+  return start;
+}
+
+/* main(argc, argv)
+ *
+ * Usage: stress-CIieeefp [max-threads [iterations-per-thread]]
+ */
+
+int main(int argc, char **argv) {
+  int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  long iterations = DEFAULT_ITERATIONS;
+  long failures = 0;
+  double base_rate = 0.0;
+  int n;
+
+  if(argc > 1) max_threads = atoi(argv[1]);
+  if(argc > 2) iterations = atol(argv[2]);
+  if(max_threads < 1) max_threads = 1;
+
+  printf("%8s %12s %14s %8s\n", "Threads", "Seconds", "Iterations/s",
+	 "Speedup");
+  for(n = 1; ; n = (n * 2 > max_threads && n < max_threads)
+	? max_threads : n * 2) {
+    double secs = run(n, iterations, &failures);
+    double rate = (double)n * (double)iterations / secs;
+
+    if(n == 1) base_rate = rate;
+    printf("%8d %12.3f %14.0f %8.2f\n", n, secs, rate, rate / base_rate);
+    if(n >= max_threads) break;
+  }
+
+  if(failures != 0) {
+    printf("*** %ld iterations found another thread's sticky bits ***\n",
+	   failures);
+    return 1;
+  }
+  return 0;
+}
@@ -26,8 +26,23 @@
       Macaulay Institute, Craigiebuckler, Aberdeen, AB15 8QH. United Kingdom
       g.polhill@macaulay.ac.uk
 */
-#ifdef __CYGWIN__
+#if defined(__CYGWIN__) \
+  || (defined(__linux__) && (defined(__i386__) || defined(__x86_64__)))
+#define CIIEEEFP_TEST		/* Testing CIieeefp, not a native ieeefp.h */
 #include <CIieeefp.h>
+#include <CIsoftfp.h>
+#include <CIfpprof.h>
+#include <CIfptry.h>
+#include <CIbatch.h>
+#include <CIinterval.h>
+#include <CIelemfn.h>
+#include <CIqueue.h>
+#include <CIreduce.h>
+#include <CIdd.h>
+#include <CIblas.h>
+#include <CIgemm.h>
+#include <CIsround.h>
+#include <CItune.h>
 #else
 #include <ieeefp.h>
 typedef unsigned short fp_pctl;
@@ -39,9 +54,19 @@ const fp_pctl FP_PC_DBL = 0;
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <float.h>
 #include <math.h>
+#include <fenv.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(CIIEEEFP_TEST) && defined(__SSE2_MATH__)
+#include <emmintrin.h>
+#endif
 
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -53,9 +78,10 @@ const fp_pctl FP_PC_DBL = 0;
 
 #define STRNAN "**not-a-number**"
 
-#define DBL2LNG sizeof(double) / sizeof(long)
+#define DBL2LNG sizeof(double) / sizeof(uint32_t)
 				/* So, we're assuming doubles are a whole
-				   number of times bigger than longs...
+				   number of times bigger than 32-bit
+				   ints...
 				*/
 #define DBL2CHR sizeof(double) / sizeof(char)
 
@@ -73,6 +99,71 @@ typedef union {
 
 typedef enum { PLUS = 0, MINUS, DIVIDE, MULTIPLY } OPERATOR;
 
+/* A calculation read from a comparison file. The exceptions are held
+   in x using the REF_X_ bits, which are the same on all platforms. */
+
+typedef struct {
+  double num1, num2, ans;
+  int op, rnd, cls, x;
+} REFERENCE;
+
+#define REF_X_INV 0x01
+#define REF_X_DZ 0x02
+#define REF_X_OFL 0x04
+#define REF_X_UFL 0x08
+#define REF_X_IMP 0x10
+#define REF_X_DNML 0x20
+
+/* The binary comparison file format. The file starts with a header of
+   REF_HEADER bytes: the REF_MAGIC string, then the record size and the
+   number of numbers as big-endian 32-bit integers, then zeros. The
+   numbers follow as big-endian 64-bit bit patterns, then one record of
+   REF_RECORD bytes per calculation, in the same order as the text
+   format. A record holds the bit patterns of the two operands and the
+   answer, then one byte each for the operator, rounding direction,
+   fpclass and REF_X_ exceptions, then four zero bytes. NaNs are stored
+   as all ones, as in the text format, where they are all alike. */
+
+#define REF_MAGIC "CIFPREF\0"
+#define REF_MAGICLEN 8
+#define REF_HEADER 32
+#define REF_RECORD 32
+
+/* Counts of the differences found in comparison mode, by kind, and
+   the breakdowns of answer and exception differences and totals by
+   number, operator, rounding direction and both of the latter */
+
+typedef struct {
+  int nopdiffs, nansdiffs, nxdiffs, nclsdiffs;
+  int *numansdiffs, *numxdiffs, *numt;
+  int opansdiffs[4], opxdiffs[4], opt[4];
+  int rndansdiffs[4], rndxdiffs[4], rndt[4];
+  int oprndansdiffs[16], oprndxdiffs[16], oprndt[16];
+} DIFFS;
+
+/* The calculations to compare with: the lines of a text comparison
+   file or the records of a binary one, or if neither, those done by
+   the software reference on the n numbers */
+
+typedef struct {
+  char **lines;
+  const unsigned char *records;
+  const double *numbers;
+  int n;
+} SOURCE;
+
+/* One thread's share of a comparison: the first numbers from first up
+   to but not including last, each operated on with all the numbers */
+
+typedef struct {
+  int first, last, n;
+  double *numbers;
+  const SOURCE *src;
+  DIFFS diffs;
+  char *text;
+  size_t textlen;
+} WORKER;
+
 #define MAXXLEN 5
 #define MAXOPLEN 2
 char operators[4][MAXOPLEN] = { "+", "-", "/", "*" };
@@ -118,7 +209,7 @@ void print(double number, char *buf) {
   }
   in.num = number;
   for(i = 0; i < DBL2LNG; i++) {
-#ifdef __CYGWIN__
+#ifdef CIIEEEFP_TEST
     out.net[DBL2LNG - i - 1] = htonl(in.hst[i]);
 #else
     out.net[i] = htonl(in.hst[i]);
@@ -166,7 +257,7 @@ double input(char *buf) {
   free(cbuf);
 
   for(i = 0; i < DBL2LNG; i++) {
-#ifdef __CYGWIN__
+#ifdef CIIEEEFP_TEST
     out.hst[DBL2LNG - i - 1] = ntohl(in.net[i]);
 #else
     out.hst[i] = ntohl(in.net[i]);
@@ -176,17 +267,194 @@ double input(char *buf) {
   return out.num;
 }
 
-/* op(num1, num2, op, dir)
+/* same(ref, num) -> whether the same
+ *
+ * Return whether a number from a comparison file is the same as one
+ * calculated here, as they would be printed: NaNs are all the same.
+ */
+
+int same(double ref, double num) {
+  if(isnan(ref) || isnan(num)) return isnan(ref) && isnan(num);
+  return memcmp(&ref, &num, sizeof(double)) == 0;
+}
+
+/* ref_except(x) -> REF_X_ bits
+ *
+ * Convert sticky bits to the REF_X_ bits used in comparison files.
+ */
+
+int ref_except(fp_except x) {
+  int ref = 0;
+
+  if(x & FP_X_INV) ref |= REF_X_INV;
+  if(x & FP_X_DZ) ref |= REF_X_DZ;
+  if(x & FP_X_OFL) ref |= REF_X_OFL;
+  if(x & FP_X_UFL) ref |= REF_X_UFL;
+  if(x & FP_X_IMP) ref |= REF_X_IMP;
+#ifdef FP_X_DNML
+  if(x & FP_X_DNML) ref |= REF_X_DNML;
+#endif
+  return ref;
+}
+
+/* lookup(name, names, width, n, what) -> index
+ *
+ * Return the index of name in the n strings of names, each width
+ * chars apart (a row of a two dimensional array), aborting with a
+ * complaint about what it was meant to be if it isn't there.
+ */
+
+int lookup(const char *name, const char *names, int width, int n,
+	   const char *what) {
+  int i;
+
+  for(i = 0; i < n; i++) {
+    if(strcmp(name, names + (i * width)) == 0) return i;
+  }
+  fprintf(stderr, "Problem reading comparison file: %s is not a valid %s\n",
+	  name, what);
+  abort();
+}
+
+/* parse_line(line, ref)
+ *
+ * Read a calculation from a line of a text comparison file.
+ */
+
+void parse_line(const char *line, REFERENCE *ref) {
+  char fp_op[MAXOPLEN], fp_rnd[MAXRNDLEN];
+  char fp_num1[(DBL2CHR * 2) + 1], fp_num2[(DBL2CHR * 2) + 1],
+    fp_ans1[(DBL2CHR * 2) + 1];
+  char fp_cls[MAXFPCLS];
+  char xbuf[MAXXLEN];
+  int len;
+
+  if(sscanf(line, "%16s %1s %1s %16s = %16s [ %7s ]%n",
+	    fp_num1, fp_op, fp_rnd, fp_num2, fp_ans1, fp_cls, &len) != 6) {
+    fprintf(stderr, "Problem reading comparison file\n");
+    abort();
+  }
+  ref->num1 = input(fp_num1);
+  ref->num2 = input(fp_num2);
+  ref->ans = input(fp_ans1);
+  ref->op = lookup(fp_op, operators[0], MAXOPLEN, 4, "operator");
+  ref->rnd = lookup(fp_rnd, rnddir[0], MAXRNDLEN, 4, "rounding direction");
+  ref->cls = lookup(fp_cls, fpcls[0], MAXFPCLS, 10, "class");
+  ref->x = 0;
+  do {
+    line += len;
+    if(sscanf(line, "%4s%n", xbuf, &len) != 1) {
+      fprintf(stderr, "Problem reading comparison file");
+      abort();
+    }
+    if(strcmp(xbuf, "INV") == 0) ref->x |= REF_X_INV;
+    else if(strcmp(xbuf, "DZ") == 0) ref->x |= REF_X_DZ;
+    else if(strcmp(xbuf, "UFL") == 0) ref->x |= REF_X_UFL;
+    else if(strcmp(xbuf, "OFL") == 0) ref->x |= REF_X_OFL;
+    else if(strcmp(xbuf, "IMP") == 0) ref->x |= REF_X_IMP;
+    else if(strcmp(xbuf, "DNML") == 0) ref->x |= REF_X_DNML;
+    else if(strcmp(xbuf, "end") != 0) {
+      fprintf(stderr, "Problem reading comparison file");
+      abort();
+    }
+  } while(strcmp(xbuf, "end") != 0);
+}
+
+/* get_bits(buf) -> number
+ * put_bits(number, buf)
+ *
+ * Read and write the bit pattern of a number as eight big-endian bytes
+ * in a binary comparison file. NaNs are written as all ones.
+ */
+
+double get_bits(const unsigned char *buf) {
+  uint64_t bits = 0;
+  double number;
+  int i;
+
+  for(i = 0; i < 8; i++) bits = (bits << 8) | buf[i];
+  memcpy(&number, &bits, sizeof(double));
+  return number;
+}
+
+void put_bits(double number, unsigned char *buf) {
+  uint64_t bits;
+  int i;
+
+  if(isnan(number)) bits = ~(uint64_t)0;
+  else memcpy(&bits, &number, sizeof(double));
+  for(i = 7; i >= 0; i--) {
+    buf[i] = (unsigned char)(bits & 0xff);
+    bits >>= 8;
+  }
+}
+
+/* get_record(buf, ref)
+ * put_record(ref, buf)
+ *
+ * Read and write a calculation as a record in a binary comparison
+ * file.
+ */
+
+void get_record(const unsigned char *buf, REFERENCE *ref) {
+  ref->num1 = get_bits(buf);
+  ref->num2 = get_bits(buf + 8);
+  ref->ans = get_bits(buf + 16);
+  ref->op = buf[24];
+  ref->rnd = buf[25];
+  ref->cls = buf[26];
+  ref->x = buf[27];
+  if(ref->op > 3 || ref->rnd > 3 || ref->cls > 9) {
+    fprintf(stderr, "Problem reading comparison file: invalid record\n");
+    abort();
+  }
+}
+
+void put_record(const REFERENCE *ref, unsigned char *buf) {
+  put_bits(ref->num1, buf);
+  put_bits(ref->num2, buf + 8);
+  put_bits(ref->ans, buf + 16);
+  buf[24] = (unsigned char)ref->op;
+  buf[25] = (unsigned char)ref->rnd;
+  buf[26] = (unsigned char)ref->cls;
+  buf[27] = (unsigned char)ref->x;
+  memset(buf + 28, 0, REF_RECORD - 28);
+}
+
+/* get_uint32(buf) -> value
+ * put_uint32(value, buf)
+ *
+ * Read and write a big-endian 32-bit integer in a binary comparison
+ * file header.
+ */
+
+uint32_t get_uint32(const unsigned char *buf) {
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16)
+    | ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+}
+
+void put_uint32(uint32_t value, unsigned char *buf) {
+  buf[0] = (unsigned char)(value >> 24);
+  buf[1] = (unsigned char)(value >> 16);
+  buf[2] = (unsigned char)(value >> 8);
+  buf[3] = (unsigned char)value;
+}
+
+/* op(num1, num2, op, dir, ref, out, diffs)
  *
  * Perform arithmetic operator op on operands num1 and num2 in
  * rounding direction dir. Check for floating point errors. Since the
  * IEEE standard allows some ambiguity in which flags are set to
  * indicate which floating point errors, overflow, underflow and
  * imprecision are comflated to give the same indication.
+ *
+ * If ref is NULL the calculation is printed to out; otherwise it is
+ * compared with the reference calculation ref, any differences are
+ * printed to out, and the counts in diffs are updated.
  */
 
-void op(double num1, double num2, OPERATOR op, int dir, FILE *fp,
-	int *nopdiffs, int *nansdiffs, int *nxdiffs, int *nclsdiffs) {
+void op(double num1, double num2, OPERATOR op, int dir,
+	const REFERENCE *ref, FILE *out, DIFFS *diffs) {
   double ans1;
   char snum1[(DBL2CHR * 2) + 1], snum2[(DBL2CHR * 2) + 1],
     sans1[(DBL2CHR * 2) + 1];
@@ -219,136 +487,102 @@ void op(double num1, double num2, OPERATOR op, int dir, FILE *fp,
   }
   x = fpgetsticky();
   fpsetprecision(pc);
-  print(num1, snum1);
-  print(num2, snum2);
-  print(ans1, sans1);
-  if(fp == NULL) {
-    printf("%s %s %s %s = %s [ %s ]",
+  if(ref == NULL) {
+    print(num1, snum1);
+    print(num2, snum2);
+    print(ans1, sans1);
+    fprintf(out, "%s %s %s %s = %s [ %s ]",
 	   snum1, operators[op], rnddir[dir], snum2, sans1,
 	   fpcls[fpclass(ans1)]);
-    if(x & FP_X_INV) printf(" INV");
-    if(x & FP_X_DZ) printf(" DZ");
-    if(x & FP_X_OFL) printf(" OFL");
-    if(x & FP_X_UFL) printf(" UFL");
-    if(x & FP_X_IMP) printf(" IMP");
+    if(x & FP_X_INV) fprintf(out, " INV");
+    if(x & FP_X_DZ) fprintf(out, " DZ");
+    if(x & FP_X_OFL) fprintf(out, " OFL");
+    if(x & FP_X_UFL) fprintf(out, " UFL");
+    if(x & FP_X_IMP) fprintf(out, " IMP");
 #ifdef FP_X_DNML
-    if(x & FP_X_DNML) printf(" DNML");
+    if(x & FP_X_DNML) fprintf(out, " DNML");
 #endif
-    printf(" end\n");
+    fprintf(out, " end\n");
   }
   else {
-    char fp_op[MAXOPLEN], fp_rnd[MAXRNDLEN];
     char fp_num1[(DBL2CHR * 2) + 1], fp_num2[(DBL2CHR * 2) + 1],
       fp_ans1[(DBL2CHR * 2) + 1];
-    char fp_cls[MAXFPCLS];
-    char xbuf[MAXXLEN];
-    int inv = 0, dz = 0, ofl = 0, ufl = 0, imp = 0, dnml = 0;
     int thisopdiff = 0, thisansdiff = 0, thisxdiff = 0, thisclsdiff = 0;
+    int thisx = ref_except(x);
     fpclass_t thiscls;
 
-    if(fscanf(fp, "%s %s %s %s = %s [ %s ]",
-	      fp_num1, fp_op, fp_rnd, fp_num2, fp_ans1, fp_cls) != 6) {
-      fprintf(stderr, "Problem reading comparison file\n");
-      abort();
-    }
-    
-    if(strcmp(operators[op], fp_op) != 0) {
+    if(ref->op != op) {
       fprintf(stderr, "Operator mismatch in comparison file "
-	      "(expecting %s found %s)\n", operators[op], fp_op);
+	      "(expecting %s found %s)\n", operators[op], operators[ref->op]);
       abort();
     }
-    if(strcmp(rnddir[dir], fp_rnd) != 0) {
+    if(ref->rnd != dir) {
       fprintf(stderr, "Rounding direction mismatch in comparison file "
-	      "(expecting %s found %s)\n", rnddir[dir], fp_rnd);
+	      "(expecting %s found %s)\n", rnddir[dir], rnddir[ref->rnd]);
       abort();
     }
 
-    if(strcmp(fp_num1, snum1) != 0) {
+    if(!same(ref->num1, num1)) {
       thisopdiff = 1;
     }
-    if(strcmp(fp_num2, snum2) != 0) {
+    if(!same(ref->num2, num2)) {
       thisopdiff = 1;
     }
-    if(strcmp(fp_ans1, sans1) != 0) {
+    if(!same(ref->ans, ans1)) {
       thisansdiff = 1;
     }
     thiscls = fpclass(ans1);
-    if(strcmp(fp_cls, fpcls[thiscls]) != 0) {
+    if(ref->cls != (int)thiscls) {
       thisclsdiff = 1;
     }
-    do {
-      if(fscanf(fp, "%s", xbuf) != 1) {
-	fprintf(stderr, "Problem reading comparison file");
-	abort();
-      }
-      if(strcmp(xbuf, "INV") == 0) inv = FP_X_INV;
-      else if(strcmp(xbuf, "DZ") == 0) dz = FP_X_DZ;
-      else if(strcmp(xbuf, "UFL") == 0) ufl = FP_X_UFL;
-      else if(strcmp(xbuf, "OFL") == 0) ofl = FP_X_OFL;
-      else if(strcmp(xbuf, "IMP") == 0) imp = FP_X_IMP;
-#ifdef FP_X_DNML
-      else if(strcmp(xbuf, "DNML") == 0) dnml = FP_X_DNML;
-#else
-      else if(strcmp(xbuf, "DNML") == 0) dnml = -1;
-#endif
-      else if(strcmp(xbuf, "end") != 0) {
-	fprintf(stderr, "Problem reading comparison file");
-	abort();
-      }
-    } while(strcmp(xbuf, "end") != 0);
-
-    if(inv != (x & FP_X_INV)) thisxdiff = 1;
-    if(dz != (x & FP_X_DZ)) thisxdiff = 1;
-    if(ufl != (x & FP_X_UFL)) thisxdiff = 1;
-    if(ofl != (x & FP_X_OFL)) thisxdiff = 1;
-    if(imp != (x & FP_X_IMP)) thisxdiff = 1;
-#ifdef FP_X_DNML
-    if(dnml != (x & FP_X_DNML)) thisxdiff = 1;
-#else
-    if(dnml == -1) thisxdiff = 1;
-#endif
+    if(ref->x != thisx) thisxdiff = 1;
     
     if(thisansdiff || thisxdiff || thisclsdiff) {
-      printf("In calculation %g %s %g = %g (rounding %s):\n",
+      print(ref->num1, fp_num1);
+      print(ref->num2, fp_num2);
+      print(ref->ans, fp_ans1);
+      print(num1, snum1);
+      print(num2, snum2);
+      print(ans1, sans1);
+      fprintf(out, "In calculation %g %s %g = %g (rounding %s):\n",
 	     num1, operators[op], num2, ans1, rnddir[dir]);
       if(thisansdiff && thisopdiff) {
-	printf("\tOperators differ leading to different answer:\n");
-	printf("\t\tFILE: op1=%s op2=%s ans=%s (%g)\n"
+	fprintf(out, "\tOperators differ leading to different answer:\n");
+	fprintf(out, "\t\tFILE: op1=%s op2=%s ans=%s (%g)\n"
 	       "\t\tHERE: op1=%s op2=%s ans=%s\n",
-	       fp_num1, fp_num2, fp_ans1, input(fp_ans1), snum1, snum2, sans1);
+	       fp_num1, fp_num2, fp_ans1, ref->ans, snum1, snum2, sans1);
       }
       else if(thisansdiff) {
-	printf("\tDifferent answer:\n\t\tFILE: ans=%s (%g)\n"
+	fprintf(out, "\tDifferent answer:\n\t\tFILE: ans=%s (%g)\n"
 	       "\t\tHERE: ans=%s\n",
-	       fp_ans1, input(fp_ans1), sans1);
+	       fp_ans1, ref->ans, sans1);
       }
       else if(thisclsdiff) {
-	printf("\tDifferent class:\n"
+	fprintf(out, "\tDifferent class:\n"
 	       "\t\tFILE: %s\n\t\tHERE: %s\n",
-	       fp_cls, fpcls[thiscls]);
+	       fpcls[ref->cls], fpcls[thiscls]);
       }
       if(thisxdiff) {
-	printf("\tDifferent exceptions raised:\n"
+	fprintf(out, "\tDifferent exceptions raised:\n"
 	       "\t\tFILE: %s %s %s %s %s %s\n"
 	       "\t\tHERE: %s %s %s %s %s %s\n",
-	       inv ? "I" : "-", dz ? "Z" : "-", ufl ? "U" : "-",
-	       ofl ? "O" : "-", imp ? "P" : "-", dnml ? "D" : "-",
-	       (x & FP_X_INV) ? "I" : "-", (x & FP_X_DZ) ? "Z" : "-",
-	       (x & FP_X_UFL) ? "U" : "-", (x & FP_X_OFL) ? "O" : "-",
-	       (x & FP_X_IMP) ? "P" : "-",
-#ifdef FP_X_DNML
-	       (x & FP_X_DNML) ? "D" : "-"
-#else
-	       "-"
-#endif
-	       );
+	       (ref->x & REF_X_INV) ? "I" : "-",
+	       (ref->x & REF_X_DZ) ? "Z" : "-",
+	       (ref->x & REF_X_UFL) ? "U" : "-",
+	       (ref->x & REF_X_OFL) ? "O" : "-",
+	       (ref->x & REF_X_IMP) ? "P" : "-",
+	       (ref->x & REF_X_DNML) ? "D" : "-",
+	       (thisx & REF_X_INV) ? "I" : "-", (thisx & REF_X_DZ) ? "Z" : "-",
+	       (thisx & REF_X_UFL) ? "U" : "-", (thisx & REF_X_OFL) ? "O" : "-",
+	       (thisx & REF_X_IMP) ? "P" : "-",
+	       (thisx & REF_X_DNML) ? "D" : "-");
       }
     }
-    if(thisopdiff) (*nopdiffs)++;
-    else if(thisansdiff) (*nansdiffs)++;
+    if(thisopdiff) diffs->nopdiffs++;
+    else if(thisansdiff) diffs->nansdiffs++;
     else {
-      if(thisxdiff) (*nxdiffs)++;
-      if(thisclsdiff) (*nclsdiffs)++;
+      if(thisxdiff) diffs->nxdiffs++;
+      if(thisclsdiff) diffs->nclsdiffs++;
     }
   }
 }
@@ -362,6 +596,9 @@ void op(double num1, double num2, OPERATOR op, int dir, FILE *fp,
 int test_settings(void) {
   int failures = 0;
   fp_except mask_orig;
+#ifdef CIIEEEFP_TEST
+  fp_unit units_orig;
+#endif
 
   printf("Testing settings on the chip... ");
   fflush(stdout);
@@ -393,13 +630,51 @@ int test_settings(void) {
   fpsetmask(mask_orig);
   if(fpgetmask() != mask_orig) FAIL_TEST;
 
-#ifdef __CYGWIN__
+#ifdef CIIEEEFP_TEST
   fpsetprecision(FP_PC_SGL);
   if(fpgetprecision() != FP_PC_SGL) FAIL_TEST;
   fpsetprecision(FP_PC_DBL);
   if(fpgetprecision() != FP_PC_DBL) FAIL_TEST;
   fpsetprecision(FP_PC_EXT);
   if(fpgetprecision() != FP_PC_EXT) FAIL_TEST;
+
+  fpsetcwcache(1);
+  fpsetround(FP_RM);
+  if(fpgetround() != FP_RM) FAIL_TEST;
+  fpsetsticky(FP_X_OFL);
+  if(fpsetround(FP_RM) != FP_RM) FAIL_TEST;
+  if(fpgetsticky() != FP_X_OFL) FAIL_TEST;
+  fpsetmask(FP_X_DZ);
+  if(fpsetmask(FP_X_DZ) != FP_X_DZ) FAIL_TEST;
+  if(fpgetmask() != FP_X_DZ) FAIL_TEST;
+  fpsetmask(mask_orig);
+  if(fpgetmask() != mask_orig) FAIL_TEST;
+  fesetround(FE_UPWARD);	/* Change the control word behind our back */
+  if(fpgetround() != FP_RM) FAIL_TEST;
+  fpsynccw();
+  if(fpgetround() != FP_RP) FAIL_TEST;
+  fesetround(FE_TONEAREST);
+  fpsynccw();
+  if(fpgetround() != FP_RN) FAIL_TEST;
+  fpsetsticky(0);
+  if(fpsetcwcache(0) != 1) FAIL_TEST;
+  if(fpgetround() != FP_RN) FAIL_TEST;
+
+  units_orig = fpsetunit(FP_UNIT_SSE);
+  fpsetround(FP_RZ);
+  if(fpgetround() != FP_RZ) FAIL_TEST;
+  if(fpsetunit(FP_UNIT_X87) != FP_UNIT_SSE) FAIL_TEST;
+  if(fpgetround() != FP_RZ) FAIL_TEST;
+  fpsetunit(FP_UNIT_BOTH);
+  fpsetround(FP_RP);
+  fpsetmask(FP_X_DZ);
+  fpsetunit(FP_UNIT_SSE);
+  if(fpgetround() != FP_RP) FAIL_TEST;
+  if(fpgetmask() != FP_X_DZ) FAIL_TEST;
+  fpsetunit(FP_UNIT_BOTH);
+  fpsetround(FP_RN);
+  fpsetmask(mask_orig);
+  fpsetunit(units_orig);
 #endif
 
   if(failures == 0) {
@@ -427,7 +702,7 @@ int test_rounding(void) {
   printf("Testing rounding direction... ");
   fflush(stdout);
 
-#ifdef __CYGWIN__
+#ifdef CIIEEEFP_TEST
   fpsetprecision(FP_PC_DBL);
 #endif
 
@@ -483,7 +758,7 @@ int test_rounding(void) {
 
   */
 
-#ifdef __CYGWIN__
+#ifdef CIIEEEFP_TEST
   fpsetprecision(FP_PC_EXT);
 #endif
 
@@ -517,7 +792,7 @@ int test_sticky(void) {
   fpsetsticky(0);
   ans = DBL_MIN / three;
   if((fpgetsticky() & FP_X_UFL) != FP_X_UFL) FAIL_TEST;
-#ifdef __CYGWIN__
+#ifdef CIIEEEFP_TEST
   ans = ans / three;
   if((fpgetsticky() & FP_X_DNML) != FP_X_DNML) FAIL_TEST;
 #endif
@@ -554,7 +829,9 @@ int test_sticky(void) {
  */
 
 int test_precision(void) {
-#ifdef __CYGWIN__
+#if defined(CIIEEEFP_TEST) && !defined(__SSE2_MATH__)
+				/* Precision control only affects
+				   arithmetic done on the x87 FPU */
   double ans;
   int failures = 0;
 
@@ -584,10 +861,11 @@ int test_precision(void) {
 
 /* test_class
  *
- * Test that various classes of number are recognised properly. As at version
- * 2.0, denormalised numbers are not properly recognised. The test will
- * therefore not check this. It is also not possible to check for a signalling
- * NaN because as soon as its value is checked it is changed to a quiet NaN.
+ * Test that various classes of number are recognised properly. Up to version
+ * 3.0, denormalised numbers were not properly recognised, as fpclass() used
+ * fxam; from version 3.1 they are. It is not possible to check for a
+ * signalling NaN because as soon as its value is checked it may be changed to
+ * a quiet NaN.
  */
 
 int test_class(void) {
@@ -600,13 +878,49 @@ int test_class(void) {
   if(fpclass(negone) != FP_NNORM) FAIL_TEST;
   if(fpclass(zero) != FP_PZERO) FAIL_TEST;
   if(fpclass(negzero) != FP_NZERO) FAIL_TEST;
-#if (defined(DENORM_BUG_SOLVED) && defined(__CYGWIN__)) || defined(__sun__)
+#if defined(CIIEEEFP_TEST) || defined(__sun__)
   if(fpclass(DBL_MIN / three) != FP_PDENORM) FAIL_TEST;
   if(fpclass(-DBL_MIN / three) != FP_NDENORM) FAIL_TEST;
 #endif
   if(fpclass(DBL_MAX * two) != FP_PINF) FAIL_TEST;
   if(fpclass(DBL_MAX * negtwo) != FP_NINF) FAIL_TEST;
   if(fpclass(sqrt(negone)) != FP_QNAN) FAIL_TEST;
+  if(!finite(DBL_MIN / three)) FAIL_TEST;
+  if(!finite(-DBL_MAX)) FAIL_TEST;
+  if(finite(DBL_MAX * two)) FAIL_TEST;
+  if(finite(sqrt(negone))) FAIL_TEST;
+#ifdef CIIEEEFP_TEST
+  if(fpclass_fast(DBL_MIN / three) != FP_PDENORM) FAIL_TEST;
+  if(fpclass_fast(negzero) != FP_NZERO) FAIL_TEST;
+  if(fpclass_fast(sqrt(negone)) != FP_QNAN) FAIL_TEST;
+  if(fpclass_x87(negone) != FP_NNORM) FAIL_TEST;
+  {
+    double nums[19];
+    fpclass_t expect[19], classes[19];
+    int i;
+
+    nums[0] = one;		expect[0] = FP_PNORM;
+    nums[1] = negone;		expect[1] = FP_NNORM;
+    nums[2] = zero;		expect[2] = FP_PZERO;
+    nums[3] = negzero;		expect[3] = FP_NZERO;
+    nums[4] = DBL_MIN / two;	expect[4] = FP_PDENORM;
+    nums[5] = -DBL_MIN / two;	expect[5] = FP_NDENORM;
+    nums[6] = DBL_MAX * two;	expect[6] = FP_PINF;
+    nums[7] = DBL_MAX * negtwo;	expect[7] = FP_NINF;
+    nums[8] = sqrt(negone);	expect[8] = FP_QNAN;
+    nums[9] = DBL_MIN;		expect[9] = FP_PNORM;
+    nums[10] = -DBL_MAX;	expect[10] = FP_NNORM;
+    for(i = 11; i < 19; i++) {
+      nums[i] = nums[i - 11];
+      expect[i] = expect[i - 11];
+    }
+
+    fpclass_array(nums, 19, classes);
+    for(i = 0; i < 19; i++) {
+      if(classes[i] != expect[i]) FAIL_TEST;
+    }
+  }
+#endif
 
   if(failures == 0) {
     printf(" PASSED\n");
@@ -619,225 +933,3128 @@ int test_class(void) {
 }
   
 
-/* test_mask
+/* test_ftz
  *
- * A thorough check of the exception masks will not be made in version 2.0.
+ * Check flush-to-zero and denormals-are-zeros can be turned on and
+ * off, that they work when arithmetic is done by the SSE unit, even
+ * with the control word cached and only the x87 FPU looked after, and
+ * that an fp_site counts the underflows and denormalised operands in
+ * it.
  */
 
-int test_mask(void) {
+int test_ftz(void) {
+#ifdef CIIEEEFP_TEST
+  int failures = 0;
+  static fp_site site = FP_SITE_INIT("test_ftz");
+  double denorm, ans;
+  fp_except before;
+  fp_unit units;
+
+  printf("Testing flush to zero... ");
+  fflush(stdout);
+
+  if(fpsetftz(1) != 0) FAIL_TEST;
+  if(fpgetftz() != 1) FAIL_TEST;
+  if(fpsetdaz(1) != 0) FAIL_TEST;
+  if(fpgetdaz() != 1) FAIL_TEST;
+#ifdef __SSE2_MATH__
+  fpsetdaz(0);
+  ans = DBL_MIN / three;
+  if(ans != 0.0) FAIL_TEST;
+  fpsetftz(0);
+  denorm = DBL_MIN / three;
+  if(denorm == 0.0) FAIL_TEST;
+  fpsetdaz(1);
+  ans = denorm * three;
+  if(ans != 0.0) FAIL_TEST;
+#endif
+  fpsetftz(0);
+  fpsetdaz(0);
+  if(fpgetftz() != 0) FAIL_TEST;
+  if(fpgetdaz() != 0) FAIL_TEST;
+
+#ifdef __SSE2_MATH__
+  /* FTZ with the control word cached while only the x87 FPU is looked
+     after, the MXCSR having changed since it was last cached */
+
+  fpsetftz(1);
+  fpsetcwcache(1);
+  fpsetcwcache(0);
+  fpsetftz(0);
+  units = fpsetunit(FP_UNIT_X87);
+  fpsetcwcache(1);
+  fpsetftz(1);
+  ans = DBL_MIN / three;
+  fpsetftz(0);
+  denorm = DBL_MIN / three;
+  fpsetcwcache(0);
+  fpsetunit(units);
+  if(ans != 0.0 || denorm == 0.0) FAIL_TEST;
+#endif
+
+  fpsetsticky(FP_X_IMP);
+  before = fpsitebegin();
+  ans = one / three;
+  fpsiteend(&site, before);
+  before = fpsitebegin();
+  denorm = DBL_MIN / three;
+  ans = denorm / three;
+  fpsiteend(&site, before);
+  if(site.calls != 2) FAIL_TEST;
+  if(site.ufl != 1) FAIL_TEST;
+  if(site.dnml != 1) FAIL_TEST;
+  if((fpgetsticky() & (FP_X_IMP | FP_X_UFL)) != (FP_X_IMP | FP_X_UFL))
+    FAIL_TEST;
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
   return 0;
+#endif
 }
 
-/* test_functions
- *
- * Go through each of the functions implemented and check that they actually
- * work. There are a number of checks to make:
- *
- * 1. Do fpget/setround fpget/setsticky fpget/setmask and fpget/setprecision
- *    remember how they have been set?
- *
- * 2. Does fpsetround work? Do imprecise calculations generate expected
- *    results?
- *
- * 3. Does fpgetsticky work? Are calculations that are supposed to generate
- *    exceptions detectable?
- *
- * 4. Does fpsetprecision work? Are calculations that should work differently
- *    under different precisions working as expected?
- *
- * 5. Does fpclass work? Is the correct class returned for a variety of 
- *    classes of floating point number?
+/* test_env
  *
- * 6. Does fpgetmask work? If a mask bit is set, is an exception generated?
- *    (this probably won't be done).
+ * Check that fpsetenv puts back everything fpgetenv saved, including
+ * exception flags raised on the chip.
  */
 
-int test_functions(void) {
-  int retval = 0;
+int test_env(void) {
+#ifdef CIIEEEFP_TEST
+  int failures = 0;
+  fp_env env;
+  fp_except mask_orig;
+  fp_unit units;
+  volatile double ans;
 
-  retval |= test_settings();
-  retval |= test_rounding();
-  retval |= test_sticky();
-  retval |= test_precision();
-  retval |= test_class();
-  retval |= test_mask();
+  printf("Testing environment... ");
+  fflush(stdout);
 
-  return retval;
-}
+  fpsetround(FP_RM);
+  mask_orig = fpsetmask(FP_X_DZ);
+  fpsetsticky(FP_X_OFL);
+  ans = one / three;
+  fpgetenv(&env);
 
-/* main(argc, argv)
- *
- * A list of numbers is given as arguments. Each number is then
- * operated on each number using each operator in each rounding
- * direction.
- */
+  fpsetround(FP_RN);
+  fpsetmask(mask_orig);
+  fpsetsticky(0);
 
-int main(int argc, char **argv) {
-  double *numbers;
-  int i, j, n, r, o;
-  int compare_mode = 0;
-  int nopdiffs = 0, nansdiffs = 0, nxdiffs = 0, nclsdiffs = 0;
-  int *numansdiffs, opansdiffs[4] = {0, 0, 0, 0};
-  int rndansdiffs[4] = {0, 0, 0, 0};
-  int *numxdiffs, opxdiffs[4] = {0, 0, 0, 0}, rndxdiffs[4] = {0, 0, 0, 0};
-  int *numt, opt[4] = {0, 0, 0, 0}, rndt[4] = {0, 0, 0, 0};
-  int oprndansdiffs[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  int oprndxdiffs[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  int oprndt[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  char *compare_file;
-  FILE *fp = NULL;
+  fpsetenv(&env);
+  if(fpgetround() != FP_RM) FAIL_TEST;
+  if(fpgetmask() != FP_X_DZ) FAIL_TEST;
+  if(fpgetsticky() != (FP_X_OFL | FP_X_IMP)) FAIL_TEST;
 
-  if(argc == 1) {
-    fprintf(stderr, "Usage: %s [-test | -cmp <file> | <list of floats....>]\n",
-	    argv[0]);
-    exit(1);
-  }
-  
-  if(argc >= 2) {
-    if(strcmp(argv[1], "-cmp") == 0) {
-      if(argc < 3) {
-	fprintf(stderr, "You must supply a file to compare with\n");
-	exit(1);
-      }
-      else if(argc > 3) {
-	fprintf(stderr, "WARNING: ignoring arguments after %s\n", argv[3]);
-      }
-      compare_mode = 1;
-      compare_file = argv[2];
-      fp = fopen(compare_file, "r");
-      if(fp == NULL) {
-	fprintf(stderr, "Error opening comparison file ");
-	perror(compare_file);
-	abort();
-      }
-    }
-    else if(strcmp(argv[1], "-test") == 0) {
-      return test_functions();
-    }
-  }
+  fpsetround(FP_RN);
+  fpsetmask(mask_orig);
+  fpsetsticky(0);
 
-  if(compare_mode) {
-    if(fscanf(fp, "Numbers: %d", &n) != 1) {
-      printf("Problem reading comparison file %s\n", compare_file);
-      abort();
-    }
+  /* An environment saved without the SSE unit must leave the cached
+     MXCSR as it is on the chip */
+
+  fpsetftz(1);
+  units = fpsetunit(FP_UNIT_X87);
+  fpsetcwcache(1);
+  fpgetenv(&env);
+  fpsetenv(&env);
+  if(fpgetftz() != 1) FAIL_TEST;
+  fpsetftz(0);
+  fpsetcwcache(0);
+  fpsetunit(units);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
   }
   else {
-    n = argc - 1;
-    printf("Numbers: %d\n", n);
-  }
-  numbers = malloc(n * sizeof(double));
-  if(numbers == NULL) {
-    perror("Memory allocation");
-    abort();
-  }
-  numansdiffs = malloc(n * sizeof(int));
-  if(numansdiffs == NULL) {
-    perror("Memory allocation");
-    abort();
-  }
-  numxdiffs = malloc(n * sizeof(int));
-  if(numxdiffs == NULL) {
-    perror("Memory allocation");
-    abort();
+    printf(" %d failures\n", failures);
+    return 1;
   }
-  numt = malloc(n * sizeof(int));
-  if(numt == NULL) {
+#else
+  return 0;
+#endif
+}
+
+/* Verification
+ *
+ * With -verify, all 2^32 single precision bit patterns are widened to
+ * double, keeping their class, and put through fpclass_array(),
+ * fpclass(), fpclass_fast(), finite() and finite_fast(), checking the
+ * results against softfp_class32(). Then a sample of pairs of single
+ * precision numbers is operated on using each operator in each rounding
+ * direction, checking the answers and exceptions against the software
+ * reference in CIsoftfp.c, and likewise a sample of pairs of double
+ * precision numbers, with square roots too. The work is shared among
+ * threads, each with its own floating point state, and progress is
+ * reported on stderr.
+ */
+
+#ifdef CIIEEEFP_TEST
+
+#define VERIFY_CHUNK 4096	/* Bit patterns classified at a time */
+#define VERIFY_BLOCK 256	/* Pairs operated on per rounding change */
+#define VERIFY_SAMPLES (1L << 22)
+				/* Default number of pairs */
+#define VERIFY_REPORT 10	/* Failures printed per thread */
+#define VERIFY_FLAGS (FP_X_INV | FP_X_DNML | FP_X_DZ | FP_X_OFL \
+		      | FP_X_UFL | FP_X_IMP)
+
+typedef struct {
+  int id, nthreads;
+  long units;			/* Chunks or blocks to do in all */
+  long stride;			/* Patterns classified are those in
+				   every stride-th chunk */
+  long failures;
+  volatile long *done;		/* Units done by all threads */
+} VERIFIER;
+
+/* widen(bits) -> number
+ *
+ * Convert the bit pattern of a single precision number to a double of
+ * the same class, by moving the fields rather than the value, so that
+ * denormals stay denormal and NaNs keep their quiet bit.
+ */
+
+double widen(uint32_t bits) {
+  uint64_t exp = (bits >> 23) & 0xffU;
+  uint64_t u;
+  double d;
+
+  if(exp == 0xffU) exp = 0x7ffU;
+  else if(exp != 0) exp += 1023 - 127;
+  u = ((uint64_t)(bits >> 31) << 63) | (exp << 52)
+    | ((uint64_t)(bits & 0x7fffffU) << 29);
+  memcpy(&d, &u, sizeof(double));
+  return d;
+}
+
+/* verify_class(arg)
+ *
+ * Classify this thread's share of the chunks of bit patterns.
+ */
+
+void *verify_class(void *arg) {
+  VERIFIER *v = (VERIFIER *)arg;
+  double *d;
+  fpclass_t *expect, *got;
+  long c;
+  int k;
+
+  d = malloc(VERIFY_CHUNK * sizeof(double));
+  expect = malloc(VERIFY_CHUNK * sizeof(fpclass_t));
+  got = malloc(VERIFY_CHUNK * sizeof(fpclass_t));
+  if(d == NULL || expect == NULL || got == NULL) {
     perror("Memory allocation");
     abort();
   }
-  
-  for(i = 0; i < n; i++) {
-    if(compare_mode) {
-      if(fscanf(fp, "%lf", &numbers[i]) != 1) {
-	printf("Problem reading comparison file %s\n", compare_file);
-	abort();
-      }
+  for(c = v->id; c < v->units; c += v->nthreads) {
+    uint32_t base = (uint32_t)(c * v->stride * VERIFY_CHUNK);
+
+    for(k = 0; k < VERIFY_CHUNK; k++) {
+      d[k] = widen(base + k);
+      expect[k] = softfp_class32(base + k);
     }
-    else {
-      numbers[i] = atof(argv[i + 1]);
-      printf("%s\n", argv[i + 1]);
+    fpclass_array(d, VERIFY_CHUNK, got);
+    for(k = 0; k < VERIFY_CHUNK; k++) {
+      int fin = expect[k] > FP_PINF;
+      const char *what = NULL;
+
+      if(got[k] != expect[k]) what = "fpclass_array";
+      else if(fpclass(d[k]) != expect[k]) what = "fpclass";
+      else if(fpclass_fast(d[k]) != expect[k]) what = "fpclass_fast";
+      else if((finite(d[k]) != 0) != fin) what = "finite";
+      else if((finite_fast(d[k]) != 0) != fin) what = "finite_fast";
+      if(what != NULL && v->failures++ < VERIFY_REPORT) {
+	printf("\t%s wrong for %08lx (%s)\n", what,
+	       (unsigned long)(base + k), fpcls[expect[k]]);
+      }
     }
-    numansdiffs[i] = 0;
-    numxdiffs[i] = 0;
-    numt[i] = 0;
+    __sync_fetch_and_add(v->done, 1L);
   }
 
-  for(i = 0; i < n; i++) {
-    for(j = 0; j < n; j++) {
-      for(o = 0; o <= 3; o++) {
-	for(r = 0; r <= 3; r++) {
-	  int pansdiffs = nansdiffs;
-	  int pxdiffs = nxdiffs;
-
-	  op(numbers[i], numbers[j], o, r, fp,
-	     &nopdiffs, &nansdiffs, &nxdiffs, &nclsdiffs);
-
-	  if(pansdiffs != nansdiffs) {
-	    numansdiffs[i]++;
-	    numansdiffs[j]++;
-	    opansdiffs[o]++;
-	    rndansdiffs[r]++;
-	    oprndansdiffs[(o * 4) + r]++;
+  free(d);
+  free(expect);
+  free(got);
+  return NULL;
+}
+
+/* verify_random(state) -> random bits
+ *
+ * Return 32 bits from an xorshift generator with the given state.
+ */
+
+uint32_t verify_random(uint64_t *state) {
+  (*state) ^= (*state) << 13;
+  (*state) ^= (*state) >> 7;
+  (*state) ^= (*state) << 17;
+  return (uint32_t)((*state) >> 16);
+}
+
+/* verify_operand(state) -> bit pattern
+ *
+ * Choose a single precision operand: half of them uniformly from all
+ * the bit patterns, and half with exponents and fractions at the ends
+ * of their ranges, where the rounding, underflow and overflow cases
+ * are.
+ */
+
+uint32_t verify_operand(uint64_t *state) {
+  static const uint32_t exps[12] = {
+    0, 1, 2, 24, 103, 126, 127, 128, 151, 253, 254, 255
+  };
+  static const uint32_t fracs[6] = {
+    0, 1, 0x7fffffU, 0x400000U, 0x3fffffU, 0x400001U
+  };
+  uint32_t r = verify_random(state);
+  uint32_t frac;
+
+  if(r & 1) return verify_random(state);
+  frac = ((r >> 1) & 1) ? fracs[(r >> 2) % 6]
+    : (verify_random(state) & 0x7fffffU);
+  return ((r >> 31) << 31) | (exps[(r >> 8) % 12] << 23) | frac;
+}
+
+/* verify_arith(arg)
+ *
+ * Operate on this thread's share of the blocks of pairs of numbers.
+ * Each block's numbers come from a generator seeded with the block
+ * number, so the same numbers are checked whatever the number of
+ * threads.
+ */
+
+void *verify_arith(void *arg) {
+  VERIFIER *v = (VERIFIER *)arg;
+  uint32_t a[VERIFY_BLOCK], b[VERIFY_BLOCK];
+  long blk;
+  int k, o, r;
+
+  fpsetftz(0);
+  fpsetdaz(0);
+  for(blk = v->id; blk < v->units; blk += v->nthreads) {
+    uint64_t state = ((uint64_t)blk + 1) * UINT64_C(0x9e3779b97f4a7c15);
+
+    for(k = 0; k < VERIFY_BLOCK; k++) {
+      a[k] = verify_operand(&state);
+      b[k] = verify_operand(&state);
+    }
+    for(r = 0; r <= 3; r++) {
+      fpsetround(fpdir[r]);
+      for(k = 0; k < VERIFY_BLOCK; k++) {
+	for(o = 0; o <= 3; o++) {
+	  volatile float x, y, z;
+	  float f;
+	  uint32_t hw, sw;
+	  fp_except hwx, swx = 0;
+
+	  memcpy(&f, &a[k], sizeof(float));
+	  x = f;
+	  memcpy(&f, &b[k], sizeof(float));
+	  y = f;
+	  fpsetsticky(0);
+	  switch(o) {
+	  case PLUS:
+	    z = x + y;
+	    sw = softfp_add32(a[k], b[k], fpdir[r], &swx);
+	    break;
+	  case MINUS:
+	    z = x - y;
+	    sw = softfp_sub32(a[k], b[k], fpdir[r], &swx);
+	    break;
+	  case DIVIDE:
+	    z = x / y;
+	    sw = softfp_div32(a[k], b[k], fpdir[r], &swx);
+	    break;
+	  default:
+	    z = x * y;
+	    sw = softfp_mul32(a[k], b[k], fpdir[r], &swx);
+	  }
+	  hwx = fpgetsticky() & VERIFY_FLAGS;
+	  f = z;
+	  memcpy(&hw, &f, sizeof(float));
+	  if(hw != sw && (o == PLUS || o == MULTIPLY)) {
+				/* The compiler may have swapped the
+				   operands, which changes which NaN
+				   operand is returned */
+	    fp_except swapx = 0;
+	    uint32_t swap = (o == PLUS)
+	      ? softfp_add32(b[k], a[k], fpdir[r], &swapx)
+	      : softfp_mul32(b[k], a[k], fpdir[r], &swapx);
+
+	    if(swap == hw && swapx == swx) sw = swap;
+	  }
+	  if((hw != sw || hwx != swx) && v->failures++ < VERIFY_REPORT) {
+	    printf("\t%08lx %s%s %08lx = %08lx (flags %02x), "
+		   "expected %08lx (flags %02x)\n",
+		   (unsigned long)a[k], operators[o], rnddir[r],
+		   (unsigned long)b[k], (unsigned long)hw, hwx,
+		   (unsigned long)sw, swx);
+	  }
+	}
+      }
+    }
+    __sync_fetch_and_add(v->done, 1L);
+  }
+  fpsetround(FP_RN);
+  fpsetsticky(0);
+
+  return NULL;
+}
+
+/* verify_operand64(state) -> bit pattern
+ *
+ * Choose a double precision operand in the same way as
+ * verify_operand().
+ */
+
+uint64_t verify_operand64(uint64_t *state) {
+  static const uint64_t exps[12] = {
+    0, 1, 2, 53, 970, 1022, 1023, 1024, 1076, 2045, 2046, 2047
+  };
+  static const uint64_t fracs[6] = {
+    0, 1, UINT64_C(0xfffffffffffff), UINT64_C(0x8000000000000),
+    UINT64_C(0x7ffffffffffff), UINT64_C(0x8000000000001)
+  };
+  uint32_t r = verify_random(state);
+  uint64_t frac;
+
+  if(r & 1) {
+    return ((uint64_t)verify_random(state) << 32) | verify_random(state);
+  }
+  frac = ((r >> 1) & 1) ? fracs[(r >> 2) % 6]
+    : ((((uint64_t)verify_random(state) << 32) | verify_random(state))
+       & UINT64_C(0xfffffffffffff));
+  return ((uint64_t)(r >> 31) << 63) | (exps[(r >> 8) % 12] << 52) | frac;
+}
+
+/* verify_arith64(arg)
+ *
+ * Operate on this thread's share of the blocks of pairs of double
+ * precision numbers, getting each block's expected answers from
+ * softfp_batch64() in one call per operator and rounding direction.
+ */
+
+#ifdef __SSE2_MATH__
+void *verify_arith64(void *arg) {
+  static const char *names[5] = { "+", "-", "*", "/", "sqrt" };
+  VERIFIER *v = (VERIFIER *)arg;
+  uint64_t a[VERIFY_BLOCK], b[VERIFY_BLOCK], sw[VERIFY_BLOCK];
+  fp_except swx[VERIFY_BLOCK];
+  long blk;
+  int k, o, r;
+
+  fpsetftz(0);
+  fpsetdaz(0);
+  for(blk = v->id; blk < v->units; blk += v->nthreads) {
+    uint64_t state = ((uint64_t)blk + 1) * UINT64_C(0x9e3779b97f4a7c15);
+
+    for(k = 0; k < VERIFY_BLOCK; k++) {
+      a[k] = verify_operand64(&state);
+      b[k] = verify_operand64(&state);
+    }
+    for(r = 0; r <= 3; r++) {
+      fpsetround(fpdir[r]);
+      for(o = SOFTFP_ADD; o <= SOFTFP_SQRT; o++) {
+	softfp_batch64((softfp_op)o, FP_UNIT_SSE, fpdir[r], FP_PC_DBL,
+		       a, b, VERIFY_BLOCK, sw, swx);
+	for(k = 0; k < VERIFY_BLOCK; k++) {
+	  volatile double x, y, z;
+	  double d;
+	  uint64_t hw, expect = sw[k];
+	  fp_except hwx, expectx = swx[k];
+
+	  memcpy(&d, &a[k], sizeof(double));
+	  x = d;
+	  memcpy(&d, &b[k], sizeof(double));
+	  y = d;
+	  fpsetsticky(0);
+	  switch(o) {
+	  case SOFTFP_ADD:
+	    z = x + y;
+	    break;
+	  case SOFTFP_SUB:
+	    z = x - y;
+	    break;
+	  case SOFTFP_MUL:
+	    z = x * y;
+	    break;
+	  case SOFTFP_DIV:
+	    z = x / y;
+	    break;
+	  default:
+	    z = _mm_cvtsd_f64(_mm_sqrt_sd(_mm_set_sd(x), _mm_set_sd(x)));
+	  }
+	  hwx = fpgetsticky() & VERIFY_FLAGS;
+	  d = z;
+	  memcpy(&hw, &d, sizeof(double));
+	  if(hw != expect && (o == SOFTFP_ADD || o == SOFTFP_MUL)) {
+				/* As in verify_arith() */
+	    fp_except swapx = 0;
+	    uint64_t swap = (o == SOFTFP_ADD)
+	      ? softfp_add64(b[k], a[k], fpdir[r], &swapx)
+	      : softfp_mul64(b[k], a[k], fpdir[r], &swapx);
+
+	    if(swap == hw && swapx == expectx) expect = swap;
 	  }
-	  if(pxdiffs != nxdiffs) {
-	    numxdiffs[i]++;
-	    numxdiffs[j]++;
-	    opxdiffs[o]++;
-	    rndxdiffs[r]++;
-	    oprndxdiffs[(o * 4) + r]++;
+	  if((hw != expect || hwx != expectx)
+	     && v->failures++ < VERIFY_REPORT) {
+	    printf("\t%016llx %s%s %016llx = %016llx (flags %02x), "
+		   "expected %016llx (flags %02x)\n",
+		   (unsigned long long)a[k], names[o], rnddir[r],
+		   (unsigned long long)b[k], (unsigned long long)hw, hwx,
+		   (unsigned long long)expect, expectx);
+	  }
+	}
+      }
+    }
+    __sync_fetch_and_add(v->done, 1L);
+  }
+  fpsetround(FP_RN);
+  fpsetsticky(0);
+
+  return NULL;
+}
+#endif
+
+/* run_verify(fn, nthreads, units, stride, label) -> failures
+ *
+ * Share units of work out among nthreads threads running fn, and
+ * wait for them to finish, reporting progress if label is not NULL.
+ */
+
+long run_verify(void *(*fn)(void *), int nthreads, long units, long stride,
+		const char *label) {
+  pthread_t *threads;
+  VERIFIER *verifiers;
+  volatile long done = 0;
+  long failures = 0;
+  int t;
+
+  threads = malloc(nthreads * sizeof(pthread_t));
+  verifiers = malloc(nthreads * sizeof(VERIFIER));
+  if(threads == NULL || verifiers == NULL) {
+    perror("Memory allocation");
+    abort();
+  }
+  for(t = 0; t < nthreads; t++) {
+    verifiers[t].id = t;
+    verifiers[t].nthreads = nthreads;
+    verifiers[t].units = units;
+    verifiers[t].stride = stride;
+    verifiers[t].failures = 0;
+    verifiers[t].done = &done;
+    if(pthread_create(&threads[t], NULL, fn, &verifiers[t]) != 0) {
+      perror("pthread_create");
+      abort();
+    }
+  }
+  while(label != NULL && done < units) {
+    fprintf(stderr, "\r%s: %5.1f%%", label, (100.0 * done) / units);
+    usleep(250000);
+  }
+  for(t = 0; t < nthreads; t++) {
+    pthread_join(threads[t], NULL);
+    failures += verifiers[t].failures;
+  }
+  if(label != NULL) fprintf(stderr, "\r%s: done  \n", label);
+
+  free(threads);
+  free(verifiers);
+  return failures;
+}
+
+/* verify(nthreads, samples) -> exit status
+ *
+ * Do the exhaustive classification check and arithmetic on samples
+ * pairs of numbers, using nthreads threads.
+ */
+
+int verify(int nthreads, long samples) {
+  long failures, total = 0;
+  long blocks = (samples + VERIFY_BLOCK - 1) / VERIFY_BLOCK;
+
+  printf("Classifying all 2^32 single precision bit patterns on %d "
+	 "threads...\n", nthreads);
+  fflush(stdout);
+  failures = run_verify(verify_class, nthreads,
+			(1L << 32) / VERIFY_CHUNK, 1L, "Classification");
+  printf("%ld failures\n", failures);
+  total += failures;
+
+#ifdef __SSE_MATH__
+  printf("Operating on %ld pairs of single precision numbers with each "
+	 "operator\nin each rounding direction on %d threads...\n",
+	 blocks * VERIFY_BLOCK, nthreads);
+  fflush(stdout);
+  failures = run_verify(verify_arith, nthreads, blocks, 1L, "Arithmetic");
+  printf("%ld failures\n", failures);
+  total += failures;
+#else
+  printf("Arithmetic not checked: single precision arithmetic is not "
+	 "done on the SSE unit\n");
+#endif
+
+#ifdef __SSE2_MATH__
+  printf("Operating on %ld pairs of double precision numbers with each "
+	 "operator and\nsquare root in each rounding direction on %d "
+	 "threads...\n", blocks * VERIFY_BLOCK, nthreads);
+  fflush(stdout);
+  failures = run_verify(verify_arith64, nthreads, blocks, 1L,
+			"Double arithmetic");
+  printf("%ld failures\n", failures);
+  total += failures;
+#else
+  printf("Double arithmetic not checked: double precision arithmetic is "
+	 "not done on\nthe SSE unit (use -soft to compare the x87 FPU with "
+	 "the software reference)\n");
+  (void)blocks;
+#endif
+
+  return total != 0;
+}
+
+#endif
+
+/* test_verify
+ *
+ * Check every 1024th chunk of single precision bit patterns is
+ * classified correctly, and that a few thousand calculations agree
+ * with the software reference, as -verify does more thoroughly.
+ */
+
+int test_verify(void) {
+#ifdef CIIEEEFP_TEST
+  long failures;
+
+  printf("Testing against software reference... ");
+  fflush(stdout);
+
+  failures = run_verify(verify_class, 1, (1L << 32) / VERIFY_CHUNK / 1024,
+			1024L, NULL);
+#ifdef __SSE_MATH__
+  failures += run_verify(verify_arith, 1, 16L, 1L, NULL);
+#endif
+#ifdef __SSE2_MATH__
+  failures += run_verify(verify_arith64, 1, 16L, 1L, NULL);
+#endif
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %ld failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_softfp
+ *
+ * Check the software reference's emulation of the x87 FPU, which
+ * test_verify cannot compare with the SSE unit: 1 + (2^-53 + 2^-105)
+ * is rounded to 1 + 2^-53 with extended precision control, then to 1
+ * when stored as a double, but to 1 + 2^-52 with double precision
+ * control, and 1 + 2^-24 to 1 with single. Unlike the SSE unit, the
+ * x87 FPU raises FP_X_DNML when it loads a denormalised operand,
+ * whatever else the operation raises. The SSE unit raises only
+ * FP_X_INV for the square root of a negative denormalised number, and
+ * only FP_X_DZ dividing one by zero, never using its value; where the
+ * arithmetic is done on the SSE unit, the chip is asked as well.
+ */
+
+int test_softfp(void) {
+#ifdef CIIEEEFP_TEST
+  static const struct {
+    softfp_op op;
+    uint64_t a, b;
+    fp_rnd rnd;
+    fp_pctl pctl;
+    uint64_t ans;
+    fp_except x;
+  } cases[] = {
+    { SOFTFP_ADD, UINT64_C(0x3ff0000000000000), UINT64_C(0x3ca0000000000001),
+      FP_RN, FP_PC_EXT, UINT64_C(0x3ff0000000000000), FP_X_IMP },
+    { SOFTFP_ADD, UINT64_C(0x3ff0000000000000), UINT64_C(0x3ca0000000000001),
+      FP_RN, FP_PC_DBL, UINT64_C(0x3ff0000000000001), FP_X_IMP },
+    { SOFTFP_ADD, UINT64_C(0x3ff0000000000000), UINT64_C(0x3e70000000000000),
+      FP_RN, FP_PC_SGL, UINT64_C(0x3ff0000000000000), FP_X_IMP },
+    { SOFTFP_ADD, UINT64_C(0x3ff0000000000000), UINT64_C(0x3e70000000000000),
+      FP_RP, FP_PC_SGL, UINT64_C(0x3ff0000020000000), FP_X_IMP },
+    { SOFTFP_SQRT, UINT64_C(0x8000000000000001), 0,
+      FP_RN, FP_PC_EXT, UINT64_C(0xfff8000000000000),
+      FP_X_INV | FP_X_DNML },
+    { SOFTFP_DIV, UINT64_C(0x0000000000000001), 0,
+      FP_RN, FP_PC_DBL, UINT64_C(0x7ff0000000000000),
+      FP_X_DZ | FP_X_DNML }
+  };
+  int failures = 0;
+  size_t i;
+  uint64_t ans;
+  fp_except x, hw;
+  volatile double denorm;
+
+  printf("Testing software x87 emulation... ");
+  fflush(stdout);
+  for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    x = 0;
+    ans = softfp_x87_64(cases[i].op, cases[i].a, cases[i].b, cases[i].rnd,
+			cases[i].pctl, &x);
+    if(ans != cases[i].ans || x != cases[i].x) FAIL_TEST;
+  }
+
+  /* The square root of a negative denormalised number, and one
+     divided by zero, on the SSE unit */
+
+  x = 0;
+  ans = softfp_sqrt64(UINT64_C(0x8000000000000001), FP_RN, &x);
+  if(ans != UINT64_C(0xfff8000000000000) || x != FP_X_INV) FAIL_TEST;
+  hw = x;
+  x = 0;
+  ans = softfp_div64(UINT64_C(0x0000000000000001), 0, FP_RN, &x);
+  if(ans != UINT64_C(0x7ff0000000000000) || x != FP_X_DZ) FAIL_TEST;
+#ifdef __SSE2_MATH__
+  denorm = -DBL_MIN * 0x1p-52;
+  fpsetsticky(0);
+  denorm = _mm_cvtsd_f64(_mm_sqrt_sd(_mm_set_sd(denorm),
+				     _mm_set_sd(denorm)));
+  if(fpgetsticky() != hw) FAIL_TEST;
+  denorm = DBL_MIN * 0x1p-52;
+  fpsetsticky(0);
+  denorm = denorm / zero;
+  if(fpgetsticky() != x) FAIL_TEST;
+  fpsetsticky(0);
+#endif
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_prof
+ *
+ * Check that the exception profiler traps divisions by zero and
+ * invalid operations, that the calculations still give their usual
+ * results and raise their usual flags, that a trapping region entered
+ * while profiling traps the exceptions it unmasked, even though the
+ * profiler's handler was installed after the region's, and that
+ * nothing is trapped once it has been stopped.
+ */
+
+int test_prof(void) {
+#ifdef CIIEEEFP_TEST
+  volatile double num = 1.0, den = 0.0, ans;
+  volatile int reached = 0;
+  fp_try region;
+  fp_except x;
+  int failures = 0;
+  int i;
+
+  printf("Testing exception profiler... ");
+  fflush(stdout);
+  fpsetsticky(0);
+  if(fpprofstart(FP_X_DZ | FP_X_INV) != 0) {
+    printf(" not supported\n");
+    return 0;
+  }
+  for(i = 0; i < 3; i++) {
+    ans = num / den;
+    if(fpclass(ans) != FP_PINF) FAIL_TEST;
+  }
+  ans = den / den;
+  if(fpclass(ans) != FP_QNAN) FAIL_TEST;
+  if(fpprofcount() != 4) FAIL_TEST;
+  if(fpgetsticky() != (FP_X_DZ | FP_X_INV)) FAIL_TEST;
+  fp_try_enter(&region, FP_X_INV);
+  if(sigsetjmp(region.jmp, 1) == 0) {
+    ans = den / den;
+    reached = 1;
+    x = fp_try_end(&region);
+  }
+  else x = fp_try_caught(&region);
+  if(reached) FAIL_TEST;
+  if(x != FP_X_INV) FAIL_TEST;
+  if(fpprofcount() != 4) FAIL_TEST;
+  fpprofstop();
+  ans = num / den;
+  if(fpprofcount() != 4) FAIL_TEST;
+  fpprofreset();
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_try
+ *
+ * Check that a trapping region returns to its start with the
+ * exception raised and the environment from before it, that nested
+ * regions trap in the innermost asking for the exception raised, and
+ * that a region without a trap returns the exceptions raised in it.
+ */
+
+int test_try(void) {
+#ifdef CIIEEEFP_TEST
+  volatile double num = 1.0, den = 0.0, big = DBL_MAX, ans;
+  volatile int reached = 0;
+  fp_try outer, inner;
+  fp_except x, mask = fpgetmask();
+  int failures = 0;
+
+  printf("Testing trapping regions... ");
+  fflush(stdout);
+  fpsetround(FP_RM);
+  fpsetsticky(FP_X_IMP);
+  fp_try_enter(&outer, FP_X_DZ | FP_X_OFL);
+  if(sigsetjmp(outer.jmp, 1) == 0) {
+    ans = num / den;
+    reached = 1;
+    x = fp_try_end(&outer);
+  }
+  else x = fp_try_caught(&outer);
+  if(reached) FAIL_TEST;
+  if(x != FP_X_DZ) FAIL_TEST;
+  if(fpgetround() != FP_RM) FAIL_TEST;
+  if(fpgetmask() != mask) FAIL_TEST;
+  if(fpgetsticky() != (FP_X_DZ | FP_X_IMP)) FAIL_TEST;
+
+  fpsetsticky(0);
+  fp_try_enter(&outer, FP_X_OFL);
+  if(sigsetjmp(outer.jmp, 1) == 0) {
+    ans = num / three;
+    fp_try_enter(&inner, FP_X_INV);
+    if(sigsetjmp(inner.jmp, 1) == 0) {
+      ans = den / den;
+      x = fp_try_end(&inner);
+    }
+    else x = fp_try_caught(&inner);
+    if(x != FP_X_INV) FAIL_TEST;
+    if(fpgetmask() != (mask | FP_X_OFL)) FAIL_TEST;
+    x = fp_try_end(&outer);
+  }
+  else x = fp_try_caught(&outer);
+  if(x != (FP_X_INV | FP_X_IMP)) FAIL_TEST;
+  if(fpgetmask() != mask) FAIL_TEST;
+
+  fpsetsticky(0);
+  reached = 0;
+  fp_try_enter(&outer, FP_X_OFL);
+  if(sigsetjmp(outer.jmp, 1) == 0) {
+    ans = num / three;
+    fp_try_enter(&inner, FP_X_INV);
+    if(sigsetjmp(inner.jmp, 1) == 0) {
+      ans = big * big;
+      reached = 1;
+      fp_try_end(&inner);
+    }
+    else fp_try_caught(&inner);
+    reached = 2;
+    x = fp_try_end(&outer);
+  }
+  else x = fp_try_caught(&outer);
+  if(reached != 0) FAIL_TEST;
+  if(x != (FP_X_OFL | FP_X_IMP)) FAIL_TEST;
+  if(fpgetmask() != mask) FAIL_TEST;
+  if(fpgetsticky() != x) FAIL_TEST;
+  fp_try_enter(&outer, FP_X_DZ);
+  if(sigsetjmp(outer.jmp, 1) == 0) {
+    ans = num / den;
+    x = fp_try_end(&outer);
+  }
+  else x = fp_try_caught(&outer);
+  if(x != FP_X_DZ) FAIL_TEST;
+  fpsetround(FP_RN);
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_batch
+ *
+ * Check the batch arithmetic on a block of double precision numbers
+ * that is not a whole number of vectors or bitmap words, in each
+ * rounding direction: the results and the bitmaps of every exception
+ * must agree with the software reference element by element, and
+ * exceptions not tracked must have empty bitmaps. The same must hold
+ * with the results overwriting the first operands. The exceptions
+ * must be in the sticky bits whatever units the library looks after.
+ */
+
+#define TEST_BATCH 1001
+
+int test_batch(void) {
+#ifdef CIIEEEFP_TEST
+  static fp_except (*const batches[4])(const double *, const double *,
+				       double *, size_t, fp_rnd, fp_except,
+				       uint64_t *) = {
+    fpbatch_add, fpbatch_sub, fpbatch_mul, fpbatch_div
+  };
+  static const softfp_op ops[4] = {
+    SOFTFP_ADD, SOFTFP_SUB, SOFTFP_MUL, SOFTFP_DIV
+  };
+  static double a[TEST_BATCH], b[TEST_BATCH], r[TEST_BATCH];
+  static uint64_t ua[TEST_BATCH], ub[TEST_BATCH], sw[TEST_BATCH];
+  static fp_except swx[TEST_BATCH];
+  static uint64_t maps[FP_BATCH_NMAPS * FP_BATCH_WORDS(TEST_BATCH)];
+  static const double big[2] = { DBL_MAX, 1.0 };
+  uint64_t state = 42;
+  fp_except track, raised, all;
+  fp_unit units;
+  int failures = 0;
+  int i, o, rd, e;
+
+  printf("Testing batch arithmetic... ");
+  fflush(stdout);
+  for(i = 0; i < TEST_BATCH; i++) {
+    ua[i] = verify_operand64(&state);
+    ub[i] = verify_operand64(&state);
+    memcpy(&a[i], &ua[i], sizeof(double));
+    memcpy(&b[i], &ub[i], sizeof(double));
+  }
+  for(o = 0; o < 4; o++) {
+    for(rd = 0; rd < 4; rd++) {
+      int wrong = 0;
+
+      track = (rd & 1) ? (VERIFY_FLAGS & ~FP_X_IMP) : VERIFY_FLAGS;
+      fpsetsticky(0);
+      softfp_batch64(ops[o], FP_UNIT_SSE, fpdir[rd], FP_PC_DBL, ua, ub,
+		     TEST_BATCH, sw, swx);
+      raised = batches[o](a, b, r, TEST_BATCH, fpdir[rd], track, maps);
+      all = 0U;
+      for(i = 0; i < TEST_BATCH; i++) {
+	uint64_t bits;
+
+	memcpy(&bits, &r[i], sizeof(double));
+	if(bits != sw[i]) wrong = 1;
+	all |= swx[i];
+	for(e = 0; e < FP_BATCH_NMAPS; e++) {
+	  if(FP_BATCH_TEST(FP_BATCH_MAP(maps, TEST_BATCH, 1U << e), i)
+	     != ((swx[i] & track & (1U << e)) != 0U)) {
+	    wrong = 1;
 	  }
-	  numt[i]++;
-	  numt[j]++;
-	  opt[o]++;
-	  rndt[r]++;
-	  oprndt[(o * 4) + r]++;
 	}
       }
+      if(wrong || raised != all || (fpgetsticky() & VERIFY_FLAGS) != all
+	 || fpgetround() != FP_RN) FAIL_TEST;
+    }
+  }
+
+  /* In place, the results overwriting the first operands */
+
+  for(o = 0; o < 4; o++) {
+    int wrong = 0;
+
+    softfp_batch64(ops[o], FP_UNIT_SSE, FP_RN, FP_PC_DBL, ua, ub,
+		   TEST_BATCH, sw, swx);
+    memcpy(r, a, sizeof(r));
+    batches[o](r, b, r, TEST_BATCH, FP_RN, VERIFY_FLAGS, maps);
+    for(i = 0; i < TEST_BATCH; i++) {
+      uint64_t bits;
+
+      memcpy(&bits, &r[i], sizeof(double));
+      if(bits != sw[i]) wrong = 1;
+      for(e = 0; e < FP_BATCH_NMAPS; e++) {
+	if(FP_BATCH_TEST(FP_BATCH_MAP(maps, TEST_BATCH, 1U << e), i)
+	   != ((swx[i] & VERIFY_FLAGS & (1U << e)) != 0U)) {
+	  wrong = 1;
+	}
+      }
+    }
+    if(wrong) FAIL_TEST;
+  }
+
+  /* The exceptions must reach the sticky bits with the library looking
+     after the x87 FPU alone */
+
+  units = fpsetunit(FP_UNIT_X87);
+  fpsetsticky(0);
+  raised = fpbatch_mul(big, big, r, 2, FP_RN, 0U, NULL);
+  if(!(raised & FP_X_OFL) || fpgetsticky() != raised) FAIL_TEST;
+  fpsetunit(units);
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_interval
+ *
+ * Check the interval arithmetic. Intervals of one number must have the
+ * bounds the software reference gives rounding down and up, the array
+ * operations must agree with the scalar ones on intervals of random
+ * numbers, and a few intervals with zeros, infinities and negative
+ * numbers must give what they should. The rounding direction must be
+ * left as it was. The sign of a zero bound doesn't matter.
+ */
+
+#define TEST_INTERVAL 1001
+
+static int interval_same(double a, double b) {
+  return a == b || (a != a && b != b);
+}
+
+int test_interval(void) {
+#ifdef CIIEEEFP_TEST
+  static fp_interval (*const scalars[4])(fp_interval, fp_interval) = {
+    fpi_add, fpi_sub, fpi_mul, fpi_div
+  };
+  static void (*const arrays[4])(const fp_interval *, const fp_interval *,
+				 fp_interval *, size_t) = {
+    fpi_add_array, fpi_sub_array, fpi_mul_array, fpi_div_array
+  };
+  static uint64_t (*const softs[4])(uint64_t, uint64_t, fp_rnd,
+				    fp_except *) = {
+    softfp_add64, softfp_sub64, softfp_mul64, softfp_div64
+  };
+  static fp_interval x[TEST_INTERVAL], y[TEST_INTERVAL], r[TEST_INTERVAL];
+  uint64_t state = 42;
+  fp_except flags;
+  fp_interval p, q, s;
+  int failures = 0;
+  int i, o;
+
+  printf("Testing interval arithmetic... ");
+  fflush(stdout);
+  for(o = 0; o < 5; o++) {
+    int wrong = 0;
+
+    for(i = 0; i < TEST_INTERVAL; i++) {
+      uint64_t ua = verify_operand64(&state), ub = verify_operand64(&state);
+      uint64_t ulo, uhi;
+      double a, b, lo, hi;
+
+      memcpy(&a, &ua, sizeof(double));
+      memcpy(&b, &ub, sizeof(double));
+      p.lo = p.hi = a;
+      q.lo = q.hi = b;
+      if(o < 4) {
+	s = scalars[o](p, q);
+	ulo = softs[o](ua, ub, FP_RM, &flags);
+	uhi = softs[o](ua, ub, FP_RP, &flags);
+      }
+      else {
+	s = fpi_sqrt(p);
+	ulo = softfp_sqrt64(ua, FP_RM, &flags);
+	uhi = softfp_sqrt64(ua, FP_RP, &flags);
+      }
+      memcpy(&lo, &ulo, sizeof(double));
+      memcpy(&hi, &uhi, sizeof(double));
+      if(lo == lo && (o != 3 || b != 0.0)
+	 && (!interval_same(s.lo, lo) || !interval_same(s.hi, hi))) {
+	wrong = 1;
+      }
+      x[i].lo = a < b ? a : b;
+      x[i].hi = a < b ? b : a;
+      ua = verify_operand64(&state);
+      ub = verify_operand64(&state);
+      memcpy(&a, &ua, sizeof(double));
+      memcpy(&b, &ub, sizeof(double));
+      y[i].lo = a < b ? a : b;
+      y[i].hi = a < b ? b : a;
+    }
+    if(o < 4) arrays[o](x, y, r, TEST_INTERVAL);
+    else fpi_sqrt_array(x, r, TEST_INTERVAL);
+    for(i = 0; i < TEST_INTERVAL; i++) {
+      s = o < 4 ? scalars[o](x[i], y[i]) : fpi_sqrt(x[i]);
+      if(!interval_same(s.lo, r[i].lo) || !interval_same(s.hi, r[i].hi)) {
+	wrong = 1;
+      }
+    }
+    if(wrong || fpgetround() != FP_RN) FAIL_TEST;
+  }
+
+  p.lo = p.hi = 1.0;
+  q.lo = q.hi = 3.0;
+  fpsetround(FP_RP);
+  s = fpi_div(p, q);
+  if(fpgetround() != FP_RP || s.lo >= s.hi
+     || s.hi != nextafter(s.lo, INFINITY)) FAIL_TEST;
+  fpsetround(FP_RN);
+  q.lo = -1.0;
+  s = fpi_div(p, q);
+  if(s.lo != -INFINITY || s.hi != INFINITY) FAIL_TEST;
+  p.lo = -INFINITY;
+  p.hi = INFINITY;
+  q.lo = q.hi = 0.0;
+  s = fpi_mul(p, q);
+  if(s.lo != 0.0 || s.hi != 0.0) FAIL_TEST;
+  p.lo = -1.0;
+  p.hi = 4.0;
+  s = fpi_sqrt(p);
+  if(s.lo != 0.0 || s.hi != 2.0) FAIL_TEST;
+  p.lo = p.hi = 2.0;
+  s = fpi_sqrt(p);
+  if(s.lo * s.lo >= 2.0 || s.hi != nextafter(s.lo, INFINITY)
+     || fpgetround() != FP_RN) FAIL_TEST;
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_elemfn
+ *
+ * Check the directed-rounding elementary functions. On random
+ * arguments the enclosures must be one double or two adjacent ones
+ * bracketing the long double libm result, allowing for its error and
+ * for pow's larger error bound, which can leave one double between
+ * the bounds when the result is within it. They must agree with the
+ * scalar functions and the arrays of them rounding down and up, and
+ * rounding to nearest must give a double between them. Some results are
+ * exact, and some just past the range of doubles. The rounding
+ * direction must be left as it was.
+ */
+
+#define TEST_ELEMFN 1001
+
+static int elemfn_brackets(fp_interval r, long double ref, long double rel) {
+  long double tol = fabsl(ref) * rel;
+  double mid = nextafter(r.lo, INFINITY);
+
+  if(r.lo != r.lo) return ref != ref;
+  return r.lo <= ref + tol && ref - tol <= r.hi
+    && (r.hi == r.lo || r.hi == mid
+	|| (r.hi == nextafter(mid, INFINITY) && fabsl(ref - mid) <= tol));
+}
+
+int test_elemfn(void) {
+#ifdef CIIEEEFP_TEST
+  static double (*const scalars[4])(double, fp_rnd) = {
+    fpe_exp, fpe_log, fpe_sin, fpe_cos
+  };
+  static void (*const arrays[4])(const double *, double *, size_t,
+				 fp_rnd) = {
+    fpe_exp_array, fpe_log_array, fpe_sin_array, fpe_cos_array
+  };
+  static void (*const encloses[4])(const double *, fp_interval *,
+				   size_t) = {
+    fpe_exp_enclose, fpe_log_enclose, fpe_sin_enclose, fpe_cos_enclose
+  };
+  static long double (*const refs[4])(long double) = {
+    expl, logl, sinl, cosl
+  };
+  static double x[TEST_ELEMFN], y[TEST_ELEMFN];
+  static double lo[TEST_ELEMFN], hi[TEST_ELEMFN], rn[TEST_ELEMFN];
+  static fp_interval r[TEST_ELEMFN];
+  uint64_t state = 42;
+  int failures = 0;
+  int i, f;
+
+  printf("Testing elementary functions... ");
+  fflush(stdout);
+  for(f = 0; f < 5; f++) {
+    int wrong = 0;
+
+    for(i = 0; i < TEST_ELEMFN; i++) {
+      double u = (double)(((uint64_t)verify_random(&state) << 21)
+			  ^ verify_random(&state)) * 0x1p-53;
+      double v = (double)verify_random(&state) * 0x1p-32;
+
+      switch(f) {
+      case 0:
+	x[i] = (u - 0.5) * 1400.0;
+	break;
+      case 1:
+	x[i] = ldexp(0.5 + u, (int)(v * 2000.0) - 1000);
+	break;
+      case 4:
+	x[i] = 0.01 + u * 10.0;
+	y[i] = (v - 0.5) * 200.0;
+	break;
+      default:
+	x[i] = ldexp(u - 0.5, (int)(v * 40.0));
+	break;
+      }
+    }
+    if(f < 4) {
+      encloses[f](x, r, TEST_ELEMFN);
+      arrays[f](x, lo, TEST_ELEMFN, FP_RM);
+      arrays[f](x, hi, TEST_ELEMFN, FP_RP);
+      arrays[f](x, rn, TEST_ELEMFN, FP_RN);
+    }
+    else {
+      fpe_pow_enclose(x, y, r, TEST_ELEMFN);
+      fpe_pow_array(x, y, lo, TEST_ELEMFN, FP_RM);
+      fpe_pow_array(x, y, hi, TEST_ELEMFN, FP_RP);
+      fpe_pow_array(x, y, rn, TEST_ELEMFN, FP_RN);
+    }
+    for(i = 0; i < TEST_ELEMFN; i++) {
+      long double ref = f < 4 ? refs[f](x[i]) : powl(x[i], y[i]);
+      double s = f < 4 ? scalars[f](x[i], FP_RM) : fpe_pow(x[i], y[i], FP_RM);
+
+      if(!elemfn_brackets(r[i], ref, f < 4 ? 0x1p-60L : 0x1p-59L)
+	 || r[i].lo != lo[i] || r[i].hi != hi[i] || s != lo[i]
+	 || rn[i] < lo[i] || rn[i] > hi[i]) {
+	wrong = 1;
+      }
+    }
+    if(wrong || fpgetround() != FP_RN) FAIL_TEST;
+  }
+
+  fpsetround(FP_RP);
+  if(fpe_exp(0.0, FP_RM) != 1.0 || fpe_log(1.0, FP_RP) != 0.0
+     || fpe_sin(0.0, FP_RM) != 0.0 || fpe_cos(0.0, FP_RP) != 1.0
+     || fpe_pow(2.0, 10.0, FP_RM) != 1024.0
+     || fpe_pow(3.0, 2.0, FP_RP) != 9.0
+     || fpe_pow(-2.0, -3.0, FP_RZ) != -0.125
+     || fpgetround() != FP_RP) FAIL_TEST;
+  fpsetround(FP_RN);
+  if(fpe_exp(710.0, FP_RM) != DBL_MAX || fpe_exp(710.0, FP_RP) != INFINITY
+     || fpe_exp(-746.0, FP_RM) != 0.0
+     || fpe_exp(-746.0, FP_RP) != 0x1p-1074
+     || fpe_sin(0x1p-40, FP_RN) != 0x1p-40
+     || fpe_sin(0x1p-40, FP_RZ) != nextafter(0x1p-40, 0.0)
+     || fpe_cos(0x1p-40, FP_RP) != 1.0
+     || fpe_log(0.0, FP_RN) != -INFINITY || !isnan(fpe_log(-1.0, FP_RN))
+     || fpe_pow(0.0, -1.0, FP_RN) != INFINITY) FAIL_TEST;
+  x[0] = 1e300;
+  x[1] = 1e22;
+  fpe_sin_enclose(x, r, 2);
+  if(!elemfn_brackets(r[0], sinl(x[0]), 0x1p-60L)
+     || !elemfn_brackets(r[1], sinl(x[1]), 0x1p-60L)) FAIL_TEST;
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_rnd
+ *
+ * Check the batch arithmetic with the rounding direction as an
+ * argument on a block of double precision numbers that is not a whole
+ * number of vectors, in each rounding direction: the results must
+ * agree with the software reference, and the rounding direction and
+ * sticky bits set must be left alone. Where both operands are NaNs,
+ * either may be the result, as gcc may swap the operands of an add or
+ * multiply instruction without embedded rounding.
+ */
+
+int test_rnd(void) {
+#ifdef CIIEEEFP_TEST
+  static void (*const rnds[4])(const double *, const double *, double *,
+			       size_t, fp_rnd) = {
+    fp_add_rnd, fp_sub_rnd, fp_mul_rnd, fp_div_rnd
+  };
+  static const softfp_op ops[4] = {
+    SOFTFP_ADD, SOFTFP_SUB, SOFTFP_MUL, SOFTFP_DIV
+  };
+  static double a[TEST_BATCH], b[TEST_BATCH], r[TEST_BATCH];
+  static uint64_t ua[TEST_BATCH], ub[TEST_BATCH], sw[TEST_BATCH];
+  static fp_except swx[TEST_BATCH];
+  uint64_t state = 7;
+  int failures = 0;
+  int i, o, rd;
+
+  printf("Testing rounding as an argument... ");
+  fflush(stdout);
+  for(i = 0; i < TEST_BATCH; i++) {
+    ua[i] = verify_operand64(&state);
+    ub[i] = verify_operand64(&state);
+    memcpy(&a[i], &ua[i], sizeof(double));
+    memcpy(&b[i], &ub[i], sizeof(double));
+  }
+  for(o = 0; o < 4; o++) {
+    for(rd = 0; rd < 4; rd++) {
+      int wrong = 0;
+
+      fpsetround(fpdir[3 - rd]);
+      fpsetsticky(0);
+      softfp_batch64(ops[o], FP_UNIT_SSE, fpdir[rd], FP_PC_DBL, ua, ub,
+		     TEST_BATCH, sw, swx);
+      rnds[o](a, b, r, TEST_BATCH, fpdir[rd]);
+      for(i = 0; i < TEST_BATCH; i++) {
+	uint64_t bits;
+
+	memcpy(&bits, &r[i], sizeof(double));
+	if(bits != sw[i]
+	   && (r[i] == r[i] || softfp_class64(sw[i]) != FP_QNAN)) {
+	  wrong = 1;
+	}
+      }
+      if(wrong || (fpgetsticky() & VERIFY_FLAGS) != 0U
+	 || fpgetround() != fpdir[3 - rd]) FAIL_TEST;
+    }
+  }
+  fpsetround(FP_RN);
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_queue
+ *
+ * Check the queue of operations. Operations on random numbers, each
+ * with a random rounding direction and precision, must give the
+ * results and exceptions of the software reference (emulating the x87
+ * FPU if the compiler uses it for doubles), and running the queue must
+ * take one run for each environment used and put back the one it
+ * found, adding the exceptions to the sticky bits, including those of
+ * the operations queued without asking for them. NaN results need
+ * only be NaNs. A full queue must refuse more operations.
+ */
+
+#define TEST_QUEUE 1001
+
+int test_queue(void) {
+#ifdef CIIEEEFP_TEST
+  static const fp_pctl pctls[3] = { FP_PC_SGL, FP_PC_DBL, FP_PC_EXT };
+  static fp_queue_entry entries[TEST_QUEUE];
+  static double r[TEST_QUEUE];
+  static fp_except flags[TEST_QUEUE];
+  static uint64_t sw[TEST_QUEUE];
+  static fp_except swx[TEST_QUEUE];
+  fp_queue queue;
+  fp_pctl pctl = fpgetprecision();
+  uint64_t state = 19;
+  fp_except all = 0U;
+  int used[16];
+  size_t runs = 0;
+  int failures = 0;
+  int i, wrong = 0;
+
+  printf("Testing queue of operations... ");
+  fflush(stdout);
+  memset(used, 0, sizeof(used));
+  fpq_init(&queue, entries, TEST_QUEUE);
+  for(i = 0; i < TEST_QUEUE; i++) {
+    uint64_t ua = verify_operand64(&state), ub = verify_operand64(&state);
+    uint32_t pick = verify_random(&state);
+    fp_queue_op op = (fp_queue_op)(pick % 5);
+    fp_rnd rnd = fpdir[(pick >> 8) & 3];
+    fp_pctl pc = pctls[(pick >> 16) % 3];
+    double a, b;
+
+    memcpy(&a, &ua, sizeof(double));
+    memcpy(&b, &ub, sizeof(double));
+    flags[i] = 0U;
+    if(fpq_push(&queue, op, a, b, rnd, pc, &r[i],
+		i % 7 == 0 ? NULL : &flags[i]) != 0) {
+      wrong = 1;
+    }
+    swx[i] = 0U;
+#ifdef __SSE2_MATH__
+    switch(op) {
+    case FP_QUEUE_ADD:
+      sw[i] = softfp_add64(ua, ub, rnd, &swx[i]);
+      break;
+    case FP_QUEUE_SUB:
+      sw[i] = softfp_sub64(ua, ub, rnd, &swx[i]);
+      break;
+    case FP_QUEUE_MUL:
+      sw[i] = softfp_mul64(ua, ub, rnd, &swx[i]);
+      break;
+    case FP_QUEUE_DIV:
+      sw[i] = softfp_div64(ua, ub, rnd, &swx[i]);
+      break;
+    default:
+      sw[i] = softfp_sqrt64(ua, rnd, &swx[i]);
+      break;
+    }
+#else
+    sw[i] = softfp_x87_64((softfp_op)op, ua, ub, rnd, pc, &swx[i]);
+#endif
+    all |= swx[i];
+    if(!used[(rnd << 2) | pc]) runs++;
+    used[(rnd << 2) | pc] = 1;
+  }
+  if(fpq_push(&queue, FP_QUEUE_ADD, 1.0, 1.0, FP_RN, FP_PC_DBL, &r[0],
+	      NULL) != -1) wrong = 1;
+  fpsetround(FP_RZ);
+  fpsetprecision(FP_PC_DBL);
+  fpsetsticky(FP_X_DZ);
+  if(fpq_run(&queue) != runs) wrong = 1;
+  for(i = 0; i < TEST_QUEUE; i++) {
+    uint64_t bits;
+
+    memcpy(&bits, &r[i], sizeof(double));
+    if((bits != sw[i] && (r[i] == r[i] || softfp_class64(sw[i]) != FP_QNAN))
+       || (i % 7 != 0 && (flags[i] & VERIFY_FLAGS) != swx[i])) {
+      wrong = 1;
+    }
+  }
+  if(wrong || queue.n != 0 || fpgetround() != FP_RZ
+     || fpgetprecision() != FP_PC_DBL
+     || (fpgetsticky() & VERIFY_FLAGS) != (all | FP_X_DZ)) FAIL_TEST;
+  if(fpq_run(&queue) != 0 || fpgetround() != FP_RZ) FAIL_TEST;
+  fpsetround(FP_RN);
+  fpsetprecision(pctl);
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_reduce
+ *
+ * Check the reproducible reductions. The sum and dot product of an
+ * array of random numbers, rounded in each direction, must be the
+ * same, bit for bit and with the same exceptions, when the array is
+ * split into parts at random places and the parts' accumulators
+ * merged in reverse order, and when it is split between threads.
+ * Sums and products of single pairs must agree with the software
+ * reference (except for the sign of a zero, NaN payloads and
+ * denormalised NaN operands), an array followed by its negation in
+ * reverse order and one more number must add up to that number, and
+ * 2-norms must neither overflow nor underflow in between. None of it
+ * may change the rounding direction or sticky bits.
+ */
+
+#define TEST_REDUCE 4099
+#define TEST_REDUCE_THREADS 3
+
+typedef struct {
+  const double *x, *y;
+  size_t n;
+  fp_acc sum, dot;
+} TEST_REDUCE_PART;
+
+static void *test_reduce_part(void *arg) {
+  TEST_REDUCE_PART *part = (TEST_REDUCE_PART *)arg;
+
+  fpacc_init(&part->sum);
+  fpacc_init(&part->dot);
+  fpacc_sum(&part->sum, part->x, part->n);
+  fpacc_dot(&part->dot, part->x, part->y, part->n);
+  return NULL;
+}
+
+static int test_reduce_same(const fp_acc *a, const fp_acc *b) {
+  fp_except xa, xb;
+  double ra, rb;
+  int i;
+
+  for(i = 0; i < 4; i++) {
+    ra = fpacc_round(a, fpdir[i], &xa);
+    rb = fpacc_round(b, fpdir[i], &xb);
+    if(memcmp(&ra, &rb, sizeof(double)) != 0 || xa != xb) return 0;
+  }
+  return 1;
+}
+
+int test_reduce(void) {
+#ifdef CIIEEEFP_TEST
+  static double x[TEST_REDUCE], y[TEST_REDUCE], z[2 * TEST_REDUCE + 1];
+  TEST_REDUCE_PART parts[TEST_REDUCE_THREADS];
+  pthread_t threads[TEST_REDUCE_THREADS];
+  fp_acc sum, dot, psum, pdot;
+  uint64_t state = 23;
+  fp_except x1, x2;
+  double v[2];
+  int failures = 0;
+  int i, k, t, wrong;
+  size_t at, len;
+
+  printf("Testing reproducible reductions... ");
+  fflush(stdout);
+  for(i = 0; i < TEST_REDUCE; i++) {
+    uint64_t bits = (uint64_t)verify_random(&state) << 32
+      | verify_random(&state);
+
+    /* Exponents from 2^-40 to 2^40, a few from anywhere */
+
+    if(i % 97 != 0) {
+      bits = (bits & UINT64_C(0x800fffffffffffff))
+	| (uint64_t)(1023 - 40 + (int)(verify_random(&state) % 81)) << 52;
+    }
+    memcpy(&x[i], &bits, sizeof(double));
+    if(x[i] != x[i] || x[i] - x[i] != 0.0) x[i] = 1.0;
+    y[i] = (double)verify_random(&state) / 4294967296.0 - 0.5;
+  }
+  fpsetround(FP_RZ);
+  fpsetsticky(0);
+  fpacc_init(&sum);
+  fpacc_init(&dot);
+  fpacc_sum(&sum, x, TEST_REDUCE);
+  fpacc_dot(&dot, x, y, TEST_REDUCE);
+  if(fpgetround() != FP_RZ || fpgetsticky() != 0) FAIL_TEST;
+  fpsetround(FP_RN);
+
+  /* Random splits, merged in reverse */
+
+  wrong = 0;
+  for(k = 0; k < 20; k++) {
+    fp_acc accs[8][2];
+    int n;
+
+    for(at = 0, n = 0; at < TEST_REDUCE; at += len, n++) {
+      len = n == 7 ? TEST_REDUCE - at
+	: verify_random(&state) % (TEST_REDUCE / 3 + 1);
+      if(len > TEST_REDUCE - at) len = TEST_REDUCE - at;
+      fpacc_init(&accs[n][0]);
+      fpacc_init(&accs[n][1]);
+      fpacc_sum(&accs[n][0], x + at, len);
+      fpacc_dot(&accs[n][1], x + at, y + at, len);
+    }
+    fpacc_init(&psum);
+    fpacc_init(&pdot);
+    while(n-- > 0) {
+      fpacc_merge(&psum, &accs[n][0]);
+      fpacc_merge(&pdot, &accs[n][1]);
+    }
+    if(!test_reduce_same(&sum, &psum) || !test_reduce_same(&dot, &pdot)) {
+      wrong = 1;
+    }
+  }
+  if(wrong) FAIL_TEST;
+
+  /* Threads */
+
+  for(t = 0, at = 0; t < TEST_REDUCE_THREADS; t++, at += len) {
+    len = t == TEST_REDUCE_THREADS - 1 ? TEST_REDUCE - at
+      : TEST_REDUCE / TEST_REDUCE_THREADS + t;
+    parts[t].x = x + at;
+    parts[t].y = y + at;
+    parts[t].n = len;
+    if(pthread_create(&threads[t], NULL, test_reduce_part, &parts[t]) != 0) {
+      perror("pthread_create");
+      return 1;
+    }
+  }
+  fpacc_init(&psum);
+  fpacc_init(&pdot);
+  for(t = 0; t < TEST_REDUCE_THREADS; t++) {
+    pthread_join(threads[t], NULL);
+    fpacc_merge(&psum, &parts[t].sum);
+    fpacc_merge(&pdot, &parts[t].dot);
+  }
+  if(!test_reduce_same(&sum, &psum)
+     || !test_reduce_same(&dot, &pdot)) FAIL_TEST;
+
+  /* Single pairs against the software reference */
+
+  wrong = 0;
+  for(i = 0; i < 400; i++) {
+    uint64_t ua = verify_operand64(&state), ub = verify_operand64(&state);
+    uint64_t sw, bits;
+    fp_except swx;
+    fp_acc acc;
+    double r;
+
+    memcpy(&v[0], &ua, sizeof(double));
+    memcpy(&v[1], &ub, sizeof(double));
+    for(k = 0; k < 4; k++) {
+      for(t = 0; t < 2; t++) {
+	swx = 0U;
+	fpacc_init(&acc);
+	if(t == 0) {
+	  sw = softfp_add64(ua, ub, fpdir[k], &swx);
+	  fpacc_sum(&acc, v, 2);
+	}
+	else {
+	  sw = softfp_mul64(ua, ub, fpdir[k], &swx);
+	  fpacc_dot(&acc, &v[0], &v[1], 1);
+	}
+	r = fpacc_round(&acc, fpdir[k], &x1);
+	memcpy(&bits, &r, sizeof(double));
+	if(softfp_class64(sw) == FP_QNAN) {
+	  if(r == r) wrong = 1;
+	}
+	else if((bits != sw && (r != 0.0 || (sw << 1) != 0))
+		|| (x1 & VERIFY_FLAGS) != swx) {
+	  wrong = 1;
+	}
+      }
+    }
+  }
+  if(wrong) FAIL_TEST;
+
+  /* Cancellation */
+
+  for(i = 0; i < TEST_REDUCE; i++) {
+    z[i] = x[i];
+    z[2 * TEST_REDUCE - 1 - i] = -x[i];
+  }
+  z[2 * TEST_REDUCE] = 0.1;
+  if(fp_sum(z, 2 * TEST_REDUCE + 1, &x1) != 0.1
+     || (x1 & ~FP_X_DNML) != 0U) FAIL_TEST;
+
+  /* 2-norms, within an ulp of sqrt(2) |v[0]| */
+
+  v[0] = 3.0;
+  v[1] = 4.0;
+  if(fp_nrm2(v, 2, &x1) != 5.0 || x1 != 0U) FAIL_TEST;
+  for(k = 0; k < 2; k++) {
+    long double ref;
+
+    v[0] = v[1] = k == 0 ? 1e300 : -1e-300;
+    ref = sqrtl(2.0L) * fabsl((long double)v[0]);
+    if(fabsl(fp_nrm2(v, 2, &x2) / ref - 1.0L) > 0x1p-52L
+       || x2 != FP_X_IMP) FAIL_TEST;
+  }
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_dd
+ *
+ * Check the error-free transformations and double-double arithmetic,
+ * with precision control set to extended and rounding up, neither of
+ * which they may use or change. TwoSum and TwoProduct of random pairs
+ * must give the sum or product rounded to nearest and an error making
+ * up the exact value, including for 2^53 + (1 + 2^-12), which the x87
+ * FPU rounds twice in extended precision. Double-double sums, products
+ * and quotients must be within their error bounds, worked out exactly
+ * in an fp_acc, results that are not finite must have a zero lo part,
+ * and the array functions must agree with the scalar ones bit for bit.
+ */
+
+#define TEST_DD 1027
+
+static int test_dd_within(const fp_acc *acc, double bound) {
+  double r = fpacc_round(acc, FP_RN, NULL);
+
+  return fabs(r) <= bound;
+}
+
+int test_dd(void) {
+#ifdef CIIEEEFP_TEST
+  static double x[TEST_DD], y[TEST_DD], s[TEST_DD], e[TEST_DD];
+  static double vs[TEST_DD], ve[TEST_DD];
+  static fp_dd a[TEST_DD], b[TEST_DD], r[3][TEST_DD], vr[TEST_DD];
+  uint64_t state = 29;
+  fp_dd one, zero, huge, q;
+  fp_acc acc;
+  fp_pctl pc = fpgetprecision();
+  double v[6], w[6], err;
+  int failures = 0;
+  int i, k, wrong;
+
+  printf("Testing error-free transformations and double-doubles... ");
+  fflush(stdout);
+  for(i = 0; i < TEST_DD; i++) {
+    uint64_t bits = (uint64_t)verify_random(&state) << 32
+      | verify_random(&state);
+
+    bits = (bits & UINT64_C(0x800fffffffffffff))
+      | (uint64_t)(1023 - 40 + (int)(verify_random(&state) % 81)) << 52;
+    memcpy(&x[i], &bits, sizeof(double));
+    y[i] = (double)verify_random(&state) / 4294967296.0 - 0.5;
+    if(i % 5 == 0) y[i] = -x[i] * (1.0 + y[i] * 0x1p-30);
+				/* Near cancellation */
+  }
+  fpsetprecision(FP_PC_EXT);
+  fpsetround(FP_RP);
+
+  /* Rounded once: 2^53 + 2 and -(1 - 2^-12) */
+
+  if(fp_two_sum(0x1p53, 1.0 + 0x1p-12, &err) != 0x1p53 + 2.0
+     || err != -(1.0 - 0x1p-12)) FAIL_TEST;
+  if(fp_fast_two_sum(0x1p53, 1.0 + 0x1p-12, &err) != 0x1p53 + 2.0
+     || err != -(1.0 - 0x1p-12)) FAIL_TEST;
+
+  /* TwoSum and TwoProduct, the result rounded to nearest and the error
+     exact */
+
+  wrong = 0;
+  for(k = 0; k < 2; k++) {
+    for(i = 0; i < TEST_DD; i++) {
+      v[0] = x[i];
+      w[0] = y[i];
+      w[1] = w[2] = 1.0;
+      fpacc_init(&acc);
+      if(k == 0) {
+	s[i] = fp_two_sum(x[i], y[i], &e[i]);
+	v[1] = y[i];
+	w[0] = 1.0;
+      }
+      else {
+	s[i] = fp_two_prod(x[i], y[i], &e[i]);
+	v[1] = 0.0;
+      }
+      fpacc_dot(&acc, v, w, 2);
+      if(fpacc_round(&acc, FP_RN, NULL) != s[i]) wrong = 1;
+      v[1] = -s[i];
+      v[2] = -e[i];
+      fpacc_dot(&acc, v + 1, w + 1, 2);
+      if(fpacc_round(&acc, FP_RN, NULL) != 0.0) wrong = 1;
+    }
+    if(k == 0) fp_two_sum_array(x, y, vs, ve, TEST_DD);
+    else fp_two_prod_array(x, y, vs, ve, TEST_DD);
+    if(memcmp(s, vs, sizeof(s)) != 0 || memcmp(e, ve, sizeof(e)) != 0) {
+      wrong = 1;
+    }
+  }
+  if(wrong) FAIL_TEST;
+
+  /* Double-doubles, with errors worked out exactly */
+
+  for(i = 0; i < TEST_DD; i++) {
+    a[i].hi = fp_two_sum(x[i], x[i] * y[i] * 0x1p-40, &a[i].lo);
+    b[i].hi = fp_two_sum(y[i], y[i] * x[(i + 1) % TEST_DD] * 0x1p-44,
+			 &b[i].lo);
+  }
+  wrong = 0;
+  for(i = 0; i < TEST_DD; i++) {
+    r[0][i] = fpdd_add(a[i], b[i]);
+    r[1][i] = fpdd_mul(a[i], b[i]);
+    r[2][i] = fpdd_div(a[i], b[i]);
+
+    v[0] = a[i].hi;		/* a + b - r */
+    v[1] = a[i].lo;
+    v[2] = b[i].hi;
+    v[3] = b[i].lo;
+    v[4] = -r[0][i].hi;
+    v[5] = -r[0][i].lo;
+    fpacc_init(&acc);
+    fpacc_sum(&acc, v, 6);
+    if(!test_dd_within(&acc, fabs(r[0][i].hi) * 0x1p-104)) wrong = 1;
+
+    v[0] = v[1] = a[i].hi;	/* a b - r */
+    v[2] = v[3] = a[i].lo;
+    w[0] = w[2] = b[i].hi;
+    w[1] = w[3] = b[i].lo;
+    v[4] = -r[1][i].hi;
+    v[5] = -r[1][i].lo;
+    w[4] = w[5] = 1.0;
+    fpacc_init(&acc);
+    fpacc_dot(&acc, v, w, 6);
+    if(!test_dd_within(&acc, fabs(r[1][i].hi) * 0x1p-102)) wrong = 1;
+
+    v[0] = v[1] = -r[2][i].hi;	/* a - r b */
+    v[2] = v[3] = -r[2][i].lo;
+    v[4] = a[i].hi;
+    v[5] = a[i].lo;
+    fpacc_init(&acc);
+    fpacc_dot(&acc, v, w, 6);
+    if(!test_dd_within(&acc, fabs(a[i].hi) * 0x1p-101)) wrong = 1;
+  }
+  if(wrong) FAIL_TEST;
+
+  /* Arrays */
+
+  fpdd_add_array(a, b, vr, TEST_DD);
+  if(memcmp(vr, r[0], sizeof(vr)) != 0) FAIL_TEST;
+  fpdd_mul_array(a, b, vr, TEST_DD);
+  if(memcmp(vr, r[1], sizeof(vr)) != 0) FAIL_TEST;
+  fpdd_div_array(a, b, vr, TEST_DD - 2);
+  if(memcmp(vr, r[2], (TEST_DD - 2) * sizeof(fp_dd)) != 0) FAIL_TEST;
+
+  /* Results that are not finite */
+
+  one.hi = 1.0;
+  one.lo = 0x1p-60;
+  zero.hi = zero.lo = 0.0;
+  huge.hi = 0x1p1000;
+  huge.lo = 0x1p940;
+  q = fpdd_div(one, zero);
+  if(q.hi != 1.0 / 0.0 || q.lo != 0.0) FAIL_TEST;
+  q = fpdd_mul(huge, huge);
+  if(q.hi != 1.0 / 0.0 || q.lo != 0.0) FAIL_TEST;
+  q = fpdd_add(huge, huge);
+  if(q.hi != 0x1p1001 || q.lo != 0x1p941) FAIL_TEST;
+
+  if(fpgetround() != FP_RP || fpgetprecision() != FP_PC_EXT) FAIL_TEST;
+  fpsetround(FP_RN);
+  fpsetprecision(pc);
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_blas
+ *
+ * Check the BLAS kernels. axpy and scal must give what doing them an
+ * element at a time gives, rounding upwards, and record overflow,
+ * underflow and invalid operations against the blocks of the elements
+ * raising them and no others, with the same results and records
+ * whatever the number of threads. The reductions must be the same
+ * bit for bit for any number of threads, close to the exact result,
+ * and nrm2 must neither overflow nor underflow in between. The
+ * exceptions must be in the sticky bits whatever units the library
+ * looks after.
+ */
+
+#define TEST_BLAS 4999		/* 19 whole blocks and a part one */
+#define TEST_BLAS_BLOCKS FP_BLAS_BLOCKS(TEST_BLAS)
+
+static int test_blas_only(const uint8_t *record, size_t block,
+			  fp_except x) {
+  size_t b;
+
+  for(b = 0; b < TEST_BLAS_BLOCKS; b++) {
+    if(record[b] != (b == block ? x : 0U)) return 0;
+  }
+  return 1;
+}
+
+int test_blas(void) {
+#ifdef CIIEEEFP_TEST
+  static double x[TEST_BLAS], y[TEST_BLAS], r[TEST_BLAS], ref[TEST_BLAS];
+  uint8_t record[TEST_BLAS_BLOCKS], record3[TEST_BLAS_BLOCKS];
+  uint64_t state = 31;
+  long double exact, bound;
+  double v[2], d[3];
+  fp_except x1, x2;
+  fp_unit units;
+  int failures = 0;
+  int i, t, wrong;
+
+  printf("Testing checked BLAS kernels... ");
+  fflush(stdout);
+  for(i = 0; i < TEST_BLAS; i++) {
+    x[i] = ((double)verify_random(&state) / 4294967296.0 - 0.5)
+      * (double)(1 + verify_random(&state) % 1000);
+    y[i] = (double)verify_random(&state) / 4294967296.0 - 0.5;
+  }
+  fpsetround(FP_RP);
+
+  /* scal, overflowing in block 7 and underflowing in block 12 */
+
+  memcpy(r, x, sizeof(x));
+  r[7 * FP_BLAS_BLOCK + 5] = 0x1p500;
+  r[12 * FP_BLAS_BLOCK + 9] = 0x1.8p-480;
+  memcpy(ref, r, sizeof(r));
+  for(i = 0; i < TEST_BLAS; i++) ref[i] *= 0x1p600;
+  fpsetsticky(0);
+  x1 = fpblas_scal(0x1p600, r, TEST_BLAS, 1, record);
+  if(memcmp(r, ref, sizeof(r)) != 0 || !test_blas_only(record, 7, FP_X_OFL)
+     || (x1 & FP_BLAS_RECORD) != FP_X_OFL
+     || (fpgetsticky() & FP_X_OFL) == 0U) FAIL_TEST;
+  memcpy(r, ref, sizeof(r));
+  memcpy(ref, x, sizeof(x));
+  ref[12 * FP_BLAS_BLOCK + 9] = 0x1.8p-480;
+  memcpy(r, ref, sizeof(r));
+  for(i = 0; i < TEST_BLAS; i++) ref[i] *= 0x1p-600;
+  x1 = fpblas_scal(0x1p-600, r, TEST_BLAS, 3, record3);
+  if(memcmp(r, ref, sizeof(r)) != 0 || !test_blas_only(record3, 12, FP_X_UFL)
+     || (x1 & FP_BLAS_RECORD) != FP_X_UFL) FAIL_TEST;
+
+  /* axpy, with inf - inf in the last, part block */
+
+  wrong = 0;
+  for(t = 1; t <= 4; t += 3) {
+    memcpy(r, y, sizeof(y));
+    r[TEST_BLAS - 3] = -1.0 / 0.0;
+    memcpy(ref, r, sizeof(r));
+    x[TEST_BLAS - 3] = 1.0 / 0.0;
+    for(i = 0; i < TEST_BLAS; i++) ref[i] = 3.0 * x[i] + ref[i];
+    x1 = fpblas_axpy(3.0, x, r, TEST_BLAS, t, record);
+    x[TEST_BLAS - 3] = 0.0;
+    if(memcmp(r, ref, sizeof(r)) != 0 || (x1 & FP_BLAS_RECORD) != FP_X_INV
+       || !test_blas_only(record, TEST_BLAS_BLOCKS - 1, FP_X_INV)) wrong = 1;
+  }
+  if(wrong) FAIL_TEST;
+  if(fpgetround() != FP_RP) FAIL_TEST;
+  fpsetround(FP_RN);
+
+  /* Reductions: the same for 1, 3 and 7 threads, and close */
+
+  d[0] = fpblas_dot(x, y, TEST_BLAS, 1, record, &x1);
+  exact = bound = 0.0L;
+  for(i = 0; i < TEST_BLAS; i++) {
+    exact += (long double)x[i] * y[i];
+    bound += fabsl((long double)x[i] * y[i]);
+  }
+  if(fabsl(d[0] - exact) > bound * TEST_BLAS * 0x1p-53L
+     || x1 != FP_X_IMP || !test_blas_only(record, 0, 0U)) FAIL_TEST;
+  d[1] = fpblas_asum(x, TEST_BLAS, 1, NULL, NULL);
+  d[2] = fpblas_nrm2(x, TEST_BLAS, 1, NULL, NULL);
+  wrong = 0;
+  for(t = 3; t <= 7; t += 4) {
+    v[0] = fpblas_dot(x, y, TEST_BLAS, t, record3, &x2);
+    if(memcmp(&v[0], &d[0], sizeof(double)) != 0 || x2 != x1
+       || memcmp(record, record3, sizeof(record)) != 0) wrong = 1;
+    v[0] = fpblas_asum(x, TEST_BLAS, t, NULL, NULL);
+    v[1] = fpblas_nrm2(x, TEST_BLAS, t, NULL, NULL);
+    if(memcmp(&v[0], &d[1], sizeof(double)) != 0
+       || memcmp(&v[1], &d[2], sizeof(double)) != 0) wrong = 1;
+  }
+  if(wrong) FAIL_TEST;
+  exact = bound = 0.0L;
+  for(i = 0; i < TEST_BLAS; i++) {
+    exact += fabsl((long double)x[i]);
+    bound += (long double)x[i] * x[i];
+  }
+  if(fabsl(d[1] / exact - 1.0L) > TEST_BLAS * 0x1p-53L
+     || fabsl(d[2] / sqrtl(bound) - 1.0L) > TEST_BLAS * 0x1p-53L) FAIL_TEST;
+
+  /* nrm2 in range when the squares are not */
+
+  v[0] = 3.0;
+  v[1] = 4.0;
+  if(fpblas_nrm2(v, 2, 1, NULL, &x1) != 5.0 || x1 != 0U) FAIL_TEST;
+  for(t = 0; t < 2; t++) {
+    long double ref2;
+
+    v[0] = v[1] = t == 0 ? 1e300 : -1e-300;
+    ref2 = sqrtl(2.0L) * fabsl((long double)v[0]);
+    if(fabsl(fpblas_nrm2(v, 2, 1, record, &x1) / ref2 - 1.0L) > 0x1p-51L
+       || (x1 & FP_BLAS_RECORD) != 0U || record[0] != 0U) FAIL_TEST;
+  }
+  units = fpsetunit(FP_UNIT_X87);
+  fpsetsticky(0);
+  v[0] = v[1] = 1e300;
+  fpblas_dot(v, v, 2, 1, NULL, &x1);
+  if(!(x1 & FP_X_OFL) || fpgetsticky() != x1) FAIL_TEST;
+  fpsetunit(units);
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_gemm
+ *
+ * Check the matrix multiply. It must give what adding up the products
+ * for each element in the same order gives, rounding upwards, with
+ * the same results and map for one and three threads, not read C when
+ * beta is zero, and put the invalid operations, NaNs, infinities and
+ * denormalised numbers in the map against the tiles they are in. The
+ * exceptions must be in the sticky bits whatever units the library
+ * looks after.
+ */
+
+#define TEST_GEMM_M 130		/* Three rows of tiles */
+#define TEST_GEMM_N 70		/* Two columns of tiles */
+#define TEST_GEMM_K 150		/* A whole panel and a part one */
+#define TEST_GEMM_LD (TEST_GEMM_K + 3)
+#define TEST_GEMM_TILES (FP_GEMM_TILES(TEST_GEMM_M) \
+			 * FP_GEMM_TILES(TEST_GEMM_N))
+
+static void test_gemm_ref(double alpha, const double *a, const double *b,
+			  double beta, double *c) {
+  double sum, t;
+  int i, j, p0, p;
+
+  for(i = 0; i < TEST_GEMM_M; i++) {
+    for(j = 0; j < TEST_GEMM_N; j++) {
+      for(p0 = 0; p0 < TEST_GEMM_K; p0 += 128) {
+	sum = 0.0;
+	for(p = p0; p < TEST_GEMM_K && p < p0 + 128; p++) {
+	  t = a[i * TEST_GEMM_LD + p] * b[p * TEST_GEMM_LD + j];
+	  sum += t;
+	}
+	t = alpha * sum;
+	if(p0 > 0) t += c[i * TEST_GEMM_LD + j];
+	else if(beta != 0.0) t += beta * c[i * TEST_GEMM_LD + j];
+	c[i * TEST_GEMM_LD + j] = t;
+      }
+    }
+  }
+}
+
+int test_gemm(void) {
+#ifdef CIIEEEFP_TEST
+  static double a[TEST_GEMM_M * TEST_GEMM_LD], b[TEST_GEMM_K * TEST_GEMM_LD];
+  static double c[TEST_GEMM_M * TEST_GEMM_LD], ref[TEST_GEMM_M * TEST_GEMM_LD];
+  static double c0[TEST_GEMM_M * TEST_GEMM_LD];
+  fp_tile map[TEST_GEMM_TILES], map3[TEST_GEMM_TILES];
+  uint64_t state = 43;
+  double d[4] = { 0x1.123456789abcdp-530, 0x1.123456789abcdp-530,
+		  0x1.123456789abcdp-530, 1.0 }, e[4];
+  fp_except x1, x3;
+  fp_unit units;
+  int failures = 0;
+  int i, t, wrong;
+
+  printf("Testing matrix multiply with a tile map... ");
+  fflush(stdout);
+  for(i = 0; i < TEST_GEMM_M * TEST_GEMM_LD; i++) {
+    a[i] = (double)verify_random(&state) / 4294967296.0 - 0.5;
+    c0[i] = (double)verify_random(&state) / 4294967296.0 - 0.5;
+  }
+  for(i = 0; i < TEST_GEMM_K * TEST_GEMM_LD; i++) {
+    b[i] = (double)verify_random(&state) / 4294967296.0 - 0.5;
+  }
+  fpsetround(FP_RP);
+
+  /* C = 1.5 A B - 0.75 C, the same for one and three threads */
+
+  memcpy(ref, c0, sizeof(c0));
+  test_gemm_ref(1.5, a, b, -0.75, ref);
+  memcpy(c, c0, sizeof(c0));
+  x1 = fpgemm(TEST_GEMM_M, TEST_GEMM_N, TEST_GEMM_K, 1.5, a, TEST_GEMM_LD,
+	      b, TEST_GEMM_LD, -0.75, c, TEST_GEMM_LD, 1, map);
+  if(memcmp(c, ref, sizeof(c)) != 0 || x1 != FP_X_IMP) FAIL_TEST;
+  memcpy(c, c0, sizeof(c0));
+  x3 = fpgemm(TEST_GEMM_M, TEST_GEMM_N, TEST_GEMM_K, 1.5, a, TEST_GEMM_LD,
+	      b, TEST_GEMM_LD, -0.75, c, TEST_GEMM_LD, 3, map3);
+  if(memcmp(c, ref, sizeof(c)) != 0 || x3 != x1
+     || memcmp(map, map3, sizeof(map)) != 0) FAIL_TEST;
+
+  /* C = A B with C full of NaNs, and inf times zero in row 70 */
+
+  a[70 * TEST_GEMM_LD + 3] = 1.0 / 0.0;
+  for(i = 0; i < TEST_GEMM_N; i++) b[3 * TEST_GEMM_LD + i] = 0.0;
+  memcpy(ref, c0, sizeof(c0));
+  test_gemm_ref(1.0, a, b, 0.0, ref);
+  wrong = 0;
+  for(t = 1; t <= 3; t += 2) {
+    for(i = 0; i < TEST_GEMM_M * TEST_GEMM_LD; i++) c[i] = 0.0 / 0.0;
+    x1 = fpgemm(TEST_GEMM_M, TEST_GEMM_N, TEST_GEMM_K, 1.0, a, TEST_GEMM_LD,
+		b, TEST_GEMM_LD, 0.0, c, TEST_GEMM_LD, t, map);
+    for(i = 0; i < TEST_GEMM_M * TEST_GEMM_LD; i++) {
+      if(i % TEST_GEMM_LD < TEST_GEMM_N && i / TEST_GEMM_LD != 70
+	 && c[i] != ref[i]) wrong = 1;
+    }
+    if(x1 != (FP_X_INV | FP_X_IMP)) wrong = 1;
+    for(i = 0; i < TEST_GEMM_TILES; i++) {
+      if(map[i].nan != (i == 2 ? 64U : i == 3 ? 6U : 0U)
+	 || (map[i].raised & FP_X_INV) != (i == 2 || i == 3 ? FP_X_INV : 0U)
+	 || map[i].inf != 0U || map[i].denorm != 0U) wrong = 1;
+    }
+  }
+  if(wrong) FAIL_TEST;
+  if(fpgetround() != FP_RP) FAIL_TEST;
+  fpsetround(FP_RN);
+
+  /* Underflow to denormalised numbers, and scaling C when alpha is 0 */
+
+  x1 = fpgemm(2, 2, 2, 1.0, d, 2, d, 2, 0.0, e, 2, 1, map);
+  if(e[0] != d[0] * d[0] + d[0] * d[0] || (x1 & FP_X_UFL) == 0U
+     || map[0].denorm != 1U || map[0].nan != 0U || map[0].inf != 0U) FAIL_TEST;
+  x1 = fpgemm(2, 2, 2, 0.0, d, 2, d, 2, 2.0, e, 2, 1, map);
+  if(e[3] != 2.0 || map[0].denorm != 1U || (x1 & ~FP_X_DNML) != 0U) FAIL_TEST;
+  units = fpsetunit(FP_UNIT_X87);
+  fpsetsticky(0);
+  x1 = fpgemm(2, 2, 2, 1.0, d, 2, d, 2, 0.0, e, 2, 1, map);
+  if((x1 & FP_X_UFL) == 0U || fpgetsticky() != x1) FAIL_TEST;
+  fpsetunit(units);
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_sround
+ *
+ * Check stochastic rounding and the conversions to narrower formats.
+ * Converting to float in the four hardware directions must give what
+ * the hardware gives, and half precision and bfloat16 must round and
+ * overflow where they should. With FP_RS, results must be one of the
+ * two numbers either side of the exact one, chosen about as often as
+ * they should be, the same again for the same seed, and a float sum
+ * of many small numbers must not stop growing as it does rounding to
+ * nearest. Arithmetic with FP_RS must leave the rounding direction
+ * and sticky bits alone.
+ */
+
+#define TEST_SROUND 20000
+
+int test_sround(void) {
+#ifdef CIIEEEFP_TEST
+  static double a[TEST_SROUND], b[TEST_SROUND], r[TEST_SROUND];
+  static float f[TEST_SROUND], g[TEST_SROUND];
+  static const double special[9] = {
+    1.0 / 0.0, -1.0 / 0.0, 0.0 / 0.0, 0x1.fffffff8p127, -0x1p-149,
+    0x1.8p-150, 0x1p-1074, -0.0, 3.4e38
+  };
+  static const fp_rnd dirs[4] = { FP_RN, FP_RM, FP_RP, FP_RZ };
+  uint16_t h[4];
+  uint64_t state = 59;
+  volatile float v;
+  float sum;
+  double lo, hi, d;
+  long double p;
+  int failures = 0;
+  int i, k, up, wrong;
+
+  printf("Testing stochastic rounding and conversions... ");
+  fflush(stdout);
+  for(i = 0; i < TEST_SROUND; i++) {
+    a[i] = ldexp((double)verify_random(&state) / 4294967296.0 - 0.5,
+		 (int)(verify_random(&state) % 320) - 180);
+  }
+  memcpy(a, special, sizeof(special));
+
+  /* To float in the hardware directions */
+
+  wrong = 0;
+  for(k = 0; k < 4; k++) {
+    fp_to_float_rnd(a, f, TEST_SROUND, dirs[k]);
+    fpsetround(dirs[k]);
+    for(i = 0; i < TEST_SROUND; i++) {
+      v = (float)a[i];
+      g[i] = v;
+    }
+    fpsetround(FP_RN);
+    if(memcmp(f, g, sizeof(f)) != 0) wrong = 1;
+  }
+  if(wrong) FAIL_TEST;
+
+  /* Half precision and bfloat16 */
+
+  b[0] = 65520.0;
+  b[1] = 0x1p-25;
+  b[2] = 1.0 / 3.0;
+  b[3] = 0.0 / 0.0;
+  fp_to_half_rnd(b, h, 4, FP_RN);
+  if(h[0] != 0x7c00U || h[1] != 0U || h[2] != 0x3555U
+     || (h[3] & 0x7e00U) != 0x7e00U) FAIL_TEST;
+  fp_to_half_rnd(b, h, 3, FP_RZ);
+  if(h[0] != 0x7bffU || h[1] != 0U || h[2] != 0x3555U) FAIL_TEST;
+  fp_to_half_rnd(b, h, 3, FP_RP);
+  if(h[0] != 0x7c00U || h[1] != 1U || h[2] != 0x3556U) FAIL_TEST;
+  b[0] = 1.0 + 0x1p-8;
+  b[1] = -(1.0 + 0x1p-8);
+  b[2] = 0x1p-133;
+  fp_to_bf16_rnd(b, h, 3, FP_RN);
+  if(h[0] != 0x3f80U || h[1] != 0xbf80U || h[2] != 0x0001U) FAIL_TEST;
+  fp_to_bf16_rnd(b, h, 3, FP_RM);
+  if(h[0] != 0x3f80U || h[1] != 0xbf81U || h[2] != 0x0001U) FAIL_TEST;
+
+  /* FP_RS: a quarter of the way to the next float up, the same again
+     for the same seed, and a quarter of the way between denormalised
+     numbers */
+
+  for(i = 0; i < TEST_SROUND; i++) b[i] = 1.0 + 0x1p-25;
+  fpsr_seed(11);
+  fp_to_float_rnd(b, f, TEST_SROUND, FP_RS);
+  up = wrong = 0;
+  for(i = 0; i < TEST_SROUND; i++) {
+    if(f[i] == 1.0f + 0x1p-23f) up++;
+    else if(f[i] != 1.0f) wrong = 1;
+  }
+  if(wrong || fabs((double)up / TEST_SROUND - 0.25) > 0.02) FAIL_TEST;
+  fpsr_seed(11);
+  fp_to_float_rnd(b, g, TEST_SROUND, FP_RS);
+  if(memcmp(f, g, sizeof(f)) != 0) FAIL_TEST;
+  fpsr_seed(12);
+  fp_to_float_rnd(b, g, TEST_SROUND, FP_RS);
+  if(memcmp(f, g, sizeof(f)) == 0) FAIL_TEST;
+  for(i = 0; i < TEST_SROUND; i++) b[i] = -0x1.4p-149;
+  fp_to_float_rnd(b, g, TEST_SROUND - 1, FP_RS);
+  up = wrong = 0;
+  for(i = 0; i < TEST_SROUND - 1; i++) {
+    if(g[i] == -0x1p-148f) up++;
+    else if(g[i] != -0x1p-149f) wrong = 1;
+  }
+  if(wrong || fabs((double)up / TEST_SROUND - 0.25) > 0.02) FAIL_TEST;
+
+  /* A float sum of 2^-25s, which rounding to nearest never moves */
+
+  sum = 1.0f;
+  for(i = 0; i < TEST_SROUND; i++) {
+    d = (double)sum + 0x1p-25;
+    fp_to_float_rnd(&d, &sum, 1, FP_RS);
+  }
+  if(fabs((double)sum - (1.0 + TEST_SROUND * 0x1p-25)) > 0x1p-12) FAIL_TEST;
+
+  /* Arithmetic: 1 + 2^-54 and 1 / 3, rounding towards zero around */
+
+  fpsetround(FP_RZ);
+  for(i = 0; i < TEST_SROUND; i++) {
+    a[i] = 1.0;
+    b[i] = 0x1p-54;
+  }
+  fpsetsticky(0);
+  fp_add_rnd(a, b, r, TEST_SROUND, FP_RS);
+  if(fpgetsticky() != 0U) FAIL_TEST;
+  up = wrong = 0;
+  for(i = 0; i < TEST_SROUND; i++) {
+    if(r[i] == 1.0 + 0x1p-52) up++;
+    else if(r[i] != 1.0) wrong = 1;
+  }
+  if(wrong || fabs((double)up / TEST_SROUND - 0.25) > 0.02) FAIL_TEST;
+  for(i = 0; i < TEST_SROUND; i++) b[i] = 3.0;
+  fp_div_rnd(a, b, r, 1, FP_RM);
+  lo = r[0];
+  fp_div_rnd(a, b, r, 1, FP_RP);
+  hi = r[0];
+  fpsetsticky(0);
+  fp_div_rnd(a, b, r, TEST_SROUND, FP_RS);
+  if(fpgetround() != FP_RZ || fpgetsticky() != 0U) FAIL_TEST;
+  fpsetround(FP_RN);
+  p = (1.0L / 3.0L - lo) / ((long double)hi - lo);
+  up = wrong = 0;
+  for(i = 0; i < TEST_SROUND; i++) {
+    if(r[i] == hi) up++;
+    else if(r[i] != lo) wrong = 1;
+  }
+  if(wrong || fabsl((long double)up / TEST_SROUND - p) > 0.02L) FAIL_TEST;
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_tune
+ *
+ * Check the precision tuner with a kernel working out partial sums of
+ * 1 / k^2. The extended precision variant must be the reference, the
+ * double variants must be within a few units in the last place of
+ * it and the single ones within float's precision but no closer, a
+ * variant the kernel does not provide must not be run, and a NaN
+ * where the reference has none must be counted as bad and keep the
+ * variant from being recommended. The precision and sticky bits must
+ * be left as they were.
+ */
+
+#define TEST_TUNE 256
+
+static int test_tune_kernel(fp_tune_variant variant, void *arg,
+			    double *out, size_t n) {
+  const int *nan = (const int *)arg;
+  long double l = 0.0L;
+  double d = 0.0;
+  float f = 0.0f;
+  size_t i;
+
+  for(i = 0; i < n; i++) {
+    long double k = (long double)(i + 1);
+
+    switch(variant) {
+    case FP_TUNE_X87_EXT:
+    case FP_TUNE_X87_DBL:
+    case FP_TUNE_X87_SGL:
+      l += 1.0L / (k * k);
+      out[i] = (double)l;
+      break;
+    case FP_TUNE_SSE_DBL:
+      d += 1.0 / ((double)k * (double)k);
+      out[i] = d;
+      break;
+    case FP_TUNE_SSE_FLT:
+      if(*nan < 0) return -1;
+      f += 1.0f / ((float)k * (float)k);
+      out[i] = (double)f;
+      break;
+    default:
+      return -1;
+    }
+  }
+  if(*nan > 0 && variant == FP_TUNE_X87_SGL) out[n / 2] = 0.0 / 0.0;
+  return 0;
+}
+
+int test_tune(void) {
+#ifdef CIIEEEFP_TEST
+  fp_tune_result res[FP_TUNE_VARIANTS];
+  int failures = 0;
+  int nan = 0;
+  int best;
+
+  printf("Testing precision tuner... ");
+
+  fpsetprecision(FP_PC_DBL);
+  fpsetsticky(FP_X_OFL);
+  if(fptune(test_tune_kernel, &nan, TEST_TUNE, 3, res) != FP_TUNE_X87_EXT)
+    FAIL_TEST;
+  if(fpgetprecision() != FP_PC_DBL || fpgetsticky() != FP_X_OFL) FAIL_TEST;
+  fpsetprecision(FP_PC_EXT);
+  fpsetsticky(0);
+  if(!res[FP_TUNE_X87_EXT].run || res[FP_TUNE_X87_EXT].max_rel != 0.0
+     || res[FP_TUNE_X87_EXT].max_ulps != 0.0) FAIL_TEST;
+  if(!res[FP_TUNE_X87_DBL].run || res[FP_TUNE_X87_DBL].max_ulps > 16.0
+     || !res[FP_TUNE_SSE_DBL].run || res[FP_TUNE_SSE_DBL].max_ulps > 16.0
+     || res[FP_TUNE_SSE_DBL].max_rel > 1.0e-14) FAIL_TEST;
+  if(!res[FP_TUNE_X87_SGL].run || res[FP_TUNE_X87_SGL].max_rel < 1.0e-9
+     || res[FP_TUNE_X87_SGL].max_rel > 1.0e-5
+     || res[FP_TUNE_X87_SGL].mean_rel > res[FP_TUNE_X87_SGL].max_rel
+     || !res[FP_TUNE_SSE_FLT].run || res[FP_TUNE_SSE_FLT].max_rel < 1.0e-9
+     || res[FP_TUNE_SSE_FLT].max_rel > 1.0e-5) FAIL_TEST;
+  if(res[FP_TUNE_X87_SGL].bad != 0 || res[FP_TUNE_SSE_FLT].bad != 0
+     || res[FP_TUNE_X87_EXT].seconds <= 0.0) FAIL_TEST;
+  best = fptune_recommend(res, 1.0e-3);
+  if(best < 0 || res[best].max_rel > 1.0e-3) FAIL_TEST;
+  best = fptune_recommend(res, 0.0);
+  if(best < 0 || best == FP_TUNE_X87_SGL || best == FP_TUNE_SSE_FLT
+     || res[best].max_rel != 0.0) FAIL_TEST;
+
+  /* A variant not provided, and a NaN in another */
+
+  nan = -1;
+  if(fptune(test_tune_kernel, &nan, TEST_TUNE, 1, res) != FP_TUNE_X87_EXT
+     || res[FP_TUNE_SSE_FLT].run || res[FP_TUNE_SSE_FLT].seconds != 0.0)
+    FAIL_TEST;
+  nan = 1;
+  if(fptune(test_tune_kernel, &nan, TEST_TUNE, 1, res) != FP_TUNE_X87_EXT
+     || res[FP_TUNE_X87_SGL].bad != 1 || res[FP_TUNE_SSE_FLT].bad != 0)
+    FAIL_TEST;
+  if(fptune_recommend(res, 1.0) == FP_TUNE_X87_SGL) FAIL_TEST;
+  fpsetsticky(0);
+
+  if(failures == 0) {
+    printf(" PASSED\n");
+    return 0;
+  }
+  else {
+    printf(" %d failures\n", failures);
+    return 1;
+  }
+#else
+  return 0;
+#endif
+}
+
+/* test_mask
+ *
+ * A thorough check of the exception masks will not be made in version 2.0.
+ */
+
+int test_mask(void) {
+  return 0;
+}
+
+/* test_functions
+ *
+ * Go through each of the functions implemented and check that they actually
+ * work. There are a number of checks to make:
+ *
+ * 1. Do fpget/setround fpget/setsticky fpget/setmask and fpget/setprecision
+ *    remember how they have been set?
+ *
+ * 2. Does fpsetround work? Do imprecise calculations generate expected
+ *    results?
+ *
+ * 3. Does fpgetsticky work? Are calculations that are supposed to generate
+ *    exceptions detectable?
+ *
+ * 4. Does fpsetprecision work? Are calculations that should work differently
+ *    under different precisions working as expected?
+ *
+ * 5. Does fpclass work? Is the correct class returned for a variety of 
+ *    classes of floating point number?
+ *
+ * 6. Does fpgetmask work? If a mask bit is set, is an exception generated?
+ *    (this probably won't be done).
+ *
+ * 7. Do fpget/setftz and fpget/setdaz work, and do fp_sites count
+ *    denormalised operands and underflows?
+ *
+ * 8. Does fpsetenv restore what fpgetenv saved?
+ *
+ * 9. Do classification and arithmetic agree with the software reference?
+ *
+ * 10. Does the software reference round twice as the x87 FPU does?
+ *
+ * 11. Does the exception profiler trap exceptions and step past them?
+ *
+ * 12. Do trapping regions come back to their start when an exception
+ *     is raised, with the environment restored?
+ *
+ * 13. Do the batch arithmetic functions find the elements raising each
+ *     exception?
+ *
+ * 14. Do the interval arithmetic functions give the tightest bounds?
+ *
+ * 15. Do the elementary functions bracket the true results?
+ *
+ * 16. Does batch arithmetic with the rounding direction as an argument
+ *     leave the rounding direction and sticky bits alone?
+ *
+ * 17. Does the queue of operations do each in its own environment?
+ *
+ * 18. Do sums and dot products come out the same however they are
+ *     split?
+ *
+ * 19. Are the errors of sums and products exact, and double-double
+ *     arithmetic within its bounds, whatever the precision control?
+ *
+ * 20. Do the BLAS kernels record exceptions against the right blocks,
+ *     with the same results however many threads they use?
+ *
+ * 21. Does the matrix multiply map exceptions and special values to
+ *     the tiles of the result they are in?
+ *
+ * 22. Does stochastic rounding choose each neighbour as often as it
+ *     should, and do the conversions round as the hardware does?
+ *
+ * 23. Does the precision tuner run a kernel at each precision and
+ *     measure its errors against the highest?
+ */
+
+int test_functions(void) {
+  int retval = 0;
+
+  retval |= test_settings();
+  retval |= test_rounding();
+  retval |= test_sticky();
+  retval |= test_precision();
+  retval |= test_class();
+  retval |= test_ftz();
+  retval |= test_env();
+  retval |= test_verify();
+  retval |= test_softfp();
+  retval |= test_try();
+  retval |= test_prof();
+  retval |= test_batch();
+  retval |= test_interval();
+  retval |= test_elemfn();
+  retval |= test_rnd();
+  retval |= test_queue();
+  retval |= test_reduce();
+  retval |= test_dd();
+  retval |= test_blas();
+  retval |= test_gemm();
+  retval |= test_sround();
+  retval |= test_tune();
+  retval |= test_mask();
+
+  return retval;
+}
+
+/* diffs_init(diffs, n)
+ *
+ * Set all the counts in diffs to zero, allocating the breakdowns by
+ * number for n numbers.
+ */
+
+void diffs_init(DIFFS *diffs, int n) {
+  memset(diffs, 0, sizeof(DIFFS));
+  diffs->numansdiffs = calloc(n, sizeof(int));
+  diffs->numxdiffs = calloc(n, sizeof(int));
+  diffs->numt = calloc(n, sizeof(int));
+  if(diffs->numansdiffs == NULL || diffs->numxdiffs == NULL
+     || diffs->numt == NULL) {
+    perror("Memory allocation");
+    abort();
+  }
+}
+
+/* diffs_add(total, diffs, n)
+ *
+ * Add the counts in diffs to those in total, then free diffs.
+ */
+
+void diffs_add(DIFFS *total, DIFFS *diffs, int n) {
+  int i;
+
+  total->nopdiffs += diffs->nopdiffs;
+  total->nansdiffs += diffs->nansdiffs;
+  total->nxdiffs += diffs->nxdiffs;
+  total->nclsdiffs += diffs->nclsdiffs;
+  for(i = 0; i < n; i++) {
+    total->numansdiffs[i] += diffs->numansdiffs[i];
+    total->numxdiffs[i] += diffs->numxdiffs[i];
+    total->numt[i] += diffs->numt[i];
+  }
+  for(i = 0; i < 4; i++) {
+    total->opansdiffs[i] += diffs->opansdiffs[i];
+    total->opxdiffs[i] += diffs->opxdiffs[i];
+    total->opt[i] += diffs->opt[i];
+    total->rndansdiffs[i] += diffs->rndansdiffs[i];
+    total->rndxdiffs[i] += diffs->rndxdiffs[i];
+    total->rndt[i] += diffs->rndt[i];
+  }
+  for(i = 0; i < 16; i++) {
+    total->oprndansdiffs[i] += diffs->oprndansdiffs[i];
+    total->oprndxdiffs[i] += diffs->oprndxdiffs[i];
+    total->oprndt[i] += diffs->oprndt[i];
+  }
+  free(diffs->numansdiffs);
+  free(diffs->numxdiffs);
+  free(diffs->numt);
+}
+
+/* read_lines(fp, nlines, buf) -> lines
+ *
+ * Read the rest of the comparison file into memory, returning an
+ * array of its first nlines non-blank lines. The memory holding the
+ * lines is returned in *buf, to be freed with the array.
+ */
+
+char **read_lines(FILE *fp, long nlines, char **buf) {
+  size_t size = 1 << 16, len = 0, got;
+  char **lines;
+  char *cp;
+  long i;
+
+  (*buf) = malloc(size);
+  lines = malloc(nlines * sizeof(char *));
+  if((*buf) == NULL || lines == NULL) {
+    perror("Memory allocation");
+    abort();
+  }
+  while((got = fread((*buf) + len, 1, size - len - 1, fp)) > 0) {
+    len += got;
+    if(len == size - 1) {
+      size *= 2;
+      (*buf) = realloc(*buf, size);
+      if((*buf) == NULL) {
+	perror("Memory allocation");
+	abort();
+      }
+    }
+  }
+  (*buf)[len] = '\0';
+
+  for(cp = (*buf), i = 0; i < nlines; i++) {
+    char *end;
+
+    while((*cp) == '\n' || (*cp) == '\r') cp++;
+    if((*cp) == '\0') {
+      fprintf(stderr, "Problem reading comparison file: expected %ld "
+	      "calculations, found %ld\n", nlines, i);
+      abort();
+    }
+    lines[i] = cp;
+    end = strchr(cp, '\n');
+    if(end == NULL) {
+      cp += strlen(cp);
+    }
+    else {
+      (*end) = '\0';
+      cp = end + 1;
+    }
+  }
+
+  return lines;
+}
+
+/* soft_reference(src, k, ref)
+ *
+ * Do the kth calculation on the numbers in src with the software
+ * reference, as the unit the compiler uses for double precision
+ * arithmetic would: the SSE unit, or the x87 FPU with double
+ * precision control, as op() sets it.
+ */
+
+#ifdef CIIEEEFP_TEST
+void soft_reference(const SOURCE *src, long k, REFERENCE *ref) {
+  static const softfp_op ops[4] = {
+    SOFTFP_ADD, SOFTFP_SUB, SOFTFP_DIV, SOFTFP_MUL
+  };
+  uint64_t a, b, ans;
+  fp_except x = 0;
+  long n = src->n;
+
+  ref->num1 = src->numbers[k / (n * 16)];
+  ref->num2 = src->numbers[(k / 16) % n];
+  ref->op = (int)((k / 4) % 4);
+  ref->rnd = (int)(k % 4);
+  memcpy(&a, &ref->num1, sizeof(double));
+  memcpy(&b, &ref->num2, sizeof(double));
+#ifdef __SSE2_MATH__
+  softfp_batch64(ops[ref->op], FP_UNIT_SSE, fpdir[ref->rnd], FP_PC_DBL,
+		 &a, &b, 1, &ans, &x);
+#else
+  softfp_batch64(ops[ref->op], FP_UNIT_X87, fpdir[ref->rnd], FP_PC_DBL,
+		 &a, &b, 1, &ans, &x);
+#endif
+  memcpy(&ref->ans, &ans, sizeof(double));
+  ref->cls = softfp_class64(ans);
+  ref->x = ref_except(x);
+}
+#endif
+
+/* get_reference(src, k, ref)
+ *
+ * Get the kth calculation from a comparison file, or from the
+ * software reference.
+ */
+
+void get_reference(const SOURCE *src, long k, REFERENCE *ref) {
+  if(src->records != NULL) get_record(src->records + (k * REF_RECORD), ref);
+  else if(src->lines != NULL) parse_line(src->lines[k], ref);
+#ifdef CIIEEEFP_TEST
+  else soft_reference(src, k, ref);
+#endif
+}
+
+/* calculate(numbers, n, i, src, out, diffs)
+ *
+ * Operate on numbers[i] with each of the n numbers using each
+ * operator in each rounding direction, comparing with the calculations
+ * in src if src is not NULL, and count the differences in diffs.
+ */
+
+void calculate(double *numbers, int n, int i, const SOURCE *src, FILE *out,
+	       DIFFS *diffs) {
+  int j, o, r;
+  REFERENCE ref;
+
+  for(j = 0; j < n; j++) {
+    for(o = 0; o <= 3; o++) {
+      for(r = 0; r <= 3; r++) {
+	int pansdiffs = diffs->nansdiffs;
+	int pxdiffs = diffs->nxdiffs;
+
+	if(src != NULL) {
+	  get_reference(src, (((long)i * n + j) * 16) + (o * 4) + r, &ref);
+	}
+	op(numbers[i], numbers[j], o, r, src == NULL ? NULL : &ref,
+	   out, diffs);
+
+	if(pansdiffs != diffs->nansdiffs) {
+	  diffs->numansdiffs[i]++;
+	  diffs->numansdiffs[j]++;
+	  diffs->opansdiffs[o]++;
+	  diffs->rndansdiffs[r]++;
+	  diffs->oprndansdiffs[(o * 4) + r]++;
+	}
+	if(pxdiffs != diffs->nxdiffs) {
+	  diffs->numxdiffs[i]++;
+	  diffs->numxdiffs[j]++;
+	  diffs->opxdiffs[o]++;
+	  diffs->rndxdiffs[r]++;
+	  diffs->oprndxdiffs[(o * 4) + r]++;
+	}
+	diffs->numt[i]++;
+	diffs->numt[j]++;
+	diffs->opt[o]++;
+	diffs->rndt[r]++;
+	diffs->oprndt[(o * 4) + r]++;
+      }
+    }
+  }
+}
+
+/* worker(arg)
+ *
+ * Do one thread's share of a comparison. The floating point state is
+ * per-thread, so each worker's calculations are unaffected by the
+ * others'. Differences are printed to memory, so that they can be
+ * output in the same order as a single threaded comparison.
+ */
+
+void *worker(void *arg) {
+  WORKER *w = (WORKER *)arg;
+  FILE *out;
+  int i;
+
+  out = open_memstream(&w->text, &w->textlen);
+  if(out == NULL) {
+    perror("open_memstream");
+    abort();
+  }
+  for(i = w->first; i < w->last; i++) {
+    calculate(w->numbers, w->n, i, w->src, out, &w->diffs);
+  }
+  fclose(out);
+
+  return NULL;
+}
+
+/* compare(numbers, n, src, nthreads, diffs)
+ *
+ * Compare all the calculations with those in src, sharing the
+ * numbers out among nthreads threads, then print their differences
+ * and add their counts to diffs.
+ */
+
+void compare(double *numbers, int n, const SOURCE *src, int nthreads,
+	     DIFFS *diffs) {
+  pthread_t *threads;
+  WORKER *workers;
+  int t;
+
+  if(nthreads > n) nthreads = n;
+  if(nthreads <= 1) {
+    for(t = 0; t < n; t++) {
+      calculate(numbers, n, t, src, stdout, diffs);
+    }
+    return;
+  }
+
+  threads = malloc(nthreads * sizeof(pthread_t));
+  workers = malloc(nthreads * sizeof(WORKER));
+  if(threads == NULL || workers == NULL) {
+    perror("Memory allocation");
+    abort();
+  }
+  for(t = 0; t < nthreads; t++) {
+    workers[t].first = (int)(((long)n * t) / nthreads);
+    workers[t].last = (int)(((long)n * (t + 1)) / nthreads);
+    workers[t].n = n;
+    workers[t].numbers = numbers;
+    workers[t].src = src;
+    workers[t].text = NULL;
+    workers[t].textlen = 0;
+    diffs_init(&workers[t].diffs, n);
+    if(pthread_create(&threads[t], NULL, worker, &workers[t]) != 0) {
+      perror("pthread_create");
+      abort();
+    }
+  }
+  for(t = 0; t < nthreads; t++) {
+    pthread_join(threads[t], NULL);
+    fwrite(workers[t].text, 1, workers[t].textlen, stdout);
+    free(workers[t].text);
+    diffs_add(diffs, &workers[t].diffs, n);
+  }
+
+  free(threads);
+  free(workers);
+}
+
+/* read_numbers(fp, file, n) -> numbers
+ *
+ * Read the numbers at the start of a text comparison file, returning
+ * them in a new array and how many there are in *n.
+ */
+
+double *read_numbers(FILE *fp, const char *file, int *n) {
+  double *numbers;
+  int i;
+
+  if(fscanf(fp, "Numbers: %d", n) != 1 || (*n) < 0) {
+    printf("Problem reading comparison file %s\n", file);
+    abort();
+  }
+  numbers = malloc((*n) * sizeof(double));
+  if(numbers == NULL) {
+    perror("Memory allocation");
+    abort();
+  }
+  for(i = 0; i < (*n); i++) {
+    if(fscanf(fp, "%lf", &numbers[i]) != 1) {
+      printf("Problem reading comparison file %s\n", file);
+      abort();
+    }
+  }
+  return numbers;
+}
+
+/* map_binary(file, n, size) -> mapped file
+ *
+ * Map a binary comparison file into memory read-only, check its
+ * header and size, and return the number of numbers in it in *n and
+ * the size of the mapping in *size.
+ */
+
+const unsigned char *map_binary(const char *file, int *n, size_t *size) {
+  const unsigned char *map;
+  struct stat st;
+  int fd;
+  uint32_t nn;
+  size_t rest;
+
+  fd = open(file, O_RDONLY);
+  if(fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "Error opening comparison file ");
+    perror(file);
+    abort();
+  }
+  (*size) = (size_t)st.st_size;
+  if((*size) < REF_HEADER) {
+    fprintf(stderr, "Problem reading comparison file %s: too short\n", file);
+    abort();
+  }
+  map = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED) {
+    perror("mmap");
+    abort();
+  }
+  close(fd);
+
+  nn = get_uint32(map + REF_MAGICLEN + 4);
+  rest = (*size) - REF_HEADER;	/* The sizes are checked by dividing,
+				   so that a corrupt count cannot make
+				   them overflow */
+  if(get_uint32(map + REF_MAGICLEN) != REF_RECORD || nn > 0x7fffffffU
+     || nn > rest / 8
+     || (nn > 0 && (rest - nn * (size_t)8) / nn / (16 * REF_RECORD) < nn)) {
+    fprintf(stderr, "Problem reading comparison file %s: bad header or "
+	    "truncated\n", file);
+    abort();
+  }
+  (*n) = (int)nn;
+  return map;
+}
+
+/* convert(text_file, binary_file) -> exit status
+ *
+ * Convert a text comparison file (as printed by this program given a
+ * list of numbers) to the binary format.
+ */
+
+int convert(const char *text_file, const char *binary_file) {
+  FILE *in, *out;
+  double *numbers;
+  char **lines;
+  char *linebuf;
+  unsigned char buf[REF_HEADER];
+  REFERENCE ref;
+  long k, nlines;
+  int i, n;
+
+  in = fopen(text_file, "r");
+  if(in == NULL) {
+    fprintf(stderr, "Error opening comparison file ");
+    perror(text_file);
+    abort();
+  }
+  numbers = read_numbers(in, text_file, &n);
+  nlines = (long)n * n * 16;
+  lines = read_lines(in, nlines, &linebuf);
+  fclose(in);
+
+  out = fopen(binary_file, "wb");
+  if(out == NULL) {
+    fprintf(stderr, "Error opening output file ");
+    perror(binary_file);
+    abort();
+  }
+  memset(buf, 0, REF_HEADER);
+  memcpy(buf, REF_MAGIC, REF_MAGICLEN);
+  put_uint32(REF_RECORD, buf + REF_MAGICLEN);
+  put_uint32((uint32_t)n, buf + REF_MAGICLEN + 4);
+  fwrite(buf, 1, REF_HEADER, out);
+  for(i = 0; i < n; i++) {
+    put_bits(numbers[i], buf);
+    fwrite(buf, 1, 8, out);
+  }
+  for(k = 0; k < nlines; k++) {
+    parse_line(lines[k], &ref);
+    put_record(&ref, buf);
+    fwrite(buf, 1, REF_RECORD, out);
+  }
+  if(fclose(out) != 0) {
+    perror(binary_file);
+    return 1;
+  }
+
+  free(numbers);
+  free(lines);
+  free(linebuf);
+  return 0;
+}
+
+/* main(argc, argv)
+ *
+ * A list of numbers is given as arguments. Each number is then
+ * operated on each number using each operator in each rounding
+ * direction. With -cmp, the numbers and the results of each
+ * calculation are read from a file and compared with those here,
+ * using the number of threads given with -j, or by default one per
+ * CPU. The file may be text, as printed by this program, or binary,
+ * as converted from text with -convert, in which case it is mapped
+ * into memory rather than read. -soft compares the calculations on
+ * the numbers given with those done by the software reference
+ * instead of a file. -verify checks classification of all single
+ * precision numbers and a sample of arithmetic against the software
+ * reference.
+ */
+
+int main(int argc, char **argv) {
+  double *numbers;
+  int i, n, r, o;
+  int compare_mode = 0;
+  int soft = 0;
+  int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  DIFFS d;
+  SOURCE src;
+  char *compare_file;
+  char *linebuf = NULL;
+  const unsigned char *map = NULL;
+  size_t mapsize = 0;
+  char magic[REF_MAGICLEN];
+  FILE *fp = NULL;
+
+  if(argc == 1) {
+    fprintf(stderr, "Usage: %s [-test | -cmp <file> [-j <threads>] | "
+	    "-convert <text file> <binary file> |\n\t-verify [-j <threads>] "
+	    "[<pairs>] | -soft [-j <threads>] <list of floats...> |\n\t"
+	    "<list of floats....>]\n",
+	    argv[0]);
+    exit(1);
+  }
+  
+  if(argc >= 2) {
+    if(strcmp(argv[1], "-cmp") == 0) {
+      if(argc < 3) {
+	fprintf(stderr, "You must supply a file to compare with\n");
+	exit(1);
+      }
+      else if(argc > 3 && strncmp(argv[3], "-j", 2) == 0) {
+	int narg = (argv[3][2] == '\0') ? 4 : 3;
+
+	if(argc <= narg
+	   || (nthreads = atoi(narg == 4 ? argv[4] : argv[3] + 2)) < 1) {
+	  fprintf(stderr, "You must supply a number of threads with -j\n");
+	  exit(1);
+	}
+	if(argc > narg + 1) {
+	  fprintf(stderr, "WARNING: ignoring arguments after %s\n",
+		  argv[narg]);
+	}
+      }
+      else if(argc > 3) {
+	fprintf(stderr, "WARNING: ignoring arguments after %s\n", argv[2]);
+      }
+      compare_mode = 1;
+      compare_file = argv[2];
+      fp = fopen(compare_file, "r");
+      if(fp == NULL) {
+	fprintf(stderr, "Error opening comparison file ");
+	perror(compare_file);
+	abort();
+      }
+    }
+    else if(strcmp(argv[1], "-test") == 0) {
+      return test_functions();
+    }
+    else if(strcmp(argv[1], "-convert") == 0) {
+      if(argc != 4) {
+	fprintf(stderr, "You must supply a text file to convert and a "
+		"binary file to write\n");
+	exit(1);
+      }
+      return convert(argv[2], argv[3]);
+    }
+#ifdef CIIEEEFP_TEST
+    else if(strcmp(argv[1], "-verify") == 0) {
+      long samples = VERIFY_SAMPLES;
+
+      for(i = 2; i < argc; i++) {
+	if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+	  nthreads = atoi(argv[++i]);
+	}
+	else if(strncmp(argv[i], "-j", 2) == 0) {
+	  nthreads = atoi(argv[i] + 2);
+	}
+	else {
+	  samples = atol(argv[i]);
+	}
+      }
+      if(nthreads < 1 || samples < 0) {
+	fprintf(stderr, "Invalid number of threads or samples\n");
+	exit(1);
+      }
+      return verify(nthreads, samples);
+    }
+    else if(strcmp(argv[1], "-soft") == 0) {
+      for(soft = 2; soft < argc && strncmp(argv[soft], "-j", 2) == 0;
+	  soft++) {
+	if(argv[soft][2] == '\0' && soft + 1 < argc) {
+	  nthreads = atoi(argv[++soft]);
+	}
+	else {
+	  nthreads = atoi(argv[soft] + 2);
+	}
+      }
+      if(nthreads < 1) {
+	fprintf(stderr, "You must supply a number of threads with -j\n");
+	exit(1);
+      }
+      compare_mode = 1;
+    }
+#endif
+  }
+
+  src.lines = NULL;
+  src.records = NULL;
+  src.numbers = NULL;
+  src.n = 0;
+  if(compare_mode) {
+    if(soft) {
+      n = argc - soft;
+      numbers = malloc(n * sizeof(double));
+      if(numbers == NULL) {
+	perror("Memory allocation");
+	abort();
+      }
+      for(i = 0; i < n; i++) {
+	numbers[i] = atof(argv[soft + i]);
+      }
+      src.numbers = numbers;
+      src.n = n;
+    }
+    else if(fread(magic, 1, REF_MAGICLEN, fp) == REF_MAGICLEN
+       && memcmp(magic, REF_MAGIC, REF_MAGICLEN) == 0) {
+      fclose(fp);
+      map = map_binary(compare_file, &n, &mapsize);
+      numbers = malloc(n * sizeof(double));
+      if(numbers == NULL) {
+	perror("Memory allocation");
+	abort();
+      }
+      for(i = 0; i < n; i++) {
+	numbers[i] = get_bits(map + REF_HEADER + (i * 8));
+      }
+      src.records = map + REF_HEADER + (n * (size_t)8);
+    }
+    else {
+      rewind(fp);
+      numbers = read_numbers(fp, compare_file, &n);
+      src.lines = read_lines(fp, (long)n * n * 16, &linebuf);
+      fclose(fp);
+    }
+    diffs_init(&d, n);
+    compare(numbers, n, &src, nthreads, &d);
+  }
+  else {
+    n = argc - 1;
+    printf("Numbers: %d\n", n);
+    numbers = malloc(n * sizeof(double));
+    if(numbers == NULL) {
+      perror("Memory allocation");
+      abort();
+    }
+    for(i = 0; i < n; i++) {
+      numbers[i] = atof(argv[i + 1]);
+      printf("%s\n", argv[i + 1]);
+    }
+    diffs_init(&d, n);
+    for(i = 0; i < n; i++) {
+      calculate(numbers, n, i, NULL, stdout, &d);
     }
   }
 
   if(compare_mode) {
-    fclose(fp);
-    printf("Summary of differences between comparison file and this run:\n");
+    printf("Summary of differences between %s and this run:\n",
+	   soft ? "software reference" : "comparison file");
     printf("\t(Each is a count of the number of calculations concerned)\n");
     printf("\t%d\t-- different representation of one or more operands\n",
-	   nopdiffs);
+	   d.nopdiffs);
     printf("\t%d\t-- different answer where operands represented the same\n",
-	   nansdiffs);
+	   d.nansdiffs);
     printf("\t%d\t-- different exceptions where answer the same\n",
-	   nxdiffs);
+	   d.nxdiffs);
     printf("\t%d\t-- different fpclasses where answer the same\n",
-	   nclsdiffs);
+	   d.nclsdiffs);
     printf("Breakdown of differences by number, operator and rounding "
 	   "direction:\n");
     printf("\t% 8s % 15s % 6s % 9s % 5s\n", "Type", "Data", "Answer",
 	   "Exception", "Total");
     for(i = 0; i < n; i++) {
       printf("\t% 8s % 15g % 6d % 9d % 5d\n", "Number", numbers[i],
-	     numansdiffs[i], numxdiffs[i], numt[i]);
+	     d.numansdiffs[i], d.numxdiffs[i], d.numt[i]);
     }
     for(i = 0; i < 4; i++) {
       printf("\t% 8s % 15s % 6d % 9d % 5d\n", "Operator", operators[i],
-	     opansdiffs[i], opxdiffs[i], opt[i]);
+	     d.opansdiffs[i], d.opxdiffs[i], d.opt[i]);
     }
     for(i = 0; i < 4; i++) {
       printf("\t% 8s % 15s % 6d % 9d % 5d\n", "Round", rnddir[i],
-	     rndansdiffs[i], rndxdiffs[i], rndt[i]);
+	     d.rndansdiffs[i], d.rndxdiffs[i], d.rndt[i]);
     }
     for(o = 0; o < 4; o++) {
       for(r = 0; r < 4; r++) {
 	printf("\t% 8s % 14s%s % 6d % 9d % 5d\n", "Op&Round", operators[o],
-	       rnddir[r], oprndansdiffs[(o * 4) + r], oprndxdiffs[(o * 4) + r],
-	       oprndt[(o * 4) + r]);
+	       rnddir[r], d.oprndansdiffs[(o * 4) + r],
+	       d.oprndxdiffs[(o * 4) + r], d.oprndt[(o * 4) + r]);
       }
     }
   }
 
   free(numbers);
-  free(numansdiffs);
-  free(numxdiffs);
-  free(numt);
+  free(d.numansdiffs);
+  free(d.numxdiffs);
+  free(d.numt);
+  free(src.lines);
+  free(linebuf);
+  if(map != NULL) munmap((void *)map, mapsize);
 
   return 0;
 }
@@ -28,7 +28,8 @@
 */
 
 /* This file contains functions to access all the Intel x87 FPU
- * commands needed to implement the functions in CIieeefp.  This is
+ * commands, and the SSE MXCSR commands, needed to implement the
+ * functions in CIieeefp.  This is
  * then the only file requiring its assembly to be hacked.
  */
 
@@ -89,19 +90,75 @@ void x87FPU_fldcw(x87FPU_control_word cw) {
  * supplied as argument. This instruction sets the condition code bits
  * in the x87 FPU status word to reflect the class of floating point
  * number on the top of the stack. The add instruction is there to get
- * num put onto the stack so that fxam can be applied to it.
+ * num put onto the stack so that fxam can be applied to it. The asm
+ * statements are volatile, as otherwise the compiler may drop the pop,
+ * whose result is not used, leaving num on the stack.
  */
 
 x87FPU_status_word x87FPU_fxam(double num) {
   x87FPU_status_word sw;
 
-  asm("fldl %[number]" :: [number] "m" (num));
+  asm volatile("fldl %[number]" :: [number] "m" (num));
 				// push num on fp stack
-  asm("fxam");                  // set condition codes
-  asm("fstsw %[status]" : [status] "=m" (sw));
+  asm volatile("fxam");         // set condition codes
+  asm volatile("fstsw %[status]" : [status] "=m" (sw));
 				// store fp status register
-  asm("fstpl %[popnum]" : [popnum] "=m" (num));
+  asm volatile("fstpl %[popnum]" : [popnum] "=m" (num));
 				// pop fp stack
 
   return sw;
 }
+
+/* x87FPU_fnstenv(env)
+ *
+ * Perform the fnstenv instruction, storing the x87 FPU environment --
+ * control word, status word, tag word and the pointers to the last
+ * instruction and operand -- in env. As well as storing the
+ * environment, fnstenv masks all exceptions, so the control word is
+ * then loaded back from the stored copy with fldcw. (The control word
+ * is the first thing in the environment.)
+ */
+
+void x87FPU_fnstenv(x87FPU_env *env) {
+  asm volatile("fnstenv %[env]\n\t"
+	       "fldcw %[env]" : [env] "=m" (*env));
+}
+
+/* x87FPU_fldenv(env)
+ *
+ * Perform the fldenv instruction, loading the whole x87 FPU
+ * environment from env. This is the only way of setting the exception
+ * flags in the status word to anything other than all clear. Any
+ * exception flag set in env whose exception is unmasked will be
+ * raised by the next floating point instruction.
+ */
+
+void x87FPU_fldenv(const x87FPU_env *env) {
+  asm volatile("fldenv %[env]" :: [env] "m" (*env));
+}
+
+/* SSE_stmxcsr() -> mxcsr
+ *
+ * Perform the stmxcsr instruction, returning the SSE control and
+ * status register (MXCSR). This is the SSE unit's equivalent of both
+ * the x87 control word and the exception flags of the status word.
+ */
+
+SSE_mxcsr SSE_stmxcsr(void) {
+  SSE_mxcsr mxcsr;
+
+  asm volatile("stmxcsr %[mxcsr]" : [mxcsr] "=m" (mxcsr));
+
+  return mxcsr;
+}
+
+/* SSE_ldmxcsr(mxcsr)
+ *
+ * Perform the ldmxcsr instruction, setting the MXCSR to that supplied
+ * as argument. Unlike fldcw, this sets the exception flags as well as
+ * the controls, and there is no need to clear the flags first.
+ */
+
+void SSE_ldmxcsr(SSE_mxcsr mxcsr) {
+  asm volatile("ldmxcsr %[mxcsr]" :: [mxcsr] "m" (mxcsr));
+}
@@ -40,5 +40,9 @@ extern x87FPU_control_word x87FPU_fstcw(void);
 extern void x87FPU_fclex(void);
 extern void x87FPU_fldcw(x87FPU_control_word cw);
 extern x87FPU_status_word x87FPU_fxam(double num);
+extern void x87FPU_fnstenv(x87FPU_env *env);
+extern void x87FPU_fldenv(const x87FPU_env *env);
+extern SSE_mxcsr SSE_stmxcsr(void);
+extern void SSE_ldmxcsr(SSE_mxcsr mxcsr);
 
 #endif
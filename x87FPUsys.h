@@ -36,5 +36,25 @@
 
 typedef unsigned short x87FPU_status_word;
 typedef unsigned short x87FPU_control_word;
+typedef unsigned int SSE_mxcsr;
+
+/* The x87 FPU environment as stored by fnstenv and loaded by fldenv
+   in 32-bit protected mode, which is also the format used in 64-bit
+   mode. */
+
+typedef struct {
+  x87FPU_control_word control_word;
+  unsigned short reserved1;
+  x87FPU_status_word status_word;
+  unsigned short reserved2;
+  unsigned short tag_word;
+  unsigned short reserved3;
+  unsigned int instruction_pointer;
+  unsigned short code_segment;
+  unsigned short opcode;
+  unsigned int operand_pointer;
+  unsigned short data_segment;
+  unsigned short reserved4;
+} x87FPU_env;
 
 #endif
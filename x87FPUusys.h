@@ -71,4 +71,26 @@
 
 #define CW_XM  0x003FU		/* All exception masks */
 
+/* MXCSR (SSE control and status register) access macros */
+
+				/* 0xFFFF0000U reserved */
+#define MX_FZ  0x8000U		/* Flush to zero */
+#define MX_RC  0x6000U		/* Rounding control */
+#define MX_PM  0x1000U		/* Precision exception mask */
+#define MX_UM  0x0800U		/* Underflow exception mask */
+#define MX_OM  0x0400U		/* Overflow exception mask */
+#define MX_ZM  0x0200U		/* Division by zero exception mask */
+#define MX_DM  0x0100U		/* Denormalisation exception mask */
+#define MX_IM  0x0080U		/* Invalid operation exception mask */
+#define MX_DAZ 0x0040U		/* Denormals are zeros */
+#define MX_PE  0x0020U		/* Precision exception flag */
+#define MX_UE  0x0010U		/* Underflow exception flag */
+#define MX_OE  0x0008U		/* Overflow exception flag */
+#define MX_ZE  0x0004U		/* Division by zero exception flag */
+#define MX_DE  0x0002U		/* Denormalisation exception flag */
+#define MX_IE  0x0001U		/* Invalid operation exception flag */
+
+#define MX_XM  0x1F80U		/* All exception masks */
+#define MX_XF  0x003FU		/* All exception flags */
+
 #endif
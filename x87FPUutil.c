@@ -31,6 +31,7 @@
  * in the x87 FPU status and control words.
  */
 
+#include <stdio.h>
 #include "x87FPUusys.h"
 
 /* get_X_word_flag(Yw, flag) -> flag value
@@ -98,6 +99,37 @@ x87FPU_control_word set_control_word_flag(x87FPU_control_word cw,
   return (cw | cw_value);
 }
 
+/* get_mxcsr_flag(mxcsr, flag) -> flag value
+ * set_mxcsr_flag(mxcsr, flag, value) -> new mxcsr
+ *
+ * The equivalents of get_control_word_flag() and
+ * set_control_word_flag() for the SSE MXCSR, using the MX_ macros
+ * from x87FPUusys.h.
+ */
+
+unsigned get_mxcsr_flag(SSE_mxcsr mxcsr, SSE_mxcsr flag) {
+  mxcsr &= flag;
+  while((flag & 0x0001U) == 0x0000U) {
+    mxcsr >>= 1;
+    flag >>= 1;
+  }
+
+  return mxcsr;
+}
+
+SSE_mxcsr set_mxcsr_flag(SSE_mxcsr mxcsr, SSE_mxcsr flag, unsigned value) {
+  SSE_mxcsr dummy_flag = flag;
+
+  mxcsr &= (~flag);
+
+  while((dummy_flag & 0x0001U) == 0x0000U) {
+    value <<= 1;
+    dummy_flag >>= 1;
+  }
+
+  return (mxcsr | (value & flag));
+}
+
 /* print_status_word(sw)
  *
  * Print out the various flag settings for the status word.
@@ -143,3 +175,30 @@ void print_control_word(x87FPU_control_word cw) {
 	 get_control_word_flag(cw, CW_DM),
 	 get_control_word_flag(cw, CW_IM));
 }
+
+/* print_mxcsr(mxcsr)
+ *
+ * Print out the various flag settings for the SSE MXCSR.
+ */
+
+void print_mxcsr(SSE_mxcsr mxcsr) {
+  printf("SSE MXCSR:\n\tFlush to Zero: %u\n\tRounding Control: %u\n"
+	 "\tException Masks: IMP[%u] UF[%u] OF[%u] DZ[%u] DNML[%u] INV[%u]\n"
+	 "\tDenormals are Zeros: %u\n\tException Flags: IMP[%u] UF[%u] "
+	 "OF[%u] DZ[%u] DNML[%u] INV[%u]\n",
+	 get_mxcsr_flag(mxcsr, MX_FZ),
+	 get_mxcsr_flag(mxcsr, MX_RC),
+	 get_mxcsr_flag(mxcsr, MX_PM),
+	 get_mxcsr_flag(mxcsr, MX_UM),
+	 get_mxcsr_flag(mxcsr, MX_OM),
+	 get_mxcsr_flag(mxcsr, MX_ZM),
+	 get_mxcsr_flag(mxcsr, MX_DM),
+	 get_mxcsr_flag(mxcsr, MX_IM),
+	 get_mxcsr_flag(mxcsr, MX_DAZ),
+	 get_mxcsr_flag(mxcsr, MX_PE),
+	 get_mxcsr_flag(mxcsr, MX_UE),
+	 get_mxcsr_flag(mxcsr, MX_OE),
+	 get_mxcsr_flag(mxcsr, MX_ZE),
+	 get_mxcsr_flag(mxcsr, MX_DE),
+	 get_mxcsr_flag(mxcsr, MX_IE));
+}
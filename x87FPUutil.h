@@ -41,7 +41,11 @@ extern unsigned get_control_word_flag (x87FPU_control_word cw,
 extern x87FPU_control_word set_control_word_flag(x87FPU_control_word cw,
 						 x87FPU_control_word flag,
 						 unsigned value);
+extern unsigned get_mxcsr_flag(SSE_mxcsr mxcsr, SSE_mxcsr flag);
+extern SSE_mxcsr set_mxcsr_flag(SSE_mxcsr mxcsr, SSE_mxcsr flag,
+				unsigned value);
 extern void print_status_word(x87FPU_status_word sw);
 extern void print_control_word(x87FPU_control_word cw);
+extern void print_mxcsr(SSE_mxcsr mxcsr);
 
 #endif